@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2015 University of Chicago.
+ * See COPYRIGHT notice in top-level directory.
+ *
+ */
+
+#ifndef __DARSHAN_IOURING_LOG_FORMAT_H
+#define __DARSHAN_IOURING_LOG_FORMAT_H
+
+/* current log format version, to support backwards compatibility */
+#define DARSHAN_IOURING_VER 1
+
+#define IOURING_COUNTERS \
+    /* count of openat operations submitted */\
+    X(IOURING_OPENS) \
+    /* count of read operations submitted (INCLUDING readv) */\
+    X(IOURING_READS) \
+    /* count of write operations submitted (INCLUDING writev) */\
+    X(IOURING_WRITES) \
+    /* count of readv operations submitted */\
+    X(IOURING_READVS) \
+    /* count of writev operations submitted */\
+    X(IOURING_WRITEVS) \
+    /* count of fsync operations submitted */\
+    X(IOURING_FSYNCS) \
+    /* count of close operations submitted */\
+    X(IOURING_CLOSES) \
+    /* count of operations that completed with an error */\
+    X(IOURING_ERRORS) \
+    /* count of operations whose completion (or, in the <IO_URING> record, submission) was not observed */\
+    X(IOURING_UNOBSERVED) \
+    /* total bytes read */\
+    X(IOURING_BYTES_READ) \
+    /* total bytes written */\
+    X(IOURING_BYTES_WRITTEN) \
+    /* maximum byte (offset) read */\
+    X(IOURING_MAX_BYTE_READ) \
+    /* maximum byte (offset) written */\
+    X(IOURING_MAX_BYTE_WRITTEN) \
+    /* sum of the file's in-flight operations seen by each submission */\
+    X(IOURING_QUEUE_DEPTH_SUM) \
+    /* maximum number of the file's operations in flight at once */\
+    X(IOURING_MAX_QUEUE_DEPTH) \
+    /* end of counters */\
+    X(IOURING_NUM_INDICES)
+
+#define IOURING_F_COUNTERS \
+    /* timestamp of first operation submission */\
+    X(IOURING_F_SUBMIT_START_TIMESTAMP) \
+    /* timestamp of last operation completion */\
+    X(IOURING_F_COMPLETE_END_TIMESTAMP) \
+    /* cumulative submission to completion latency of reads */\
+    X(IOURING_F_READ_LATENCY) \
+    /* cumulative submission to completion latency of writes */\
+    X(IOURING_F_WRITE_LATENCY) \
+    /* cumulative submission to completion latency of opens, fsyncs, closes */\
+    X(IOURING_F_META_LATENCY) \
+    /* longest submission to completion latency of a read */\
+    X(IOURING_F_MAX_READ_LATENCY) \
+    /* longest submission to completion latency of a write */\
+    X(IOURING_F_MAX_WRITE_LATENCY) \
+    /* end of counters */\
+    X(IOURING_F_NUM_INDICES)
+
+#define X(a) a,
+/* integer counters for the "IOURING" module */
+enum darshan_iouring_indices
+{
+    IOURING_COUNTERS
+};
+
+/* floating point counters for the "IOURING" module */
+enum darshan_iouring_f_indices
+{
+    IOURING_F_COUNTERS
+};
+#undef X
+
+/* the darshan_iouring_file structure encompasses the high-level data/counters
+ * which would actually be logged to file by Darshan for the "IOURING"
+ * module. This logs the following data for each record:
+ *      - a corresponding Darshan record identifier
+ *      - the rank of the process responsible for the record
+ *      - integer I/O counters (operation counts, I/O sizes, etc.)
+ *      - floating point I/O counters (timestamps, cumulative timers, etc.)
+ */
+struct darshan_iouring_file
+{
+    struct darshan_base_record base_rec;
+    int64_t counters[IOURING_NUM_INDICES];
+    double fcounters[IOURING_F_NUM_INDICES];
+};
+
+#endif /* __DARSHAN_IOURING_LOG_FORMAT_H */
@@ -24,7 +24,7 @@
  * log format version, NOT when a new version of a module record is
  * introduced -- we have module-specific versions to handle that
  */
-#define DARSHAN_LOG_VERSION "3.10"
+#define DARSHAN_LOG_VERSION "3.20"
 
 /* magic number for validating output files and checking byte order */
 #define DARSHAN_MAGIC_NR 6567223
@@ -49,6 +49,15 @@ enum darshan_comp_type
     DARSHAN_ZLIB_COMP,
     DARSHAN_BZIP2_COMP,
     DARSHAN_NO_COMP, 
+    DARSHAN_ZSTD_COMP,
+    DARSHAN_LZ4_COMP,
+};
+
+/* hash function used to generate the record ids in a darshan log file */
+enum darshan_hash_type
+{
+    DARSHAN_JENKINS_HASH, /* darshan_hash() from lookup8.c */
+    DARSHAN_WYHASH_HASH,
 };
 
 typedef uint64_t darshan_record_id;
@@ -72,6 +81,10 @@ struct darshan_header
     char version_string[8];
     int64_t magic_nr;
     unsigned char comp_type;
+    /* NOTE: hash_type occupies what used to be padding, which was always
+     * zeroed (i.e., DARSHAN_JENKINS_HASH) in earlier logs
+     */
+    unsigned char hash_type;
     uint32_t partial_flag;
     struct darshan_log_map name_map;
     struct darshan_log_map mod_map[DARSHAN_MAX_MODS];
@@ -97,6 +110,18 @@ struct darshan_name_record
     char name[1];
 };
 
+/* name records are front coded in the log file's name map: each record is
+ * serialized as its record id, the number of leading characters its name
+ * shares with the name of the preceding record in the map (as a uint16_t),
+ * and the remainder of its name (including the terminating null character)
+ *
+ *     ... darshan_record_id | (uint16_t) prefix_len | name suffix ...
+ */
+#define DARSHAN_NAME_RECORD_HDR_SIZE \
+    (sizeof(darshan_record_id) + sizeof(uint16_t))
+/* maximum length of a record name that can be front coded */
+#define DARSHAN_NAME_RECORD_MAX_LEN UINT16_MAX
+
 /* base record definition that can be used by modules */
 struct darshan_base_record
 {
@@ -120,6 +145,8 @@ struct darshan_base_record
 /* DXT */
 #include "darshan-dxt-log-format.h"
 #include "darshan-mdhim-log-format.h"
+#include "darshan-self-log-format.h"
+#include "darshan-iouring-log-format.h"
 
 /* X-macro for keeping module ordering consistent */
 /* NOTE: first val used to define module enum values, 
@@ -143,7 +170,9 @@ struct darshan_base_record
     /* DXT */ \
     X(DXT_POSIX_MOD,       "DXT_POSIX",  DXT_POSIX_VER,         &dxt_posix_logutils) \
     X(DXT_MPIIO_MOD,       "DXT_MPIIO",  DXT_MPIIO_VER,         &dxt_mpiio_logutils) \
-    X(DARSHAN_MDHIM_MOD,   "MDHIM",      DARSHAN_MDHIM_VER,     &mdhim_logutils)
+    X(DARSHAN_MDHIM_MOD,   "MDHIM",      DARSHAN_MDHIM_VER,     &mdhim_logutils) \
+    X(DARSHAN_SELF_MOD,    "SELF",       DARSHAN_SELF_VER,      &self_logutils) \
+    X(DARSHAN_IOURING_MOD, "IOURING",    DARSHAN_IOURING_VER,   &iouring_logutils)
 
 
 /* unique identifiers to distinguish between available darshan modules */
@@ -7,7 +7,7 @@
 #define __DARSHAN_POSIX_LOG_FORMAT_H
 
 /* current POSIX log format version */
-#define DARSHAN_POSIX_VER 4
+#define DARSHAN_POSIX_VER 5
 
 #define POSIX_COUNTERS \
     /* count of posix opens (INCLUDING fileno and dup operations) */\
@@ -26,6 +26,14 @@
     X(POSIX_STATS) \
     /* count of posix mmaps */\
     X(POSIX_MMAPS) \
+    /* count of posix msyncs */\
+    X(POSIX_MSYNCS) \
+    /* total bytes of the file mapped into memory by mmaps */\
+    X(POSIX_MMAP_BYTES) \
+    /* estimated bytes of the file faulted into memory through mappings */\
+    X(POSIX_MMAP_BYTES_READ) \
+    /* upper bound on bytes of the file dirtied through shared mappings */\
+    X(POSIX_MMAP_BYTES_WRITTEN) \
     /* count of posix fsyncs */\
     X(POSIX_FSYNCS) \
     /* count of posix fdatasyncs */\
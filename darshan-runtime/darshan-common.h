@@ -7,6 +7,9 @@
 #ifndef __DARSHAN_COMMON_H
 #define __DARSHAN_COMMON_H
 
+#include <stdint.h>
+#include <pthread.h>
+
 /* increment a timer counter, making sure not to account for overlap
  * with previous operations
  *
@@ -129,12 +132,22 @@
     memcpy(__cnt_p, tmp_cnt, 4*sizeof(int64_t)); \
 } while(0)
 
-/* maximum number of common values that darshan will track per file at runtime */
-#define DARSHAN_COMMON_VAL_MAX_RUNTIME_COUNT 32
-struct darshan_common_val_counter
+/* number of candidate common values tracked by a darshan_common_val_sketch */
+#define DARSHAN_COMMON_VAL_SKETCH_SIZE 8
+
+/* fixed-size "Space-Saving" summary of the most frequently occurring
+ * values in a stream. A value that is not tracked replaces the candidate
+ * with the smallest count and inherits that count, so the counts of
+ * the most frequent values are overestimated by at most the smallest
+ * count in the sketch, however many distinct values are seen. Entries
+ * with a count of 0 are unused. A zeroed sketch is empty. Values and counts
+ * are stored in separate arrays (a cache line each) so that looking up a
+ * value is a linear scan over a single cache line.
+ */
+struct darshan_common_val_sketch
 {
-    int64_t val;
-    int freq;
+    int64_t vals[DARSHAN_COMMON_VAL_SKETCH_SIZE];
+    int64_t cnts[DARSHAN_COMMON_VAL_SKETCH_SIZE];
 };
 
 /* i/o type (read or write) */
@@ -144,6 +157,101 @@ enum darshan_io_type
     DARSHAN_IO_WRITE = 2,
 };
 
+/* number of file descriptors covered by each page of a darshan_fd_table;
+ * must be a power of 2
+ */
+#define DARSHAN_FD_TABLE_PAGE_SIZE 1024
+
+/* table mapping file descriptors directly to record reference pointers.
+ * File descriptors are small, dense integers, so the table is a two level
+ * array indexed by descriptor, whose page directory is sized by the
+ * process's RLIMIT_NOFILE and whose pages are allocated as descriptors are
+ * added. A zeroed table is empty.
+ */
+struct darshan_fd_table
+{
+    void ***pages;
+    int page_count;
+};
+
+/* number of handle lookups cached per thread by the counter shard interface;
+ * must be a power of 2
+ */
+#define DARSHAN_SHARD_CACHE_SIZE 64
+
+/* per-thread cache entry mapping an instrumented handle (e.g., a file
+ * descriptor) to the calling thread's counter shard for the corresponding
+ * record. Entries are only valid while 'gen' matches the generation the
+ * owning shard registry keeps for their slot.
+ */
+struct darshan_shard_cache_entry
+{
+    uint64_t handle;
+    uint64_t gen;
+    void *shard_p;
+};
+
+/* an I/O operation recorded in a thread's deferred event ring, whose
+ * counter updates are applied to 'shard_p' later by the owning module.
+ * 'op' is a darshan_io_type value; 'flags' and 'session' are interpreted
+ * by the module.
+ */
+struct darshan_shard_event
+{
+    void *shard_p;
+    int64_t offset;
+    int64_t size;
+    double tm1;
+    double tm2;
+    int op;
+    int flags;
+    int session;
+};
+
+/* counter shards owned by a single thread for a single module; modules
+ * keep a static __thread pointer ('tls_p') to the calling thread's shards
+ */
+struct darshan_thread_shards
+{
+    int active;
+    void *shard_hash;
+    struct darshan_shard_cache_entry cache[DARSHAN_SHARD_CACHE_SIZE];
+    struct darshan_shard_event *events;
+    int event_count;
+    struct darshan_shard_registry *reg;
+    struct darshan_thread_shards **tls_p;
+    struct darshan_thread_shards *next;
+};
+
+/* number of events each thread may defer per module before they are
+ * applied to its shards (0 if deferred recording is disabled)
+ */
+extern int darshan_event_ring_size;
+
+/* module-wide registry of all thread shards, used to invalidate cached
+ * handle lookups and to fold shards back into records at shutdown. There
+ * is a generation for each handle cache slot, so that opening or closing
+ * a handle only invalidates the cached lookups of handles sharing its
+ * slot (which can not be cached at the same time anyway).
+ * 'exit_action' is called when a thread that used the module exits, and
+ * must hand the thread's shards to darshan_shards_release() while holding
+ * the module's lock.
+ */
+struct darshan_shard_registry
+{
+    uint64_t gen[DARSHAN_SHARD_CACHE_SIZE];
+    size_t shard_sz;
+    pthread_mutex_t mutex;
+    struct darshan_thread_shards *thread_list;
+    void (*exit_action)(struct darshan_thread_shards *);
+    pthread_key_t key;
+    int key_created;
+};
+
+#define DARSHAN_SHARD_REGISTRY_INITIALIZER(__shard_sz, __exit_action) \
+    { { [0 ... DARSHAN_SHARD_CACHE_SIZE - 1] = 1 }, __shard_sz, \
+      PTHREAD_MUTEX_INITIALIZER, NULL, __exit_action }
+
 /* struct used for calculating variances */
 struct darshan_variance_dt
 {
@@ -217,16 +325,91 @@ void darshan_iter_record_refs(
     void *hash_head,
     void (*iter_action)(void *));
 
+/* darshan_lookup_fd_ref()
+ *
+ * Lookup the record reference pointer for file descriptor 'fd' in the
+ * file descriptor table 'table'. Returns the record reference pointer if
+ * 'fd' is in the table, otherwise NULL.
+ */
+void *darshan_lookup_fd_ref(
+    struct darshan_fd_table *table,
+    int fd);
+
+/* darshan_add_fd_ref()
+ *
+ * Map file descriptor 'fd' to the record reference pointer 'rec_ref_p' in
+ * the file descriptor table 'table', replacing any existing mapping for
+ * 'fd'. Returns 1 on success, 0 if 'fd' is invalid or memory could not be
+ * allocated.
+ */
+int darshan_add_fd_ref(
+    struct darshan_fd_table *table,
+    int fd,
+    void *rec_ref_p);
+
+/* darshan_delete_fd_ref()
+ *
+ * Remove file descriptor 'fd' from the file descriptor table 'table'.
+ * Returns the record reference pointer 'fd' was mapped to, or NULL if it
+ * was not in the table.
+ */
+void *darshan_delete_fd_ref(
+    struct darshan_fd_table *table,
+    int fd);
+
+/* darshan_clear_fd_refs()
+ *
+ * Remove all file descriptors from the file descriptor table 'table' and
+ * free its memory. The record reference pointers are not freed.
+ */
+void darshan_clear_fd_refs(
+    struct darshan_fd_table *table);
+
 /* darshan_clean_file_path()
  *
  * Allocate a new string that contains a new cleaned-up version of
  * the file path given in 'path' argument. Converts relative paths
- * to absolute paths and filters out some potential noise in the
- * path string.
+ * to absolute paths and filters out "//", "." and ".." components
+ * in the path string.
  */
 char* darshan_clean_file_path(
     const char *path);
 
+/* darshan_clean_file_path_id()
+ *
+ * Writes a cleaned-up version of the file path given in 'path' (as
+ * returned by darshan_clean_file_path()) to 'buf', which must hold
+ * PATH_MAX bytes, and sets 'rec_id' to the corresponding record id.
+ * Results are memoized in a small per-thread cache, so that repeated
+ * lookups of the same path skip the getcwd(), cleanup, and hashing.
+ * Returns 'buf' on success, or NULL if 'path' is not a file path
+ * Darshan can clean up (e.g., reserved names like <STDIN>).
+ */
+char *darshan_clean_file_path_id(
+    const char *path,
+    char *buf,
+    darshan_record_id *rec_id);
+
+/* darshan_common_cwd_track()
+ *
+ * Tells the path cache used by darshan_clean_file_path_id() that the
+ * caller (i.e., the POSIX module, through its chdir() wrappers) is now
+ * tracking changes to the current working directory, so relative paths
+ * may be memoized. Calling this again once tracking has started is a
+ * no-op.
+ */
+void darshan_common_cwd_track(
+    void);
+
+/* darshan_common_cwd_changed()
+ *
+ * Notifies the path cache used by darshan_clean_file_path_id() that the
+ * current working directory may have changed. This also starts tracking
+ * the working directory, if darshan_common_cwd_track() was not called.
+ */
+void darshan_common_cwd_changed(
+    void);
+
 /* darshan_record_sort()
  *
  * Sort the records in 'rec_buf' by descending rank to get all
@@ -243,26 +426,187 @@ void darshan_record_sort(
 
 /* darshan_common_val_counter()
  *
- * Potentially increment an existing common value counter or allocate
- * a new one to keep track of commonly occuring values. Example use
- * cases would be to track the most frequent access sizes or strides
- * used by a specific module, for instance. 'common_val_root' is the
- * root pointer for the tree which stores common value info, 
- * 'common_val_count' is a pointer to the number of nodes in the 
- * tree (i.e., the number of allocated common value counters), 'val'
- * is the new value to attempt to add, 'val_p' is a pointer to the
- * base counter (i.e., the first) of the common values (which are
- * assumed to be 4 total and contiguous in memory), and 'cnt_p' is
- * a pointer to the base counter of the common counts (which are
- * again expected to be contiguous in memory).
+ * Count an occurrence of value 'val' in the common value sketch 'sketch'.
+ * Example use cases would be to track the most frequent access sizes or
+ * strides used by a specific module, for instance. Values of 0 are not
+ * counted. This function does not allocate memory.
  */
 void darshan_common_val_counter(
-    void **common_val_root,
-    int *common_val_count,
-    int64_t val,
+    struct darshan_common_val_sketch *sketch,
+    int64_t val);
+
+/* darshan_common_val_sketch_merge()
+ *
+ * Merge the common value sketch 'src' into the sketch 'dst', keeping the
+ * values with the largest combined counts.
+ */
+void darshan_common_val_sketch_merge(
+    struct darshan_common_val_sketch *src,
+    struct darshan_common_val_sketch *dst);
+
+/* darshan_common_val_sketch_top()
+ *
+ * Merge the most frequent values in the common value sketch 'sketch' into
+ * a set of 4 common values and counts stored in a record. 'val_p' is a
+ * pointer to the base counter (i.e., the first) of the common values
+ * (which are assumed to be 4 total and contiguous in memory), and 'cnt_p'
+ * is a pointer to the base counter of the common counts (which are again
+ * expected to be contiguous in memory).
+ */
+void darshan_common_val_sketch_top(
+    struct darshan_common_val_sketch *sketch,
     int64_t *val_p,
     int64_t *cnt_p);
 
+/* darshan_shards_enter()
+ *
+ * Mark the calling thread as active in the counter shards of the module
+ * owning 'reg', with 'tls_p' pointing to the module's thread-local shards
+ * pointer. Thread shard state is allocated on the first call from each
+ * thread, and is released by the registry's exit action when the thread
+ * exits.
+ * Returns the thread's shards, or NULL if Darshan instrumentation is
+ * disabled (in which case the thread is not marked active). Every
+ * successful call must be paired with a call to darshan_shards_exit().
+ * NOTE: this function does not acquire any lock after the first call
+ * from a given thread.
+ */
+struct darshan_thread_shards *darshan_shards_enter(
+    struct darshan_shard_registry *reg,
+    struct darshan_thread_shards **tls_p);
+
+/* darshan_shards_exit()
+ *
+ * Mark the calling thread as no longer active in the given 'shards'.
+ */
+void darshan_shards_exit(
+    struct darshan_thread_shards *shards);
+
+/* darshan_shards_lookup()
+ *
+ * Look up the given 'handle' in the per-thread handle cache of 'shards'.
+ * Returns 1 on a cache hit, in which case the corresponding shard (or NULL
+ * if the handle is known not to be instrumented) is stored in 'shard_p'.
+ * Returns 0 on a cache miss, in which case the caller should resolve the
+ * handle and call darshan_shards_fill().
+ */
+int darshan_shards_lookup(
+    struct darshan_shard_registry *reg,
+    struct darshan_thread_shards *shards,
+    uint64_t handle,
+    void **shard_p);
+
+/* darshan_shards_fill()
+ *
+ * Cache the mapping of 'handle' to the record reference 'rec_ref_p' in the
+ * handle cache of 'shards', allocating a zeroed shard for the record if the
+ * thread does not already have one. 'gen' is the generation of 'handle'
+ * (as returned by darshan_shards_gen()) observed before it was resolved.
+ * 'rec_ref_p' may be NULL to cache that a handle is not instrumented.
+ * Shard structures must begin with a pointer to their record reference,
+ * which is initialized by this function. Returns the shard pointer, or NULL
+ * if 'rec_ref_p' is NULL or memory could not be allocated.
+ */
+void *darshan_shards_fill(
+    struct darshan_shard_registry *reg,
+    struct darshan_thread_shards *shards,
+    uint64_t handle,
+    uint64_t gen,
+    void *rec_ref_p);
+
+/* darshan_shards_gen()
+ *
+ * Return the current generation of 'handle' in registry 'reg'.
+ */
+uint64_t darshan_shards_gen(
+    struct darshan_shard_registry *reg,
+    uint64_t handle);
+
+/* darshan_shards_invalidate()
+ *
+ * Invalidate every thread's cached lookup of 'handle' for registry 'reg'.
+ * Modules must call this whenever 'handle' is added to or removed from
+ * their handle hash tables.
+ */
+void darshan_shards_invalidate(
+    struct darshan_shard_registry *reg,
+    uint64_t handle);
+
+/* darshan_shards_quiesce()
+ *
+ * Wait for all threads to leave the counter shards of registry 'reg'.
+ * This must be called after Darshan instrumentation has been disabled
+ * and without holding the module's lock.
+ */
+void darshan_shards_quiesce(
+    struct darshan_shard_registry *reg);
+
+/* darshan_shards_iter()
+ *
+ * Perform the given action 'iter_action' on every shard of every thread
+ * registered in 'reg'. Should only be called after darshan_shards_quiesce(),
+ * unless 'iter_action' only reads the shards and the caller holds the lock
+ * the module fills shards under (shard counters may then be read while
+ * they are updated, which is acceptable for log checkpoints).
+ */
+void darshan_shards_iter(
+    struct darshan_shard_registry *reg,
+    void (*iter_action)(void *));
+
+/* darshan_shards_defer()
+ *
+ * Returns the next free slot in the deferred event ring of 'shards' for
+ * the caller to fill in, first applying (with 'apply_action') and emptying
+ * the ring if it is full. Returns NULL if deferred recording is disabled or
+ * the ring could not be allocated, in which case the caller should apply
+ * the event immediately.
+ */
+struct darshan_shard_event *darshan_shards_defer(
+    struct darshan_thread_shards *shards,
+    void (*apply_action)(struct darshan_shard_event *));
+
+/* darshan_shards_drain()
+ *
+ * Apply (with 'apply_action') and empty the deferred event rings of every
+ * thread registered in 'reg'. Should only be called after
+ * darshan_shards_quiesce().
+ */
+void darshan_shards_drain(
+    struct darshan_shard_registry *reg,
+    void (*apply_action)(struct darshan_shard_event *));
+
+/* darshan_shards_pending()
+ *
+ * Return the number of events waiting in the deferred event rings of the
+ * threads registered in 'reg'. May be called while threads record events,
+ * in which case the count is only approximate.
+ */
+int darshan_shards_pending(
+    struct darshan_shard_registry *reg);
+
+/* darshan_shards_release()
+ *
+ * Unregister the shards of an exiting thread from 'reg' and free them,
+ * first applying their deferred events (with 'apply_action') and folding
+ * each shard into its record (with 'iter_action'). Either action may be
+ * NULL, e.g. once the module has shut down. Must be called with the
+ * module's lock held.
+ */
+void darshan_shards_release(
+    struct darshan_shard_registry *reg,
+    struct darshan_thread_shards *shards,
+    void (*apply_action)(struct darshan_shard_event *),
+    void (*iter_action)(void *));
+
+/* darshan_shards_clear()
+ *
+ * Free all shards registered in 'reg', discarding any deferred events, and
+ * invalidate all cached handle lookups. Should only be called after
+ * darshan_shards_quiesce().
+ */
+void darshan_shards_clear(
+    struct darshan_shard_registry *reg);
+
 #ifdef HAVE_MPI
 /* darshan_variance_reduce()
  *
@@ -11,6 +11,9 @@
 #include <sys/types.h>
 #include <stdint.h>
 #include <limits.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <signal.h>
 
 #include "uthash.h"
 #include "darshan-log-format.h"
@@ -33,6 +36,99 @@
 /* Environment variable to enable profiling without MPI */
 #define DARSHAN_ENABLE_NONMPI "DARSHAN_ENABLE_NONMPI"
 
+/* Environment variable to select the timer used for Darshan timestamps */
+#define DARSHAN_TIMER_OVERRIDE "DARSHAN_TIMER"
+
+/* Environment variable to override the number of threads used to compress
+ * log regions at shutdown
+ */
+#define DARSHAN_COMP_THREADS_OVERRIDE "DARSHAN_COMP_THREADS"
+
+/* default (and maximum) number of log compression threads */
+#define DARSHAN_DEF_COMP_THREADS 4
+#define DARSHAN_MAX_COMP_THREADS 16
+
+/* logs with less uncompressed data than this are compressed by the calling
+ * thread, as starting compression threads would cost more than they save
+ */
+#define DARSHAN_COMP_THREADS_MIN_SIZE (256*1024)
+
+/* Environment variable to select the log compression codec ("zlib", "zstd",
+ * or "lz4"); codecs that were not found at configure time fall back to zlib
+ */
+#define DARSHAN_COMP_OVERRIDE "DARSHAN_COMP"
+
+/* Environment variable to override the codec specific compression level */
+#define DARSHAN_COMP_LEVEL_OVERRIDE "DARSHAN_COMP_LEVEL"
+
+/* default zstd compression level (fast end of the zstd range) */
+#define DARSHAN_DEF_ZSTD_LEVEL 3
+
+/* Environment variable to select the hash function used to generate
+ * record ids ("jenkins" or "wyhash")
+ */
+#define DARSHAN_HASH_OVERRIDE "DARSHAN_HASH"
+#ifdef __DARSHAN_RECORD_HASH_WYHASH
+#define DARSHAN_DEF_HASH DARSHAN_WYHASH_HASH
+#else
+#define DARSHAN_DEF_HASH DARSHAN_JENKINS_HASH
+#endif
+
+/* Environment variable to write a checkpoint log every N seconds */
+#define DARSHAN_CHECKPOINT_INTERVAL_OVERRIDE "DARSHAN_CHECKPOINT_INTERVAL"
+
+/* Environment variable giving a signal number that triggers a checkpoint */
+#define DARSHAN_CHECKPOINT_SIGNAL_OVERRIDE "DARSHAN_CHECKPOINT_SIGNAL"
+
+/* Environment variable to collect the logs of a job's serial processes on
+ * each node and merge them into a single log when the last process exits
+ */
+#define DARSHAN_COLLECT_OVERRIDE "DARSHAN_COLLECT"
+
+/* Environment variable to override the node-local directory that collected
+ * logs are stored in until they are merged
+ */
+#define DARSHAN_COLLECT_DIR_OVERRIDE "DARSHAN_COLLECT_DIR"
+#define DARSHAN_DEF_COLLECT_DIR "/dev/shm"
+
+/* Environment variable to override the program used to merge collected logs */
+#define DARSHAN_MERGE_OVERRIDE "DARSHAN_MERGE"
+#define DARSHAN_DEF_MERGE "darshan-merge"
+
+/* Environment variable giving the path exclusion/inclusion rules, which
+ * replace the default rules; per-module rules are given by appending the
+ * module name (e.g. DARSHAN_EXCLUDE_DIRS_POSIX)
+ */
+#define DARSHAN_EXCLUDE_DIRS_OVERRIDE "DARSHAN_EXCLUDE_DIRS"
+
+/* Environment variable to override the node-local directory used to cache
+ * the mounted file system table across processes (empty to disable)
+ */
+#define DARSHAN_MNT_CACHE_DIR_OVERRIDE "DARSHAN_MNT_CACHE_DIR"
+#define DARSHAN_DEF_MNT_CACHE_DIR "/dev/shm"
+
+/* Environment variable to have one process per node write the log data of
+ * all processes on its node at shutdown
+ */
+#define DARSHAN_NODE_AGGREGATE_OVERRIDE "DARSHAN_NODE_AGGREGATE"
+
+/* Environment variable giving a directory in which each MPI process writes
+ * its own piece of the log at shutdown, without any collective operations;
+ * the pieces are assembled into a single log afterwards with darshan-merge
+ */
+#define DARSHAN_LOG_PIECES_OVERRIDE "DARSHAN_LOG_PIECES"
+
+/* Environment variable to record Darshan's own overhead in the log */
+#define DARSHAN_SELF_PROFILE_OVERRIDE "DARSHAN_SELF_PROFILE"
+
+/* Environment variable giving the number of read/write events each thread
+ * records per module before applying them to its counters in a batch
+ */
+#define DARSHAN_EVENT_RING_OVERRIDE "DARSHAN_EVENT_RING"
+
+/* length of the window (in seconds) used to calibrate TSC timers */
+#define DARSHAN_TSC_CALIBRATION_TIME 0.002
+
 #ifdef __DARSHAN_ENABLE_MMAP_LOGS
 /* Environment variable to override default mmap log path */
 #define DARSHAN_MMAP_LOG_PATH_OVERRIDE "DARSHAN_MMAP_LOGPATH"
@@ -48,27 +144,219 @@
 #define DARSHAN_MOD_MEM_MAX (2 * 1024 * 1024) /* 2 MiB default */
 #endif
 
-/* default name record buf can store 2048 records of size 100 bytes */
+/* module memory is committed in chunks of this size as records are stored */
+#define DARSHAN_MOD_MEM_CHUNK_SIZE (64 * 1024)
+
+/* name records are stored in chunks of this size as they are registered */
+#define DARSHAN_NAME_RECORD_CHUNK_SIZE (64 * 1024)
+
+/* size of the name record region of mmap log files, which can store
+ * 2048 records of size 100 bytes without any prefix compression
+ */
 #define DARSHAN_NAME_RECORD_BUF_SIZE (2048 * 100)
 
 /* structure to track registered modules */
+/* NOTE: each module's record buffer is a reserved region of address space
+ * that memory is committed to on demand, up to 'rec_mem_max' bytes
+ */
 struct darshan_core_module
 {
     void *rec_buf_start;
     void *rec_buf_p;
     int rec_mem_avail;
+    int rec_mem_committed;
+    int rec_mem_max;
+#ifdef __DARSHAN_ENABLE_MMAP_LOGS
+    off_t rec_buf_off;
+#endif
     darshan_module_shutdown mod_shutdown_func;
+    darshan_module_snapshot mod_snapshot_func;
+};
+
+/* structure for keeping a reference to a directory shared by one or more
+ * registered name records (path includes the trailing '/', if any)
+ */
+struct darshan_core_name_dir_ref
+{
+    char *path;
+    int path_len;
+    UT_hash_handle hlink;
 };
 
 /* strucutre for keeping a reference to registered name records */
+/* NOTE: the record's full name is the concatenation of its directory
+ * path and its base name
+ */
 struct darshan_core_name_record_ref
 {
-    struct darshan_name_record *name_record;
+    darshan_record_id id;
+    struct darshan_core_name_dir_ref *dir;
+    char *base;
     uint64_t mod_flags;
     uint64_t global_mod_flags;
+    int rank_count; /* ranks holding this record, or 0 if not yet known */
+    int name_rank; /* lowest rank holding this record, writes its name */
     UT_hash_handle hlink;
 };
 
+/* messages exchanged with the rank that owns a record id when detecting
+ * shared records at shutdown
+ */
+struct darshan_core_shared_rec_query
+{
+    darshan_record_id id;
+    uint64_t mod_flags;
+};
+
+struct darshan_core_shared_rec_reply
+{
+    uint64_t global_mod_flags;
+    int32_t rank_count;
+    int32_t name_rank;
+};
+
+/* a name record routed to the rank owning its id at shutdown */
+struct darshan_core_routed_name
+{
+    darshan_record_id id;
+    char *name;
+};
+
+/* a query received by the owning rank, and where its reply goes */
+struct darshan_core_shared_rec_entry
+{
+    darshan_record_id id;
+    uint64_t mod_flags;
+    int src_rank;
+    int reply_ndx;
+};
+
+/* structure describing a log region (the name map or a module's buffer)
+ * to be compressed at shutdown
+ */
+struct darshan_core_comp_job
+{
+    void *buf;
+    int len;
+    char *comp_buf;
+    int comp_len;
+    int ret;
+    int done;
+    double comp_time;
+};
+
+/* pool of threads compressing log regions concurrently at shutdown, while
+ * the main thread runs module shutdown routines and writes out regions that
+ * have already been compressed
+ */
+/* NOTE: the name map is compressed by job DARSHAN_MAX_MODS */
+struct darshan_core_comp_pool
+{
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    pthread_t threads[DARSHAN_MAX_COMP_THREADS];
+    int nthreads;
+    struct darshan_core_comp_job jobs[DARSHAN_MAX_MODS + 1];
+    struct darshan_core_comp_job *queue[DARSHAN_MAX_MODS + 1];
+    int queue_len;
+    int queue_next;
+    int finish;
+};
+
+/* background thread that periodically (or when signaled) writes a complete
+ * log from a snapshot of the instrumentation collected so far
+ */
+/* NOTE: the signal handler only posts 'sem', all work is done on the thread */
+struct darshan_core_checkpoint
+{
+    pthread_t thread;
+    sem_t sem;
+    pid_t pid;
+    int stop;
+    double interval;
+    int signum;
+    struct sigaction old_act;
+    char log_name[PATH_MAX];
+};
+
+/* maximum number of processes of a job that can be registered with a
+ * node's log collector at once
+ */
+#define DARSHAN_COLLECT_MAX_PROCS 4096
+
+/* node-local shared memory segment tracking the processes of a job that
+ * deposit logs with the collector
+ */
+/* NOTE: processes are tracked by pid rather than counted, so that a process
+ * which exec()s (without running Darshan's shutdown) keeps its registration
+ * and processes that died without shutting down can be pruned. The segment
+ * is only accessed while holding an flock() on it. The last process to
+ * leave unlinks the segment and sets 'unlinked', so that processes which
+ * opened it before then create a new one.
+ */
+struct darshan_core_collector_shm
+{
+    int64_t generation;
+    int unlinked;
+    pid_t pids[DARSHAN_COLLECT_MAX_PROCS];
+};
+
+/* per-process state of the node-local log collector */
+struct darshan_core_collector
+{
+    int fd;
+    struct darshan_core_collector_shm *shm;
+    pid_t pid;
+    char shm_name[NAME_MAX];
+    char spool_dir[PATH_MAX];
+};
+
+/* per-process state for writing the log in pieces (file-per-process) */
+/* NOTE: 'dir' is empty unless the log is written in pieces */
+struct darshan_core_pieces
+{
+    int rank;
+    int nprocs;
+    char dir[PATH_MAX];
+    char log_name[PATH_MAX];
+};
+
+/* path rule flags */
+#define DARSHAN_PATH_RULE_EXCLUDE  0x1 /* matching paths are not instrumented */
+#define DARSHAN_PATH_RULE_INCLUDE  0x2 /* matching paths are always instrumented */
+#define DARSHAN_PATH_RULE_SUFFIX   0x4 /* glob is a plain "*<suffix>" pattern */
+#define DARSHAN_PATH_RULE_BASENAME 0x8 /* glob is matched against the basename */
+
+/* node in the byte-wise trie of prefix path rules; node 0 is the root,
+ * so a child or sibling index of 0 means there is none
+ */
+struct darshan_core_path_rule_node
+{
+    unsigned char c;
+    unsigned char flags;
+    int child;
+    int sibling;
+};
+
+/* path rule that cannot be stored in the prefix trie */
+struct darshan_core_path_glob
+{
+    char *pattern;
+    int len;
+    int flags;
+};
+
+/* compiled set of path exclusion and inclusion rules */
+struct darshan_core_path_rules
+{
+    struct darshan_core_path_rule_node *nodes;
+    int node_count;
+    int node_max;
+    struct darshan_core_path_glob *globs;
+    int glob_count;
+    int glob_max;
+};
+
 /* in memory structure to keep up with job level data */
 struct darshan_core_runtime
 {
@@ -76,18 +364,31 @@ struct darshan_core_runtime
     struct darshan_header *log_hdr_p;
     struct darshan_job *log_job_p;
     char *log_exemnt_p;
+#ifdef __DARSHAN_ENABLE_MMAP_LOGS
     void *log_name_p;
-    void *log_mod_p;
+#endif
 
     /* darshan-core internal data structures */
     struct darshan_core_module* mod_array[DARSHAN_MAX_MODS];
-    int mod_mem_used;
+    long mod_mem_used;
     struct darshan_core_name_record_ref *name_hash;
-    int name_mem_used; 
+    struct darshan_core_name_dir_ref *name_dir_hash;
+    void *name_chunk_list;
+    char *name_chunk_p;
+    long name_chunk_avail;
+    long name_mem_used;
     double wtime_offset;
+    int lazy_init_done;
     char *comp_buf;
+    int comp_buf_sz;
+    struct darshan_core_comp_pool *comp_pool;
 #ifdef __DARSHAN_ENABLE_MMAP_LOGS
     char mmap_log_name[PATH_MAX];
+    int mmap_log_fd;
+    off_t mmap_log_size;
+    off_t mmap_log_mod_off;
+    char *mmap_last_name; /* last name appended to the mmap'd name map */
+    int mmap_last_name_max;
 #endif
 };
 
@@ -96,5 +397,6 @@ void darshan_core_shutdown(void);
 
 uint32_t darshan_hashlittle(const void *key, size_t length, uint32_t initval);
 uint64_t darshan_hash(const register unsigned char *k, register uint64_t length, register uint64_t level);
+uint64_t darshan_wyhash(const void *key, uint64_t len, uint64_t seed);
 
 #endif /* __DARSHAN_CORE_H */
@@ -78,6 +78,13 @@
 /* default number of records to attempt to store for each module */
 #define DARSHAN_DEF_MOD_REC_COUNT 1024
 
+/* maximum amount of memory to use for storing DXT records */
+#ifdef __DARSHAN_MOD_MEM_MAX
+#define DXT_IO_TRACE_MEM_MAX (__DARSHAN_MOD_MEM_MAX * 1024 * 1024)
+#else
+#define DXT_IO_TRACE_MEM_MAX (4 * 1024 * 1024) /* 4 MiB default */
+#endif
+
 /* module developers must define a 'darshan_module_shutdown' function
  * for allowing darshan-core to call into a module and retrieve final
  * output data to be saved in the log.
@@ -95,6 +102,25 @@ typedef void (*darshan_module_shutdown)(
     int *mod_buf_sz /* output parameter to save module buffer size */
 );
 
+/* modules may also define a 'darshan_module_snapshot' function, which
+ * darshan-core calls to checkpoint the log while the application is still
+ * running. On input, 'mod_buf' and 'mod_buf_sz' describe the module's
+ * record buffer; the module must return a newly allocated copy of its
+ * records (in final output form) in the same parameters, without disabling
+ * instrumentation or modifying its live records. darshan-core frees the
+ * returned buffer. The module sets 'mod_partial' if the copy is missing
+ * some of the I/O it instrumented, which marks the module's data as
+ * incomplete in the checkpoint.
+ *
+ * NOTE: snapshots are taken from a background thread, so this function
+ * must not run collective MPI operations.
+ */
+typedef void (*darshan_module_snapshot)(
+    void **mod_buf, /* input/output parameter for the module buffer address */
+    int *mod_buf_sz, /* input/output parameter for the module buffer size */
+    int *mod_partial /* output parameter set if the snapshot is incomplete */
+);
+
 /* stores FS info from statfs calls for a given mount point */
 struct darshan_fs_info
 {
@@ -129,8 +155,11 @@ void darshan_instrument_fs_data(
  * 'mod_shutdown_func is a pointer to a function responsible for
  * shutting down the module and returning final output data to darshan-core.
  * 'inout_mod_buf_size' is an input/output argument, with it being
- * set to the requested amount of module memory on input, and set to
- * the amount allocated by darshan-core on output. If given, 'rank' is
+ * set to the maximum amount of module memory requested on input, and
+ * set to the amount currently available to the module on output. Module
+ * memory is committed on demand as records are registered, so requesting
+ * a large amount of memory does not cost anything until it is used.
+ * If given, 'rank' is
  * a pointer to an integer which will contain the calling process's
  * MPI rank on return. If given, 'sys_mem_alignment' is a pointer to
  * an integer which will contain the memory alignment value Darshan
@@ -143,6 +172,16 @@ void darshan_core_register_module(
     int *rank,
     int *sys_mem_alignment);
 
+/* darshan_core_register_module_snapshot()
+ *
+ * Set the function darshan-core uses to snapshot the records of the
+ * already registered module 'mod_id' for log checkpoints. Modules that do
+ * not register a snapshot function are left out of checkpoints.
+ */
+void darshan_core_register_module_snapshot(
+    darshan_module_id mod_id,
+    darshan_module_snapshot mod_snapshot_func);
+
 /* darshan_core_unregister_module()
  * 
  * Unregisters module identifier 'mod_id' with the darshan-core runtime,
@@ -166,12 +205,14 @@ darshan_record_id darshan_core_gen_record_id(
  * `darshan_core_gen_record_id` function. 'name' is the the name of the
  * Darshan record (e.g., the full file path), which is ignored if NULL is
  * passed. 'mod_id' is the identifier of the calling module. 'rec_len'
- * is the size of the record being registered with Darshan. If given,
- * 'fs_info' is a pointer to a structure containing information on
- * the underlying FS this record is associated with (determined by
- * matching the file name prefix with Darshan's list of tracked mount
- * points). Returns a pointer to the address the record should be
- * written to on success, NULL on failure.
+ * is the size of the record being registered with Darshan, which may
+ * vary from record to record. Records are stored back to back in the
+ * module's buffer in the order they are registered. If given, 'fs_info'
+ * is a pointer to a structure containing information on the underlying
+ * FS this record is associated with (determined by matching the file
+ * name prefix with Darshan's list of tracked mount points). Returns a
+ * pointer to the address the record should be written to on success,
+ * NULL on failure.
  */
 void *darshan_core_register_record(
     darshan_record_id rec_id,
@@ -183,7 +224,9 @@ void *darshan_core_register_record(
 
 /* darshan_core_lookup_record_name()
  *
- * Looks up the name associated with a given Darshan record ID.
+ * Looks up the name associated with a given Darshan record ID. Returns
+ * a copy of the name that the caller must free, or NULL if the record
+ * ID is not known.
  */
 char *darshan_core_lookup_record_name(
     darshan_record_id rec_id);
@@ -204,21 +247,114 @@ void darshan_core_fprintf(
     const char *format,
     ...);
 
+/* darshan_core_lookup_mount()
+ *
+ * Finds the mount point that the file at the absolute path 'path'
+ * resides on, using the longest path prefix (by whole path components)
+ * among Darshan's list of tracked mount points. If given, 'fs_info' is
+ * set to the information Darshan collected for that file system and
+ * 'mnt_path' to the mount point path, which remains valid until Darshan
+ * shuts down. Returns true (1) if a mount point was found, false (0)
+ * otherwise, in which case 'fs_info->fs_type' is set to -1.
+ */
+int darshan_core_lookup_mount(
+    const char *path,
+    struct darshan_fs_info *fs_info,
+    const char **mnt_path);
+
 /* darshan_core_excluded_path()
  *
- * Returns true (1) if the given file path 'path' is in Darshan's
- * list of excluded file paths, false (0) otherwise.
+ * Returns true (1) if the given file path 'path' is excluded from
+ * instrumentation by module 'mod_id', either by Darshan's path rules
+ * or by rules the user gave for that module, false (0) otherwise.
  */
 int darshan_core_excluded_path(
+    darshan_module_id mod_id,
     const char * path);
 
 /* darshan_core_disabled_instrumentation
  *
  * Returns true (1) if Darshan has currently disabled instrumentation,
- * false (0) otherwise. If instrumentation is disabled, modules should
- * no longer update any file records as part of the intercepted function
- * wrappers.
+ * either entirely or for the calling thread, false (0) otherwise. If
+ * instrumentation is disabled, modules should no longer update any file
+ * records as part of the intercepted function wrappers.
  */
 int darshan_core_disabled_instrumentation(void);
 
+/*****************************************************
+* self profiling hooks (see darshan-self.c)          *
+*****************************************************/
+
+/* nonzero if Darshan is recording its own overhead in the log; the hooks
+ * below do nothing but test this flag when self profiling is disabled
+ */
+extern int darshan_self_profile;
+
+/* passing DARSHAN_SELF_CURRENT as a module id charges a counter to the
+ * module whose call the calling thread is currently instrumenting
+ */
+#define DARSHAN_SELF_CURRENT (-1)
+
+/* darshan_self_enter() / darshan_self_exit()
+ *
+ * Bracket the bookkeeping module 'mod_id' does for an intercepted call,
+ * i.e., from just before it takes its lock to just after it releases it.
+ */
+void darshan_self_enter(
+    int mod_id);
+void darshan_self_exit(
+    int mod_id);
+
+/* darshan_self_lock()
+ *
+ * Acquires 'mutex' on behalf of module 'mod_id', counting the acquisition
+ * and any time spent waiting for another thread to release it.
+ */
+void darshan_self_lock(
+    pthread_mutex_t *mutex,
+    int mod_id);
+
+/* darshan_self_count() / darshan_self_max() / darshan_self_time()
+ *
+ * Add 'val' to, or raise to 'val', the given SELF_* integer counter, or
+ * add 'elapsed' seconds to the given SELF_F_* timer, of module 'mod_id'.
+ */
+void darshan_self_count(
+    int mod_id,
+    int counter,
+    int64_t val);
+void darshan_self_max(
+    int mod_id,
+    int counter,
+    int64_t val);
+void darshan_self_time(
+    int mod_id,
+    int fcounter,
+    double elapsed);
+
+#define DARSHAN_SELF_ENTER(__mod_id) do { \
+    if(darshan_self_profile) darshan_self_enter(__mod_id); \
+} while(0)
+
+#define DARSHAN_SELF_EXIT(__mod_id) do { \
+    if(darshan_self_profile) darshan_self_exit(__mod_id); \
+} while(0)
+
+#define DARSHAN_SELF_LOCK(__mutex, __mod_id) do { \
+    if(darshan_self_profile) darshan_self_lock(__mutex, __mod_id); \
+    else pthread_mutex_lock(__mutex); \
+} while(0)
+
+#define DARSHAN_SELF_COUNT(__mod_id, __counter, __val) do { \
+    if(darshan_self_profile) darshan_self_count(__mod_id, __counter, __val); \
+} while(0)
+
+#define DARSHAN_SELF_MAX(__mod_id, __counter, __val) do { \
+    if(darshan_self_profile) darshan_self_max(__mod_id, __counter, __val); \
+} while(0)
+
+#define DARSHAN_SELF_TIME(__mod_id, __fcounter, __elapsed) do { \
+    if(darshan_self_profile) darshan_self_time(__mod_id, __fcounter, __elapsed); \
+} while(0)
+
 #endif /* __DARSHAN_H */
@@ -54,7 +54,7 @@ void bgq_runtime_initialize(void);
 static void bgq_shutdown(MPI_Comm mod_comm, darshan_record_id *shared_recs, int shared_rec_count, void **buffer, int *size);
 
 /* macros for obtaining/releasing the BGQ module lock */
-#define BGQ_LOCK() pthread_mutex_lock(&bgq_runtime_mutex)
+#define BGQ_LOCK() DARSHAN_SELF_LOCK(&bgq_runtime_mutex, DARSHAN_BGQ_MOD)
 #define BGQ_UNLOCK() pthread_mutex_unlock(&bgq_runtime_mutex)
 
 /*
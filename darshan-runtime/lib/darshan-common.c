@@ -12,13 +12,23 @@
 #include <stdlib.h>
 #include <string.h>
 #include <limits.h>
-#include <search.h>
 #include <assert.h>
+#include <sched.h>
+#include <pthread.h>
+#include <sys/resource.h>
 
 #include "uthash.h"
 
 #include "darshan.h"
 
+/* largest RLIMIT_NOFILE a file descriptor table's page directory is sized
+ * for up front; tables of processes with larger limits grow on demand
+ */
+#define DARSHAN_FD_TABLE_MAX_INIT_FDS (1024 * 1024)
+
+/* set by darshan-core from DARSHAN_EVENT_RING before modules initialize */
+int darshan_event_ring_size = 0;
+
 /* track opaque record referencre using a hash link */
 struct darshan_record_ref_tracker
 {
@@ -34,6 +44,7 @@ void *darshan_lookup_record_ref(void *hash_head, void *handle, size_t handle_sz)
 
     /* search the hash table for the given handle */
     HASH_FIND(hlink, ref_tracker_head, handle, handle_sz, ref_tracker);
+    DARSHAN_SELF_COUNT(DARSHAN_SELF_CURRENT, SELF_HASH_LOOKUPS, 1);
     if(ref_tracker)
         return(ref_tracker->rec_ref_p);
     else
@@ -120,65 +131,315 @@ void darshan_iter_record_refs(void *hash_head, void (*iter_action)(void *))
     return;
 }
 
-char* darshan_clean_file_path(const char* path)
+void *darshan_lookup_fd_ref(struct darshan_fd_table *table, int fd)
 {
-    char* newpath = NULL;
-    char* cwd = NULL;
-    char* filter = NULL;
+    void **page;
+
+    if(fd < 0 || fd / DARSHAN_FD_TABLE_PAGE_SIZE >= table->page_count)
+        return(NULL);
+    page = table->pages[fd / DARSHAN_FD_TABLE_PAGE_SIZE];
+    if(!page)
+        return(NULL);
+
+    return(page[fd & (DARSHAN_FD_TABLE_PAGE_SIZE - 1)]);
+}
+
+int darshan_add_fd_ref(struct darshan_fd_table *table, int fd, void *rec_ref_p)
+{
+    struct rlimit fd_limit;
+    void ***new_pages;
+    int page_ndx;
+    int page_count;
+
+    if(fd < 0)
+        return(0);
+
+    page_ndx = fd / DARSHAN_FD_TABLE_PAGE_SIZE;
+    if(page_ndx >= table->page_count)
+    {
+        /* size the page directory for every descriptor the process may
+         * open, or just this one if the limit has been raised since
+         */
+        page_count = page_ndx + 1;
+        if(!table->pages && getrlimit(RLIMIT_NOFILE, &fd_limit) == 0 &&
+           fd_limit.rlim_cur != RLIM_INFINITY &&
+           fd_limit.rlim_cur <= DARSHAN_FD_TABLE_MAX_INIT_FDS &&
+           fd_limit.rlim_cur > (rlim_t)fd)
+        {
+            page_count = (fd_limit.rlim_cur + DARSHAN_FD_TABLE_PAGE_SIZE - 1) /
+                DARSHAN_FD_TABLE_PAGE_SIZE;
+        }
+
+        new_pages = realloc(table->pages, page_count * sizeof(*new_pages));
+        if(!new_pages)
+            return(0);
+        memset(&new_pages[table->page_count], 0,
+            (page_count - table->page_count) * sizeof(*new_pages));
+        table->pages = new_pages;
+        table->page_count = page_count;
+    }
+
+    if(!table->pages[page_ndx])
+    {
+        table->pages[page_ndx] = calloc(DARSHAN_FD_TABLE_PAGE_SIZE,
+            sizeof(**table->pages));
+        if(!table->pages[page_ndx])
+            return(0);
+    }
+
+    table->pages[page_ndx][fd & (DARSHAN_FD_TABLE_PAGE_SIZE - 1)] = rec_ref_p;
+    return(1);
+}
+
+void *darshan_delete_fd_ref(struct darshan_fd_table *table, int fd)
+{
+    void *rec_ref_p;
+
+    rec_ref_p = darshan_lookup_fd_ref(table, fd);
+    if(rec_ref_p)
+        table->pages[fd / DARSHAN_FD_TABLE_PAGE_SIZE]
+            [fd & (DARSHAN_FD_TABLE_PAGE_SIZE - 1)] = NULL;
+
+    return(rec_ref_p);
+}
+
+void darshan_clear_fd_refs(struct darshan_fd_table *table)
+{
+    int i;
+
+    for(i = 0; i < table->page_count; i++)
+        free(table->pages[i]);
+    free(table->pages);
+    table->pages = NULL;
+    table->page_count = 0;
+
+    return;
+}
+
+/* the current working directory, as far as darshan_clean_file_path_id()
+ * is concerned, is identified by a generation number that is bumped
+ * whenever it may have changed; -1 means changes are not being tracked
+ * yet (i.e., the POSIX module has not initialized and none of its chdir
+ * wrappers have been called), so relative paths must not be memoized
+ */
+static int darshan_cwd_generation = -1;
+
+#define DARSHAN_PATH_CACHE_SIZE 64 /* must be a power of 2 */
+
+struct darshan_path_cache_entry
+{
+    uint64_t hash;
+    int cwd_gen; /* -1 for absolute paths */
+    int raw_len;
+    int clean_len;
+    darshan_record_id rec_id;
+    char *raw; /* the raw path, followed by the clean one */
+};
+
+struct darshan_path_cache
+{
+    int cwd_gen;
+    char cwd[PATH_MAX];
+    struct darshan_path_cache_entry entries[DARSHAN_PATH_CACHE_SIZE];
+};
+
+static pthread_key_t darshan_path_cache_key;
+static pthread_once_t darshan_path_cache_once = PTHREAD_ONCE_INIT;
+
+static void darshan_path_cache_destroy(void *cache_p)
+{
+    struct darshan_path_cache *cache = cache_p;
+    int i;
+
+    for(i = 0; i < DARSHAN_PATH_CACHE_SIZE; i++)
+        free(cache->entries[i].raw);
+    free(cache);
+
+    return;
+}
+
+static void darshan_path_cache_key_init(void)
+{
+    pthread_key_create(&darshan_path_cache_key, darshan_path_cache_destroy);
+    return;
+}
+
+void darshan_common_cwd_track(void)
+{
+    int gen = -1;
+
+    __atomic_compare_exchange_n(&darshan_cwd_generation, &gen, 0, 0,
+        __ATOMIC_RELEASE, __ATOMIC_RELAXED);
+
+    return;
+}
+
+void darshan_common_cwd_changed(void)
+{
+    int gen = __atomic_load_n(&darshan_cwd_generation, __ATOMIC_RELAXED);
+
+    /* NOTE: -1 is skipped when the counter wraps around */
+    while(!__atomic_compare_exchange_n(&darshan_cwd_generation, &gen,
+        (gen == INT_MAX) ? 0 : gen + 1, 0, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+
+    return;
+}
+
+/* writes the cleaned up version of 'path' to 'buf' (of size PATH_MAX) in a
+ * single pass, prefixing relative paths with 'cwd' and resolving "//", "."
+ * and ".." components; returns the length of the result, or -1 if it does
+ * not fit
+ */
+static int darshan_normalize_path(const char *cwd, const char *path, char *buf)
+{
+    const char *comp, *end;
+    int len = 0;
+    int comp_len;
+
+    if(path[0] != '/')
+    {
+        /* NOTE: getcwd() always returns a clean absolute path */
+        len = strlen(cwd);
+        if(len >= PATH_MAX)
+            return(-1);
+        memmove(buf, cwd, len);
+        if(len == 1)
+            len = 0; /* cwd is "/" */
+    }
+
+    for(comp = path; *comp; comp = end)
+    {
+        while(*comp == '/')
+            comp++;
+        if(!*comp)
+            break;
+        end = strchrnul(comp, '/');
+        comp_len = end - comp;
+
+        if(comp_len == 1 && comp[0] == '.')
+            continue;
+        if(comp_len == 2 && comp[0] == '.' && comp[1] == '.')
+        {
+            /* drop the last component, stopping at the root */
+            while(len > 0 && buf[len-1] != '/')
+                len--;
+            if(len > 0)
+                len--;
+            continue;
+        }
+
+        if(len + 1 + comp_len >= PATH_MAX)
+            return(-1);
+        buf[len++] = '/';
+        memcpy(&buf[len], comp, comp_len);
+        len += comp_len;
+    }
+
+    /* keep a trailing slash, which marks the path as a directory */
+    if(len == 0 || (path[strlen(path)-1] == '/' && len + 1 < PATH_MAX))
+        buf[len++] = '/';
+    buf[len] = '\0';
+
+    return(len);
+}
+
+char *darshan_clean_file_path_id(const char *path, char *buf,
+    darshan_record_id *rec_id)
+{
+    struct darshan_path_cache *cache;
+    struct darshan_path_cache_entry *entry;
+    uint64_t hash;
+    int cwd_gen = -1;
+    int raw_len;
+    int len;
+    char *tmp;
 
     /* NOTE: the last check in this if statement is for path strings that
      * begin with the '<' character.  We assume that these are special
      * reserved paths used by Darshan, like <STDIN>.
      */
-    if(!path || strlen(path) < 1 || path[0] == '<')
+    if(!path || path[0] == '\0' || path[0] == '<')
         return(NULL);
 
-    if(path[0] == '/')
+    pthread_once(&darshan_path_cache_once, darshan_path_cache_key_init);
+    cache = pthread_getspecific(darshan_path_cache_key);
+    if(!cache)
     {
-        /* it is already an absolute path */
-        newpath = malloc(strlen(path)+1);
-        if(newpath)
+        cache = calloc(1, sizeof(*cache));
+        if(cache)
         {
-            strcpy(newpath, path);
+            cache->cwd_gen = -1;
+            pthread_setspecific(darshan_path_cache_key, cache);
         }
     }
-    else
+
+    /* FNV-1a hash of the raw path, computed along with its length */
+    hash = 14695981039346656037ULL;
+    for(raw_len = 0; path[raw_len]; raw_len++)
+        hash = (hash ^ (unsigned char)path[raw_len]) * 1099511628211ULL;
+    if(path[0] != '/')
+        cwd_gen = __atomic_load_n(&darshan_cwd_generation, __ATOMIC_ACQUIRE);
+
+    /* relative paths are only memoized while the cwd is being tracked */
+    entry = NULL;
+    if(cache && (path[0] == '/' || cwd_gen >= 0))
     {
-        /* handle relative path */
-        cwd = malloc(PATH_MAX);
-        if(cwd)
+        entry = &cache->entries[hash & (DARSHAN_PATH_CACHE_SIZE - 1)];
+        if(entry->raw && entry->hash == hash && entry->cwd_gen == cwd_gen &&
+           entry->raw_len == raw_len && !memcmp(entry->raw, path, raw_len))
         {
-            if(getcwd(cwd, PATH_MAX))
-            {
-                newpath = malloc(strlen(path) + strlen(cwd) + 2);
-                if(newpath)
-                {
-                    sprintf(newpath, "%s/%s", cwd, path);
-                }
-            }
-            free(cwd);
+            memcpy(buf, entry->raw + raw_len + 1, entry->clean_len + 1);
+            *rec_id = entry->rec_id;
+            return(buf);
         }
     }
 
-    if(!newpath)
-        return(NULL);
-
-    /* filter out any double slashes */
-    while((filter = strstr(newpath, "//")))
+    if(path[0] == '/')
+        len = darshan_normalize_path(NULL, path, buf);
+    else if(cache && cwd_gen >= 0 && cache->cwd_gen == cwd_gen)
+        len = darshan_normalize_path(cache->cwd, path, buf);
+    else
     {
-        /* shift down one character */
-        memmove(filter, &filter[1], (strlen(&filter[1]) + 1));
+        /* NOTE: buf doubles as the cwd buffer when there is no cache */
+        tmp = cache ? cache->cwd : buf;
+        if(!getcwd(tmp, PATH_MAX))
+            return(NULL);
+        if(cache)
+            cache->cwd_gen = cwd_gen;
+        len = darshan_normalize_path(tmp, path, buf);
     }
+    if(len < 0)
+        return(NULL);
+    *rec_id = darshan_core_gen_record_id(buf);
 
-    /* filter out any /./ instances */
-    while((filter = strstr(newpath, "/./")))
+    if(entry)
     {
-        /* shift down two characters */
-        memmove(filter, &filter[2], (strlen(&filter[2]) + 1));
+        tmp = realloc(entry->raw, raw_len + len + 2);
+        if(tmp)
+        {
+            memcpy(tmp, path, raw_len + 1);
+            memcpy(tmp + raw_len + 1, buf, len + 1);
+            entry->raw = tmp;
+            entry->hash = hash;
+            entry->cwd_gen = cwd_gen;
+            entry->raw_len = raw_len;
+            entry->clean_len = len;
+            entry->rec_id = *rec_id;
+        }
     }
 
-    /* return result */
-    return(newpath);
+    return(buf);
+}
+
+char* darshan_clean_file_path(const char* path)
+{
+    char buf[PATH_MAX];
+    darshan_record_id rec_id;
+
+    if(!darshan_clean_file_path_id(path, buf, &rec_id))
+        return(NULL);
+
+    return(strdup(buf));
 }
 
 /* compare function for sorting file records according to their 
@@ -212,68 +473,382 @@ void darshan_record_sort(void *rec_buf, int rec_count, int rec_size)
     return;
 }
 
-static int darshan_common_val_compare(const void *a_p, const void *b_p)
+void darshan_common_val_counter(struct darshan_common_val_sketch *sketch,
+    int64_t val)
 {
-    const struct darshan_common_val_counter* a = a_p;
-    const struct darshan_common_val_counter* b = b_p;
+    int min_ndx = 0;
+    int i;
 
-    if(a->val < b->val)
-        return(-1);
-    if(a->val > b->val)
-        return(1);
-    return(0);
+    /* don't count any values of 0 */
+    if(val == 0)
+        return;
+
+    /* check to see if this val is already tracked (unused entries hold 0) */
+    for(i = 0; i < DARSHAN_COMMON_VAL_SKETCH_SIZE; i++)
+    {
+        if(sketch->vals[i] == val)
+        {
+            sketch->cnts[i]++;
+            return;
+        }
+    }
+
+    /* if not, it takes over the least frequent (or an unused) entry */
+    for(i = 1; i < DARSHAN_COMMON_VAL_SKETCH_SIZE; i++)
+    {
+        if(sketch->cnts[i] < sketch->cnts[min_ndx])
+            min_ndx = i;
+    }
+    sketch->vals[min_ndx] = val;
+    sketch->cnts[min_ndx]++;
+
+    return;
 }
 
-void darshan_common_val_counter(void **common_val_root, int *common_val_count,
-    int64_t val, int64_t *common_val_p, int64_t *common_cnt_p)
+void darshan_common_val_sketch_merge(struct darshan_common_val_sketch *src,
+    struct darshan_common_val_sketch *dst)
 {
-    struct darshan_common_val_counter* counter;
-    struct darshan_common_val_counter* found = NULL;
-    struct darshan_common_val_counter tmp_counter;
-    void* tmp;
+    int64_t vals[2 * DARSHAN_COMMON_VAL_SKETCH_SIZE];
+    int64_t cnts[2 * DARSHAN_COMMON_VAL_SKETCH_SIZE];
+    int64_t tmp;
+    int n = 0;
+    int i, j, max_ndx;
+
+    /* combine the counts of values tracked by both sketches */
+    for(i = 0; i < DARSHAN_COMMON_VAL_SKETCH_SIZE; i++)
+    {
+        if(dst->cnts[i] == 0)
+            continue;
+        vals[n] = dst->vals[i];
+        cnts[n] = dst->cnts[i];
+        n++;
+    }
+    for(i = 0; i < DARSHAN_COMMON_VAL_SKETCH_SIZE; i++)
+    {
+        if(src->cnts[i] == 0)
+            continue;
+        for(j = 0; j < n; j++)
+        {
+            if(vals[j] == src->vals[i])
+                break;
+        }
+        if(j == n)
+        {
+            vals[n] = src->vals[i];
+            cnts[n] = 0;
+            n++;
+        }
+        cnts[j] += src->cnts[i];
+    }
 
-    /* don't count any values of 0 */
-    if(val == 0)
-        return;
+    /* keep the most frequent of them */
+    memset(dst, 0, sizeof(*dst));
+    for(i = 0; i < n && i < DARSHAN_COMMON_VAL_SKETCH_SIZE; i++)
+    {
+        max_ndx = i;
+        for(j = i + 1; j < n; j++)
+        {
+            if(cnts[j] > cnts[max_ndx])
+                max_ndx = j;
+        }
+        tmp = vals[i]; vals[i] = vals[max_ndx]; vals[max_ndx] = tmp;
+        tmp = cnts[i]; cnts[i] = cnts[max_ndx]; cnts[max_ndx] = tmp;
+        dst->vals[i] = vals[i];
+        dst->cnts[i] = cnts[i];
+    }
+
+    return;
+}
+
+void darshan_common_val_sketch_top(struct darshan_common_val_sketch *sketch,
+    int64_t *val_p, int64_t *cnt_p)
+{
+    int j;
+    int64_t val, cnt;
+
+    /* copy each entry out first, DARSHAN_COMMON_VAL_COUNTER_INC declares
+     * its own loop index
+     */
+    for(j = 0; j < DARSHAN_COMMON_VAL_SKETCH_SIZE; j++)
+    {
+        if(sketch->cnts[j] == 0)
+            continue;
+        val = sketch->vals[j];
+        cnt = sketch->cnts[j];
+        DARSHAN_COMMON_VAL_COUNTER_INC(val_p, cnt_p, val, cnt, 0);
+    }
+
+    return;
+}
+
+/* map a handle to a slot in a thread's direct-mapped handle cache */
+#define DARSHAN_SHARD_CACHE_INDEX(__handle) \
+    (((__handle) ^ ((__handle) >> 7) ^ ((__handle) >> 17)) & \
+     (DARSHAN_SHARD_CACHE_SIZE - 1))
+
+/* thread-specific data destructor handing an exiting thread's shards back
+ * to the module that owns them
+ */
+static void darshan_shards_destroy(void *shards_p)
+{
+    struct darshan_thread_shards *shards = shards_p;
+
+    /* I/O from later destructors of this thread starts over with new
+     * shards
+     */
+    *shards->tls_p = NULL;
+    shards->reg->exit_action(shards);
 
-    /* check to see if this val is already recorded */
-    tmp_counter.val = val;
-    tmp_counter.freq = 1;
-    tmp = tfind(&tmp_counter, common_val_root, darshan_common_val_compare);
-    if(tmp)
+    return;
+}
+
+struct darshan_thread_shards *darshan_shards_enter(
+    struct darshan_shard_registry *reg, struct darshan_thread_shards **tls_p)
+{
+    struct darshan_thread_shards *shards = *tls_p;
+
+    if(!shards)
+    {
+        /* first call from this thread, register new thread shards */
+        shards = calloc(1, sizeof(*shards));
+        if(!shards)
+            return(NULL);
+        shards->reg = reg;
+        shards->tls_p = tls_p;
+
+        pthread_mutex_lock(&reg->mutex);
+        if(!reg->key_created && reg->exit_action &&
+           pthread_key_create(&reg->key, darshan_shards_destroy) == 0)
+            reg->key_created = 1;
+        shards->next = reg->thread_list;
+        reg->thread_list = shards;
+        pthread_mutex_unlock(&reg->mutex);
+        *tls_p = shards;
+        if(reg->key_created)
+            pthread_setspecific(reg->key, shards);
+    }
+
+    /* NOTE: the active flag must be visible before checking whether
+     * instrumentation is disabled, so that darshan_shards_quiesce() either
+     * waits on this thread or this thread observes the shutdown
+     */
+    __atomic_store_n(&shards->active, 1, __ATOMIC_SEQ_CST);
+    if(darshan_core_disabled_instrumentation())
     {
-        found = *(struct darshan_common_val_counter**)tmp;
-        found->freq++;
+        __atomic_store_n(&shards->active, 0, __ATOMIC_RELEASE);
+        return(NULL);
     }
-    else if(*common_val_count < DARSHAN_COMMON_VAL_MAX_RUNTIME_COUNT)
+
+    return(shards);
+}
+
+void darshan_shards_exit(struct darshan_thread_shards *shards)
+{
+    __atomic_store_n(&shards->active, 0, __ATOMIC_RELEASE);
+    return;
+}
+
+int darshan_shards_lookup(struct darshan_shard_registry *reg,
+    struct darshan_thread_shards *shards, uint64_t handle, void **shard_p)
+{
+    struct darshan_shard_cache_entry *entry =
+        &shards->cache[DARSHAN_SHARD_CACHE_INDEX(handle)];
+
+    if(entry->handle != handle || entry->gen !=
+       __atomic_load_n(&reg->gen[DARSHAN_SHARD_CACHE_INDEX(handle)],
+       __ATOMIC_ACQUIRE))
+        return(0);
+
+    *shard_p = entry->shard_p;
+    return(1);
+}
+
+void *darshan_shards_fill(struct darshan_shard_registry *reg,
+    struct darshan_thread_shards *shards, uint64_t handle, uint64_t gen,
+    void *rec_ref_p)
+{
+    struct darshan_shard_cache_entry *entry =
+        &shards->cache[DARSHAN_SHARD_CACHE_INDEX(handle)];
+    void *shard_p = NULL;
+
+    if(rec_ref_p)
     {
-        /* we can add a new one as long as we haven't hit the limit */
-        counter = malloc(sizeof(*counter));
-        if(!counter)
+        /* shards are indexed by the address of their record reference */
+        shard_p = darshan_lookup_record_ref(shards->shard_hash, &rec_ref_p,
+            sizeof(rec_ref_p));
+        if(!shard_p)
         {
-            return;
+            shard_p = calloc(1, reg->shard_sz);
+            if(!shard_p)
+                return(NULL);
+            *(void **)shard_p = rec_ref_p;
+            if(!darshan_add_record_ref(&shards->shard_hash, &rec_ref_p,
+                sizeof(rec_ref_p), shard_p))
+            {
+                free(shard_p);
+                return(NULL);
+            }
         }
+    }
 
-        counter->val = val;
-        counter->freq = 1;
+    entry->handle = handle;
+    entry->gen = gen;
+    entry->shard_p = shard_p;
 
-        tmp = tsearch(counter, common_val_root, darshan_common_val_compare);
-        found = *(struct darshan_common_val_counter**)tmp;
-        /* if we get a new answer out here we are in trouble; this was
-         * already checked with the tfind()
-         */
-        assert(found == counter);
+    return(shard_p);
+}
+
+uint64_t darshan_shards_gen(struct darshan_shard_registry *reg,
+    uint64_t handle)
+{
+    return(__atomic_load_n(&reg->gen[DARSHAN_SHARD_CACHE_INDEX(handle)],
+        __ATOMIC_ACQUIRE));
+}
+
+void darshan_shards_invalidate(struct darshan_shard_registry *reg,
+    uint64_t handle)
+{
+    __atomic_add_fetch(&reg->gen[DARSHAN_SHARD_CACHE_INDEX(handle)], 1,
+        __ATOMIC_ACQ_REL);
+    return;
+}
+
+void darshan_shards_quiesce(struct darshan_shard_registry *reg)
+{
+    struct darshan_thread_shards *shards;
+
+    pthread_mutex_lock(&reg->mutex);
+    for(shards = reg->thread_list; shards; shards = shards->next)
+    {
+        while(__atomic_load_n(&shards->active, __ATOMIC_SEQ_CST))
+            sched_yield();
+    }
+    pthread_mutex_unlock(&reg->mutex);
+
+    return;
+}
+
+void darshan_shards_iter(struct darshan_shard_registry *reg,
+    void (*iter_action)(void *))
+{
+    struct darshan_thread_shards *shards;
+
+    pthread_mutex_lock(&reg->mutex);
+    for(shards = reg->thread_list; shards; shards = shards->next)
+        darshan_iter_record_refs(shards->shard_hash, iter_action);
+    pthread_mutex_unlock(&reg->mutex);
+
+    return;
+}
+
+struct darshan_shard_event *darshan_shards_defer(
+    struct darshan_thread_shards *shards,
+    void (*apply_action)(struct darshan_shard_event *))
+{
+    int i;
+
+    if(darshan_event_ring_size <= 0)
+        return(NULL);
+
+    if(!shards->events)
+    {
+        shards->events = malloc(darshan_event_ring_size *
+            sizeof(*shards->events));
+        if(!shards->events)
+            return(NULL);
+    }
+    else if(shards->event_count == darshan_event_ring_size)
+    {
+        /* ring is full, apply the batch in the order it was recorded */
+        for(i = 0; i < shards->event_count; i++)
+            apply_action(&shards->events[i]);
+        shards->event_count = 0;
+    }
 
-        (*common_val_count)++;
+    return(&shards->events[shards->event_count++]);
+}
+
+void darshan_shards_drain(struct darshan_shard_registry *reg,
+    void (*apply_action)(struct darshan_shard_event *))
+{
+    struct darshan_thread_shards *shards;
+    int i;
+
+    pthread_mutex_lock(&reg->mutex);
+    for(shards = reg->thread_list; shards; shards = shards->next)
+    {
+        for(i = 0; i < shards->event_count; i++)
+            apply_action(&shards->events[i]);
+        shards->event_count = 0;
+    }
+    pthread_mutex_unlock(&reg->mutex);
+
+    return;
+}
+
+int darshan_shards_pending(struct darshan_shard_registry *reg)
+{
+    struct darshan_thread_shards *shards;
+    int pending = 0;
+
+    pthread_mutex_lock(&reg->mutex);
+    for(shards = reg->thread_list; shards; shards = shards->next)
+        pending += __atomic_load_n(&shards->event_count, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&reg->mutex);
+
+    return(pending);
+}
+
+void darshan_shards_release(struct darshan_shard_registry *reg,
+    struct darshan_thread_shards *shards,
+    void (*apply_action)(struct darshan_shard_event *),
+    void (*iter_action)(void *))
+{
+    struct darshan_thread_shards **prev_p;
+    int i;
+
+    pthread_mutex_lock(&reg->mutex);
+    for(prev_p = &reg->thread_list; *prev_p; prev_p = &(*prev_p)->next)
+    {
+        if(*prev_p == shards)
+        {
+            *prev_p = shards->next;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&reg->mutex);
+
+    if(apply_action)
+    {
+        for(i = 0; i < shards->event_count; i++)
+            apply_action(&shards->events[i]);
     }
+    if(iter_action)
+        darshan_iter_record_refs(shards->shard_hash, iter_action);
+    darshan_clear_record_refs(&shards->shard_hash, 1);
+    free(shards->events);
+    free(shards);
+
+    return;
+}
 
-    /* update common access counters as we go, as long as we haven't already
-     * hit the limit in the number we are willing to track */
-    if(found)
+void darshan_shards_clear(struct darshan_shard_registry *reg)
+{
+    struct darshan_thread_shards *shards;
+    int i;
+
+    pthread_mutex_lock(&reg->mutex);
+    for(shards = reg->thread_list; shards; shards = shards->next)
     {
-        DARSHAN_COMMON_VAL_COUNTER_INC(common_val_p, common_cnt_p,
-            found->val, found->freq, 1);
+        darshan_clear_record_refs(&shards->shard_hash, 1);
+        /* deferred events refer to the shards we just freed */
+        shards->event_count = 0;
     }
+    pthread_mutex_unlock(&reg->mutex);
+
+    /* cached handle lookups may refer to the shards we just freed */
+    for(i = 0; i < DARSHAN_SHARD_CACHE_SIZE; i++)
+        __atomic_add_fetch(&reg->gen[i], 1, __ATOMIC_ACQ_REL);
 
     return;
 }
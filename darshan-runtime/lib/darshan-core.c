@@ -21,15 +21,29 @@
 #include <fcntl.h>
 #include <stdarg.h>
 #include <dirent.h>
+#include <fnmatch.h>
+#include <ctype.h>
 #include <sys/ioctl.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/mman.h>
+#include <sys/file.h>
+#include <sys/wait.h>
 #include <sys/vfs.h>
+#include <sys/syscall.h>
 #include <zlib.h>
+#ifdef HAVE_LIBZSTD
+#include <zstd.h>
+#endif
+#ifdef HAVE_LIBLZ4
+#include <lz4frame.h>
+#endif
 #include <assert.h>
-#ifdef __DARSHAN_TRAP_SIGNALS
+#include <errno.h>
 #include <signal.h>
+#include <semaphore.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
 #endif
 
 #include "uthash.h"
@@ -44,15 +58,32 @@
 
 extern char* __progname;
 extern char* __progname_full;
+extern char **environ;
 
 /* internal variable delcarations */
 static struct darshan_core_runtime *darshan_core = NULL;
 static pthread_mutex_t darshan_core_mutex = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+/* lock-free copies of darshan_core state needed on module fast paths */
+static int darshan_core_enabled = 0;
+/* set on darshan's own threads, whose I/O is not instrumented */
+static __thread int darshan_core_thread_disabled = 0;
+static double darshan_core_wtime_offset = 0;
 static int my_rank = -1;
 static int nprocs = -1;
 static int using_mpi;
 static int darshan_mem_alignment = 1;
 static long darshan_mod_mem_quota = DARSHAN_MOD_MEM_MAX;
+static int darshan_comp_type = DARSHAN_ZLIB_COMP;
+static int darshan_hash_type = DARSHAN_DEF_HASH;
+static int darshan_comp_level = Z_DEFAULT_COMPRESSION;
+static struct darshan_core_checkpoint darshan_ckpt;
+static struct darshan_core_collector darshan_collect;
+static struct darshan_core_pieces darshan_pieces;
+#ifdef HAVE_MPI
+/* communicators for node-aggregated log writes, if enabled */
+static MPI_Comm darshan_node_comm = MPI_COMM_NULL;
+static MPI_Comm darshan_leader_comm = MPI_COMM_NULL;
+#endif
 
 /* paths prefixed with the following directories are not tracked by darshan */
 char* darshan_path_exclusions[] = {
@@ -77,8 +108,12 @@ char* darshan_path_inclusions[] = {
     NULL
 };
 
-/* allow users to override the path exclusions */
-char** user_darshan_path_exclusions = NULL;
+/* the exclusion and inclusion rules above (or the user's rules, if given)
+ * are compiled into a single rule set, which each module shares unless
+ * the user gave it additional rules of its own
+ */
+static struct darshan_core_path_rules darshan_path_rules;
+static struct darshan_core_path_rules *darshan_mod_path_rules[DARSHAN_MAX_MODS];
 
 #ifdef DARSHAN_BGQ
 extern void bgq_runtime_initialize();
@@ -102,11 +137,11 @@ void (*mod_static_init_fns[])(void) =
 extern void darshan_instrument_lustre_file(const char *filepath, int fd);
 #endif
 
-#define DARSHAN_CORE_LOCK() pthread_mutex_lock(&darshan_core_mutex)
+#define DARSHAN_CORE_LOCK() \
+    DARSHAN_SELF_LOCK(&darshan_core_mutex, DARSHAN_SELF_MOD)
 #define DARSHAN_CORE_UNLOCK() pthread_mutex_unlock(&darshan_core_mutex)
 
 /* FS mount information */
-#define DARSHAN_MAX_MNTS 64
 #define DARSHAN_MAX_MNT_PATH 256
 #define DARSHAN_MAX_MNT_TYPE 32
 struct mnt_data
@@ -115,23 +150,76 @@ struct mnt_data
     char type[DARSHAN_MAX_MNT_TYPE];
     struct darshan_fs_info fs_info;
 };
-static struct mnt_data mnt_data_array[DARSHAN_MAX_MNTS];
+static struct mnt_data *mnt_data_array = NULL;
 static int mnt_data_count = 0;
+static int mnt_data_max = 0;
+
+/* mount points are looked up in a radix tree with one node per path
+ * component, so that finding the mount point a file resides on costs
+ * O(path depth) rather than a scan over every mount point
+ */
+struct mnt_tree_node
+{
+    const char *name; /* path component (not NUL terminated) */
+    int name_len;
+    int mnt_index; /* index into mnt_data_array, or -1 */
+    int child_count;
+    int child_max;
+    int *children; /* indices into mnt_tree, sorted by component name */
+};
+static struct mnt_tree_node *mnt_tree = NULL;
+static int mnt_tree_count = 0;
+static int mnt_tree_max = 0;
+
+/* header of the node-local mount table cache file, which is followed by
+ * an array of 'count' mnt_data structures (in mount table order)
+ */
+#define DARSHAN_MNT_CACHE_MAGIC 0x44534D4E54434831ULL /* "DSMNTCH1" */
+#define DARSHAN_MNT_CACHE_VER 1
+struct mnt_cache_header
+{
+    uint64_t magic;
+    uint64_t fingerprint;
+    uint32_t version;
+    uint32_t entry_size;
+    uint32_t count;
+    uint32_t pad;
+};
 
 /* prototypes for internal helper functions */
 #ifdef __DARSHAN_ENABLE_MMAP_LOGS
 static void *darshan_init_mmap_log(
     struct darshan_core_runtime* core, int jobid);
 #endif
+static int darshan_mod_mem_reserve(
+    struct darshan_core_runtime *core, struct darshan_core_module *mod);
+static int darshan_mod_mem_commit(
+    struct darshan_core_runtime *core, struct darshan_core_module *mod,
+    int len);
+static void darshan_mod_mem_release(
+    struct darshan_core_runtime *core, struct darshan_core_module *mod);
 static void darshan_log_record_hints_and_ver(
     struct darshan_core_runtime* core);
-static void darshan_get_exe_and_mounts(
+static void darshan_path_rules_init(
+    void);
+static void darshan_get_exe(
     struct darshan_core_runtime *core, int argc, char **argv);
+static void darshan_get_mounts(
+    struct darshan_core_runtime *core);
+static void darshan_core_lazy_init(
+    void);
 static void darshan_fs_info_from_path(
     const char *path, struct darshan_fs_info *fs_info);
+static void *darshan_name_mem_alloc(
+    struct darshan_core_runtime *core, int len);
 static int darshan_add_name_record_ref(
     struct darshan_core_runtime *core, darshan_record_id rec_id,
     const char *name, darshan_module_id mod_id);
+static int darshan_name_record_ref_cmp(
+    const void *a, const void *b);
+static int darshan_name_record_encode(
+    char *buf, darshan_record_id id, const char *prev_name,
+    const char *name);
 static void darshan_get_user_name(
     char *user);
 static void darshan_get_logfile_name(
@@ -146,26 +234,89 @@ static int darshan_log_open_all(
 static int darshan_log_open_all(
     char *logfile_name, int *log_fh);
 #endif
+static void darshan_comp_select(
+    void);
+static int darshan_comp_bound(
+    int len);
 static int darshan_deflate_buffer(
     void **pointers, int *lengths, int count, char *comp_buf,
     int *comp_buf_length);
+static int darshan_log_pack_name_records(
+    struct darshan_core_runtime *core, char **name_buf, int *name_buf_len);
+#ifdef HAVE_MPI
+static int darshan_log_route_name_records(
+    struct darshan_core_runtime *core, char **name_buf, int *name_buf_len);
+#endif
+static struct darshan_core_comp_pool *darshan_comp_pool_create(
+    int nthreads);
+static void darshan_comp_pool_destroy(
+    struct darshan_core_comp_pool *pool);
+static void darshan_comp_pool_submit(
+    struct darshan_core_comp_pool *pool, int job_id, void *buf, int len);
+static struct darshan_core_comp_job *darshan_comp_pool_wait(
+    struct darshan_core_comp_pool *pool, int job_id);
+static void *darshan_comp_pool_worker(
+    void *arg);
+static void darshan_comp_job_run(
+    struct darshan_core_comp_job *job);
 #ifdef HAVE_MPI
-static int darshan_log_write_name_record_hash(
-    struct darshan_mpi_file log_fh, struct darshan_core_runtime *core,
+static void darshan_log_node_comms_create(
+    void);
+static void darshan_log_node_comms_free(
+    void);
+static int darshan_log_append_node(
+    struct darshan_mpi_file log_fh, struct darshan_core_comp_job *job,
     uint64_t *inout_off);
 static int darshan_log_append_all(
-    struct darshan_mpi_file log_fh, struct darshan_core_runtime *core, void *buf,
-    int count, uint64_t *inout_off);
-#else
-static int darshan_log_write_name_record_hash(
-    int log_fh, struct darshan_core_runtime *core,
+    struct darshan_mpi_file log_fh, struct darshan_core_comp_job *job,
     uint64_t *inout_off);
+#else
 static int darshan_log_append_all(
-    int log_fh, struct darshan_core_runtime *core, void *buf,
-    int count, uint64_t *inout_off);
+    int log_fh, struct darshan_core_comp_job *job,
+    uint64_t *inout_off);
 #endif /* #ifdef HAVE_MPI */
+static void darshan_checkpoint_start(
+    int jobid, time_t start_time);
+static int darshan_checkpoint_stop(
+    void);
+static void darshan_checkpoint_signal(
+    int signum);
+static void *darshan_checkpoint_thread(
+    void *arg);
+static int darshan_checkpoint_write(
+    void);
+static int darshan_checkpoint_append(
+    int fd, void *buf, int len, uint64_t *inout_off);
+static void darshan_collector_init(
+    int key, int key_is_jobid);
+static int darshan_collector_join(
+    void);
+static int darshan_collector_prune(
+    void);
+static int darshan_collector_log_name(
+    char *logfile_name);
+static void darshan_collector_leave(
+    struct darshan_core_runtime *core);
+static int darshan_collector_merge(
+    char *merge_dir, char *logfile_name);
+#ifdef HAVE_MPI
+static int darshan_pieces_dir_name(
+    char *log_name, char *pieces_path);
+static void darshan_pieces_init(
+    struct darshan_core_runtime *core, int jobid);
+#endif
+static int darshan_pieces_log_name(
+    char *logfile_name);
+static void darshan_pieces_write_manifest(
+    void);
+static void darshan_log_complete(
+    char *logfile_name, double start_log_time, int rename_partial);
 static void darshan_core_cleanup(
     struct darshan_core_runtime* core);
+static void darshan_timer_select(
+    void);
+static void darshan_timer_calibrate(
+    void);
 static double time_nanoseconds();
 
 /* *********************************** */
@@ -200,6 +351,9 @@ void darshan_core_initialize(int argc, char **argv)
     if(getenv("DARSHAN_INTERNAL_TIMING"))
         internal_timing_flag = 1;
 
+    /* pick the timer backend before taking any timestamps */
+    darshan_timer_select();
+
     if(internal_timing_flag)
         init_start = time_nanoseconds();
 
@@ -248,6 +402,7 @@ void darshan_core_initialize(int argc, char **argv)
         {
             /* use pid as fall back */
             jobid = getpid();
+            jobid_str = NULL;
         }
 
         /* set the memory quota for darshan modules' records */
@@ -262,6 +417,32 @@ void darshan_core_initialize(int argc, char **argv)
             }
         }
 
+        /* DXT stores its trace data in module memory, so make room for
+         * the DXT trace quota on top of the other modules' records
+         */
+        envstr = getenv("DXT_ENABLE_IO_TRACE");
+        if(envstr)
+        {
+            ret = sscanf(envstr, "%lf", &tmpfloat);
+            if(ret == 1 && tmpfloat > 0)
+                darshan_mod_mem_quota += tmpfloat * 1024 * 1024;
+            else
+                darshan_mod_mem_quota += DXT_IO_TRACE_MEM_MAX;
+        }
+
+        /* select the hash function used to generate record ids */
+        envstr = getenv(DARSHAN_HASH_OVERRIDE);
+        if(envstr)
+        {
+            if(strcmp(envstr, "wyhash") == 0)
+                darshan_hash_type = DARSHAN_WYHASH_HASH;
+            else if(strcmp(envstr, "jenkins") == 0)
+                darshan_hash_type = DARSHAN_JENKINS_HASH;
+            else if(my_rank == 0)
+                darshan_core_fprintf(stderr, "darshan library warning: "
+                    "unsupported %s value '%s'\n", DARSHAN_HASH_OVERRIDE, envstr);
+        }
+
         /* allocate structure to track darshan core runtime information */
         init_core = malloc(sizeof(*init_core));
         if(init_core)
@@ -269,19 +450,17 @@ void darshan_core_initialize(int argc, char **argv)
             memset(init_core, 0, sizeof(*init_core));
             init_core->wtime_offset = time_nanoseconds();
 
-        /* TODO: do we alloc new memory as we go or just do everything up front? */
-
 #ifndef __DARSHAN_ENABLE_MMAP_LOGS
             /* just allocate memory for each log file region */
+            /* NOTE: module memory is reserved and committed on demand as
+             * modules register with darshan-core
+             */
             init_core->log_hdr_p = malloc(sizeof(struct darshan_header));
             init_core->log_job_p = malloc(sizeof(struct darshan_job));
             init_core->log_exemnt_p = malloc(DARSHAN_EXE_LEN+1);
-            init_core->log_name_p = malloc(DARSHAN_NAME_RECORD_BUF_SIZE);
-            init_core->log_mod_p = malloc(darshan_mod_mem_quota);
 
             if(!(init_core->log_hdr_p) || !(init_core->log_job_p) ||
-               !(init_core->log_exemnt_p) || !(init_core->log_name_p) ||
-               !(init_core->log_mod_p))
+               !(init_core->log_exemnt_p))
             {
                 free(init_core);
                 return;
@@ -290,8 +469,6 @@ void darshan_core_initialize(int argc, char **argv)
             memset(init_core->log_hdr_p, 0, sizeof(struct darshan_header));
             memset(init_core->log_job_p, 0, sizeof(struct darshan_job));
             memset(init_core->log_exemnt_p, 0, DARSHAN_EXE_LEN+1);
-            memset(init_core->log_name_p, 0, DARSHAN_NAME_RECORD_BUF_SIZE);
-            memset(init_core->log_mod_p, 0, darshan_mod_mem_quota);
 #else
             /* if mmap logs are enabled, we need to initialize the mmap region
              * before setting the corresponding log file region pointers
@@ -311,8 +488,6 @@ void darshan_core_initialize(int argc, char **argv)
                 ((char *)init_core->log_job_p + sizeof(struct darshan_job));
             init_core->log_name_p = (void *)
                 ((char *)init_core->log_exemnt_p + DARSHAN_EXE_LEN + 1);
-            init_core->log_mod_p = (void *)
-                ((char *)init_core->log_name_p + DARSHAN_NAME_RECORD_BUF_SIZE);
 
             /* set header fields needed for the mmap log mechanism */
             init_core->log_hdr_p->comp_type = DARSHAN_NO_COMP;
@@ -323,6 +498,7 @@ void darshan_core_initialize(int argc, char **argv)
             /* set known header fields for the log file */
             strcpy(init_core->log_hdr_p->version_string, DARSHAN_LOG_VERSION);
             init_core->log_hdr_p->magic_nr = DARSHAN_MAGIC_NR;
+            init_core->log_hdr_p->hash_type = darshan_hash_type;
 
             /* set known job-level metadata fields for the log file */
             init_core->log_job_p->uid = getuid();
@@ -335,22 +511,56 @@ void darshan_core_initialize(int argc, char **argv)
              */
             darshan_log_record_hints_and_ver(init_core);
 
-            /* collect information about command line and mounted file systems */
-            darshan_get_exe_and_mounts(init_core, argc, argv);
+            /* collect information about the command line */
+            /* NOTE: mounted file systems are collected lazily, see
+             * darshan_core_lazy_init()
+             */
+            darshan_get_exe(init_core, argc, argv);
+
+#ifdef HAVE_MPI
+            /* agree on where the pieces of the log go, if the log is
+             * written in pieces
+             */
+            if(using_mpi && getenv(DARSHAN_LOG_PIECES_OVERRIDE))
+                darshan_pieces_init(init_core, jobid);
+#endif
 
             /* if darshan was successfully initialized, set the global pointer
              * and bootstrap any modules with static initialization routines
              */
             DARSHAN_CORE_LOCK();
             darshan_core = init_core;
+            darshan_core_wtime_offset = init_core->wtime_offset;
+            __atomic_store_n(&darshan_core_enabled, 1, __ATOMIC_SEQ_CST);
+            if(using_mpi)
+                darshan_core_lazy_init();
             DARSHAN_CORE_UNLOCK();
 
+            if(getenv(DARSHAN_SELF_PROFILE_OVERRIDE))
+                darshan_self_profile = 1;
+
+            /* silently ignore if the env variable is set poorly */
+            envstr = getenv(DARSHAN_EVENT_RING_OVERRIDE);
+            if(envstr && sscanf(envstr, "%d", &tmpval) == 1 && tmpval > 0)
+                darshan_event_ring_size = tmpval;
+
             i = 0;
             while(mod_static_init_fns[i])
             {
                 (*mod_static_init_fns[i])();
                 i++;
             }
+
+            /* checkpoints are only written by processes that do not
+             * use MPI, as there is no collective point to write them at
+             */
+            if(!using_mpi)
+                darshan_checkpoint_start(jobid, init_core->log_job_p->start_time);
+
+            /* processes without a job id are collected by session */
+            if(!using_mpi && getenv(DARSHAN_COLLECT_OVERRIDE))
+                darshan_collector_init(jobid_str ? jobid : getsid(0),
+                    jobid_str != NULL);
         }
     }
 
@@ -388,8 +598,17 @@ void darshan_core_shutdown()
     double rec1 = 0, rec2 = 0;
     double mod1[DARSHAN_MAX_MODS] = {0};
     double mod2[DARSHAN_MAX_MODS] = {0};
+    double write1[DARSHAN_MAX_MODS] = {0};
+    double write2[DARSHAN_MAX_MODS] = {0};
+    double comp_tm[DARSHAN_MAX_MODS + 1] = {0};
     double header1 = 0, header2 = 0;
     char *logfile_name;
+    char *name_buf = NULL;
+    int name_buf_len = 0;
+    int comp_threads = DARSHAN_DEF_COMP_THREADS;
+    long comp_size;
+    struct darshan_core_comp_job *job;
+    char *envstr;
     int local_mod_use[DARSHAN_MAX_MODS] = {0};
     int global_mod_use_count[DARSHAN_MAX_MODS] = {0};
     darshan_record_id *shared_recs;
@@ -397,7 +616,9 @@ void darshan_core_shutdown()
     int shared_rec_cnt = 0;
     int ret = 0;
     int all_ret = 0;
-    int i;
+    int ckpt_owner;
+    int collected = 0;
+    int i, k;
     uint64_t gz_fp = 0;
 #ifdef HAVE_MPI
     struct darshan_mpi_file log_fh;
@@ -409,6 +630,31 @@ void darshan_core_shutdown()
     if(getenv("DARSHAN_INTERNAL_TIMING"))
         internal_timing_flag = 1;
 
+    envstr = getenv(DARSHAN_COMP_THREADS_OVERRIDE);
+    if(envstr)
+    {
+        /* silently ignore if the env variable is set poorly */
+        if(sscanf(envstr, "%d", &ret) == 1 && ret >= 0)
+            comp_threads = ret;
+        if(comp_threads > DARSHAN_MAX_COMP_THREADS)
+            comp_threads = DARSHAN_MAX_COMP_THREADS;
+        ret = 0;
+    }
+    darshan_comp_select();
+
+    /* stop writing checkpoints before any module is shut down */
+    ckpt_owner = darshan_checkpoint_stop();
+
+    /* processes writing their own piece of the log shut down on their own,
+     * just like processes that do not use MPI
+     */
+    if(darshan_pieces.dir[0])
+    {
+        using_mpi = 0;
+        my_rank = 0;
+        nprocs = 1;
+    }
+
     /* synchronize before getting start time */
 #ifdef HAVE_MPI
     darshan_mpi_barrier(MPI_COMM_WORLD);
@@ -424,6 +670,7 @@ void darshan_core_shutdown()
     }
     final_core = darshan_core;
     darshan_core = NULL;
+    __atomic_store_n(&darshan_core_enabled, 0, __ATOMIC_SEQ_CST);
     DARSHAN_CORE_UNLOCK();
 
 #ifdef __DARSHAN_ENABLE_MMAP_LOGS
@@ -436,6 +683,27 @@ void darshan_core_shutdown()
     unlink(final_core->mmap_log_name);
 #endif
 
+    /* serial processes that never stored a record don't write a log.
+     * processes writing a piece of the log always write it, so that the
+     * assembly can tell that every piece is present
+     */
+    if(!using_mpi && !darshan_pieces.dir[0])
+    {
+        for(i = 0; i < DARSHAN_MAX_MODS; i++)
+        {
+            if(final_core->mod_array[i] && final_core->mod_array[i]->rec_buf_p !=
+               final_core->mod_array[i]->rec_buf_start)
+                break;
+        }
+        if(i == DARSHAN_MAX_MODS)
+        {
+            if(ckpt_owner)
+                unlink(darshan_ckpt.log_name);
+            darshan_core_cleanup(final_core);
+            return;
+        }
+    }
+
     final_core->log_job_p->end_time = time(NULL);
 
 #ifdef HAVE_MPI
@@ -451,7 +719,13 @@ void darshan_core_shutdown()
     }
 #endif
 
-    final_core->comp_buf = malloc(darshan_mod_mem_quota);
+    /* NOTE: this buffer is only used for the job data, the name map and
+     * module regions are compressed into buffers owned by the compression
+     * pool
+     */
+    final_core->comp_buf_sz = darshan_comp_bound(sizeof(struct darshan_job) +
+        DARSHAN_EXE_LEN + 1);
+    final_core->comp_buf = malloc(final_core->comp_buf_sz);
     if(!(final_core->comp_buf))
     {
         darshan_core_cleanup(final_core);
@@ -472,7 +746,15 @@ void darshan_core_shutdown()
         start_time_tmp = final_core->log_job_p->start_time;
         start_tm = localtime(&start_time_tmp);
 
-        darshan_get_logfile_name(logfile_name, final_core->log_job_p->jobid, start_tm);
+        /* collected logs are deposited in a node-local directory, and
+         * pieces of a log in the job's pieces directory
+         */
+        if(darshan_collect.pid)
+            collected = (darshan_collector_log_name(logfile_name) == 0);
+        else if(darshan_pieces.dir[0])
+            collected = (darshan_pieces_log_name(logfile_name) == 0);
+        if(!collected)
+            darshan_get_logfile_name(logfile_name, final_core->log_job_p->jobid, start_tm);
     }
 
 #ifdef HAVE_MPI
@@ -507,8 +789,19 @@ void darshan_core_shutdown()
     memcpy(global_mod_use_count, local_mod_use, DARSHAN_MAX_MODS * sizeof(*local_mod_use));
 #endif
 
-    /* get a list of records which are shared across all processes */
-    darshan_get_shared_records(final_core, &shared_recs, &shared_rec_cnt);
+    /* get a list of records which are shared across all processes, and
+     * find which process writes the name of records shared by only some
+     *
+     * NOTE: the records in pieces of a log are reduced when the pieces
+     * are assembled
+     */
+    if(darshan_pieces.dir[0])
+    {
+        shared_recs = malloc(sizeof(darshan_record_id));
+        assert(shared_recs);
+    }
+    else
+        darshan_get_shared_records(final_core, &shared_recs, &shared_rec_cnt);
 
 
     if(internal_timing_flag)
@@ -532,6 +825,9 @@ void darshan_core_shutdown()
         darshan_core_cleanup(final_core);
         return;
     }
+
+    /* set up node-aggregated writes of the log regions, if requested */
+    darshan_log_node_comms_create();
 #endif
 
     if(internal_timing_flag)
@@ -541,7 +837,7 @@ void darshan_core_shutdown()
     {
         void *pointers[2] = {final_core->log_job_p, final_core->log_exemnt_p};
         int lengths[2] = {sizeof(struct darshan_job), strlen(final_core->log_exemnt_p)};
-        int comp_buf_sz = 0;
+        int comp_buf_sz = final_core->comp_buf_sz;
         ssize_t written;
 
         /* compress the job info and the trailing mount/exe data */
@@ -589,16 +885,42 @@ void darshan_core_shutdown()
     if(internal_timing_flag)
         job2 = time_nanoseconds();
 
-    if(internal_timing_flag)
-        rec1 = time_nanoseconds();
-    /* write the record name->id hash to the log file */
-    final_core->log_hdr_p->name_map.off = gz_fp;
-    ret = darshan_log_write_name_record_hash(log_fh, final_core, &gz_fp);
-    final_core->log_hdr_p->name_map.len = gz_fp - final_core->log_hdr_p->name_map.off;
+    /* serialize the record name->id hash */
+#ifdef HAVE_MPI
+    ret = darshan_log_route_name_records(final_core, &name_buf, &name_buf_len);
+#else
+    ret = darshan_log_pack_name_records(final_core, &name_buf, &name_buf_len);
+#endif
+
+    /* start the pool of threads that compress log regions, so that regions
+     * are compressed while we shut down modules and write out regions that
+     * have already been compressed. small logs are just compressed inline
+     */
+    comp_size = name_buf_len;
+    for(i = 0; i < DARSHAN_MAX_MODS; i++)
+    {
+        if(final_core->mod_array[i])
+            comp_size += final_core->mod_array[i]->rec_buf_p -
+                final_core->mod_array[i]->rec_buf_start;
+    }
+    if(comp_size < DARSHAN_COMP_THREADS_MIN_SIZE)
+        comp_threads = 0;
+    final_core->comp_pool = darshan_comp_pool_create(comp_threads);
+    if(!final_core->comp_pool)
+        ret = -1;
+    if(ret == 0)
+    {
+        /* queue the name records for compression */
+        darshan_comp_pool_submit(final_core->comp_pool, DARSHAN_MAX_MODS,
+            name_buf, name_buf_len);
+    }
 
 #ifdef HAVE_MPI
-    /* error out if unable to write the name record hash */
+    /* error out if unable to prepare the name record hash */
     darshan_mpi_allreduce(&ret, &all_ret, 1, MPI_INT, MPI_LOR, MPI_COMM_WORLD);
+#else
+    all_ret = ret;
+#endif
     if(all_ret != 0)
     {
         if(my_rank == 0)
@@ -610,31 +932,37 @@ void darshan_core_shutdown()
         }
         free(logfile_name);
         darshan_core_cleanup(final_core);
+        free(name_buf);
         return;
     }
-#endif
-    if(internal_timing_flag)
-        rec2 = time_nanoseconds();
 
     mod_shared_recs = malloc(shared_rec_cnt * sizeof(darshan_record_id));
     assert(mod_shared_recs);
 
     /* loop over globally used darshan modules and:
      *      - get final output buffer
-     *      - compress (zlib) provided output buffer
-     *      - append compressed buffer to log file
-     *      - add module map info (file offset/length) to log header
+     *      - queue the output buffer for compression (zlib)
      *      - shutdown the module
+     *
+     * NOTE: modules are visited in id order, except for the SELF module,
+     * which goes last so that it only stops counting once no other module
+     * can call into Darshan anymore
      */
-    for(i = 0; i < DARSHAN_MAX_MODS; i++)
+    for(k = 0; k < DARSHAN_MAX_MODS; k++)
     {
-        struct darshan_core_module* this_mod = final_core->mod_array[i];
+        struct darshan_core_module* this_mod;
         struct darshan_core_name_record_ref *ref = NULL;
         int mod_shared_rec_cnt = 0;
         void* mod_buf = NULL;
         int mod_buf_sz = 0;
         int j;
 
+        if(k == DARSHAN_MAX_MODS - 1)
+            i = DARSHAN_SELF_MOD;
+        else
+            i = (k < DARSHAN_SELF_MOD) ? k : k + 1;
+        this_mod = final_core->mod_array[i];
+
         if(global_mod_use_count[i] == 0)
         {
             if(my_rank == 0)
@@ -678,18 +1006,63 @@ void darshan_core_shutdown()
                 mod_shared_rec_cnt, &mod_buf, &mod_buf_sz);
         }
 
-        /* append this module's data to the darshan log */
+        /* NOTE: modules not registered locally still queue an empty region,
+         * so every process takes part in each region's collective write
+         */
+        darshan_comp_pool_submit(final_core->comp_pool, i, mod_buf, mod_buf_sz);
+
+        if(internal_timing_flag)
+            mod2[i] = time_nanoseconds();
+    }
+
+    if(internal_timing_flag)
+        rec1 = time_nanoseconds();
+    /* write the record name->id hash to the log file once compressed */
+    job = darshan_comp_pool_wait(final_core->comp_pool, DARSHAN_MAX_MODS);
+    comp_tm[DARSHAN_MAX_MODS] = job->comp_time;
+    final_core->log_hdr_p->name_map.off = gz_fp;
+    ret = darshan_log_append_all(log_fh, job, &gz_fp);
+    final_core->log_hdr_p->name_map.len = gz_fp - final_core->log_hdr_p->name_map.off;
+    free(name_buf);
+
+#ifdef HAVE_MPI
+    /* error out if unable to write the name record hash */
+    darshan_mpi_allreduce(&ret, &all_ret, 1, MPI_INT, MPI_LOR, MPI_COMM_WORLD);
+    if(all_ret != 0)
+    {
+        if(my_rank == 0)
+        {
+            darshan_core_fprintf(stderr,
+                "darshan library warning: unable to write record hash to log file %s\n",
+                logfile_name);
+            unlink(logfile_name);
+        }
+        free(logfile_name);
+        darshan_core_cleanup(final_core);
+        return;
+    }
+#endif
+    if(internal_timing_flag)
+        rec2 = time_nanoseconds();
+
+    /* append each module's compressed data to the darshan log, in order,
+     * and add module map info (file offset/length) to log header
+     */
+    for(i = 0; i < DARSHAN_MAX_MODS; i++)
+    {
+        if(global_mod_use_count[i] == 0)
+            continue;
+
+        if(internal_timing_flag)
+            write1[i] = time_nanoseconds();
+
+        job = darshan_comp_pool_wait(final_core->comp_pool, i);
+        comp_tm[i] = job->comp_time;
         final_core->log_hdr_p->mod_map[i].off = gz_fp;
-        ret = darshan_log_append_all(log_fh, final_core, mod_buf, mod_buf_sz, &gz_fp);
+        ret = darshan_log_append_all(log_fh, job, &gz_fp);
         final_core->log_hdr_p->mod_map[i].len =
             gz_fp - final_core->log_hdr_p->mod_map[i].off;
 
-        /* XXX: DXT manages its own module memory buffers, so we need to
-         * explicitly free them
-         */
-        if(i == DXT_POSIX_MOD || i == DXT_MPIIO_MOD)
-            free(mod_buf);
-
 #ifdef HAVE_MPI
         /* error out if the log append failed */
         darshan_mpi_allreduce(&ret, &all_ret, 1, MPI_INT, MPI_LOR, MPI_COMM_WORLD);
@@ -709,7 +1082,7 @@ void darshan_core_shutdown()
 #endif
 
         if(internal_timing_flag)
-            mod2[i] = time_nanoseconds();
+            write2[i] = time_nanoseconds();
     }
 
     if(internal_timing_flag)
@@ -724,7 +1097,7 @@ void darshan_core_shutdown()
     {
         ssize_t written;
         /* rank 0 is responsible for writing the log header */
-        final_core->log_hdr_p->comp_type = DARSHAN_ZLIB_COMP;
+        final_core->log_hdr_p->comp_type = darshan_comp_type;
 
 #ifdef HAVE_MPI
         darshan_mpi_reduce(
@@ -784,35 +1157,16 @@ void darshan_core_shutdown()
      */
     if(my_rank == 0)
     {
-        mode_t chmod_mode = S_IRUSR;
-#ifdef __DARSHAN_GROUP_READABLE_LOGS
-        chmod_mode |= S_IRGRP;
-#endif
+        darshan_log_complete(logfile_name, start_log_time,
+            !getenv("DARSHAN_LOGFILE") || collected);
 
-        if(getenv("DARSHAN_LOGFILE"))
-        {
-            chmod(logfile_name, chmod_mode);
-        }
-        else
-        {
-            char* tmp_index;
-            double end_log_time;
-            char* new_logfile_name;
+        /* the final log supersedes the last checkpoint */
+        if(ckpt_owner)
+            unlink(darshan_ckpt.log_name);
 
-            new_logfile_name = malloc(PATH_MAX);
-            if(new_logfile_name)
-            {
-                new_logfile_name[0] = '\0';
-                end_log_time = time_nanoseconds();
-                strcat(new_logfile_name, logfile_name);
-                tmp_index = strstr(new_logfile_name, ".darshan_partial");
-                sprintf(tmp_index, "_%d.darshan", (int)(end_log_time-start_log_time+1));
-                rename(logfile_name, new_logfile_name);
-                /* set permissions on log file */
-                chmod(new_logfile_name, chmod_mode);
-                free(new_logfile_name);
-            }
-        }
+        /* rank 0 describes the pieces of the log once its own is written */
+        if(collected && darshan_pieces.dir[0] && darshan_pieces.rank == 0)
+            darshan_pieces_write_manifest();
     }
 
     free(logfile_name);
@@ -827,6 +1181,8 @@ void darshan_core_shutdown()
         double job_tm, job_slowest;
         double rec_tm, rec_slowest;
         double mod_tm[DARSHAN_MAX_MODS], mod_slowest[DARSHAN_MAX_MODS];
+        double write_tm[DARSHAN_MAX_MODS], write_slowest[DARSHAN_MAX_MODS];
+        double comp_slowest[DARSHAN_MAX_MODS + 1];
         double all_tm, all_slowest;
 
         tm_end = time_nanoseconds();
@@ -839,6 +1195,7 @@ void darshan_core_shutdown()
         for(i = 0;i < DARSHAN_MAX_MODS; i++)
         {
             mod_tm[i] = mod2[i] - mod1[i];
+            write_tm[i] = write2[i] - write1[i];
         }
 
 #ifdef HAVE_MPI
@@ -854,6 +1211,10 @@ void darshan_core_shutdown()
             MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
         darshan_mpi_reduce(mod_tm, mod_slowest, DARSHAN_MAX_MODS,
             MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+        darshan_mpi_reduce(write_tm, write_slowest, DARSHAN_MAX_MODS,
+            MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+        darshan_mpi_reduce(comp_tm, comp_slowest, DARSHAN_MAX_MODS + 1,
+            MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
 #else
         open_slowest = open_tm;
         header_slowest = header_tm;
@@ -861,6 +1222,8 @@ void darshan_core_shutdown()
         rec_slowest = rec_tm;
         all_slowest = all_tm;
         memcpy(mod_slowest, mod_tm, sizeof(*mod_tm) * DARSHAN_MAX_MODS);
+        memcpy(write_slowest, write_tm, sizeof(*write_tm) * DARSHAN_MAX_MODS);
+        memcpy(comp_slowest, comp_tm, sizeof(*comp_tm) * (DARSHAN_MAX_MODS + 1));
 #endif
 
         if(my_rank == 0)
@@ -868,13 +1231,25 @@ void darshan_core_shutdown()
             darshan_core_fprintf(stderr, "#darshan:<op>\t<nprocs>\t<time>\n");
             darshan_core_fprintf(stderr, "darshan:log_open\t%d\t%f\n", nprocs, open_slowest);
             darshan_core_fprintf(stderr, "darshan:job_write\t%d\t%f\n", nprocs, job_slowest);
+            darshan_core_fprintf(stderr, "darshan:hash_compress\t%d\t%f\n", nprocs,
+                comp_slowest[DARSHAN_MAX_MODS]);
             darshan_core_fprintf(stderr, "darshan:hash_write\t%d\t%f\n", nprocs, rec_slowest);
             darshan_core_fprintf(stderr, "darshan:header_write\t%d\t%f\n", nprocs, header_slowest);
+            /* NOTE: module compression overlaps with the shutdown of later
+             * modules and with writes of earlier ones, so the write stage
+             * only includes time spent waiting on compression to finish
+             */
             for(i = 0; i < DARSHAN_MAX_MODS; i++)
             {
                 if(global_mod_use_count[i])
+                {
                     darshan_core_fprintf(stderr, "darshan:%s_shutdown\t%d\t%f\n", darshan_module_names[i],
                         nprocs, mod_slowest[i]);
+                    darshan_core_fprintf(stderr, "darshan:%s_compress\t%d\t%f\n", darshan_module_names[i],
+                        nprocs, comp_slowest[i]);
+                    darshan_core_fprintf(stderr, "darshan:%s_write\t%d\t%f\n", darshan_module_names[i],
+                        nprocs, write_slowest[i]);
+                }
             }
             darshan_core_fprintf(stderr, "darshan:core_shutdown\t%d\t%f\n", nprocs, all_slowest);
         }
@@ -903,8 +1278,11 @@ static void *darshan_init_mmap_log(struct darshan_core_runtime* core, int jobid)
     sys_page_size = sysconf(_SC_PAGESIZE);
     assert(sys_page_size > 0);
 
+    /* NOTE: module memory is mapped in separately as modules register,
+     * following these fixed size regions in the log file
+     */
     mmap_size = sizeof(struct darshan_header) + DARSHAN_JOB_RECORD_SIZE +
-        + DARSHAN_NAME_RECORD_BUF_SIZE + darshan_mod_mem_quota;
+        + DARSHAN_NAME_RECORD_BUF_SIZE;
     if(mmap_size % sys_page_size)
         mmap_size = ((mmap_size / sys_page_size) + 1) * sys_page_size;
 
@@ -972,13 +1350,135 @@ static void *darshan_init_mmap_log(struct darshan_core_runtime* core, int jobid)
         return(NULL);
     }
 
-    /* close darshan log file (this does *not* unmap the log file) */
-    close(mmap_fd);
+    /* keep the log file open so it can be extended with module memory */
+    core->mmap_log_fd = mmap_fd;
+    core->mmap_log_size = mmap_size;
+    core->mmap_log_mod_off = mmap_size;
 
     return(mmap_p);
 }
 #endif
 
+/* round a module memory size up to a multiple of the commit chunk size */
+static long darshan_mod_mem_roundup(long len)
+{
+    long chunk = DARSHAN_MOD_MEM_CHUNK_SIZE;
+    long sys_page_size = sysconf(_SC_PAGESIZE);
+
+    if(sys_page_size > chunk)
+        chunk = sys_page_size;
+
+    return(((len + chunk - 1) / chunk) * chunk);
+}
+
+/* reserve address space for a module's record buffer -- no memory is
+ * committed to the buffer until the module registers records
+ */
+static int darshan_mod_mem_reserve(
+    struct darshan_core_runtime *core, struct darshan_core_module *mod)
+{
+    long buf_sz = darshan_mod_mem_roundup(mod->rec_mem_max);
+    void *buf;
+
+#ifndef __DARSHAN_ENABLE_MMAP_LOGS
+    buf = mmap(NULL, buf_sz, PROT_NONE,
+        MAP_PRIVATE|MAP_ANONYMOUS|MAP_NORESERVE, -1, 0);
+#else
+    /* module buffers are laid out one after the other following the
+     * fixed size regions of the mmap log, which is only extended as
+     * memory is actually committed to the buffer
+     */
+    buf = mmap(NULL, buf_sz, PROT_WRITE, MAP_SHARED, core->mmap_log_fd,
+        core->mmap_log_mod_off);
+#endif
+    if(buf == MAP_FAILED)
+        return(0);
+
+    mod->rec_buf_start = buf;
+    mod->rec_buf_p = buf;
+    mod->rec_mem_avail = 0;
+    mod->rec_mem_committed = 0;
+#ifdef __DARSHAN_ENABLE_MMAP_LOGS
+    mod->rec_buf_off = core->mmap_log_mod_off;
+    core->mmap_log_mod_off += buf_sz;
+#endif
+
+    return(1);
+}
+
+/* commit enough memory to a module's record buffer to store 'len' more
+ * bytes, without exceeding the module's or darshan's memory limits
+ */
+static int darshan_mod_mem_commit(
+    struct darshan_core_runtime *core, struct darshan_core_module *mod,
+    int len)
+{
+    long used = (char *)mod->rec_buf_p - (char *)mod->rec_buf_start;
+    long commit_sz;
+
+    if(!mod->rec_buf_start || (used + len) > mod->rec_mem_max)
+        return(0);
+
+    commit_sz = darshan_mod_mem_roundup(used + len) - mod->rec_mem_committed;
+    if((core->mod_mem_used + commit_sz) > darshan_mod_mem_quota)
+        return(0);
+
+#ifndef __DARSHAN_ENABLE_MMAP_LOGS
+    if(mprotect((char *)mod->rec_buf_start + mod->rec_mem_committed,
+        commit_sz, PROT_READ|PROT_WRITE) < 0)
+        return(0);
+#else
+    if((mod->rec_buf_off + mod->rec_mem_committed + commit_sz) >
+        core->mmap_log_size)
+    {
+        if(ftruncate(core->mmap_log_fd,
+            mod->rec_buf_off + mod->rec_mem_committed + commit_sz) < 0)
+            return(0);
+        core->mmap_log_size = mod->rec_buf_off + mod->rec_mem_committed +
+            commit_sz;
+    }
+#endif
+
+    mod->rec_mem_committed += commit_sz;
+    if(mod->rec_mem_committed < mod->rec_mem_max)
+        mod->rec_mem_avail = mod->rec_mem_committed - used;
+    else
+        mod->rec_mem_avail = mod->rec_mem_max - used;
+    core->mod_mem_used += commit_sz;
+
+    return(1);
+}
+
+/* release a module's record buffer, returning its memory to darshan */
+static void darshan_mod_mem_release(
+    struct darshan_core_runtime *core, struct darshan_core_module *mod)
+{
+    long buf_sz = darshan_mod_mem_roundup(mod->rec_mem_max);
+
+    if(!mod->rec_buf_start)
+        return;
+
+    munmap(mod->rec_buf_start, buf_sz);
+#ifdef __DARSHAN_ENABLE_MMAP_LOGS
+    /* we can only give log file space back if this is the last module
+     * buffer in the log
+     */
+    if((mod->rec_buf_off + buf_sz) == core->mmap_log_mod_off)
+    {
+        core->mmap_log_mod_off = mod->rec_buf_off;
+        if((core->mmap_log_size > mod->rec_buf_off) &&
+           (ftruncate(core->mmap_log_fd, mod->rec_buf_off) == 0))
+            core->mmap_log_size = mod->rec_buf_off;
+    }
+#endif
+    core->mod_mem_used -= mod->rec_mem_committed;
+
+    mod->rec_buf_start = mod->rec_buf_p = NULL;
+    mod->rec_mem_avail = mod->rec_mem_committed = 0;
+
+    return;
+}
+
 /* record any hints used to write the darshan log in the job data */
 static void darshan_log_record_hints_and_ver(struct darshan_core_runtime* core)
 {
@@ -1025,69 +1525,220 @@ static void darshan_log_record_hints_and_ver(struct darshan_core_runtime* core)
     return;
 }
 
-static int mnt_data_cmp(const void* a, const void* b)
+static int mnt_tree_cmp(const struct mnt_tree_node *node,
+    const char *name, int name_len)
 {
-    const struct mnt_data *d_a = (const struct mnt_data*)a;
-    const struct mnt_data *d_b = (const struct mnt_data*)b;
+    int ret;
 
-    if(strlen(d_a->path) > strlen(d_b->path))
-        return(-1);
-    else if(strlen(d_a->path) < strlen(d_b->path))
-        return(1);
-    else
-        return(0);
+    ret = memcmp(node->name, name,
+        node->name_len < name_len ? node->name_len : name_len);
+    if(ret == 0)
+        ret = node->name_len - name_len;
+    return(ret);
 }
 
-/* adds an entry to table of mounted file systems */
-static void add_entry(char* buf, int* space_left, struct mntent* entry)
+/* finds the child of node 'parent' named by the given path component;
+ * returns the child's index into mnt_tree, or -1 with '*pos' set to the
+ * position a new child would be inserted at
+ */
+static int mnt_tree_find_child(int parent, const char *name, int name_len,
+    int *pos)
 {
-    int i;
+    struct mnt_tree_node *node = &mnt_tree[parent];
+    int lo = 0, hi = node->child_count - 1;
+    int mid;
     int ret;
-    char tmp_mnt[256];
-    struct statfs statfsbuf;
 
-    /* avoid adding the same mount points multiple times -- to limit
-     * storage space and potential statfs, ioctl, etc calls
-     */
-    for(i = 0; i < mnt_data_count; i++)
+    while(lo <= hi)
     {
-        if((strncmp(mnt_data_array[i].path, entry->mnt_dir, DARSHAN_MAX_MNT_PATH) == 0) &&
-           (strncmp(mnt_data_array[i].type, entry->mnt_type, DARSHAN_MAX_MNT_PATH) == 0))
-            return;
+        mid = (lo + hi) / 2;
+        ret = mnt_tree_cmp(&mnt_tree[node->children[mid]], name, name_len);
+        if(ret == 0)
+            return(node->children[mid]);
+        else if(ret < 0)
+            lo = mid + 1;
+        else
+            hi = mid - 1;
     }
 
-    strncpy(mnt_data_array[mnt_data_count].path, entry->mnt_dir,
-        DARSHAN_MAX_MNT_PATH-1);
-    strncpy(mnt_data_array[mnt_data_count].type, entry->mnt_type,
-        DARSHAN_MAX_MNT_TYPE-1);
-    /* NOTE: we now try to detect the preferred block size for each file 
-     * system using fstatfs().  On Lustre we assume a size of 1 MiB 
-     * because fstatfs() reports 4 KiB. 
-     */
-#ifndef LL_SUPER_MAGIC
-#define LL_SUPER_MAGIC 0x0BD00BD0
-#endif
-    ret = statfs(entry->mnt_dir, &statfsbuf);
-    mnt_data_array[mnt_data_count].fs_info.fs_type = statfsbuf.f_type;
-    if(ret == 0 && statfsbuf.f_type != LL_SUPER_MAGIC)
-        mnt_data_array[mnt_data_count].fs_info.block_size = statfsbuf.f_bsize;
-    else if(ret == 0 && statfsbuf.f_type == LL_SUPER_MAGIC)
-        mnt_data_array[mnt_data_count].fs_info.block_size = 1024*1024;
-    else
-        mnt_data_array[mnt_data_count].fs_info.block_size = 4096;
+    if(pos)
+        *pos = lo;
+    return(-1);
+}
 
-#ifdef DARSHAN_LUSTRE
-    /* attempt to retrieve OST and MDS counts from Lustre */
-    mnt_data_array[mnt_data_count].fs_info.ost_count = -1;
-    mnt_data_array[mnt_data_count].fs_info.mdt_count = -1;
-    if ( statfsbuf.f_type == LL_SUPER_MAGIC )
+/* returns the index of a new, empty tree node, or -1 on failure */
+static int mnt_tree_new_node(const char *name, int name_len)
+{
+    struct mnt_tree_node *tmp_tree;
+
+    if(mnt_tree_count == mnt_tree_max)
     {
-        int n_ost, n_mdt;
-        int ret_ost, ret_mdt;
-        DIR *mount_dir;
+        tmp_tree = realloc(mnt_tree,
+            (mnt_tree_max ? mnt_tree_max * 2 : 128) * sizeof(*tmp_tree));
+        if(!tmp_tree)
+            return(-1);
+        mnt_tree = tmp_tree;
+        mnt_tree_max = mnt_tree_max ? mnt_tree_max * 2 : 128;
+    }
 
-        mount_dir = opendir( entry->mnt_dir );
-        if ( mount_dir  ) 
+    memset(&mnt_tree[mnt_tree_count], 0, sizeof(*mnt_tree));
+    mnt_tree[mnt_tree_count].name = name;
+    mnt_tree[mnt_tree_count].name_len = name_len;
+    mnt_tree[mnt_tree_count].mnt_index = -1;
+
+    return(mnt_tree_count++);
+}
+
+/* adds mount point 'mnt_index' to the tree, creating nodes for any
+ * components of its path that are not in the tree yet
+ */
+static void mnt_tree_insert(int mnt_index)
+{
+    const char *path = mnt_data_array[mnt_index].path;
+    const char *end;
+    struct mnt_tree_node *parent;
+    int *tmp_children;
+    int node = 0, child;
+    int pos;
+
+    if(path[0] != '/')
+        return;
+
+    while(*path)
+    {
+        /* skip over separators to the next path component */
+        while(*path == '/')
+            path++;
+        if(!*path)
+            break;
+        end = strchrnul(path, '/');
+
+        child = mnt_tree_find_child(node, path, end - path, &pos);
+        if(child < 0)
+        {
+            child = mnt_tree_new_node(path, end - path);
+            if(child < 0)
+                return;
+
+            parent = &mnt_tree[node];
+            if(parent->child_count == parent->child_max)
+            {
+                tmp_children = realloc(parent->children,
+                    (parent->child_max ? parent->child_max * 2 : 4) * sizeof(int));
+                if(!tmp_children)
+                    return;
+                parent->children = tmp_children;
+                parent->child_max = parent->child_max ? parent->child_max * 2 : 4;
+            }
+            memmove(&parent->children[pos+1], &parent->children[pos],
+                (parent->child_count - pos) * sizeof(int));
+            parent->children[pos] = child;
+            parent->child_count++;
+        }
+
+        node = child;
+        path = end;
+    }
+
+    /* NOTE: mount points are inserted in mount table order, so if a path
+     * is mounted more than once the most recent (visible) mount wins
+     */
+    mnt_tree[node].mnt_index = mnt_index;
+    return;
+}
+
+/* builds the mount point tree from mnt_data_array */
+static void mnt_tree_build(void)
+{
+    int i;
+
+    for(i = 0; i < mnt_tree_count; i++)
+        free(mnt_tree[i].children);
+    mnt_tree_count = 0;
+
+    /* the root node stands for "/" */
+    if(mnt_tree_new_node("", 0) < 0)
+        return;
+
+    for(i = 0; i < mnt_data_count; i++)
+        mnt_tree_insert(i);
+
+    return;
+}
+
+/* adds an entry to table of mounted file systems */
+static void add_entry(struct mntent* entry)
+{
+    int i;
+    struct mnt_data *tmp_array;
+
+    /* avoid adding the same mount points multiple times -- to limit
+     * storage space and potential statfs, ioctl, etc calls
+     */
+    for(i = 0; i < mnt_data_count; i++)
+    {
+        if((strncmp(mnt_data_array[i].path, entry->mnt_dir, DARSHAN_MAX_MNT_PATH-1) == 0) &&
+           (strncmp(mnt_data_array[i].type, entry->mnt_type, DARSHAN_MAX_MNT_TYPE-1) == 0))
+            return;
+    }
+
+    if(mnt_data_count == mnt_data_max)
+    {
+        tmp_array = realloc(mnt_data_array,
+            (mnt_data_max ? mnt_data_max * 2 : 64) * sizeof(*tmp_array));
+        if(!tmp_array)
+            return;
+        mnt_data_array = tmp_array;
+        mnt_data_max = mnt_data_max ? mnt_data_max * 2 : 64;
+    }
+
+    /* NOTE: entries are zeroed so that they can be compared against the
+     * mount table cache byte for byte
+     */
+    memset(&mnt_data_array[mnt_data_count], 0, sizeof(*mnt_data_array));
+    strncpy(mnt_data_array[mnt_data_count].path, entry->mnt_dir,
+        DARSHAN_MAX_MNT_PATH-1);
+    strncpy(mnt_data_array[mnt_data_count].type, entry->mnt_type,
+        DARSHAN_MAX_MNT_TYPE-1);
+
+    mnt_data_count++;
+    return;
+}
+
+/* queries the file system backing a mount table entry */
+static void mnt_data_fs_info(struct mnt_data *mnt)
+{
+    int ret;
+    struct statfs statfsbuf;
+
+    /* NOTE: we now try to detect the preferred block size for each file 
+     * system using fstatfs().  On Lustre we assume a size of 1 MiB 
+     * because fstatfs() reports 4 KiB. 
+     */
+#ifndef LL_SUPER_MAGIC
+#define LL_SUPER_MAGIC 0x0BD00BD0
+#endif
+    ret = statfs(mnt->path, &statfsbuf);
+    mnt->fs_info.fs_type = statfsbuf.f_type;
+    if(ret == 0 && statfsbuf.f_type != LL_SUPER_MAGIC)
+        mnt->fs_info.block_size = statfsbuf.f_bsize;
+    else if(ret == 0 && statfsbuf.f_type == LL_SUPER_MAGIC)
+        mnt->fs_info.block_size = 1024*1024;
+    else
+        mnt->fs_info.block_size = 4096;
+
+#ifdef DARSHAN_LUSTRE
+    /* attempt to retrieve OST and MDS counts from Lustre */
+    mnt->fs_info.ost_count = -1;
+    mnt->fs_info.mdt_count = -1;
+    if ( statfsbuf.f_type == LL_SUPER_MAGIC )
+    {
+        int n_ost, n_mdt;
+        int ret_ost, ret_mdt;
+        DIR *mount_dir;
+
+        mount_dir = opendir( mnt->path );
+        if ( mount_dir  ) 
         {
             /* n_ost and n_mdt are used for both input and output to ioctl */
             n_ost = 0;
@@ -1098,113 +1749,403 @@ static void add_entry(char* buf, int* space_left, struct mntent* entry)
 
             if ( !(ret_ost < 0 || ret_mdt < 0) )
             {
-                mnt_data_array[mnt_data_count].fs_info.ost_count = n_ost;
-                mnt_data_array[mnt_data_count].fs_info.mdt_count = n_mdt;
+                mnt->fs_info.ost_count = n_ost;
+                mnt->fs_info.mdt_count = n_mdt;
             }
             closedir( mount_dir );
         }
     }
 #endif
 
-    /* store mount information with the job-level metadata in darshan log */
-    ret = snprintf(tmp_mnt, 256, "\n%s\t%s",
-        entry->mnt_type, entry->mnt_dir);
-    if(ret < 256 && strlen(tmp_mnt) <= (*space_left))
+    return;
+}
+
+/* NOTE: the mount table cache is read and written with raw system calls
+ * rather than the (possibly intercepted) libc wrappers, since it is
+ * accessed lazily from within instrumented calls
+ */
+static ssize_t mnt_cache_io(int write_flag, int fd, void *buf, size_t count)
+{
+    ssize_t ret;
+    size_t done = 0;
+
+    while(done < count)
     {
-        strcat(buf, tmp_mnt);
-        (*space_left) -= strlen(tmp_mnt);
+        ret = syscall(write_flag ? SYS_write : SYS_read, fd,
+            (char *)buf + done, count - done);
+        if(ret < 0 && errno == EINTR)
+            continue;
+        if(ret <= 0)
+            return(-1);
+        done += ret;
     }
 
-    mnt_data_count++;
+    return(done);
+}
+
+/* attempts to fill in the file system info of every mount table entry from
+ * the cache file written by an earlier process; returns 0 on success
+ */
+static int mnt_cache_load(const char *cache_path, uint64_t fingerprint)
+{
+    struct mnt_cache_header hdr;
+    struct mnt_data *cached;
+    int fd;
+    int i;
+    int ret = -1;
+
+    fd = syscall(SYS_openat, AT_FDCWD, cache_path, O_RDONLY | O_NOFOLLOW);
+    if(fd < 0)
+        return(-1);
+
+    if(mnt_cache_io(0, fd, &hdr, sizeof(hdr)) < 0 ||
+       hdr.magic != DARSHAN_MNT_CACHE_MAGIC ||
+       hdr.version != DARSHAN_MNT_CACHE_VER ||
+       hdr.entry_size != sizeof(struct mnt_data) ||
+       hdr.fingerprint != fingerprint ||
+       hdr.count != mnt_data_count)
+    {
+        syscall(SYS_close, fd);
+        return(-1);
+    }
+
+    cached = malloc(mnt_data_count * sizeof(*cached));
+    if(cached && mnt_cache_io(0, fd, cached, mnt_data_count * sizeof(*cached)) >= 0)
+    {
+        /* the fingerprint only names the cache file; make sure it really
+         * describes the same mount points before trusting it
+         */
+        for(i = 0; i < mnt_data_count; i++)
+        {
+            if(memcmp(cached[i].path, mnt_data_array[i].path, DARSHAN_MAX_MNT_PATH) ||
+               memcmp(cached[i].type, mnt_data_array[i].type, DARSHAN_MAX_MNT_TYPE))
+                break;
+        }
+        if(i == mnt_data_count)
+        {
+            memcpy(mnt_data_array, cached, mnt_data_count * sizeof(*cached));
+            ret = 0;
+        }
+    }
+    free(cached);
+    syscall(SYS_close, fd);
+
+    return(ret);
+}
+
+/* publishes the mount table for later processes on this node; the cache
+ * is written to a temporary file first and then renamed into place, so
+ * readers never see a partially written cache
+ */
+static void mnt_cache_store(const char *cache_path, uint64_t fingerprint)
+{
+    struct mnt_cache_header hdr;
+    char tmp_path[PATH_MAX];
+    int fd;
+    int ret;
+
+    ret = snprintf(tmp_path, PATH_MAX, "%s.%d", cache_path, getpid());
+    if(ret < 0 || ret >= PATH_MAX)
+        return;
+
+    fd = syscall(SYS_openat, AT_FDCWD, tmp_path,
+        O_WRONLY | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR);
+    if(fd < 0)
+        return;
+
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.magic = DARSHAN_MNT_CACHE_MAGIC;
+    hdr.fingerprint = fingerprint;
+    hdr.version = DARSHAN_MNT_CACHE_VER;
+    hdr.entry_size = sizeof(struct mnt_data);
+    hdr.count = mnt_data_count;
+
+    ret = 0;
+    if(mnt_cache_io(1, fd, &hdr, sizeof(hdr)) < 0 ||
+       mnt_cache_io(1, fd, mnt_data_array, mnt_data_count * sizeof(*mnt_data_array)) < 0)
+        ret = -1;
+    syscall(SYS_close, fd);
+
+    /* NOTE: this replaces any stale or corrupt cache; concurrent writers
+     * all describe the same mount table, so it does not matter who wins
+     */
+    if(ret == 0)
+#ifdef SYS_renameat
+        ret = syscall(SYS_renameat, AT_FDCWD, tmp_path, AT_FDCWD, cache_path);
+#else
+        ret = syscall(SYS_renameat2, AT_FDCWD, tmp_path, AT_FDCWD, cache_path, 0);
+#endif
+    if(ret != 0)
+        syscall(SYS_unlinkat, AT_FDCWD, tmp_path, 0);
+
     return;
 }
 
-/* darshan_get_exe_and_mounts()
- *
- * collects command line and list of mounted file systems into a string that
- * will be stored with the job-level metadata
+/* skip these fs types when collecting mounted file systems */
+static char* fs_exclusions[] = {
+    "tmpfs",
+    "proc",
+    "sysfs",
+    "devpts",
+    "binfmt_misc",
+    "fusectl",
+    "debugfs",
+    "securityfs",
+    "nfsd",
+    "none",
+    "rpc_pipefs",
+    "hugetlbfs",
+    "cgroup",
+    NULL
+};
+
+/* adds a single path rule to a rule set; 'flags' is either
+ * DARSHAN_PATH_RULE_EXCLUDE or DARSHAN_PATH_RULE_INCLUDE
  */
-static void darshan_get_exe_and_mounts(struct darshan_core_runtime *core,
-    int argc, char **argv)
+static void darshan_path_rules_add(struct darshan_core_path_rules *rules,
+    const char *rule, int flags)
 {
-    FILE* tab;
-    struct mntent *entry;
-    char* exclude;
-    char* truncate_string = "<TRUNCATED>";
-    int truncate_offset;
-    int space_left = DARSHAN_EXE_LEN;
-    FILE *fh;
-    int i, ii;
-    char cmdl[DARSHAN_EXE_LEN];
-    int tmp_index = 0;
-    int skip = 0;
-    char* env_exclusions;
-    char* string;
-    char* token;
-
-    /* skip these fs types */
-    static char* fs_exclusions[] = {
-        "tmpfs",
-        "proc",
-        "sysfs",
-        "devpts",
-        "binfmt_misc",
-        "fusectl",
-        "debugfs",
-        "securityfs",
-        "nfsd",
-        "none",
-        "rpc_pipefs",
-        "hugetlbfs",
-        "cgroup",
-        NULL
-    };
+    struct darshan_core_path_rule_node *tmp_nodes;
+    struct darshan_core_path_glob *tmp_globs;
+    const char *wild;
+    const char *p;
+    int len = strlen(rule);
+    int node, child;
+
+    if(len == 0)
+        return;
+
+    /* rules without wildcards (other than a trailing slash-star, which
+     * matches everything below a directory) are plain prefixes and go in
+     * the trie
+     */
+    wild = strpbrk(rule, "*?[");
+    if(wild && (wild == rule + len - 1) && len > 1 && rule[len-2] == '/')
+        len--;
+    else if(wild)
+    {
+        if(rules->glob_count == rules->glob_max)
+        {
+            tmp_globs = realloc(rules->globs, (rules->glob_max + 8) *
+                sizeof(*tmp_globs));
+            if(!tmp_globs)
+                return;
+            rules->globs = tmp_globs;
+            rules->glob_max += 8;
+        }
+
+        /* "*<suffix>" rules are matched without fnmatch(), and rules
+         * without a '/' are matched against the basename of the path
+         */
+        if(rule[0] == '*' && !strpbrk(rule + 1, "*?[") && !strchr(rule, '/'))
+        {
+            flags |= DARSHAN_PATH_RULE_SUFFIX;
+            rule++;
+            len--;
+        }
+        else if(!strchr(rule, '/'))
+            flags |= DARSHAN_PATH_RULE_BASENAME;
+
+        rules->globs[rules->glob_count].pattern = strdup(rule);
+        if(!rules->globs[rules->glob_count].pattern)
+            return;
+        rules->globs[rules->glob_count].len = len;
+        rules->globs[rules->glob_count].flags = flags;
+        rules->glob_count++;
+        return;
+    }
+
+    if(rules->node_max - rules->node_count < len + 1)
+    {
+        tmp_nodes = realloc(rules->nodes, (rules->node_max + len + 64) *
+            sizeof(*tmp_nodes));
+        if(!tmp_nodes)
+            return;
+        rules->nodes = tmp_nodes;
+        rules->node_max += len + 64;
+    }
+    if(rules->node_count == 0)
+    {
+        memset(&rules->nodes[0], 0, sizeof(rules->nodes[0]));
+        rules->node_count = 1;
+    }
+
+    node = 0;
+    for(p = rule; p < rule + len; p++)
+    {
+        for(child = rules->nodes[node].child;
+            child && rules->nodes[child].c != (unsigned char)*p;
+            child = rules->nodes[child].sibling);
+        if(!child)
+        {
+            child = rules->node_count++;
+            rules->nodes[child].c = (unsigned char)*p;
+            rules->nodes[child].flags = 0;
+            rules->nodes[child].child = 0;
+            rules->nodes[child].sibling = rules->nodes[node].child;
+            rules->nodes[node].child = child;
+        }
+        node = child;
+    }
+    rules->nodes[node].flags |= flags;
+
+    return;
+}
+
+/* adds a comma-separated list of path rules to a rule set; rules
+ * starting with '+' are inclusions, all others are exclusions
+ */
+static void darshan_path_rules_add_list(struct darshan_core_path_rules *rules,
+    const char *list)
+{
+    char *string;
+    char *token;
+    char *saveptr = NULL;
+
+    string = strdup(list);
+    if(!string)
+        return;
+
+    for(token = strtok_r(string, ",", &saveptr); token;
+        token = strtok_r(NULL, ",", &saveptr))
+    {
+        if(token[0] == '+')
+            darshan_path_rules_add(rules, token + 1, DARSHAN_PATH_RULE_INCLUDE);
+        else
+            darshan_path_rules_add(rules, token, DARSHAN_PATH_RULE_EXCLUDE);
+    }
+    free(string);
+
+    return;
+}
+
+/* compiles the user's path rules (or the default ones, if 'user_list' is
+ * NULL) and any additional module rules into a rule set
+ */
+static void darshan_path_rules_compile(struct darshan_core_path_rules *rules,
+    const char *user_list, const char *mod_list)
+{
+    int i;
+
+    if(user_list)
+        darshan_path_rules_add_list(rules, user_list);
+    else
+    {
+        for(i = 0; darshan_path_exclusions[i]; i++)
+            darshan_path_rules_add(rules, darshan_path_exclusions[i],
+                DARSHAN_PATH_RULE_EXCLUDE);
+        for(i = 0; darshan_path_inclusions[i]; i++)
+            darshan_path_rules_add(rules, darshan_path_inclusions[i],
+                DARSHAN_PATH_RULE_INCLUDE);
+    }
+    if(mod_list)
+        darshan_path_rules_add_list(rules, mod_list);
+
+    return;
+}
+
+static void darshan_path_rules_free(struct darshan_core_path_rules *rules)
+{
+    int i;
+
+    for(i = 0; i < rules->glob_count; i++)
+        free(rules->globs[i].pattern);
+    free(rules->globs);
+    free(rules->nodes);
+    memset(rules, 0, sizeof(*rules));
+
+    return;
+}
+
+/* sets up the path rules used by darshan_core_excluded_path() */
+static void darshan_path_rules_init(void)
+{
+    struct darshan_core_path_rules *rules;
+    char *env_exclusions;
+    char *mod_exclusions;
+    char env_name[64];
+    char *c;
+    int i;
+
+    for(i = 0; i < DARSHAN_MAX_MODS; i++)
+    {
+        if(darshan_mod_path_rules[i] && darshan_mod_path_rules[i] != &darshan_path_rules)
+        {
+            darshan_path_rules_free(darshan_mod_path_rules[i]);
+            free(darshan_mod_path_rules[i]);
+        }
+        darshan_mod_path_rules[i] = NULL;
+    }
+    darshan_path_rules_free(&darshan_path_rules);
 
     /* Check if user has set the env variable DARSHAN_EXCLUDE_DIRS */
-    env_exclusions = getenv("DARSHAN_EXCLUDE_DIRS");
+    env_exclusions = getenv(DARSHAN_EXCLUDE_DIRS_OVERRIDE);
     if(env_exclusions)
     {
         fs_exclusions[0]=NULL;
         /* if DARSHAN_EXCLUDE_DIRS=none, do not exclude any dir */
-        if(strncmp(env_exclusions,"none",strlen(env_exclusions))>=0)
+        if(strcmp(env_exclusions, "none") == 0)
         {
             if (my_rank == 0) 
                 darshan_core_fprintf(stderr, "Darshan info: no system dirs will be excluded\n");
-            darshan_path_exclusions[0]=NULL;
+            env_exclusions = "";
         }
         else
         {
             if (my_rank == 0) 
                 darshan_core_fprintf(stderr, "Darshan info: the following system dirs will be excluded: %s\n",
                     env_exclusions);
-            string = strdup(env_exclusions);
-            i = 0;
-            /* get the comma separated number of directories */
-            token = strtok(string, ",");
-            while (token != NULL)
-            {
-                i++;
-                token = strtok(NULL, ",");
-            }
-            user_darshan_path_exclusions=(char **)malloc((i+1)*sizeof(char *));
-            assert(user_darshan_path_exclusions);
+        }
+    }
+    darshan_path_rules_compile(&darshan_path_rules, env_exclusions, NULL);
 
-            i = 0;
-            strcpy(string, env_exclusions);
-            token = strtok(string, ",");
-            while (token != NULL)
-            {
-                user_darshan_path_exclusions[i]=(char *)malloc(strlen(token)+1);
-                assert(user_darshan_path_exclusions[i]);
-                strcpy(user_darshan_path_exclusions[i],token);
-                i++;
-                token = strtok(NULL, ",");
-            }
-            user_darshan_path_exclusions[i]=NULL;
-            free(string);
+    /* modules given rules of their own get a rule set of their own */
+    for(i = 0; i < DARSHAN_MAX_MODS; i++)
+    {
+        darshan_mod_path_rules[i] = &darshan_path_rules;
+        if(i >= (int)(sizeof(darshan_module_names) / sizeof(darshan_module_names[0])))
+            continue;
+
+        /* e.g., DARSHAN_EXCLUDE_DIRS_MPI_IO for the "MPI-IO" module */
+        snprintf(env_name, sizeof(env_name), "%s_%s",
+            DARSHAN_EXCLUDE_DIRS_OVERRIDE, darshan_module_names[i]);
+        for(c = env_name; *c; c++)
+        {
+            if(!isalnum((unsigned char)*c))
+                *c = '_';
         }
+        mod_exclusions = getenv(env_name);
+        if(!mod_exclusions)
+            continue;
+
+        rules = calloc(1, sizeof(*rules));
+        if(!rules)
+            continue;
+        darshan_path_rules_compile(rules, env_exclusions, mod_exclusions);
+        darshan_mod_path_rules[i] = rules;
     }
 
+    return;
+}
+
+/* darshan_get_exe()
+ *
+ * collects the command line into a string that will be stored with the
+ * job-level metadata, and sets up user path exclusions
+ */
+static void darshan_get_exe(struct darshan_core_runtime *core,
+    int argc, char **argv)
+{
+    char* truncate_string = "<TRUNCATED>";
+    int truncate_offset;
+    int space_left = DARSHAN_EXE_LEN;
+    FILE *fh;
+    int i, ii;
+    char cmdl[DARSHAN_EXE_LEN];
+
+    /* compile the user's path exclusions, or the default ones */
+    darshan_path_rules_init();
+
     /* record exe and arguments */
     for(i=0; i<argc; i++)
     {
@@ -1255,110 +2196,295 @@ static void darshan_get_exe_and_mounts(struct darshan_core_runtime *core,
             truncate_string);
     }
 
-    /* we make two passes through mounted file systems; in the first pass we
-     * grab any non-nfs mount points, then on the second pass we grab nfs
-     * mount points
-     */
-    mnt_data_count = 0;
+    return;
+}
 
-    tab = setmntent("/etc/mtab", "r");
-    if(!tab)
-        return;
-    /* loop through list of mounted file systems */
-    while(mnt_data_count<DARSHAN_MAX_MNTS && (entry = getmntent(tab)) != NULL)
+/* darshan_get_mounts()
+ *
+ * collects the list of mounted file systems, and appends it to the
+ * job-level metadata string following the command line
+ */
+/* NOTE: this only calls functions that Darshan does not intercept, so it
+ * can be run lazily from within an instrumented call
+ */
+static void darshan_get_mounts(struct darshan_core_runtime *core)
+{
+    FILE* tab;
+    struct mntent *entry;
+    char* exclude;
+    char* cache_dir;
+    char cache_path[PATH_MAX];
+    char tmp_mnt[256];
+    uint64_t fingerprint = 0;
+    int space_left = DARSHAN_EXE_LEN - strlen(core->log_exemnt_p);
+    int tmp_index = 0;
+    int skip = 0;
+    int nfs_pass;
+    int ret;
+    int i;
+
+    /* we make two passes through mounted file systems; in the first pass we
+     * grab any non-nfs mount points, then on the second pass we grab nfs
+     * mount points
+     */
+    mnt_data_count = 0;
+
+    for(nfs_pass = 0; nfs_pass < 2; nfs_pass++)
     {
-        /* filter out excluded fs types */
-        tmp_index = 0;
-        skip = 0;
-        while((exclude = fs_exclusions[tmp_index]))
+        tab = setmntent("/etc/mtab", "r");
+        if(!tab)
+            return;
+        /* loop through list of mounted file systems */
+        while((entry = getmntent(tab)) != NULL)
         {
-            if(!(strcmp(exclude, entry->mnt_type)))
+            if(nfs_pass)
             {
-                skip =1;
-                break;
+                if(strcmp(entry->mnt_type, "nfs") == 0)
+                    add_entry(entry);
+                continue;
             }
-            tmp_index++;
-        }
 
-        if(skip || (strcmp(entry->mnt_type, "nfs") == 0))
-            continue;
+            /* filter out excluded fs types */
+            tmp_index = 0;
+            skip = 0;
+            while((exclude = fs_exclusions[tmp_index]))
+            {
+                if(!(strcmp(exclude, entry->mnt_type)))
+                {
+                    skip =1;
+                    break;
+                }
+                tmp_index++;
+            }
+
+            if(skip || (strcmp(entry->mnt_type, "nfs") == 0))
+                continue;
 
-        add_entry(core->log_exemnt_p, &space_left, entry);
+            add_entry(entry);
+        }
+        endmntent(tab);
     }
-    endmntent(tab);
 
-    tab = setmntent("/etc/mtab", "r");
-    if(!tab)
-        return;
-    /* loop through list of mounted file systems */
-    while(mnt_data_count<DARSHAN_MAX_MNTS && (entry = getmntent(tab)) != NULL)
+    /* querying every file system (especially over the network) is far more
+     * expensive than reading the mount table, so processes on the same node
+     * share the results through a cache file named after a fingerprint of
+     * the mount table.  The cache is looked up by content rather than
+     * validated against the mtime of /etc/mtab, which is usually a symlink
+     * into /proc and does not change when file systems are (un)mounted.
+     */
+    for(i = 0; i < mnt_data_count; i++)
+        fingerprint = darshan_hash((void *)&mnt_data_array[i],
+            DARSHAN_MAX_MNT_PATH + DARSHAN_MAX_MNT_TYPE, fingerprint);
+
+    cache_dir = getenv(DARSHAN_MNT_CACHE_DIR_OVERRIDE);
+    if(!cache_dir)
+        cache_dir = DARSHAN_DEF_MNT_CACHE_DIR;
+    ret = -1;
+    if(*cache_dir)
+        ret = snprintf(cache_path, PATH_MAX, "%s/darshan-mnt-%d-%016llx",
+            cache_dir, (int)getuid(), (unsigned long long)fingerprint);
+    if(ret < 0 || ret >= PATH_MAX || mnt_cache_load(cache_path, fingerprint) < 0)
     {
-        if(strcmp(entry->mnt_type, "nfs") != 0)
-            continue;
+        for(i = 0; i < mnt_data_count; i++)
+            mnt_data_fs_info(&mnt_data_array[i]);
+        if(ret >= 0 && ret < PATH_MAX)
+            mnt_cache_store(cache_path, fingerprint);
+    }
 
-        add_entry(core->log_exemnt_p, &space_left, entry);
+    /* store mount information with the job-level metadata in darshan log */
+    for(i = 0; i < mnt_data_count; i++)
+    {
+        ret = snprintf(tmp_mnt, 256, "\n%s\t%s",
+            mnt_data_array[i].type, mnt_data_array[i].path);
+        if(ret < 256 && strlen(tmp_mnt) <= space_left)
+        {
+            strcat(core->log_exemnt_p, tmp_mnt);
+            space_left -= strlen(tmp_mnt);
+        }
     }
-    endmntent(tab);
 
-    /* sort mount points in order of longest path to shortest path.  This is
-     * necessary so that if we try to match file paths to mount points later
-     * we don't match on "/" every time.
-     */
-    qsort(mnt_data_array, mnt_data_count, sizeof(mnt_data_array[0]), mnt_data_cmp);
+    mnt_tree_build();
     return;
 }
 
 static void darshan_fs_info_from_path(const char *path, struct darshan_fs_info *fs_info)
 {
-    int i;
-    fs_info->fs_type = -1;
-    fs_info->block_size = -1;
+    darshan_core_lookup_mount(path, fs_info, NULL);
+    return;
+}
+
+static void *darshan_name_mem_alloc(struct darshan_core_runtime *core,
+    int len)
+{
+    void *chunk;
+    long chunk_sz;
+    void *ret;
+
+    /* keep allocations aligned for name record reference structures */
+    len = (len + sizeof(uint64_t) - 1) & ~(sizeof(uint64_t) - 1);
 
-    for(i=0; i<mnt_data_count; i++)
+    if(len > core->name_chunk_avail)
     {
-        if(!(strncmp(mnt_data_array[i].path, path, strlen(mnt_data_array[i].path))))
-        {
-            *fs_info = mnt_data_array[i].fs_info;
-            return;
-        }
+        /* the first bytes of each chunk link to the previous chunk */
+        chunk_sz = DARSHAN_NAME_RECORD_CHUNK_SIZE;
+        if(len + sizeof(uint64_t) > chunk_sz)
+            chunk_sz = len + sizeof(uint64_t);
+        chunk = malloc(chunk_sz);
+        if(!chunk)
+            return(NULL);
+        *(void **)chunk = core->name_chunk_list;
+        core->name_chunk_list = chunk;
+        core->name_chunk_p = (char *)chunk + sizeof(uint64_t);
+        core->name_chunk_avail = chunk_sz - sizeof(uint64_t);
     }
 
-    return;
+    ret = core->name_chunk_p;
+    core->name_chunk_p += len;
+    core->name_chunk_avail -= len;
+
+    return(ret);
 }
 
 static int darshan_add_name_record_ref(struct darshan_core_runtime *core,
     darshan_record_id rec_id, const char *name, darshan_module_id mod_id)
 {
     struct darshan_core_name_record_ref *ref;
-    int record_size = sizeof(darshan_record_id) + strlen(name) + 1;
+    struct darshan_core_name_dir_ref *dir;
+    const char *base;
+    int dir_len;
+    int name_len = strlen(name);
 
-    if((record_size + core->name_mem_used) > DARSHAN_NAME_RECORD_BUF_SIZE)
+    /* names are front coded in the log with a 16-bit prefix length */
+    if(name_len > DARSHAN_NAME_RECORD_MAX_LEN)
         return(0);
 
-    ref = malloc(sizeof(*ref));
+    /* look up (or add) the directory portion of the name, so records
+     * in the same directory share a single copy of its path
+     */
+    base = strrchr(name, '/');
+    base = base ? base + 1 : name;
+    dir_len = base - name;
+    HASH_FIND(hlink, core->name_dir_hash, name, dir_len, dir);
+    if(!dir)
+    {
+        dir = darshan_name_mem_alloc(core, sizeof(*dir) + dir_len + 1);
+        if(!dir)
+            return(0);
+        memset(dir, 0, sizeof(*dir));
+        dir->path = (char *)(dir + 1);
+        memcpy(dir->path, name, dir_len);
+        dir->path[dir_len] = '\0';
+        dir->path_len = dir_len;
+        HASH_ADD_KEYPTR(hlink, core->name_dir_hash, dir->path,
+            dir->path_len, dir);
+    }
+
+    ref = darshan_name_mem_alloc(core, sizeof(*ref) + (name_len - dir_len) + 1);
     if(!ref)
         return(0);
     memset(ref, 0, sizeof(*ref));
 
     /* initialize the name record */
-    ref->name_record = (struct darshan_name_record *)
-        ((char *)core->log_name_p + core->name_mem_used);
-    memset(ref->name_record, 0, record_size);
-    ref->name_record->id = rec_id;
-    strcpy(ref->name_record->name, name);
+    ref->id = rec_id;
+    ref->dir = dir;
+    ref->base = (char *)(ref + 1);
+    strcpy(ref->base, base);
     DARSHAN_MOD_FLAG_SET(ref->mod_flags, mod_id);
 
     /* add the record to the hash table */
-    HASH_ADD(hlink, core->name_hash, name_record->id,
-        sizeof(darshan_record_id), ref);
-    core->name_mem_used += record_size;
+    HASH_ADD(hlink, core->name_hash, id, sizeof(darshan_record_id), ref);
+    core->name_mem_used += DARSHAN_NAME_RECORD_HDR_SIZE + name_len + 1;
 #ifdef __DARSHAN_ENABLE_MMAP_LOGS
-    core->log_hdr_p->name_map.len += record_size;
+    {
+        /* append the record to the log's name map, front coded relative to
+         * the last record appended, which is kept in a buffer that is only
+         * reallocated when a longer name comes along
+         */
+        const char *prev_name = core->mmap_last_name ? core->mmap_last_name : "";
+        char *tmp_name;
+        int tmp_max;
+        int rec_size;
+
+        rec_size = darshan_name_record_encode(NULL, rec_id, prev_name, name);
+
+        /* NOTE: the name is still tracked if the mmap region is full (or
+         * the buffer can't grow), it just won't be visible in the log until
+         * the log is finalized
+         */
+        if(name_len >= core->mmap_last_name_max)
+        {
+            tmp_max = core->mmap_last_name_max ? core->mmap_last_name_max : 256;
+            while(tmp_max <= name_len)
+                tmp_max *= 2;
+            tmp_name = realloc(core->mmap_last_name, tmp_max);
+            if(!tmp_name)
+                return(1);
+            if(!core->mmap_last_name)
+                tmp_name[0] = '\0';
+            core->mmap_last_name = tmp_name;
+            core->mmap_last_name_max = tmp_max;
+            prev_name = tmp_name;
+        }
+        if(core->log_hdr_p->name_map.len + rec_size <=
+            DARSHAN_NAME_RECORD_BUF_SIZE)
+        {
+            darshan_name_record_encode((char *)core->log_name_p +
+                core->log_hdr_p->name_map.len, rec_id, prev_name, name);
+            core->log_hdr_p->name_map.len += rec_size;
+            memcpy(core->mmap_last_name, name, name_len + 1);
+        }
+    }
 #endif
 
     return(1);
 }
 
+/* sort name records by directory, then by base name, so names sharing a
+ * prefix are adjacent when the name map is front coded
+ */
+static int darshan_name_record_ref_cmp(const void *a, const void *b)
+{
+    struct darshan_core_name_record_ref *ref_a =
+        *(struct darshan_core_name_record_ref **)a;
+    struct darshan_core_name_record_ref *ref_b =
+        *(struct darshan_core_name_record_ref **)b;
+    int ret;
+
+    if(ref_a->dir != ref_b->dir)
+    {
+        ret = strcmp(ref_a->dir->path, ref_b->dir->path);
+        if(ret)
+            return(ret);
+    }
+
+    return(strcmp(ref_a->base, ref_b->base));
+}
+
+/* serialize a front coded name record into buf, or just compute its size
+ * if buf is NULL. returns the size of the serialized record
+ */
+static int darshan_name_record_encode(char *buf, darshan_record_id id,
+    const char *prev_name, const char *name)
+{
+    uint16_t prefix_len = 0;
+    int suffix_len;
+
+    while(prev_name[prefix_len] && prev_name[prefix_len] == name[prefix_len]
+        && prefix_len < UINT16_MAX)
+        prefix_len++;
+    suffix_len = strlen(name + prefix_len) + 1;
+
+    if(buf)
+    {
+        memcpy(buf, &id, sizeof(id));
+        memcpy(buf + sizeof(id), &prefix_len, sizeof(prefix_len));
+        memcpy(buf + DARSHAN_NAME_RECORD_HDR_SIZE, name + prefix_len,
+            suffix_len);
+    }
+
+    return(DARSHAN_NAME_RECORD_HDR_SIZE + suffix_len);
+}
+
 static void darshan_get_user_name(char *cuser)
 {
     char* logname_string;
@@ -1522,82 +2648,169 @@ static void darshan_get_logfile_name(char* logfile_name, int jobid, struct tm* s
     return;
 }
 
+#ifdef HAVE_MPI
+static int darshan_shared_rec_entry_cmp(const void *a, const void *b)
+{
+    const struct darshan_core_shared_rec_entry *ent_a = a;
+    const struct darshan_core_shared_rec_entry *ent_b = b;
+
+    if(ent_a->id != ent_b->id)
+        return((ent_a->id < ent_b->id) ? -1 : 1);
+    return(ent_a->src_rank - ent_b->src_rank);
+}
+
+static int darshan_record_id_cmp(const void *a, const void *b)
+{
+    darshan_record_id id_a = *(const darshan_record_id *)a;
+    darshan_record_id id_b = *(const darshan_record_id *)b;
+
+    if(id_a == id_b)
+        return(0);
+    return((id_a < id_b) ? -1 : 1);
+}
+#endif
+
+/* determine which records are shared by all processes, and how many
+ * processes share each of the others
+ *
+ * NOTE: each record id is owned by the process given by the id modulo the
+ * number of processes. every process sends its (id, module flags) pairs to
+ * their owners in a single all-to-all exchange, and each owner replies with
+ * the number of processes holding the record, the lowest of those ranks,
+ * and the module flags set on all of them. this costs each process time and
+ * memory proportional to the number of records it holds locally.
+ */
 static void darshan_get_shared_records(struct darshan_core_runtime *core,
     darshan_record_id **shared_recs, int *shared_rec_cnt)
 {
 #ifdef HAVE_MPI
-    int i, j;
-    int tmp_cnt = HASH_CNT(hlink, core->name_hash);
+    int i, j, k;
+    int local_cnt = HASH_CNT(hlink, core->name_hash);
+    int recv_cnt;
+    int *send_counts, *send_displs, *recv_counts, *recv_displs;
     struct darshan_core_name_record_ref *tmp, *ref;
-    darshan_record_id *id_array;
-    uint64_t *mod_flags;
-    uint64_t *global_mod_flags;
+    struct darshan_core_name_record_ref **ref_array;
+    struct darshan_core_shared_rec_query *send_queries, *recv_queries;
+    struct darshan_core_shared_rec_reply *send_replies, *recv_replies;
+    struct darshan_core_shared_rec_entry *entries;
+    uint64_t global_mod_flags;
+
+    send_counts = calloc(4 * nprocs, sizeof(int));
+    ref_array = malloc((local_cnt + 1) * sizeof(*ref_array));
+    send_queries = malloc((local_cnt + 1) * sizeof(*send_queries));
+    recv_replies = malloc((local_cnt + 1) * sizeof(*recv_replies));
+    *shared_recs = malloc((local_cnt + 1) * sizeof(darshan_record_id));
+    assert(send_counts && ref_array && send_queries && recv_replies &&
+        *shared_recs);
+    send_displs = send_counts + nprocs;
+    recv_counts = send_displs + nprocs;
+    recv_displs = recv_counts + nprocs;
+
+    /* bucket local records by the rank owning their id */
+    HASH_ITER(hlink, core->name_hash, ref, tmp)
+    {
+        send_counts[ref->id % nprocs]++;
+    }
+    for(i = 1; i < nprocs; i++)
+        send_displs[i] = send_displs[i-1] + send_counts[i-1];
+    HASH_ITER(hlink, core->name_hash, ref, tmp)
+    {
+        j = send_displs[ref->id % nprocs]++;
+        ref_array[j] = ref;
+        send_queries[j].id = ref->id;
+        send_queries[j].mod_flags = ref->mod_flags;
+    }
+    for(i = 0; i < nprocs; i++)
+        send_displs[i] -= send_counts[i];
 
-    /* broadcast root's number of records to all other processes */
-    darshan_mpi_bcast(&tmp_cnt, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    /* tell each owner how many queries to expect from us */
+    darshan_mpi_alltoall(send_counts, 1, MPI_INT, recv_counts, 1, MPI_INT,
+        MPI_COMM_WORLD);
+    recv_cnt = 0;
+    for(i = 0; i < nprocs; i++)
+    {
+        recv_displs[i] = recv_cnt;
+        recv_cnt += recv_counts[i];
+    }
+
+    /* exchange counts and offsets are in bytes from here on */
+    for(i = 0; i < nprocs; i++)
+    {
+        send_counts[i] *= sizeof(*send_queries);
+        send_displs[i] *= sizeof(*send_queries);
+        recv_counts[i] *= sizeof(*send_queries);
+        recv_displs[i] *= sizeof(*send_queries);
+    }
 
-    /* use root record count to allocate data structures */
-    id_array = malloc(tmp_cnt * sizeof(darshan_record_id));
-    mod_flags = malloc(tmp_cnt * sizeof(uint64_t));
-    global_mod_flags = malloc(tmp_cnt * sizeof(uint64_t));
-    *shared_recs = malloc(tmp_cnt * sizeof(darshan_record_id));
-    assert(id_array && mod_flags && global_mod_flags && *shared_recs);
+    recv_queries = malloc((recv_cnt + 1) * sizeof(*recv_queries));
+    send_replies = malloc((recv_cnt + 1) * sizeof(*send_replies));
+    entries = malloc((recv_cnt + 1) * sizeof(*entries));
+    assert(recv_queries && send_replies && entries);
 
-    memset(mod_flags, 0, tmp_cnt * sizeof(uint64_t));
-    memset(global_mod_flags, 0, tmp_cnt * sizeof(uint64_t));
-    memset(*shared_recs, 0, tmp_cnt * sizeof(darshan_record_id));
+    darshan_mpi_alltoallv(send_queries, send_counts, send_displs, MPI_BYTE,
+        recv_queries, recv_counts, recv_displs, MPI_BYTE, MPI_COMM_WORLD);
 
-    /* first, determine list of records root process has opened */
-    if(my_rank == 0)
+    /* group the queries we own by record id, ordered by sending rank */
+    for(i = 0, k = 0; i < nprocs; i++)
     {
-        i = 0;
-        HASH_ITER(hlink, core->name_hash, ref, tmp)
+        for(j = 0; j < recv_counts[i] / (int)sizeof(*recv_queries); j++, k++)
         {
-            id_array[i++] = ref->name_record->id;
+            entries[k].id = recv_queries[k].id;
+            entries[k].mod_flags = recv_queries[k].mod_flags;
+            entries[k].src_rank = i;
+            entries[k].reply_ndx = k;
         }
     }
+    qsort(entries, recv_cnt, sizeof(*entries), darshan_shared_rec_entry_cmp);
 
-    /* broadcast root's list of records to all other processes */
-    darshan_mpi_bcast(id_array, (tmp_cnt * sizeof(darshan_record_id)),
-        MPI_BYTE, 0, MPI_COMM_WORLD);
-
-    /* everyone looks to see if they opened the same records as root */
-    for(i=0; i<tmp_cnt; i++)
+    /* reply to each query with the totals for its record */
+    for(i = 0; i < recv_cnt; i = j)
     {
-        HASH_FIND(hlink, core->name_hash, &id_array[i], sizeof(darshan_record_id), ref);
-        if(ref)
+        global_mod_flags = entries[i].mod_flags;
+        for(j = i + 1; j < recv_cnt && entries[j].id == entries[i].id; j++)
+            global_mod_flags &= entries[j].mod_flags;
+        for(k = i; k < j; k++)
         {
-            /* we opened that record too, save the mod_flags */
-            mod_flags[i] = ref->mod_flags;
+            send_replies[entries[k].reply_ndx].global_mod_flags =
+                (j - i == nprocs) ? global_mod_flags : 0;
+            send_replies[entries[k].reply_ndx].rank_count = j - i;
+            send_replies[entries[k].reply_ndx].name_rank = entries[i].src_rank;
         }
     }
 
-    /* now allreduce so everyone agrees which records are shared and
-     * which modules accessed them collectively
-     */
-    darshan_mpi_allreduce(mod_flags, global_mod_flags, tmp_cnt, MPI_UINT64_T, MPI_BAND, MPI_COMM_WORLD);
+    /* replies travel back the way the queries came, and are the same size */
+    darshan_mpi_alltoallv(send_replies, recv_counts, recv_displs, MPI_BYTE,
+        recv_replies, send_counts, send_displs, MPI_BYTE, MPI_COMM_WORLD);
 
     j = 0;
-    for(i=0; i<tmp_cnt; i++)
+    for(i = 0; i < local_cnt; i++)
     {
-        if(global_mod_flags[i] != 0)
-        {
-            (*shared_recs)[j++] = id_array[i];
+        ref = ref_array[i];
+        ref->rank_count = recv_replies[i].rank_count;
+        ref->name_rank = recv_replies[i].name_rank;
 
-            /* set global_mod_flags so we know which modules collectively
-             * accessed this module. we need this info to support shared
-             * record reductions
-             */
-            HASH_FIND(hlink, core->name_hash, &id_array[i], sizeof(darshan_record_id), ref);
-            assert(ref);
-            ref->global_mod_flags = global_mod_flags[i];
-        }
+        /* set global_mod_flags so we know which modules collectively
+         * accessed this record. we need this info to support shared
+         * record reductions
+         */
+        ref->global_mod_flags = recv_replies[i].global_mod_flags;
+        if(ref->global_mod_flags != 0)
+            (*shared_recs)[j++] = ref->id;
     }
     *shared_rec_cnt = j;
 
-    free(id_array);
-    free(mod_flags);
-    free(global_mod_flags);
+    /* every process holds all globally shared records, so sorting gives
+     * each of them the same list
+     */
+    qsort(*shared_recs, j, sizeof(darshan_record_id), darshan_record_id_cmp);
+
+    free(send_counts);
+    free(ref_array);
+    free(send_queries);
+    free(recv_replies);
+    free(recv_queries);
+    free(send_replies);
+    free(entries);
 #else
     int j;
     struct darshan_core_name_record_ref *tmp, *ref;
@@ -1610,7 +2823,7 @@ static void darshan_get_shared_records(struct darshan_core_runtime *core,
     j = 0;
     HASH_ITER(hlink, core->name_hash, ref, tmp)
     {
-        (*shared_recs)[j++] = ref->name_record->id;
+        (*shared_recs)[j++] = ref->id;
     }
     *shared_rec_cnt = j;
 
@@ -1689,6 +2902,99 @@ static int darshan_log_open_all(char *logfile_name, int *log_fh)
 }
 #endif
 
+/* pick the log compression codec and level from the environment */
+static void darshan_comp_select()
+{
+    char *envstr;
+    int level;
+
+    darshan_comp_type = DARSHAN_ZLIB_COMP;
+    darshan_comp_level = Z_DEFAULT_COMPRESSION;
+
+    envstr = getenv(DARSHAN_COMP_OVERRIDE);
+    if(envstr)
+    {
+#ifdef HAVE_LIBZSTD
+        if(strcmp(envstr, "zstd") == 0)
+        {
+            darshan_comp_type = DARSHAN_ZSTD_COMP;
+            darshan_comp_level = DARSHAN_DEF_ZSTD_LEVEL;
+        }
+#endif
+#ifdef HAVE_LIBLZ4
+        if(strcmp(envstr, "lz4") == 0)
+        {
+            darshan_comp_type = DARSHAN_LZ4_COMP;
+            darshan_comp_level = 0;
+        }
+#endif
+        if(darshan_comp_type == DARSHAN_ZLIB_COMP &&
+            strcmp(envstr, "zlib") != 0 && my_rank == 0)
+        {
+            darshan_core_fprintf(stderr, "darshan library warning: "
+                "unsupported %s codec '%s', using zlib\n",
+                DARSHAN_COMP_OVERRIDE, envstr);
+        }
+    }
+
+    envstr = getenv(DARSHAN_COMP_LEVEL_OVERRIDE);
+    if(envstr && sscanf(envstr, "%d", &level) == 1)
+    {
+        /* out of range levels are clamped by the individual libraries,
+         * except for zlib which rejects them
+         */
+        if(darshan_comp_type != DARSHAN_ZLIB_COMP ||
+            (level >= Z_NO_COMPRESSION && level <= Z_BEST_COMPRESSION))
+            darshan_comp_level = level;
+    }
+
+    return;
+}
+
+/* upper bound on the compressed size of len bytes with the selected codec */
+static int darshan_comp_bound(int len)
+{
+#ifdef HAVE_LIBZSTD
+    if(darshan_comp_type == DARSHAN_ZSTD_COMP)
+        return(ZSTD_compressBound(len));
+#endif
+#ifdef HAVE_LIBLZ4
+    if(darshan_comp_type == DARSHAN_LZ4_COMP)
+        return(LZ4F_compressFrameBound(len, NULL));
+#endif
+    return(compressBound(len));
+}
+
+#if defined(HAVE_LIBZSTD) || defined(HAVE_LIBLZ4)
+/* zstd and lz4 compress a single contiguous input in one call, so gather
+ * multiple input buffers into a temporary one first
+ */
+static void *darshan_gather_buffers(void **pointers, int *lengths, int count,
+    int total)
+{
+    char *buf;
+    int i;
+
+    if(count == 1)
+        return(pointers[0]);
+
+    buf = malloc(total);
+    if(!buf)
+        return(NULL);
+    total = 0;
+    for(i = 0; i < count; i++)
+    {
+        memcpy(buf + total, pointers[i], lengths[i]);
+        total += lengths[i];
+    }
+
+    return(buf);
+}
+#endif
+
+/* NOTE: comp_buf_length contains the size of comp_buf at the beginning
+ *       of the call, and the size of the compressed data at the end
+ */
 static int darshan_deflate_buffer(void **pointers, int *lengths, int count,
     char *comp_buf, int *comp_buf_length)
 {
@@ -1696,6 +3002,10 @@ static int darshan_deflate_buffer(void **pointers, int *lengths, int count,
     int i;
     int total_target = 0;
     z_stream tmp_stream;
+#if defined(HAVE_LIBZSTD) || defined(HAVE_LIBLZ4)
+    void *in_buf;
+    size_t comp_ret;
+#endif
 
     /* just return if there is no data */
     for(i = 0; i < count; i++)
@@ -1704,6 +3014,44 @@ static int darshan_deflate_buffer(void **pointers, int *lengths, int count,
     }
     if(total_target)
     {
+#ifdef HAVE_LIBZSTD
+        if(darshan_comp_type == DARSHAN_ZSTD_COMP)
+        {
+            in_buf = darshan_gather_buffers(pointers, lengths, count,
+                total_target);
+            if(!in_buf)
+                return(-1);
+            comp_ret = ZSTD_compress(comp_buf, *comp_buf_length, in_buf,
+                total_target, darshan_comp_level);
+            if(in_buf != pointers[0])
+                free(in_buf);
+            if(ZSTD_isError(comp_ret))
+                return(-1);
+            *comp_buf_length = comp_ret;
+            return(0);
+        }
+#endif
+#ifdef HAVE_LIBLZ4
+        if(darshan_comp_type == DARSHAN_LZ4_COMP)
+        {
+            LZ4F_preferences_t prefs;
+
+            memset(&prefs, 0, sizeof(prefs));
+            prefs.compressionLevel = darshan_comp_level;
+            in_buf = darshan_gather_buffers(pointers, lengths, count,
+                total_target);
+            if(!in_buf)
+                return(-1);
+            comp_ret = LZ4F_compressFrame(comp_buf, *comp_buf_length, in_buf,
+                total_target, &prefs);
+            if(in_buf != pointers[0])
+                free(in_buf);
+            if(LZ4F_isError(comp_ret))
+                return(-1);
+            *comp_buf_length = comp_ret;
+            return(0);
+        }
+#endif
         total_target = 0;
     }
     else
@@ -1721,14 +3069,14 @@ static int darshan_deflate_buffer(void **pointers, int *lengths, int count,
     /* TODO: check these parameters? */
 //    ret = deflateInit2(&tmp_stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
 //        15 + 16, 8, Z_DEFAULT_STRATEGY);
-    ret = deflateInit(&tmp_stream, Z_DEFAULT_COMPRESSION);
+    ret = deflateInit(&tmp_stream, darshan_comp_level);
     if(ret != Z_OK)
     {
         return(-1);
     }
 
     tmp_stream.next_out = (unsigned char *)comp_buf;
-    tmp_stream.avail_out = darshan_mod_mem_quota;
+    tmp_stream.avail_out = *comp_buf_length;
 
     /* loop over the input pointers */
     for(i = 0; i < count; i++)
@@ -1775,162 +3123,530 @@ static int darshan_deflate_buffer(void **pointers, int *lengths, int count,
     return(0);
 }
 
-/* NOTE: the map written to file may contain duplicate id->name entries if a
- *       record is opened by multiple ranks, but not all ranks
+/* serialize the record name->id hash into a newly allocated buffer,
+ * returned in name_buf. returns 0 on success, -1 on failure
+ *
+ * NOTE: a record held by multiple ranks only has its name written by the
+ *       lowest of those ranks, once shared records have been detected
  */
-#ifdef HAVE_MPI
-static int darshan_log_write_name_record_hash(struct darshan_mpi_file log_fh,
-    struct darshan_core_runtime *core, uint64_t *inout_off)
+static int darshan_log_pack_name_records(struct darshan_core_runtime *core,
+    char **name_buf, int *name_buf_len)
 {
-    struct darshan_core_name_record_ref *ref;
-    struct darshan_name_record *name_rec;
-    char *my_buf, *shared_buf;
-    char *tmp_p;
-    int rec_len;
-    int shared_buf_len;
-    int name_rec_buf_len;
-    int ret;
+    struct darshan_core_name_record_ref **ref_array;
+    struct darshan_core_name_record_ref *ref, *tmp;
+    char *prev_name = NULL, *cur_name = NULL;
+    char *swap;
+    int ref_cnt = 0;
+    int max_name_len = 0;
+    int name_len;
+    int i;
 
-    /* remove globally shared name records from non-zero ranks */
-    name_rec_buf_len = core->name_mem_used;
-    if(my_rank > 0)
+    *name_buf_len = 0;
+    *name_buf = malloc(core->name_mem_used + 1);
+    ref_array = malloc((HASH_CNT(hlink, core->name_hash) + 1) * sizeof(*ref_array));
+    if(*name_buf && ref_array)
     {
-        name_rec = core->log_name_p;
-        my_buf = core->log_name_p;
-        shared_buf = core->comp_buf;
-        shared_buf_len = 0;
-        while(name_rec_buf_len > 0)
+        /* remove name records written by another rank */
+        HASH_ITER(hlink, core->name_hash, ref, tmp)
         {
-            HASH_FIND(hlink, core->name_hash, &(name_rec->id),
-                sizeof(darshan_record_id), ref);
-            assert(ref);
-            rec_len = sizeof(darshan_record_id) + strlen(name_rec->name) + 1;
-
-            if(ref->global_mod_flags)
-            {
-                /* this record is shared globally, move to the temporary
-                 * shared record buffer and update hash references
-                 */
-                HASH_DELETE(hlink, core->name_hash, ref);
-                memcpy(shared_buf, name_rec, rec_len);
-                ref->name_record = (struct darshan_name_record *)shared_buf;
-                HASH_ADD(hlink, core->name_hash, name_record->id,
-                    sizeof(darshan_record_id), ref);
-
-                shared_buf += rec_len;
-                shared_buf_len += rec_len;
-            }
-            else
-            {
-                /* this record is not shared, but we still may need to
-                 * move it forward in our buffer and update hash references
-                 */
-                if(my_buf != (char *)name_rec)
-                {
-                    HASH_DELETE(hlink, core->name_hash, ref);
-                    memcpy(my_buf, name_rec, rec_len);
-                    ref->name_record =(struct darshan_name_record *)my_buf;
-                    HASH_ADD(hlink, core->name_hash, name_record->id,
-                        sizeof(darshan_record_id), ref);
-                }
-                my_buf += rec_len;
-            }
-
-            tmp_p = (char *)name_rec + rec_len;
-            name_rec = (struct darshan_name_record *)tmp_p;
-            name_rec_buf_len -= rec_len;
+            if(ref->rank_count > 1 && ref->name_rank != my_rank)
+                continue;
+            ref_array[ref_cnt++] = ref;
+            name_len = ref->dir->path_len + strlen(ref->base);
+            if(name_len > max_name_len)
+                max_name_len = name_len;
         }
-        name_rec_buf_len = core->name_mem_used - shared_buf_len;
-
-        /* append the shared records back to the end of the name record
-         * buffer and update hash table references so we can still
-         * reference these records as modules shutdown
-         */
-        name_rec = (struct darshan_name_record *)core->comp_buf;
-        while(shared_buf_len > 0)
-        {
-            HASH_FIND(hlink, core->name_hash, &(name_rec->id),
-                sizeof(darshan_record_id), ref);
-            assert(ref);
-            rec_len = sizeof(darshan_record_id) + strlen(name_rec->name) + 1;
 
-            HASH_DELETE(hlink, core->name_hash, ref);
-            memcpy(my_buf, name_rec, rec_len);
-            ref->name_record = (struct darshan_name_record *)my_buf;
-            HASH_ADD(hlink, core->name_hash, name_record->id,
-                sizeof(darshan_record_id), ref);
+        prev_name = malloc(max_name_len + 1);
+        cur_name = malloc(max_name_len + 1);
+    }
+    if(!prev_name || !cur_name)
+    {
+        free(ref_array);
+        free(prev_name);
+        free(cur_name);
+        free(*name_buf);
+        *name_buf = NULL;
+        return(-1);
+    }
 
-            tmp_p = (char *)name_rec + rec_len;
-            name_rec = (struct darshan_name_record *)tmp_p;
-            my_buf += rec_len;
-            shared_buf_len -= rec_len;
-        }
+    /* sort the records so names sharing a prefix are adjacent, then
+     * front code each name relative to the one preceding it
+     */
+    qsort(ref_array, ref_cnt, sizeof(*ref_array), darshan_name_record_ref_cmp);
+    prev_name[0] = '\0';
+    for(i = 0; i < ref_cnt; i++)
+    {
+        sprintf(cur_name, "%s%s", ref_array[i]->dir->path, ref_array[i]->base);
+        *name_buf_len += darshan_name_record_encode(*name_buf + *name_buf_len,
+            ref_array[i]->id, prev_name, cur_name);
+        swap = prev_name;
+        prev_name = cur_name;
+        cur_name = swap;
     }
 
-    /* collectively write out the record hash to the darshan log */
-    ret = darshan_log_append_all(log_fh, core, core->log_name_p,
-        name_rec_buf_len, inout_off);
+    free(ref_array);
+    free(prev_name);
+    free(cur_name);
 
-    return(ret);
+    return(0);
 }
-#else
-static int darshan_log_write_name_record_hash(int log_fh,
-    struct darshan_core_runtime *core, uint64_t *inout_off)
+
+#ifdef HAVE_MPI
+static int darshan_routed_name_cmp(const void *a, const void *b)
 {
-    return darshan_log_append_all(log_fh, core, core->log_name_p, core->name_mem_used, inout_off);
+    const struct darshan_core_routed_name *name_a = a;
+    const struct darshan_core_routed_name *name_b = b;
+
+    return(strcmp(name_a->name, name_b->name));
 }
-#endif /* #ifdef HAVE_MPI */
 
-/* NOTE: inout_off contains the starting offset of this append at the beginning
- *       of the call, and contains the ending offset at the end of the call.
- *       This variable is only valid on the root rank (rank 0).
+/* route each name record to the rank owning its id, which serializes the
+ * name records it owns into a newly allocated buffer, returned in name_buf.
+ * returns 0 on success, -1 on failure
+ *
+ * NOTE: this is collective, and must follow darshan_get_shared_records so
+ *       that only one rank sends each name. each rank then writes a disjoint,
+ *       evenly sized slice of a name map with no duplicate records
  */
-#ifdef HAVE_MPI
-static int darshan_log_append_all(struct darshan_mpi_file log_fh, struct darshan_core_runtime *core,
-    void *buf, int count, uint64_t *inout_off)
+static int darshan_log_route_name_records(struct darshan_core_runtime *core,
+    char **name_buf, int *name_buf_len)
 {
-    MPI_Offset send_off, my_off;
-    MPI_Status status; /* if used, darshan_mpi_file_* needs to be updated */
-    int comp_buf_sz = 0;
-    int ret;
+    struct darshan_core_name_record_ref *ref, *tmp;
+    struct darshan_core_routed_name *names;
+    int *send_counts, *send_displs, *recv_counts, *recv_displs;
+    char *send_buf, *recv_buf, *p;
+    int recv_len = 0;
+    int name_cnt = 0;
+    int buf_sz = 0;
+    int dest;
+    int i;
 
-    /* compress the input buffer */
-    ret = darshan_deflate_buffer((void **)&buf, &count, 1,
-        core->comp_buf, &comp_buf_sz);
-    if(ret < 0)
-        comp_buf_sz = 0;
+    send_counts = calloc(4 * nprocs, sizeof(int));
+    send_buf = malloc(core->name_mem_used + 1);
+    assert(send_counts && send_buf);
+    send_displs = send_counts + nprocs;
+    recv_counts = send_displs + nprocs;
+    recv_displs = recv_counts + nprocs;
 
-    /* figure out where everyone is writing using scan */
-    send_off = comp_buf_sz;
-    if(my_rank == 0)
+    /* pack the (id, name) pairs we send to each owner back to back */
+    HASH_ITER(hlink, core->name_hash, ref, tmp)
     {
-        send_off += *inout_off; /* rank 0 knows the beginning offset */
+        if(ref->rank_count > 1 && ref->name_rank != my_rank)
+            continue;
+        send_counts[ref->id % nprocs] += sizeof(ref->id) +
+            ref->dir->path_len + strlen(ref->base) + 1;
+    }
+    for(i = 1; i < nprocs; i++)
+        send_displs[i] = send_displs[i-1] + send_counts[i-1];
+    HASH_ITER(hlink, core->name_hash, ref, tmp)
+    {
+        if(ref->rank_count > 1 && ref->name_rank != my_rank)
+            continue;
+        dest = ref->id % nprocs;
+        p = send_buf + send_displs[dest];
+        memcpy(p, &ref->id, sizeof(ref->id));
+        p += sizeof(ref->id);
+        p += sprintf(p, "%s%s", ref->dir->path, ref->base) + 1;
+        send_displs[dest] = p - send_buf;
     }
+    for(i = 0; i < nprocs; i++)
+        send_displs[i] -= send_counts[i];
 
-    darshan_mpi_scan(&send_off, &my_off, 1, MPI_OFFSET,
-        MPI_SUM, MPI_COMM_WORLD);
-    /* scan is inclusive; subtract local size back out */
-    my_off -= comp_buf_sz;
+    darshan_mpi_alltoall(send_counts, 1, MPI_INT, recv_counts, 1, MPI_INT,
+        MPI_COMM_WORLD);
+    for(i = 0; i < nprocs; i++)
+    {
+        recv_displs[i] = recv_len;
+        recv_len += recv_counts[i];
+    }
+    recv_buf = malloc(recv_len + 1);
+    assert(recv_buf);
 
-    if(ret == 0)
+    darshan_mpi_alltoallv(send_buf, send_counts, send_displs, MPI_BYTE,
+        recv_buf, recv_counts, recv_displs, MPI_BYTE, MPI_COMM_WORLD);
+    free(send_buf);
+    free(send_counts);
+
+    /* unpack the name records we own */
+    for(p = recv_buf; p < recv_buf + recv_len; p += strlen(p) + 1)
     {
-        /* no compression errors, proceed with the collective write */
-        ret = darshan_mpi_file_write_at_all(log_fh, my_off,
-            core->comp_buf, comp_buf_sz, MPI_BYTE, &status);
+        p += sizeof(darshan_record_id);
+        name_cnt++;
     }
-    else
+    names = malloc((name_cnt + 1) * sizeof(*names));
+    *name_buf = malloc(recv_len + name_cnt * DARSHAN_NAME_RECORD_HDR_SIZE + 1);
+    if(!names || !*name_buf)
     {
-        /* error during compression. preserve and return error to caller,
-         * but participate in collective write to avoid deadlock.
-         */
-        (void)darshan_mpi_file_write_at_all(log_fh, my_off,
-            core->comp_buf, comp_buf_sz, MPI_BYTE, &status);
+        free(names);
+        free(*name_buf);
+        free(recv_buf);
+        *name_buf = NULL;
+        *name_buf_len = 0;
+        return(-1);
+    }
+    for(i = 0, p = recv_buf; i < name_cnt; i++, p += strlen(p) + 1)
+    {
+        memcpy(&names[i].id, p, sizeof(darshan_record_id));
+        p += sizeof(darshan_record_id);
+        names[i].name = p;
     }
 
-    if(nprocs > 1)
+    /* sort the names so those sharing a prefix are adjacent, then front
+     * code each name relative to the one preceding it
+     */
+    qsort(names, name_cnt, sizeof(*names), darshan_routed_name_cmp);
+    for(i = 0; i < name_cnt; i++)
     {
-        /* send the ending offset from rank (n-1) to rank 0 
-         *
+        buf_sz += darshan_name_record_encode(*name_buf + buf_sz, names[i].id,
+            (i > 0) ? names[i-1].name : "", names[i].name);
+    }
+    *name_buf_len = buf_sz;
+
+    free(names);
+    free(recv_buf);
+
+    return(0);
+}
+#endif
+
+static struct darshan_core_comp_pool *darshan_comp_pool_create(int nthreads)
+{
+    struct darshan_core_comp_pool *pool;
+    int i;
+
+    pool = malloc(sizeof(*pool));
+    if(!pool)
+        return(NULL);
+    memset(pool, 0, sizeof(*pool));
+    pthread_mutex_init(&pool->mutex, NULL);
+    pthread_cond_init(&pool->cond, NULL);
+
+    /* NOTE: if no threads can be started, regions are just compressed by
+     * the calling thread as they are submitted
+     */
+    for(i = 0; i < nthreads; i++)
+    {
+        if(pthread_create(&pool->threads[i], NULL, darshan_comp_pool_worker,
+            pool) != 0)
+            break;
+        pool->nthreads++;
+    }
+
+    return(pool);
+}
+
+static void darshan_comp_pool_destroy(struct darshan_core_comp_pool *pool)
+{
+    int i;
+
+    /* let workers finish any regions they have started and exit */
+    pthread_mutex_lock(&pool->mutex);
+    pool->finish = 1;
+    pthread_cond_broadcast(&pool->cond);
+    pthread_mutex_unlock(&pool->mutex);
+    for(i = 0; i < pool->nthreads; i++)
+        pthread_join(pool->threads[i], NULL);
+
+    for(i = 0; i < DARSHAN_MAX_MODS + 1; i++)
+        free(pool->jobs[i].comp_buf);
+    pthread_mutex_destroy(&pool->mutex);
+    pthread_cond_destroy(&pool->cond);
+    free(pool);
+
+    return;
+}
+
+static void darshan_comp_pool_submit(struct darshan_core_comp_pool *pool,
+    int job_id, void *buf, int len)
+{
+    struct darshan_core_comp_job *job = &pool->jobs[job_id];
+
+    job->buf = buf;
+    job->len = len;
+
+    if(pool->nthreads == 0)
+    {
+        darshan_comp_job_run(job);
+        job->done = 1;
+        return;
+    }
+
+    pthread_mutex_lock(&pool->mutex);
+    pool->queue[pool->queue_len++] = job;
+    pthread_cond_broadcast(&pool->cond);
+    pthread_mutex_unlock(&pool->mutex);
+
+    return;
+}
+
+static struct darshan_core_comp_job *darshan_comp_pool_wait(
+    struct darshan_core_comp_pool *pool, int job_id)
+{
+    struct darshan_core_comp_job *job = &pool->jobs[job_id];
+
+    pthread_mutex_lock(&pool->mutex);
+    while(!job->done)
+        pthread_cond_wait(&pool->cond, &pool->mutex);
+    pthread_mutex_unlock(&pool->mutex);
+
+    return(job);
+}
+
+static void *darshan_comp_pool_worker(void *arg)
+{
+    struct darshan_core_comp_pool *pool = arg;
+    struct darshan_core_comp_job *job;
+
+    pthread_mutex_lock(&pool->mutex);
+    while(1)
+    {
+        /* compress regions in the order they were submitted */
+        while(pool->queue_next == pool->queue_len && !pool->finish)
+            pthread_cond_wait(&pool->cond, &pool->mutex);
+        if(pool->queue_next == pool->queue_len)
+            break;
+        job = pool->queue[pool->queue_next++];
+        pthread_mutex_unlock(&pool->mutex);
+
+        darshan_comp_job_run(job);
+
+        pthread_mutex_lock(&pool->mutex);
+        job->done = 1;
+        pthread_cond_broadcast(&pool->cond);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+
+    return(NULL);
+}
+
+static void darshan_comp_job_run(struct darshan_core_comp_job *job)
+{
+    double tm1 = time_nanoseconds();
+
+    job->comp_len = darshan_comp_bound(job->len);
+    job->comp_buf = malloc(job->comp_len);
+    if(job->comp_buf)
+        job->ret = darshan_deflate_buffer(&job->buf, &job->len, 1,
+            job->comp_buf, &job->comp_len);
+    else
+        job->ret = -1;
+    if(job->ret != 0)
+        job->comp_len = 0;
+
+    job->comp_time = time_nanoseconds() - tm1;
+    return;
+}
+
+#ifdef HAVE_MPI
+/* split the processes into per-node communicators, plus a communicator of
+ * the lowest rank on each node (the node leaders), if node-aggregated log
+ * writes are enabled. rank 0 decides for everyone
+ */
+static void darshan_log_node_comms_create()
+{
+    int node_rank;
+    int enable = 0;
+
+    if(!using_mpi || nprocs == 1)
+        return;
+
+#if MPI_VERSION >= 3
+    if(my_rank == 0 && getenv(DARSHAN_NODE_AGGREGATE_OVERRIDE))
+        enable = 1;
+#endif
+    darshan_mpi_bcast(&enable, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    if(!enable)
+        return;
+
+    /* we don't bother wrapping the communicator functions used here, as
+     * node aggregation is never enabled in serial mode
+     */
+#if MPI_VERSION >= 3
+    PMPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, my_rank,
+        MPI_INFO_NULL, &darshan_node_comm);
+    PMPI_Comm_rank(darshan_node_comm, &node_rank);
+    PMPI_Comm_split(MPI_COMM_WORLD, (node_rank == 0) ? 0 : MPI_UNDEFINED,
+        my_rank, &darshan_leader_comm);
+#endif
+
+    return;
+}
+
+static void darshan_log_node_comms_free()
+{
+    if(darshan_node_comm != MPI_COMM_NULL)
+        PMPI_Comm_free(&darshan_node_comm);
+    if(darshan_leader_comm != MPI_COMM_NULL)
+        PMPI_Comm_free(&darshan_leader_comm);
+
+    return;
+}
+
+/* append a compressed log region to the darshan log, with the node leaders
+ * writing the regions of all processes on their node
+ *
+ * NOTE: leaders gather their node's region sizes, and only the leaders
+ *       scan for the offsets each node writes at. the regions themselves
+ *       are then gathered to the leader, which writes them with a single
+ *       call. if a node's regions do not fit in a single buffer, processes
+ *       instead write their own regions at offsets given by the leader.
+ *       regions are ordered by node and then by rank within each node,
+ *       which readers of the log do not depend on
+ */
+static int darshan_log_append_node(struct darshan_mpi_file log_fh,
+    struct darshan_core_comp_job *job, uint64_t *inout_off)
+{
+    MPI_Offset node_sz = 0, node_off = 0, my_off;
+    MPI_Offset *offsets = NULL;
+    MPI_Status status; /* if used, darshan_mpi_file_* needs to be updated */
+    int comp_buf_sz = job->comp_len;
+    int ret = job->ret;
+    int *sizes = NULL;
+    int *displs = NULL;
+    char *node_buf = NULL;
+    int node_rank, node_nprocs, leader_rank, leader_nprocs;
+    int gathered = 0;
+    int i;
+
+    PMPI_Comm_rank(darshan_node_comm, &node_rank);
+    PMPI_Comm_size(darshan_node_comm, &node_nprocs);
+    if(node_rank == 0)
+    {
+        sizes = malloc(node_nprocs * sizeof(*sizes));
+        displs = malloc(node_nprocs * sizeof(*displs));
+        offsets = malloc(node_nprocs * sizeof(*offsets));
+        assert(sizes && displs && offsets);
+    }
+
+    /* node leaders learn how much each process on their node writes */
+    PMPI_Gather(&comp_buf_sz, 1, MPI_INT, sizes, 1, MPI_INT, 0,
+        darshan_node_comm);
+
+    if(node_rank == 0)
+    {
+        for(i = 0; i < node_nprocs; i++)
+        {
+            offsets[i] = node_sz;
+            node_sz += sizes[i];
+        }
+
+        /* figure out where each node is writing using scan */
+        PMPI_Comm_rank(darshan_leader_comm, &leader_rank);
+        PMPI_Comm_size(darshan_leader_comm, &leader_nprocs);
+        my_off = node_sz;
+        if(my_rank == 0)
+            my_off += *inout_off; /* rank 0 knows the beginning offset */
+        PMPI_Scan(&my_off, &node_off, 1, MPI_OFFSET, MPI_SUM,
+            darshan_leader_comm);
+        /* scan is inclusive; subtract the node's size back out */
+        node_off -= node_sz;
+
+        /* send the ending offset from the last leader to rank 0 */
+        if(leader_nprocs == 1)
+            *inout_off = node_off + node_sz;
+        else if(leader_rank == (leader_nprocs-1))
+        {
+            my_off = node_off + node_sz;
+            PMPI_Send(&my_off, 1, MPI_OFFSET, 0, 0, darshan_leader_comm);
+        }
+        else if(my_rank == 0)
+        {
+            PMPI_Recv(&my_off, 1, MPI_OFFSET, (leader_nprocs-1), 0,
+                darshan_leader_comm, &status);
+            *inout_off = my_off;
+        }
+
+        if(node_sz <= INT_MAX)
+            node_buf = malloc(node_sz + 1);
+        gathered = (node_buf != NULL);
+        for(i = 0; i < node_nprocs; i++)
+        {
+            displs[i] = offsets[i];
+            offsets[i] += node_off;
+        }
+    }
+
+    PMPI_Bcast(&gathered, 1, MPI_INT, 0, darshan_node_comm);
+    if(gathered)
+    {
+        PMPI_Gatherv(job->comp_buf, comp_buf_sz, MPI_BYTE, node_buf, sizes,
+            displs, MPI_BYTE, 0, darshan_node_comm);
+        if(node_rank == 0 && node_sz > 0 &&
+            darshan_mpi_file_write_at(log_fh, node_off, node_buf, node_sz,
+                MPI_BYTE, &status) != MPI_SUCCESS)
+            ret = -1;
+    }
+    else
+    {
+        PMPI_Scatter(offsets, 1, MPI_OFFSET, &my_off, 1, MPI_OFFSET, 0,
+            darshan_node_comm);
+        if(comp_buf_sz > 0 &&
+            darshan_mpi_file_write_at(log_fh, my_off, job->comp_buf,
+                comp_buf_sz, MPI_BYTE, &status) != MPI_SUCCESS)
+            ret = -1;
+    }
+
+    free(sizes);
+    free(displs);
+    free(offsets);
+    free(node_buf);
+
+    if(ret != 0)
+        return(-1);
+    return(0);
+}
+#endif
+
+/* append a compressed log region to the darshan log
+ *
+ * NOTE: inout_off contains the starting offset of this append at the beginning
+ *       of the call, and contains the ending offset at the end of the call.
+ *       This variable is only valid on the root rank (rank 0).
+ */
+#ifdef HAVE_MPI
+static int darshan_log_append_all(struct darshan_mpi_file log_fh,
+    struct darshan_core_comp_job *job, uint64_t *inout_off)
+{
+    MPI_Offset send_off, my_off;
+    MPI_Status status; /* if used, darshan_mpi_file_* needs to be updated */
+    int comp_buf_sz = job->comp_len;
+    int ret = job->ret;
+
+    if(darshan_node_comm != MPI_COMM_NULL)
+        return(darshan_log_append_node(log_fh, job, inout_off));
+
+    /* figure out where everyone is writing using scan */
+    send_off = comp_buf_sz;
+    if(my_rank == 0)
+    {
+        send_off += *inout_off; /* rank 0 knows the beginning offset */
+    }
+
+    darshan_mpi_scan(&send_off, &my_off, 1, MPI_OFFSET,
+        MPI_SUM, MPI_COMM_WORLD);
+    /* scan is inclusive; subtract local size back out */
+    my_off -= comp_buf_sz;
+
+    if(ret == 0)
+    {
+        /* no compression errors, proceed with the collective write */
+        ret = darshan_mpi_file_write_at_all(log_fh, my_off,
+            job->comp_buf, comp_buf_sz, MPI_BYTE, &status);
+    }
+    else
+    {
+        /* error during compression. preserve and return error to caller,
+         * but participate in collective write to avoid deadlock.
+         */
+        (void)darshan_mpi_file_write_at_all(log_fh, my_off,
+            job->comp_buf, comp_buf_sz, MPI_BYTE, &status);
+    }
+
+    if(nprocs > 1)
+    {
+        /* send the ending offset from rank (n-1) to rank 0 
+         *
          * we don't bother factoring out MPI_Send because it should never be
          * called in serial mode when nprocs == 1
          */
@@ -1958,20 +3674,17 @@ static int darshan_log_append_all(struct darshan_mpi_file log_fh, struct darshan
     return(0);
 }
 #else
-static int darshan_log_append_all(int log_fh, struct darshan_core_runtime *core,
-    void *buf, int count, uint64_t *inout_off)
+static int darshan_log_append_all(int log_fh,
+    struct darshan_core_comp_job *job, uint64_t *inout_off)
 {
     ssize_t written;
-    int comp_buf_sz = 0;
-    int ret;
+    int comp_buf_sz = job->comp_len;
 
-    /* compress the input buffer */
-    ret = darshan_deflate_buffer((void **)&buf, &count, 1, core->comp_buf, &comp_buf_sz);
-
-    if(ret != 0)
+    /* return an error if the region could not be compressed */
+    if(job->ret != 0)
         return(-1);
 
-    written = pwrite(log_fh, core->comp_buf, comp_buf_sz, *inout_off);
+    written = pwrite(log_fh, job->comp_buf, comp_buf_sz, *inout_off);
 
     if (written != comp_buf_sz)
         return(-1);
@@ -1981,38 +3694,975 @@ static int darshan_log_append_all(int log_fh, struct darshan_core_runtime *core,
 }
 #endif /* #ifdef HAVE_MPI */
 
-/* free darshan core data structures to shutdown */
-static void darshan_core_cleanup(struct darshan_core_runtime* core)
+/* finish the parts of initialization that are only needed once a process
+ * performs instrumented I/O, so that processes which never do (short-lived
+ * helpers in serial mode, in particular) start and exit quickly
+ */
+/* NOTE: must be called while holding the darshan-core lock */
+static void darshan_core_lazy_init()
 {
-    struct darshan_core_name_record_ref *tmp, *ref;
-    int i;
+    if(!darshan_core || darshan_core->lazy_init_done)
+        return;
 
-    HASH_ITER(hlink, core->name_hash, ref, tmp)
+    /* collect information about mounted file systems */
+    darshan_get_mounts(darshan_core);
+    darshan_core->lazy_init_done = 1;
+
+    return;
+}
+
+/* set the permissions on a completed log file and, if rename_partial is
+ * set, rename it from *.darshan_partial to *-<logwritetime>.darshan
+ */
+static void darshan_log_complete(char *logfile_name, double start_log_time,
+    int rename_partial)
+{
+    mode_t chmod_mode = S_IRUSR;
+#ifdef __DARSHAN_GROUP_READABLE_LOGS
+    chmod_mode |= S_IRGRP;
+#endif
+
+    if(!rename_partial)
     {
-        HASH_DELETE(hlink, core->name_hash, ref);
-        free(ref);
+        chmod(logfile_name, chmod_mode);
     }
+    else
+    {
+        char* tmp_index;
+        double end_log_time;
+        char* new_logfile_name;
 
-    for(i = 0; i < DARSHAN_MAX_MODS; i++)
+        new_logfile_name = malloc(PATH_MAX);
+        if(new_logfile_name)
+        {
+            new_logfile_name[0] = '\0';
+            end_log_time = time_nanoseconds();
+            strcat(new_logfile_name, logfile_name);
+            tmp_index = strstr(new_logfile_name, ".darshan_partial");
+            sprintf(tmp_index, "_%d.darshan", (int)(end_log_time-start_log_time+1));
+            rename(logfile_name, new_logfile_name);
+            /* set permissions on log file */
+            chmod(new_logfile_name, chmod_mode);
+            free(new_logfile_name);
+        }
+    }
+
+    return;
+}
+
+/* start the checkpoint thread, if checkpoints are enabled */
+static void darshan_checkpoint_start(int jobid, time_t start_time)
+{
+    char *envstr;
+    char *tmp_index;
+    struct sigaction act;
+    sigset_t all_set, old_set;
+    int ret;
+
+    darshan_ckpt.interval = 0;
+    darshan_ckpt.signum = 0;
+
+    /* silently ignore if the env variables are set poorly */
+    envstr = getenv(DARSHAN_CHECKPOINT_INTERVAL_OVERRIDE);
+    if(envstr && (sscanf(envstr, "%lf", &darshan_ckpt.interval) != 1 ||
+        darshan_ckpt.interval < 0))
+        darshan_ckpt.interval = 0;
+    envstr = getenv(DARSHAN_CHECKPOINT_SIGNAL_OVERRIDE);
+    if(envstr && (sscanf(envstr, "%d", &darshan_ckpt.signum) != 1 ||
+        darshan_ckpt.signum <= 0 || darshan_ckpt.signum >= NSIG))
+        darshan_ckpt.signum = 0;
+    if(darshan_ckpt.interval == 0 && darshan_ckpt.signum == 0)
+        return;
+
+    /* checkpoints are named after the log file, with the .darshan_partial
+     * suffix replaced by _checkpoint.darshan (or with .checkpoint appended
+     * if the user named the log file)
+     */
+    darshan_get_logfile_name(darshan_ckpt.log_name, jobid, localtime(&start_time));
+    tmp_index = strstr(darshan_ckpt.log_name, ".darshan_partial");
+    if(tmp_index)
+        *tmp_index = '\0';
+    if(strlen(darshan_ckpt.log_name) == 0 ||
+       strlen(darshan_ckpt.log_name) + strlen("_checkpoint.darshan_partial") >= PATH_MAX)
     {
-        if(core->mod_array[i])
-        {        
-            free(core->mod_array[i]);
-            core->mod_array[i] = NULL;
+        darshan_core_fprintf(stderr, "darshan library warning: "
+            "unable to determine checkpoint file path\n");
+        return;
+    }
+    strcat(darshan_ckpt.log_name, tmp_index ? "_checkpoint.darshan" : ".checkpoint");
+
+    darshan_comp_select();
+    darshan_ckpt.stop = 0;
+    if(sem_init(&darshan_ckpt.sem, 0, 0) != 0)
+        return;
+
+    if(darshan_ckpt.signum)
+    {
+        memset(&act, 0, sizeof(act));
+        act.sa_handler = darshan_checkpoint_signal;
+        sigemptyset(&act.sa_mask);
+        act.sa_flags = SA_RESTART;
+        if(sigaction(darshan_ckpt.signum, &act, &darshan_ckpt.old_act) != 0)
+            darshan_ckpt.signum = 0;
+    }
+
+    /* block all signals on the checkpoint thread, so that it never
+     * interrupts the application's own signal handling
+     */
+    sigfillset(&all_set);
+    pthread_sigmask(SIG_SETMASK, &all_set, &old_set);
+    ret = pthread_create(&darshan_ckpt.thread, NULL,
+        darshan_checkpoint_thread, NULL);
+    pthread_sigmask(SIG_SETMASK, &old_set, NULL);
+    if(ret != 0)
+    {
+        if(darshan_ckpt.signum)
+            sigaction(darshan_ckpt.signum, &darshan_ckpt.old_act, NULL);
+        sem_destroy(&darshan_ckpt.sem);
+        return;
+    }
+
+    darshan_ckpt.pid = getpid();
+    return;
+}
+
+/* stop the checkpoint thread, returning 1 if this process was writing
+ * checkpoints and 0 otherwise
+ */
+static int darshan_checkpoint_stop()
+{
+    if(darshan_ckpt.pid == 0)
+        return(0);
+
+    if(darshan_ckpt.signum)
+        sigaction(darshan_ckpt.signum, &darshan_ckpt.old_act, NULL);
+
+    /* a forked child inherits our state, but not the checkpoint thread */
+    if(darshan_ckpt.pid != getpid())
+    {
+        darshan_ckpt.pid = 0;
+        return(0);
+    }
+
+    __atomic_store_n(&darshan_ckpt.stop, 1, __ATOMIC_SEQ_CST);
+    sem_post(&darshan_ckpt.sem);
+    pthread_join(darshan_ckpt.thread, NULL);
+    sem_destroy(&darshan_ckpt.sem);
+    darshan_ckpt.pid = 0;
+
+    return(1);
+}
+
+static void darshan_checkpoint_signal(int signum)
+{
+    /* NOTE: sem_post() is async-signal-safe */
+    sem_post(&darshan_ckpt.sem);
+    return;
+}
+
+static void *darshan_checkpoint_thread(void *arg)
+{
+    struct timespec ts;
+    double sec;
+    int ret;
+
+    /* don't instrument the I/O used to write checkpoints */
+    darshan_core_thread_disabled = 1;
+
+    while(1)
+    {
+        if(darshan_ckpt.interval > 0)
+        {
+            clock_gettime(CLOCK_REALTIME, &ts);
+            sec = ts.tv_nsec * 1.0e-9 + darshan_ckpt.interval;
+            ts.tv_sec += (time_t)sec;
+            ts.tv_nsec = (sec - (time_t)sec) * 1.0e9;
+            ret = sem_timedwait(&darshan_ckpt.sem, &ts);
         }
+        else
+            ret = sem_wait(&darshan_ckpt.sem);
+        if(ret != 0 && errno == EINTR)
+            continue;
+        if(__atomic_load_n(&darshan_ckpt.stop, __ATOMIC_SEQ_CST))
+            break;
+
+        /* coalesce signals that arrived while writing the last checkpoint */
+        while(sem_trywait(&darshan_ckpt.sem) == 0);
+
+        darshan_checkpoint_write();
     }
 
-#ifndef __DARSHAN_ENABLE_MMAP_LOGS
-    free(core->log_hdr_p);
-    free(core->log_job_p);
-    free(core->log_exemnt_p);
-    free(core->log_name_p);
-    free(core->log_mod_p);
-#endif
+    return(NULL);
+}
+
+/* write a complete log file from a snapshot of the job data, the name
+ * records, and the records of each module that supports snapshots.
+ * returns 0 on success, -1 on failure
+ */
+static int darshan_checkpoint_write()
+{
+    struct darshan_header hdr;
+    darshan_module_snapshot snap_funcs[DARSHAN_MAX_MODS] = {0};
+    void *mod_bufs[DARSHAN_MAX_MODS] = {0};
+    int mod_buf_szs[DARSHAN_MAX_MODS] = {0};
+    char tmp_name[PATH_MAX];
+    char *job_buf;
+    int job_buf_len;
+    char *name_buf = NULL;
+    int name_buf_len = 0;
+    mode_t chmod_mode = S_IRUSR;
+    uint64_t off;
+    int fd = -1;
+    int partial;
+    int ret;
+    int i;
+
+    job_buf = malloc(sizeof(struct darshan_job) + DARSHAN_EXE_LEN + 1);
+    if(!job_buf)
+        return(-1);
+
+    DARSHAN_CORE_LOCK();
+    if(!darshan_core)
+    {
+        DARSHAN_CORE_UNLOCK();
+        free(job_buf);
+        return(-1);
+    }
+    memcpy(&hdr, darshan_core->log_hdr_p, sizeof(hdr));
+    memcpy(job_buf, darshan_core->log_job_p, sizeof(struct darshan_job));
+    strcpy(job_buf + sizeof(struct darshan_job), darshan_core->log_exemnt_p);
+    job_buf_len = sizeof(struct darshan_job) + strlen(darshan_core->log_exemnt_p);
+    for(i = 0; i < DARSHAN_MAX_MODS; i++)
+    {
+        if(darshan_core->mod_array[i] &&
+           darshan_core->mod_array[i]->mod_snapshot_func)
+        {
+            snap_funcs[i] = darshan_core->mod_array[i]->mod_snapshot_func;
+            mod_bufs[i] = darshan_core->mod_array[i]->rec_buf_start;
+            mod_buf_szs[i] = (char *)darshan_core->mod_array[i]->rec_buf_p -
+                (char *)mod_bufs[i];
+        }
+    }
+    DARSHAN_CORE_UNLOCK();
+
+    /* NOTE: modules register records with darshan-core while holding their
+     * own lock, so their snapshot routines must be called without holding
+     * the core lock
+     */
+    for(i = 0; i < DARSHAN_MAX_MODS; i++)
+    {
+        partial = 0;
+        if(snap_funcs[i])
+            snap_funcs[i](&mod_bufs[i], &mod_buf_szs[i], &partial);
+        else
+            hdr.mod_ver[i] = 0;
+        if(partial)
+            DARSHAN_MOD_FLAG_SET(hdr.partial_flag, i);
+    }
+
+    /* pack the name records last, so they cover every snapshotted record */
+    DARSHAN_CORE_LOCK();
+    ret = darshan_core ?
+        darshan_log_pack_name_records(darshan_core, &name_buf, &name_buf_len) : -1;
+    DARSHAN_CORE_UNLOCK();
+
+    ((struct darshan_job *)job_buf)->end_time = time(NULL);
+
+    if(snprintf(tmp_name, PATH_MAX, "%s_partial", darshan_ckpt.log_name) >=
+        PATH_MAX)
+    {
+        /* never open, rename, or unlink a truncated path */
+        tmp_name[0] = '\0';
+        ret = -1;
+    }
+    if(ret == 0)
+    {
+        fd = open(tmp_name, O_CREAT|O_WRONLY|O_TRUNC, S_IRUSR|S_IWUSR);
+        if(fd < 0)
+            ret = -1;
+    }
+
+    /* write the job data, name records, and module regions, then the
+     * header that locates them
+     */
+    off = sizeof(struct darshan_header);
+    if(ret == 0)
+        ret = darshan_checkpoint_append(fd, job_buf, job_buf_len, &off);
+    if(ret == 0)
+    {
+        hdr.name_map.off = off;
+        ret = darshan_checkpoint_append(fd, name_buf, name_buf_len, &off);
+        hdr.name_map.len = off - hdr.name_map.off;
+    }
+    for(i = 0; i < DARSHAN_MAX_MODS && ret == 0; i++)
+    {
+        hdr.mod_map[i].off = off;
+        ret = darshan_checkpoint_append(fd, mod_bufs[i], mod_buf_szs[i], &off);
+        hdr.mod_map[i].len = off - hdr.mod_map[i].off;
+    }
+    if(ret == 0)
+    {
+        hdr.comp_type = darshan_comp_type;
+        if(pwrite(fd, &hdr, sizeof(hdr), 0) != sizeof(hdr))
+            ret = -1;
+    }
+    if(fd >= 0)
+        close(fd);
+
+    /* atomically replace the previous checkpoint, so there is always a
+     * complete checkpoint to read
+     */
+    if(ret == 0)
+    {
+#ifdef __DARSHAN_GROUP_READABLE_LOGS
+        chmod_mode |= S_IRGRP;
+#endif
+        chmod(tmp_name, chmod_mode);
+        if(rename(tmp_name, darshan_ckpt.log_name) != 0)
+            ret = -1;
+    }
+    if(ret != 0)
+    {
+        darshan_core_fprintf(stderr, "darshan library warning: "
+            "unable to write checkpoint file %s\n", darshan_ckpt.log_name);
+        if(tmp_name[0])
+            unlink(tmp_name);
+    }
+
+    for(i = 0; i < DARSHAN_MAX_MODS; i++)
+    {
+        if(snap_funcs[i])
+            free(mod_bufs[i]);
+    }
+    free(name_buf);
+    free(job_buf);
+
+    return(ret);
+}
+
+/* compress a log region and write it to a checkpoint file at inout_off,
+ * advancing inout_off past it. returns 0 on success, -1 on failure
+ */
+static int darshan_checkpoint_append(int fd, void *buf, int len,
+    uint64_t *inout_off)
+{
+    struct darshan_core_comp_job job;
+    int ret;
+
+    memset(&job, 0, sizeof(job));
+    job.buf = buf;
+    job.len = len;
+    darshan_comp_job_run(&job);
+
+    ret = job.ret;
+    if(ret == 0 && job.comp_len > 0)
+    {
+        if(pwrite(fd, job.comp_buf, job.comp_len, *inout_off) != job.comp_len)
+            ret = -1;
+        *inout_off += job.comp_len;
+    }
+    free(job.comp_buf);
+
+    return(ret);
+}
+
+/* set up the node-local log collector for the job (or session) 'key' and
+ * register this process with it
+ */
+static void darshan_collector_init(int key, int key_is_jobid)
+{
+    char *collect_dir;
+
+    collect_dir = getenv(DARSHAN_COLLECT_DIR_OVERRIDE);
+    if(!collect_dir)
+        collect_dir = DARSHAN_DEF_COLLECT_DIR;
+
+    snprintf(darshan_collect.shm_name, NAME_MAX, "/darshan-%d-%s%d",
+        (int)getuid(), key_is_jobid ? "id" : "sid", key);
+    if(snprintf(darshan_collect.spool_dir, PATH_MAX, "%s%s.d", collect_dir,
+        darshan_collect.shm_name) >= PATH_MAX || darshan_collector_join() != 0)
+        darshan_core_fprintf(stderr, "darshan library warning: unable to "
+            "join log collector %s, writing an individual log\n",
+            darshan_collect.shm_name);
+
+    return;
+}
+
+/* register this process in the collector's shared memory segment, creating
+ * the segment if this is the first process of the job on the node.
+ * returns 0 on success, -1 on failure
+ */
+static int darshan_collector_join()
+{
+    struct stat st;
+    pid_t pid = getpid();
+    int slot = -1;
+    int fd;
+    int i;
+
+retry:
+    fd = shm_open(darshan_collect.shm_name, O_CREAT|O_RDWR, S_IRUSR|S_IWUSR);
+    if(fd < 0)
+        return(-1);
+
+    flock(fd, LOCK_EX);
+    if(fstat(fd, &st) != 0 ||
+       (st.st_size < sizeof(*darshan_collect.shm) &&
+        ftruncate(fd, sizeof(*darshan_collect.shm)) != 0))
+    {
+        flock(fd, LOCK_UN);
+        close(fd);
+        return(-1);
+    }
+    darshan_collect.shm = mmap(NULL, sizeof(*darshan_collect.shm),
+        PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+    if(darshan_collect.shm == MAP_FAILED)
+    {
+        flock(fd, LOCK_UN);
+        close(fd);
+        return(-1);
+    }
+
+    /* the last process left (and unlinked the segment) after we opened it */
+    if(darshan_collect.shm->unlinked)
+    {
+        flock(fd, LOCK_UN);
+        munmap(darshan_collect.shm, sizeof(*darshan_collect.shm));
+        close(fd);
+        goto retry;
+    }
+
+    /* a process that exec()ed is already registered under its pid */
+    for(i = 0; i < DARSHAN_COLLECT_MAX_PROCS; i++)
+    {
+        if(darshan_collect.shm->pids[i] == pid)
+            break;
+        if(slot < 0 && darshan_collect.shm->pids[i] == 0)
+            slot = i;
+    }
+    if(i == DARSHAN_COLLECT_MAX_PROCS)
+    {
+        if(slot < 0)
+        {
+            darshan_collector_prune();
+            for(slot = 0; slot < DARSHAN_COLLECT_MAX_PROCS; slot++)
+                if(darshan_collect.shm->pids[slot] == 0)
+                    break;
+        }
+        if(slot == DARSHAN_COLLECT_MAX_PROCS)
+        {
+            flock(fd, LOCK_UN);
+            munmap(darshan_collect.shm, sizeof(*darshan_collect.shm));
+            close(fd);
+            return(-1);
+        }
+        darshan_collect.shm->pids[slot] = pid;
+    }
+    flock(fd, LOCK_UN);
+
+    darshan_collect.fd = fd;
+    darshan_collect.pid = pid;
+    return(0);
+}
+
+/* remove processes that no longer exist from the collector, returning the
+ * number of processes still registered
+ */
+/* NOTE: must be called while holding the collector's flock() */
+static int darshan_collector_prune()
+{
+    int live = 0;
+    int i;
+
+    for(i = 0; i < DARSHAN_COLLECT_MAX_PROCS; i++)
+    {
+        if(darshan_collect.shm->pids[i] == 0)
+            continue;
+        if(kill(darshan_collect.shm->pids[i], 0) != 0 && errno == ESRCH)
+            darshan_collect.shm->pids[i] = 0;
+        else
+            live++;
+    }
+
+    return(live);
+}
+
+/* generate the name this process deposits its log under in the collector's
+ * spool directory. returns 0 on success, -1 if the process should write an
+ * individual log instead
+ */
+static int darshan_collector_log_name(char *logfile_name)
+{
+    struct timespec ts;
+
+    /* a forked child shares its parent's registration and flock, so it
+     * registers on its own with a new descriptor
+     */
+    if(darshan_collect.pid != getpid())
+    {
+        munmap(darshan_collect.shm, sizeof(*darshan_collect.shm));
+        close(darshan_collect.fd);
+        darshan_collect.pid = 0;
+        if(darshan_collector_join() != 0)
+            return(-1);
+    }
+
+    if(mkdir(darshan_collect.spool_dir, S_IRWXU) != 0 && errno != EEXIST)
+        return(-1);
+
+    /* pids are reused over long workflows, so add the time */
+    clock_gettime(CLOCK_REALTIME, &ts);
+    if(snprintf(logfile_name, PATH_MAX, "%s/%d-%ld-%ld.darshan_partial",
+        darshan_collect.spool_dir, (int)getpid(), (long)ts.tv_sec,
+        (long)ts.tv_nsec) >= PATH_MAX)
+        return(-1);
+
+    return(0);
+}
+
+/* unregister this process from the collector. the last process to leave
+ * moves the spool directory aside and merges the logs deposited in it
+ * into a single log for the job, delaying its exit until the merge is done
+ */
+/* NOTE: processes that join while the merge runs deposit their logs in a
+ * new spool directory, which is merged when they all have left
+ */
+static void darshan_collector_leave(struct darshan_core_runtime *core)
+{
+    char merge_dir[PATH_MAX];
+    char path[PATH_MAX];
+    char *logfile_name;
+    double start_log_time;
+    time_t start_time_tmp;
+    struct dirent *entry;
+    DIR *dir;
+    int merge = 0;
+    int i;
+
+    if(!darshan_collect.pid)
+        return;
+
+    /* forked children that never deposited a log never registered */
+    if(darshan_collect.pid == getpid())
+    {
+        flock(darshan_collect.fd, LOCK_EX);
+        for(i = 0; i < DARSHAN_COLLECT_MAX_PROCS; i++)
+        {
+            if(darshan_collect.shm->pids[i] == darshan_collect.pid)
+                darshan_collect.shm->pids[i] = 0;
+        }
+        if(darshan_collector_prune() == 0)
+        {
+            /* the generation restarts with each new segment, so the pid
+             * keeps the directory name unique while the merge runs
+             */
+            if(snprintf(merge_dir, PATH_MAX, "%s.%d.%" PRId64,
+                darshan_collect.spool_dir, (int)darshan_collect.pid,
+                darshan_collect.shm->generation++) < PATH_MAX)
+                merge = (rename(darshan_collect.spool_dir, merge_dir) == 0);
+            darshan_collect.shm->unlinked = 1;
+            shm_unlink(darshan_collect.shm_name);
+        }
+        flock(darshan_collect.fd, LOCK_UN);
+    }
+    munmap(darshan_collect.shm, sizeof(*darshan_collect.shm));
+    close(darshan_collect.fd);
+    darshan_collect.pid = 0;
+
+    if(!merge)
+        return;
+
+    logfile_name = malloc(PATH_MAX);
+    if(!logfile_name)
+        return;
+
+    start_log_time = time_nanoseconds();
+    start_time_tmp = core->log_job_p->start_time;
+    darshan_get_logfile_name(logfile_name, core->log_job_p->jobid,
+        localtime(&start_time_tmp));
+    if(strlen(logfile_name) == 0 ||
+       darshan_collector_merge(merge_dir, logfile_name) != 0)
+    {
+        darshan_core_fprintf(stderr, "darshan library warning: unable to "
+            "merge collected logs in %s\n", merge_dir);
+        free(logfile_name);
+        return;
+    }
+    darshan_log_complete(logfile_name, start_log_time,
+        !getenv("DARSHAN_LOGFILE"));
+    free(logfile_name);
+
+    /* the collected logs are no longer needed once merged */
+    dir = opendir(merge_dir);
+    if(dir)
+    {
+        while((entry = readdir(dir)))
+        {
+            if(entry->d_name[0] == '.')
+                continue;
+            if(snprintf(path, PATH_MAX, "%s/%s", merge_dir, entry->d_name) >=
+                PATH_MAX)
+                continue;
+            unlink(path);
+        }
+        closedir(dir);
+    }
+    rmdir(merge_dir);
+
+    return;
+}
+
+/* find the program 'exe' in PATH (unless it names a path already), setting
+ * its path in 'exe_path'. returns 0 on success, -1 if there is no such
+ * program
+ */
+static int darshan_collector_find_exe(char *exe, char *exe_path)
+{
+    char *path_env;
+    char *dir, *end;
+    int dir_len;
+
+    if(strchr(exe, '/'))
+    {
+        if(strlen(exe) >= PATH_MAX)
+            return(-1);
+        strcpy(exe_path, exe);
+        return(0);
+    }
+
+    path_env = getenv("PATH");
+    if(!path_env)
+        path_env = "/bin:/usr/bin";
+    for(dir = path_env; ; dir = end + 1)
+    {
+        end = strchrnul(dir, ':');
+        dir_len = end - dir;
+        /* an empty PATH entry stands for the current directory */
+        if(snprintf(exe_path, PATH_MAX, "%.*s%s%s", dir_len, dir,
+            dir_len ? "/" : "", exe) < PATH_MAX && access(exe_path, X_OK) == 0)
+            return(0);
+        if(*end == '\0')
+            break;
+    }
+
+    return(-1);
+}
+
+/* run the merge program on the logs in merge_dir, writing the merged log
+ * to logfile_name. returns 0 on success, -1 on failure
+ */
+/* NOTE: the application may still have threads running, so the child only
+ * calls async-signal-safe functions between fork() and execve(); its
+ * arguments and environment are built beforehand
+ */
+static int darshan_collector_merge(char *merge_dir, char *logfile_name)
+{
+    char pattern[PATH_MAX];
+    char exe_path[PATH_MAX];
+    char *merge_exe;
+    char *argv[5];
+    char **envp;
+    int env_count = 0;
+    pid_t pid;
+    int status;
+    int i;
+
+    merge_exe = getenv(DARSHAN_MERGE_OVERRIDE);
+    if(!merge_exe)
+        merge_exe = DARSHAN_DEF_MERGE;
+    if(snprintf(pattern, PATH_MAX, "%s/*.darshan", merge_dir) >= PATH_MAX ||
+       darshan_collector_find_exe(merge_exe, exe_path) != 0)
+        return(-1);
+
+    argv[0] = merge_exe;
+    argv[1] = "--output";
+    argv[2] = logfile_name;
+    argv[3] = pattern;
+    argv[4] = NULL;
+
+    /* the merge program must neither be instrumented nor collected */
+    for(i = 0; environ[i]; i++);
+    envp = malloc((i + 2) * sizeof(*envp));
+    if(!envp)
+        return(-1);
+    for(i = 0; environ[i]; i++)
+    {
+        if(strncmp(environ[i], "DARSHAN_DISABLE=", 16) != 0)
+            envp[env_count++] = environ[i];
+    }
+    envp[env_count++] = "DARSHAN_DISABLE=1";
+    envp[env_count] = NULL;
+
+    pid = fork();
+    if(pid == 0)
+    {
+        execve(exe_path, argv, envp);
+        _exit(127);
+    }
+    free(envp);
+    if(pid < 0)
+        return(-1);
+
+    if(waitpid(pid, &status, 0) != pid || !WIFEXITED(status) ||
+       WEXITSTATUS(status) != 0)
+        return(-1);
+
+    return(0);
+}
+
+#ifdef HAVE_MPI
+/* set the directory that the pieces of log 'log_name' go in, which is
+ * named after the log (without its suffix). returns 0 on success, -1 if
+ * there is no such log or the name is too long
+ */
+static int darshan_pieces_dir_name(char *log_name, char *pieces_path)
+{
+    char *base;
+    char *suffix;
+    int base_len;
+
+    base = strrchr(log_name, '/');
+    base = base ? base + 1 : log_name;
+    suffix = strstr(base, ".darshan");
+    base_len = suffix ? suffix - base : strlen(base);
+    if(base_len == 0 || snprintf(darshan_pieces.dir, PATH_MAX, "%s/%.*s",
+        pieces_path, base_len, base) >= PATH_MAX)
+    {
+        darshan_pieces.dir[0] = '\0';
+        return(-1);
+    }
+
+    return(0);
+}
+
+/* rank 0 names the log for the job and creates the directory that the
+ * pieces of the log go in, named after it. this is the only collective
+ * operation needed for writing the log in pieces
+ */
+static void darshan_pieces_init(struct darshan_core_runtime *core, int jobid)
+{
+    char *log_name;
+    char *suffix;
+    char *pieces_path;
+    time_t start_time_tmp;
+    struct tm *start_tm;
+    mode_t dir_mode = S_IRWXU;
+#ifdef __DARSHAN_GROUP_READABLE_LOGS
+    dir_mode |= S_IRGRP | S_IXGRP;
+#endif
+
+    log_name = malloc(PATH_MAX);
+    assert(log_name);
+    log_name[0] = '\0';
+    pieces_path = getenv(DARSHAN_LOG_PIECES_OVERRIDE);
+
+    if(my_rank == 0)
+    {
+        start_time_tmp = core->log_job_p->start_time;
+        start_tm = localtime(&start_time_tmp);
+        darshan_get_logfile_name(log_name, jobid, start_tm);
+    }
+
+    if(my_rank == 0 && (darshan_pieces_dir_name(log_name, pieces_path) != 0 ||
+       (mkdir(darshan_pieces.dir, dir_mode) != 0 && errno != EEXIST)))
+    {
+        darshan_core_fprintf(stderr, "darshan library warning: unable to "
+            "create log pieces directory, writing a single log instead\n");
+        log_name[0] = '\0';
+    }
+
+    /* every piece carries rank 0's job id */
+    darshan_mpi_bcast(log_name, PATH_MAX, MPI_CHAR, 0, MPI_COMM_WORLD);
+    darshan_mpi_bcast(&core->log_job_p->jobid, 1, MPI_INT64_T, 0,
+        MPI_COMM_WORLD);
+
+    if(darshan_pieces_dir_name(log_name, pieces_path) == 0)
+    {
+        darshan_pieces.rank = my_rank;
+        darshan_pieces.nprocs = nprocs;
+
+        /* the assembled log gets the name of a completed log */
+        strcpy(darshan_pieces.log_name, log_name);
+        suffix = strstr(darshan_pieces.log_name, ".darshan_partial");
+        if(suffix)
+            strcpy(suffix, ".darshan");
+    }
+
+    free(log_name);
+    return;
+}
+#endif
+
+/* generate the name this process writes its piece of the log under.
+ * returns 0 on success, -1 if the process should write an individual log
+ * instead
+ */
+/* NOTE: ranks are zero padded so that rank 0's piece, which always exists,
+ * is listed first
+ */
+static int darshan_pieces_log_name(char *logfile_name)
+{
+    if(snprintf(logfile_name, PATH_MAX, "%s/%06d.darshan_partial",
+        darshan_pieces.dir, darshan_pieces.rank) >= PATH_MAX)
+        return(-1);
+
+    return(0);
+}
+
+/* write the manifest describing the pieces of the log, which darshan-merge
+ * uses to assemble them into the log for the job
+ */
+/* NOTE: other ranks may still be writing their pieces; darshan-merge
+ * refuses to assemble the log until all 'nprocs' of them are complete
+ */
+static void darshan_pieces_write_manifest()
+{
+    char tmp_name[PATH_MAX];
+    char manifest_name[PATH_MAX];
+    FILE *manifest;
+    int ret;
+
+    if(snprintf(manifest_name, PATH_MAX, "%s/manifest", darshan_pieces.dir) >=
+        PATH_MAX ||
+       snprintf(tmp_name, PATH_MAX, "%s.partial", manifest_name) >= PATH_MAX)
+    {
+        darshan_core_fprintf(stderr, "darshan library warning: unable to "
+            "write log pieces manifest in %s\n", darshan_pieces.dir);
+        return;
+    }
+
+    manifest = fopen(tmp_name, "w");
+    if(!manifest)
+        return;
+    fprintf(manifest, "# darshan log pieces\n");
+    fprintf(manifest, "log=%s\n", darshan_pieces.log_name);
+    fprintf(manifest, "nprocs=%d\n", darshan_pieces.nprocs);
+    ret = fclose(manifest);
+
+    /* the manifest appears complete, or not at all */
+    if(ret == 0)
+        rename(tmp_name, manifest_name);
+    else
+        unlink(tmp_name);
+
+    return;
+}
+
+/* free darshan core data structures to shutdown */
+static void darshan_core_cleanup(struct darshan_core_runtime* core)
+{
+    void *chunk;
+    int i;
+
+    /* stop compressing log regions before releasing the buffers they
+     * are compressed from. Darshan's threads are all stopped before
+     * leaving the log collector, which may fork the merge program
+     */
+    if(core->comp_pool)
+    {
+        darshan_comp_pool_destroy(core->comp_pool);
+        core->comp_pool = NULL;
+    }
+    darshan_checkpoint_stop();
+
+    /* NOTE: every shutdown path ends here, so this is where processes
+     * leave the log collector, after depositing their log (if any)
+     */
+    darshan_collector_leave(core);
+
+#ifdef HAVE_MPI
+    darshan_log_node_comms_free();
+#endif
+
+    /* name record references and directories are freed with the chunks
+     * they were allocated from
+     */
+    HASH_CLEAR(hlink, core->name_hash);
+    HASH_CLEAR(hlink, core->name_dir_hash);
+    while(core->name_chunk_list)
+    {
+        chunk = core->name_chunk_list;
+        core->name_chunk_list = *(void **)chunk;
+        free(chunk);
+    }
+
+    for(i = 0; i < DARSHAN_MAX_MODS; i++)
+    {
+        if(core->mod_array[i])
+        {        
+#ifndef __DARSHAN_ENABLE_MMAP_LOGS
+            darshan_mod_mem_release(core, core->mod_array[i]);
+#endif
+            free(core->mod_array[i]);
+            core->mod_array[i] = NULL;
+        }
+    }
+
+#ifndef __DARSHAN_ENABLE_MMAP_LOGS
+    free(core->log_hdr_p);
+    free(core->log_job_p);
+    free(core->log_exemnt_p);
+#else
+    close(core->mmap_log_fd);
+    free(core->mmap_last_name);
+#endif
+
+    if(core->comp_buf)
+        free(core->comp_buf);
+    free(core);
+
+    for(i = 0; i < mnt_tree_count; i++)
+        free(mnt_tree[i].children);
+    free(mnt_tree);
+    mnt_tree = NULL;
+    mnt_tree_count = 0;
+    mnt_tree_max = 0;
+
+    free(mnt_data_array);
+    mnt_data_array = NULL;
+    mnt_data_count = 0;
+    mnt_data_max = 0;
+
+    return;
+}
+
+/* sets up the given shutdown benchmark test case (with 'file_count' files
+ * for the test cases that use many files) in a freshly initialized
+ * darshan-core, then shuts darshan down, optionally returning the time
+ * taken by each step
+ */
+extern void darshan_posix_shutdown_bench_setup(int test_case, int file_count);
+#ifdef HAVE_MPI
+extern void darshan_mpiio_shutdown_bench_setup(int test_case, int file_count);
+#endif
+static void darshan_shutdown_bench_run(int argc, char **argv, int test_case,
+    int file_count, const char *desc, double *setup_time, double *shutdown_time)
+{
+    double tm1, tm2, tm3;
+
+    /* restart darshan */
+    darshan_core_initialize(argc, argv);
+
+    tm1 = time_nanoseconds();
+    darshan_posix_shutdown_bench_setup(test_case, file_count);
+#ifdef HAVE_MPI
+    darshan_mpiio_shutdown_bench_setup(test_case, file_count);
+#endif
+    tm2 = time_nanoseconds();
+
+    if(desc && my_rank == 0)
+        fprintf(stderr, "# %s\n", desc);
+#ifdef HAVE_MPI
+    darshan_mpi_barrier(MPI_COMM_WORLD);
+#endif
+    darshan_core_shutdown();
+    darshan_core = NULL;
+    tm3 = time_nanoseconds();
 
-    if(core->comp_buf)
-        free(core->comp_buf);
-    free(core);
+    if(setup_time)
+        *setup_time = tm2 - tm1;
+    if(shutdown_time)
+        *shutdown_time = tm3 - tm2;
 
     return;
 }
@@ -2020,86 +4670,53 @@ static void darshan_core_cleanup(struct darshan_core_runtime* core)
 /* crude benchmarking hook into darshan-core to benchmark Darshan
  * shutdown overhead using a variety of application I/O workloads
  */
-extern void darshan_posix_shutdown_bench_setup();
-extern void darshan_mpiio_shutdown_bench_setup();
 void darshan_shutdown_bench(int argc, char **argv)
 {
     /* clear out existing core runtime structure */
     if(darshan_core)
     {
+        __atomic_store_n(&darshan_core_enabled, 0, __ATOMIC_SEQ_CST);
         darshan_core_cleanup(darshan_core);
         darshan_core = NULL;
     }
 
-    /***********************************************************/
-    /* restart darshan */
-    darshan_core_initialize(argc, argv);
-
-    darshan_posix_shutdown_bench_setup(1);
-    darshan_mpiio_shutdown_bench_setup(1);
-
-    if(my_rank == 0)
-        fprintf(stderr, "# 1 unique file per proc\n");
-#ifdef HAVE_MPI
-    darshan_mpi_barrier(MPI_COMM_WORLD);
-#endif
-    darshan_core_shutdown();
-    darshan_core = NULL;
-
+    darshan_shutdown_bench_run(argc, argv, 1, 1,
+        "1 unique file per proc", NULL, NULL);
     sleep(1);
 
-    /***********************************************************/
-    /* restart darshan */
-    darshan_core_initialize(argc, argv);
-
-    darshan_posix_shutdown_bench_setup(2);
-    darshan_mpiio_shutdown_bench_setup(2);
-
-    if(my_rank == 0)
-        fprintf(stderr, "# 1 shared file per proc\n");
-#ifdef HAVE_MPI
-    darshan_mpi_barrier(MPI_COMM_WORLD);
-#endif
-    darshan_core_shutdown();
-    darshan_core = NULL;
-
+    darshan_shutdown_bench_run(argc, argv, 2, 1,
+        "1 shared file per proc", NULL, NULL);
     sleep(1);
 
-    /***********************************************************/
-    /* restart darshan */
-    darshan_core_initialize(argc, argv);
-
-    darshan_posix_shutdown_bench_setup(3);
-    darshan_mpiio_shutdown_bench_setup(3);
-
-    if(my_rank == 0)
-        fprintf(stderr, "# 1024 unique files per proc\n");
-#ifdef HAVE_MPI
-    darshan_mpi_barrier(MPI_COMM_WORLD);
-#endif
-    darshan_core_shutdown();
-    darshan_core = NULL;
+    darshan_shutdown_bench_run(argc, argv, 3, 1024,
+        "1024 unique files per proc", NULL, NULL);
+    sleep(1);
 
+    darshan_shutdown_bench_run(argc, argv, 4, 1024,
+        "1024 shared files per proc", NULL, NULL);
     sleep(1);
 
-    /***********************************************************/
-    /* restart darshan */
-    darshan_core_initialize(argc, argv);
+    return;
+}
 
-    darshan_posix_shutdown_bench_setup(4);
-    darshan_mpiio_shutdown_bench_setup(4);
+/* benchmarking hook for processes that do not use MPI: runs the given
+ * shutdown benchmark test case, returning the time taken to register its
+ * records and to shut darshan down (in seconds) in 'setup_time' and
+ * 'shutdown_time'. The running instance of darshan, if any, is shut down
+ * (writing its log as usual) first.
+ */
+void darshan_shutdown_bench_serial(int test_case, int file_count,
+    double *setup_time, double *shutdown_time)
+{
+    if(using_mpi)
+    {
+        *setup_time = *shutdown_time = 0;
+        return;
+    }
 
-    if(my_rank == 0)
-        fprintf(stderr, "# 1024 shared files per proc\n");
-#ifdef HAVE_MPI
-    darshan_mpi_barrier(MPI_COMM_WORLD);
-#endif
     darshan_core_shutdown();
-    darshan_core = NULL;
-
-    sleep(1);
-
-    /***********************************************************/
+    darshan_shutdown_bench_run(0, NULL, test_case, file_count, NULL,
+        setup_time, shutdown_time);
 
     return;
 }
@@ -2131,6 +4748,9 @@ void darshan_core_register_module(
         return;
     }
 
+    /* the first module registers on the first instrumented call */
+    darshan_core_lazy_init();
+
     mod = malloc(sizeof(*mod));
     if(!mod)
     {
@@ -2139,26 +4759,34 @@ void darshan_core_register_module(
     }
     memset(mod, 0, sizeof(*mod));
 
-    /* set module's record buffer and max memory usage */
-    mod_mem_avail = darshan_mod_mem_quota - darshan_core->mod_mem_used;
-    if(mod_mem_avail >= mod_mem_req)
-        mod->rec_mem_avail = mod_mem_req;
-    else
-        mod->rec_mem_avail = mod_mem_avail;
-    mod->rec_buf_start = darshan_core->log_mod_p + darshan_core->mod_mem_used;
-    mod->rec_buf_p = mod->rec_buf_start;
+    /* set module's max memory usage and reserve its record buffer --
+     * memory is committed to the buffer as the module registers records
+     */
+    mod->rec_mem_max = mod_mem_req;
+    if(mod->rec_mem_max > darshan_mod_mem_quota)
+        mod->rec_mem_max = darshan_mod_mem_quota;
+    if((mod->rec_mem_max > 0) && !darshan_mod_mem_reserve(darshan_core, mod))
+    {
+        free(mod);
+        DARSHAN_CORE_UNLOCK();
+        return;
+    }
     mod->mod_shutdown_func = mod_shutdown_func;
+    DARSHAN_SELF_MAX(mod_id, SELF_MEM_LIMIT, mod->rec_mem_max);
+    DARSHAN_SELF_MAX(DARSHAN_SELF_MOD, SELF_MEM_LIMIT, darshan_mod_mem_quota);
 
     /* register module with darshan */
     darshan_core->mod_array[mod_id] = mod;
-    darshan_core->mod_mem_used += mod->rec_mem_avail;
     darshan_core->log_hdr_p->mod_ver[mod_id] = darshan_module_versions[mod_id];
 #ifdef __DARSHAN_ENABLE_MMAP_LOGS
-    darshan_core->log_hdr_p->mod_map[mod_id].off =
-        ((char *)mod->rec_buf_start - (char *)darshan_core->log_hdr_p);
+    darshan_core->log_hdr_p->mod_map[mod_id].off = mod->rec_buf_off;
 #endif
 
-    *inout_mod_buf_size = mod->rec_mem_avail;
+    mod_mem_avail = darshan_mod_mem_quota - darshan_core->mod_mem_used;
+    if(mod_mem_avail >= mod->rec_mem_max)
+        *inout_mod_buf_size = mod->rec_mem_max;
+    else
+        *inout_mod_buf_size = mod_mem_avail;
     DARSHAN_CORE_UNLOCK();
 
     /* set the memory alignment and calling process's rank, if desired */
@@ -2170,11 +4798,19 @@ void darshan_core_register_module(
     return;
 }
 
-/* NOTE: we currently don't really have a simple way of returning the
- * memory allocated to this module back to darshan to hand out to
- * other modules, so all we do is disable the module so darshan does
- * not attempt to call into it at shutdown time
- */
+void darshan_core_register_module_snapshot(
+    darshan_module_id mod_id,
+    darshan_module_snapshot mod_snapshot_func)
+{
+    DARSHAN_CORE_LOCK();
+    if(darshan_core && (mod_id < DARSHAN_MAX_MODS) &&
+       darshan_core->mod_array[mod_id])
+        darshan_core->mod_array[mod_id]->mod_snapshot_func = mod_snapshot_func;
+    DARSHAN_CORE_UNLOCK();
+
+    return;
+}
+
 void darshan_core_unregister_module(
     darshan_module_id mod_id)
 {
@@ -2185,6 +4821,10 @@ void darshan_core_unregister_module(
         return;
     }
 
+    /* return the module's memory to darshan so other modules can use it */
+    if(darshan_core->mod_array[mod_id])
+        darshan_mod_mem_release(darshan_core, darshan_core->mod_array[mod_id]);
+
     /* update darshan internal structures and header */
     free(darshan_core->mod_array[mod_id]);
     darshan_core->mod_array[mod_id] = NULL;
@@ -2202,6 +4842,8 @@ darshan_record_id darshan_core_gen_record_id(
     const char *name)
 {
     /* hash the input name to get a unique id for this record */
+    if(darshan_hash_type == DARSHAN_WYHASH_HASH)
+        return darshan_wyhash(name, strlen(name), 0);
     return darshan_hash((unsigned char *)name, strlen(name), 0);
 }
 
@@ -2213,6 +4855,7 @@ void *darshan_core_register_record(
     struct darshan_fs_info *fs_info)
 {
     struct darshan_core_name_record_ref *ref;
+    struct darshan_core_module *mod;
     void *rec_buf;
     int ret;
 
@@ -2223,10 +4866,15 @@ void *darshan_core_register_record(
         return(NULL);
     }
 
-    /* check to see if this module has enough space to store a new record */
-    if(darshan_core->mod_array[mod_id]->rec_mem_avail < rec_len)
+    /* check to see if this module has enough space to store a new record,
+     * committing more memory to the module if needed
+     */
+    mod = darshan_core->mod_array[mod_id];
+    if((mod->rec_mem_avail < rec_len) &&
+       !darshan_mod_mem_commit(darshan_core, mod, rec_len))
     {
         DARSHAN_MOD_FLAG_SET(darshan_core->log_hdr_p->partial_flag, mod_id);
+        DARSHAN_SELF_COUNT(mod_id, SELF_RECORDS_DROPPED, 1);
         DARSHAN_CORE_UNLOCK();
         return(NULL);
     }
@@ -2239,12 +4887,14 @@ void *darshan_core_register_record(
          */
         HASH_FIND(hlink, darshan_core->name_hash, &rec_id,
             sizeof(darshan_record_id), ref);
+        DARSHAN_SELF_COUNT(DARSHAN_SELF_CURRENT, SELF_HASH_LOOKUPS, 1);
         if(!ref)
         {
             ret = darshan_add_name_record_ref(darshan_core, rec_id, name, mod_id);
             if(ret == 0)
             {
                 DARSHAN_MOD_FLAG_SET(darshan_core->log_hdr_p->partial_flag, mod_id);
+                DARSHAN_SELF_COUNT(mod_id, SELF_RECORDS_DROPPED, 1);
                 DARSHAN_CORE_UNLOCK();
                 return(NULL);
             }
@@ -2255,12 +4905,15 @@ void *darshan_core_register_record(
         }
     }
 
-    rec_buf = darshan_core->mod_array[mod_id]->rec_buf_p;
-    darshan_core->mod_array[mod_id]->rec_buf_p += rec_len;
-    darshan_core->mod_array[mod_id]->rec_mem_avail -= rec_len;
+    rec_buf = mod->rec_buf_p;
+    mod->rec_buf_p += rec_len;
+    mod->rec_mem_avail -= rec_len;
 #ifdef __DARSHAN_ENABLE_MMAP_LOGS
     darshan_core->log_hdr_p->mod_map[mod_id].len += rec_len;
 #endif
+    DARSHAN_SELF_COUNT(mod_id, SELF_RECORDS, 1);
+    DARSHAN_SELF_MAX(mod_id, SELF_MEM_MAX, mod->rec_mem_committed);
+    DARSHAN_SELF_MAX(DARSHAN_SELF_MOD, SELF_MEM_MAX, darshan_core->mod_mem_used);
     DARSHAN_CORE_UNLOCK();
 
     if(fs_info)
@@ -2275,10 +4928,17 @@ char *darshan_core_lookup_record_name(darshan_record_id rec_id)
     char *name = NULL;
 
     DARSHAN_CORE_LOCK();
-    HASH_FIND(hlink, darshan_core->name_hash, &rec_id,
-        sizeof(darshan_record_id), ref);
-    if(ref)
-        name = ref->name_record->name;
+    if(darshan_core)
+    {
+        HASH_FIND(hlink, darshan_core->name_hash, &rec_id,
+            sizeof(darshan_record_id), ref);
+        if(ref)
+        {
+            name = malloc(ref->dir->path_len + strlen(ref->base) + 1);
+            if(name)
+                sprintf(name, "%s%s", ref->dir->path, ref->base);
+        }
+    }
     DARSHAN_CORE_UNLOCK();
 
     return(name);
@@ -2299,15 +4959,10 @@ void darshan_instrument_fs_data(int fs_type, const char *path, int fd)
 
 double darshan_core_wtime()
 {
-    DARSHAN_CORE_LOCK();
-    if(!darshan_core)
-    {
-        DARSHAN_CORE_UNLOCK();
+    if(!__atomic_load_n(&darshan_core_enabled, __ATOMIC_ACQUIRE))
         return(0);
-    }
-    DARSHAN_CORE_UNLOCK();
 
-    return(time_nanoseconds() - darshan_core->wtime_offset);
+    return(time_nanoseconds() - darshan_core_wtime_offset);
 }
 
 #ifdef DARSHAN_PRELOAD
@@ -2329,73 +4984,360 @@ void darshan_core_fprintf(
     return;
 }
 
-int darshan_core_excluded_path(const char *path)
+int darshan_core_lookup_mount(const char *path,
+    struct darshan_fs_info *fs_info, const char **mnt_path)
 {
-    char *exclude, *include;
-    int tmp_index = 0;
-    int tmp_jndex;
+    const char *end;
+    int node = 0;
+    int mnt_index = -1;
 
-    /* if user has set DARSHAN_EXCLUDE_DIRS, override the default ones */
-    if (user_darshan_path_exclusions != NULL) {
-        while((exclude = user_darshan_path_exclusions[tmp_index++])) {
-            if(!(strncmp(exclude, path, strlen(exclude))))
-                return(1);
+    /* NOTE: the mount point tree is only modified while Darshan is
+     * initialized, before any records are registered, so it can be read
+     * here without holding the darshan-core lock
+     */
+    if(mnt_tree_count && path[0] == '/')
+    {
+        mnt_index = mnt_tree[0].mnt_index;
+        while(*path)
+        {
+            while(*path == '/')
+                path++;
+            if(!*path)
+                break;
+            end = strchrnul(path, '/');
+
+            node = mnt_tree_find_child(node, path, end - path, NULL);
+            if(node < 0)
+                break;
+            if(mnt_tree[node].mnt_index >= 0)
+                mnt_index = mnt_tree[node].mnt_index;
+            path = end;
         }
     }
-    else
+
+    if(mnt_index < 0)
     {
-        /* scan blacklist for paths to exclude */
-        while((exclude = darshan_path_exclusions[tmp_index++])) {
-            if(!(strncmp(exclude, path, strlen(exclude)))) {
-                /* before excluding path, ensure it's not in whitelist */
-                tmp_jndex = 0;
-                while((include = darshan_path_inclusions[tmp_jndex++])) {
-                    if(!(strncmp(include, path, strlen(include))))
-                        return(0); /* whitelist hits are always tracked */
-                }
-                return(1); /* if not in whitelist, then blacklist it */
-            }
+        if(fs_info)
+        {
+            fs_info->fs_type = -1;
+            fs_info->block_size = -1;
         }
+        if(mnt_path)
+            *mnt_path = NULL;
+        return(0);
     }
 
-    /* if not in blacklist, no problem */
-    return(0);
+    if(fs_info)
+        *fs_info = mnt_data_array[mnt_index].fs_info;
+    if(mnt_path)
+        *mnt_path = mnt_data_array[mnt_index].path;
+    return(1);
 }
 
-int darshan_core_disabled_instrumentation()
+int darshan_core_excluded_path(darshan_module_id mod_id, const char *path)
 {
-    int ret;
+    struct darshan_core_path_rules *rules = darshan_mod_path_rules[mod_id];
+    struct darshan_core_path_glob *glob;
+    const char *p;
+    const char *base = NULL;
+    int path_len = -1;
+    int node = 0;
+    int flags = 0;
+    int match;
+    int i;
 
-    DARSHAN_CORE_LOCK();
-    if(darshan_core)
-        ret = 0;
-    else
-        ret = 1;
-    DARSHAN_CORE_UNLOCK();
+    if(!rules)
+        return(0);
 
-    return(ret);
+    /* walk the prefix trie as far as the path allows, picking up the
+     * flags of every rule that is a prefix of the path on the way
+     */
+    for(p = path; *p && rules->node_count; p++)
+    {
+        for(node = rules->nodes[node].child;
+            node && rules->nodes[node].c != (unsigned char)*p;
+            node = rules->nodes[node].sibling);
+        if(!node)
+            break;
+        flags |= rules->nodes[node].flags;
+    }
+
+    /* inclusions always win over exclusions */
+    if(flags & DARSHAN_PATH_RULE_INCLUDE)
+        return(0);
+
+    for(i = 0; i < rules->glob_count; i++)
+    {
+        glob = &rules->globs[i];
+        if((flags & DARSHAN_PATH_RULE_EXCLUDE) &&
+           (glob->flags & DARSHAN_PATH_RULE_EXCLUDE))
+            continue;
+
+        if(glob->flags & DARSHAN_PATH_RULE_SUFFIX)
+        {
+            if(path_len < 0)
+                path_len = strlen(path);
+            match = (path_len >= glob->len) &&
+                !memcmp(path + path_len - glob->len, glob->pattern, glob->len);
+        }
+        else if(glob->flags & DARSHAN_PATH_RULE_BASENAME)
+        {
+            if(!base)
+            {
+                base = strrchr(path, '/');
+                base = base ? base + 1 : path;
+            }
+            match = !fnmatch(glob->pattern, base, 0);
+        }
+        else
+            match = !fnmatch(glob->pattern, path, 0);
+
+        if(match && (glob->flags & DARSHAN_PATH_RULE_INCLUDE))
+            return(0);
+        if(match)
+            flags |= DARSHAN_PATH_RULE_EXCLUDE;
+    }
+
+    return((flags & DARSHAN_PATH_RULE_EXCLUDE) ? 1 : 0);
+}
+
+int darshan_core_disabled_instrumentation()
+{
+    /* NOTE: no lock is taken here so that modules can check this on
+     * every instrumented call; see darshan_shards_enter()
+     */
+    return(!__atomic_load_n(&darshan_core_enabled, __ATOMIC_SEQ_CST) ||
+        darshan_core_thread_disabled);
 }
 
 
 
 /*
- * Darshan MPI stubs: pass through to PMPI_* if MPI is initialized; otherwise
- * fake the MPI call.
+ * Darshan timers: all Darshan timestamps are taken using one of the
+ * following backends, selected once at initialization time. By default the
+ * first usable backend in darshan_timers is used, but users may request a
+ * specific one by name using the DARSHAN_TIMER environment variable.
+ * MPI builds keep using MPI_Wtime by default, so that timestamps stay on
+ * the same time base as the application's own MPI_Wtime calls.
  */
+struct darshan_timer
+{
+    const char *name;
+    int (*init)(void); /* returns 0 if the timer is usable */
+    /* completes setup before the timer is used; returns 0 once done, or
+     * -1 if it can not be done yet
+     */
+    int (*calibrate)(void);
+    double (*now)(void);
+};
+
+static int darshan_tsc_init(void);
+static int darshan_tsc_calibrate(void);
+static double darshan_tsc_now(void);
+static double darshan_clock_now(void);
 #ifdef HAVE_MPI
-static double time_nanoseconds()
+static double darshan_mpi_now(void);
+#endif
+
+static struct darshan_timer darshan_timers[] =
 {
-    return darshan_mpi_wtime();
+#ifdef HAVE_MPI
+    {"mpi", NULL, NULL, &darshan_mpi_now},
+#endif
+    {"tsc", &darshan_tsc_init, &darshan_tsc_calibrate, &darshan_tsc_now},
+    {"clock", NULL, NULL, &darshan_clock_now},
+    {NULL, NULL, NULL, NULL}
+};
+
+/* NOTE: this defaults to clock_gettime so timestamps taken before a timer
+ * is selected are still valid
+ */
+static double (*darshan_timer_now)(void) = &darshan_clock_now;
+static int darshan_timer_selected = 0;
+static struct darshan_timer *darshan_timer_pending = NULL;
+static int darshan_timer_calibrating = 0;
+
+static void darshan_timer_select()
+{
+    char *envstr;
+    int i;
+
+    if(darshan_timer_selected)
+        return;
+    darshan_timer_selected = 1;
+
+    envstr = getenv(DARSHAN_TIMER_OVERRIDE);
+    for(i = 0; darshan_timers[i].name; i++)
+    {
+        if(envstr && strcmp(envstr, darshan_timers[i].name) != 0)
+            continue;
+        if(darshan_timers[i].init && darshan_timers[i].init() != 0)
+            continue;
+
+        if(darshan_timers[i].calibrate)
+            __atomic_store_n(&darshan_timer_pending, &darshan_timers[i],
+                __ATOMIC_RELAXED);
+        else
+            darshan_timer_now = darshan_timers[i].now;
+        return;
+    }
+
+    /* requested timer is unknown or unusable, stick with clock_gettime */
+    return;
 }
-#else
+
+/* switch to the selected timer, if it still needed calibration and can be
+ * calibrated by now
+ */
+/* NOTE: calibration never waits; timestamps keep being taken with
+ * clock_gettime until the calibration window has elapsed, which is on the
+ * same time base, and the first thread to take a timestamp after that
+ * switches every thread over to the selected timer
+ */
+static void darshan_timer_calibrate()
+{
+    struct darshan_timer *timer;
+    int calibrating = 0;
+
+    if(!__atomic_compare_exchange_n(&darshan_timer_calibrating, &calibrating,
+        1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+        return;
+
+    timer = __atomic_load_n(&darshan_timer_pending, __ATOMIC_RELAXED);
+    if(timer && timer->calibrate() == 0)
+    {
+        __atomic_store_n(&darshan_timer_now, timer->now, __ATOMIC_RELEASE);
+        __atomic_store_n(&darshan_timer_pending, NULL, __ATOMIC_RELAXED);
+    }
+    __atomic_store_n(&darshan_timer_calibrating, 0, __ATOMIC_RELEASE);
+
+    return;
+}
+
 static double time_nanoseconds()
+{
+    if(__atomic_load_n(&darshan_timer_pending, __ATOMIC_RELAXED))
+        darshan_timer_calibrate();
+
+    return((*__atomic_load_n(&darshan_timer_now, __ATOMIC_ACQUIRE))());
+}
+
+/* CLOCK_MONOTONIC, which glibc serves from the vDSO without a syscall */
+static double darshan_clock_now()
 {
     struct timespec t;
     clock_gettime(CLOCK_MONOTONIC, &t);
     return (double)(t.tv_sec) + (double)(t.tv_nsec) * 1.0e-9;
 }
+
+#ifdef HAVE_MPI
+static double darshan_mpi_now()
+{
+    return darshan_mpi_wtime();
+}
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+/* TSC timestamps are converted to seconds on the CLOCK_MONOTONIC time
+ * base, using a rate calibrated when the timer is selected
+ */
+static uint64_t darshan_tsc_base;
+static double darshan_tsc_clock_base;
+static double darshan_tsc_sec_per_tick;
+static uint64_t darshan_tsc_cal_start;
+static double darshan_tsc_cal_clock_start;
+
+static inline uint64_t darshan_rdtsc()
+{
+    uint32_t lo, hi;
+
+    __asm__ __volatile__("rdtsc" : "=a"(lo), "=d"(hi));
+    return(((uint64_t)hi << 32) | lo);
+}
+
+static int darshan_tsc_init()
+{
+    unsigned int eax, ebx, ecx, edx;
+    char clksrc[16] = {0};
+    int fd;
+
+    /* only use an invariant TSC, which ticks at a constant rate regardless
+     * of frequency scaling and sleep states
+     */
+    if(!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) || !(edx & (1 << 8)))
+        return(-1);
+
+    /* if the kernel has rejected the TSC as its clock source (e.g., because
+     * it is not synchronized across sockets), don't use it either
+     */
+    fd = open("/sys/devices/system/clocksource/clocksource0/current_clocksource",
+        O_RDONLY);
+    if(fd >= 0)
+    {
+        if(read(fd, clksrc, sizeof(clksrc) - 1) > 0 &&
+            strncmp(clksrc, "tsc", 3) != 0)
+        {
+            close(fd);
+            return(-1);
+        }
+        close(fd);
+    }
+
+    /* start the calibration window */
+    darshan_tsc_cal_clock_start = darshan_clock_now();
+    darshan_tsc_cal_start = darshan_rdtsc();
+
+    return(0);
+}
+
+/* calibrate the TSC rate against CLOCK_MONOTONIC, over a window starting
+ * when the timer was selected; fails if the window has not elapsed yet
+ */
+static int darshan_tsc_calibrate()
+{
+    uint64_t tsc1 = darshan_tsc_cal_start, tsc2;
+    double clock1 = darshan_tsc_cal_clock_start, clock2;
+
+    clock2 = darshan_clock_now();
+    tsc2 = darshan_rdtsc();
+    if((clock2 - clock1) < DARSHAN_TSC_CALIBRATION_TIME || tsc2 <= tsc1)
+        return(-1);
+
+    darshan_tsc_sec_per_tick = (clock2 - clock1) / (double)(tsc2 - tsc1);
+    darshan_tsc_base = tsc1;
+    darshan_tsc_clock_base = clock1;
+
+    return(0);
+}
+
+static double darshan_tsc_now()
+{
+    return(darshan_tsc_clock_base +
+        (double)(darshan_rdtsc() - darshan_tsc_base) * darshan_tsc_sec_per_tick);
+}
+#else
+static int darshan_tsc_init()
+{
+    /* no TSC support on this architecture */
+    return(-1);
+}
+
+static int darshan_tsc_calibrate()
+{
+    return(0);
+}
+
+static double darshan_tsc_now()
+{
+    return(darshan_clock_now());
+}
 #endif
 
+/*
+ * Darshan MPI stubs: pass through to PMPI_* if MPI is initialized; otherwise
+ * fake the MPI call.
+ */
+
 #ifdef HAVE_MPI
 static size_t sizeof_mpi_datatype(MPI_Datatype datatype)
 {
@@ -2521,6 +5463,25 @@ int darshan_mpi_gather(void *sendbuf, int sendcount, MPI_Datatype sendtype, void
     return generic_serial_reduce(sendbuf, recvbuf, sendcount, sendtype);
 }
 
+int darshan_mpi_alltoall(void *sendbuf, int sendcount, MPI_Datatype sendtype, void *recvbuf, int recvcount, MPI_Datatype recvtype, MPI_Comm comm)
+{
+    if (using_mpi)
+        return PMPI_Alltoall(sendbuf, sendcount, sendtype, recvbuf, recvcount, recvtype, comm);
+
+    return generic_serial_reduce(sendbuf, recvbuf, sendcount, sendtype);
+}
+
+int darshan_mpi_alltoallv(void *sendbuf, int *sendcounts, int *sdispls, MPI_Datatype sendtype, void *recvbuf, int *recvcounts, int *rdispls, MPI_Datatype recvtype, MPI_Comm comm)
+{
+    size_t size = sizeof_mpi_datatype(sendtype);
+
+    if (using_mpi)
+        return PMPI_Alltoallv(sendbuf, sendcounts, sdispls, sendtype, recvbuf, recvcounts, rdispls, recvtype, comm);
+
+    return generic_serial_reduce((char *)sendbuf + sdispls[0] * size,
+        (char *)recvbuf + rdispls[0] * size, sendcounts[0], sendtype);
+}
+
 int darshan_mpi_barrier(MPI_Comm comm)
 {
     if (using_mpi)
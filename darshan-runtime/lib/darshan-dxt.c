@@ -34,29 +34,10 @@
 typedef int64_t off64_t;
 #endif
 
-/* maximum amount of memory to use for storing DXT records */
-#ifdef __DARSHAN_MOD_MEM_MAX
-#define DXT_IO_TRACE_MEM_MAX (__DARSHAN_MOD_MEM_MAX * 1024 * 1024)
-#else
-#define DXT_IO_TRACE_MEM_MAX (4 * 1024 * 1024) /* 4 MiB default */
-#endif
-
-/* initial size of read/write trace buffer (in number of segments) */
-/* NOTE: when this size is exceeded, the buffer size is doubled */
+/* number of read/write trace segments to make room for at a time */
+/* NOTE: the in-memory trace buffer is doubled in size when it fills up */
 #define IO_TRACE_BUF_SIZE       64
 
-/* XXX: dirty hack -- If DXT runs out of memory to store trace data in,
- * we should set a flag so that log parsers know that the log has
- * incomplete data. This functionality is typically handled automatically
- * when registering records with Darshan, but DXT modules don't
- * register records and manage their own memory. Since DXT modules request
- * 0 memory when registering themselves, any attempt to register a record
- * will result in setting the partial flag for the module, which is
- * exactly what we do here.
- */
-#define SET_DXT_MOD_PARTIAL_FLAG(mod_id) \
-    darshan_core_register_record(0, NULL, mod_id, 1, NULL);
-
 /* The dxt_file_record_ref structure maintains necessary runtime metadata
  * for the DXT file record (dxt_file_record structure, defined in
  * darshan-dxt-log-format.h) pointed to by 'file_rec'. This metadata
@@ -76,6 +57,8 @@ struct dxt_file_record_ref
 
     int64_t write_available_buf;
     int64_t read_available_buf;
+    int64_t write_alloc_buf;
+    int64_t read_alloc_buf;
 
     segment_info *write_traces;
     segment_info *read_traces;
@@ -112,9 +95,9 @@ void dxt_mpiio_read(darshan_record_id rec_id, int64_t length,
         double start_time, double end_time);
 
 static void check_wr_trace_buf(
-    struct dxt_file_record_ref *rec_ref);
+    struct dxt_file_record_ref *rec_ref, darshan_module_id mod_id);
 static void check_rd_trace_buf(
-    struct dxt_file_record_ref *rec_ref);
+    struct dxt_file_record_ref *rec_ref, darshan_module_id mod_id);
 static void dxt_posix_runtime_initialize(
     void);
 static void dxt_mpiio_runtime_initialize(
@@ -142,9 +125,8 @@ static pthread_mutex_t dxt_runtime_mutex =
 
 static int dxt_my_rank = -1;
 static int dxt_total_mem = DXT_IO_TRACE_MEM_MAX;
-static int dxt_mem_remaining = 0;
 
-#define DXT_LOCK() pthread_mutex_lock(&dxt_runtime_mutex)
+#define DXT_LOCK() DARSHAN_SELF_LOCK(&dxt_runtime_mutex, DXT_POSIX_MOD)
 #define DXT_UNLOCK() pthread_mutex_unlock(&dxt_runtime_mutex)
 
 
@@ -152,70 +134,79 @@ static int dxt_mem_remaining = 0;
  *      Wrappers for DXT I/O functions of interest      *
  **********************************************************/
 
-static void check_wr_trace_buf(struct dxt_file_record_ref *rec_ref)
+/* DXT records vary in size with the number of traced segments and are not
+ * serialized into the module buffer until shutdown time, so room for each
+ * batch of segments is registered with darshan-core before it is used.
+ * darshan-core marks the module as partial if it runs out of memory.
+ */
+static void check_wr_trace_buf(struct dxt_file_record_ref *rec_ref,
+    darshan_module_id mod_id)
 {
     struct dxt_file_record *file_rec = rec_ref->file_rec;
+    segment_info *tmp_traces;
+    int64_t write_alloc_buf;
+    void *ret;
 
-    int write_count = file_rec->write_count;
-    int write_available_buf = rec_ref->write_available_buf;
-
-    if (write_count >= write_available_buf) {
-        int write_count_inc;
-        if(write_available_buf == 0)
-            write_count_inc = IO_TRACE_BUF_SIZE;
-        else
-            write_count_inc = write_available_buf;
+    if(file_rec->write_count < rec_ref->write_available_buf)
+        return;
 
-        DXT_LOCK();
-        if((write_count_inc * sizeof(segment_info)) > dxt_mem_remaining)
-            write_count_inc = dxt_mem_remaining / sizeof(segment_info);
+    ret = darshan_core_register_record(file_rec->base_rec.id, NULL, mod_id,
+        IO_TRACE_BUF_SIZE * sizeof(segment_info), NULL);
+    if(!ret)
+        return;
 
-        dxt_mem_remaining -= (write_count_inc * sizeof(segment_info));
-        DXT_UNLOCK();
+    if(rec_ref->write_available_buf + IO_TRACE_BUF_SIZE >
+        rec_ref->write_alloc_buf)
+    {
+        if(rec_ref->write_alloc_buf == 0)
+            write_alloc_buf = IO_TRACE_BUF_SIZE;
+        else
+            write_alloc_buf = rec_ref->write_alloc_buf * 2;
 
-        if(write_count_inc > 0)
-        {
-            write_available_buf += write_count_inc;
-            rec_ref->write_traces =
-                (segment_info *)realloc(rec_ref->write_traces,
-                        write_available_buf * sizeof(segment_info));
+        tmp_traces = (segment_info *)realloc(rec_ref->write_traces,
+            write_alloc_buf * sizeof(segment_info));
+        if(!tmp_traces)
+            return;
 
-            rec_ref->write_available_buf = write_available_buf;
-        }
+        rec_ref->write_traces = tmp_traces;
+        rec_ref->write_alloc_buf = write_alloc_buf;
     }
+    rec_ref->write_available_buf += IO_TRACE_BUF_SIZE;
 }
 
-static void check_rd_trace_buf(struct dxt_file_record_ref *rec_ref)
+static void check_rd_trace_buf(struct dxt_file_record_ref *rec_ref,
+    darshan_module_id mod_id)
 {
     struct dxt_file_record *file_rec = rec_ref->file_rec;
+    segment_info *tmp_traces;
+    int64_t read_alloc_buf;
+    void *ret;
 
-    int read_count = file_rec->read_count;
-    int read_available_buf = rec_ref->read_available_buf;
+    if(file_rec->read_count < rec_ref->read_available_buf)
+        return;
 
-    if (read_count >= read_available_buf) {
-        int read_count_inc;
-        if(read_available_buf == 0)
-            read_count_inc = IO_TRACE_BUF_SIZE;
-        else
-            read_count_inc = read_available_buf;
+    ret = darshan_core_register_record(file_rec->base_rec.id, NULL, mod_id,
+        IO_TRACE_BUF_SIZE * sizeof(segment_info), NULL);
+    if(!ret)
+        return;
 
-        DXT_LOCK();
-        if((read_count_inc * sizeof(segment_info)) > dxt_mem_remaining)
-            read_count_inc = dxt_mem_remaining / sizeof(segment_info);
+    if(rec_ref->read_available_buf + IO_TRACE_BUF_SIZE >
+        rec_ref->read_alloc_buf)
+    {
+        if(rec_ref->read_alloc_buf == 0)
+            read_alloc_buf = IO_TRACE_BUF_SIZE;
+        else
+            read_alloc_buf = rec_ref->read_alloc_buf * 2;
 
-        dxt_mem_remaining -= (read_count_inc * sizeof(segment_info));
-        DXT_UNLOCK();
+        tmp_traces = (segment_info *)realloc(rec_ref->read_traces,
+            read_alloc_buf * sizeof(segment_info));
+        if(!tmp_traces)
+            return;
 
-        if(read_count_inc > 0)
-        {
-            read_available_buf += read_count_inc;
-            rec_ref->read_traces =
-                (segment_info *)realloc(rec_ref->read_traces,
-                        read_available_buf * sizeof(segment_info));
-            
-            rec_ref->read_available_buf = read_available_buf;
-        }
+        rec_ref->read_traces = tmp_traces;
+        rec_ref->read_alloc_buf = read_alloc_buf;
     }
+    rec_ref->read_available_buf += IO_TRACE_BUF_SIZE;
 }
 
 void dxt_posix_write(darshan_record_id rec_id, int64_t offset,
@@ -241,11 +232,10 @@ void dxt_posix_write(darshan_record_id rec_id, int64_t offset,
     }
 
     file_rec = rec_ref->file_rec;
-    check_wr_trace_buf(rec_ref);
+    check_wr_trace_buf(rec_ref, DXT_POSIX_MOD);
     if(file_rec->write_count == rec_ref->write_available_buf)
     {
         /* no more memory for i/o segments ... back out */
-        SET_DXT_MOD_PARTIAL_FLAG(DXT_POSIX_MOD);
         return;
     }
 
@@ -278,11 +268,10 @@ void dxt_posix_read(darshan_record_id rec_id, int64_t offset,
     }
 
     file_rec = rec_ref->file_rec;
-    check_rd_trace_buf(rec_ref);
+    check_rd_trace_buf(rec_ref, DXT_POSIX_MOD);
     if(file_rec->read_count == rec_ref->read_available_buf)
     {
         /* no more memory for i/o segments ... back out */
-        SET_DXT_MOD_PARTIAL_FLAG(DXT_POSIX_MOD);
         return;
     }
 
@@ -316,11 +305,10 @@ void dxt_mpiio_write(darshan_record_id rec_id, int64_t length,
     }
 
     file_rec = rec_ref->file_rec;
-    check_wr_trace_buf(rec_ref);
+    check_wr_trace_buf(rec_ref, DXT_MPIIO_MOD);
     if(file_rec->write_count == rec_ref->write_available_buf)
     {
         /* no more memory for i/o segments ... back out */
-        SET_DXT_MOD_PARTIAL_FLAG(DXT_MPIIO_MOD);
         return;
     }
 
@@ -353,11 +341,10 @@ void dxt_mpiio_read(darshan_record_id rec_id, int64_t length,
     }
 
     file_rec = rec_ref->file_rec;
-    check_rd_trace_buf(rec_ref);
+    check_rd_trace_buf(rec_ref, DXT_MPIIO_MOD);
     if(file_rec->read_count == rec_ref->read_available_buf)
     {
         /* no more memory for i/o segments ... back out */
-        SET_DXT_MOD_PARTIAL_FLAG(DXT_MPIIO_MOD);
         return;
     }
 
@@ -375,15 +362,24 @@ void dxt_mpiio_read(darshan_record_id rec_id, int64_t length,
 /* initialize internal DXT module data structures and register with darshan-core */
 static void dxt_posix_runtime_initialize()
 {
-    /* DXT modules request 0 memory -- buffers will be managed internally by DXT
-     * and passed back to darshan-core at shutdown time to allow DXT more control
-     * over realloc'ing module memory as needed.
-     */
-    int dxt_psx_buf_size = 0;
+    int dxt_psx_buf_size;
     int ret;
     double tmpfloat;
     char *envstr;
 
+    /* set the memory quota for DXT */
+    envstr = getenv("DXT_ENABLE_IO_TRACE");
+    if(envstr)
+    {
+        ret = sscanf(envstr, "%lf", &tmpfloat);
+        /* silently ignore if the env variable is set poorly */
+        if(ret == 1 && tmpfloat > 0)
+        {
+            dxt_total_mem = tmpfloat * 1024 * 1024; /* convert from MiB */
+        }
+    }
+    dxt_psx_buf_size = dxt_total_mem;
+
     /* register the DXT module with darshan core */
     darshan_core_register_module(
         DXT_POSIX_MOD,
@@ -392,8 +388,8 @@ static void dxt_posix_runtime_initialize()
         &dxt_my_rank,
         NULL);
 
-    /* return if darshan-core allocates an unexpected amount of memory */
-    if(dxt_psx_buf_size != 0)
+    /* return if darshan-core does not provide enough module memory */
+    if(dxt_psx_buf_size < sizeof(struct dxt_file_record))
     {
         darshan_core_unregister_module(DXT_POSIX_MOD);
         return;
@@ -408,19 +404,6 @@ static void dxt_posix_runtime_initialize()
         return;
     }
     memset(dxt_posix_runtime, 0, sizeof(*dxt_posix_runtime));
-
-    /* set the memory quota for DXT, if it has not been initialized */
-    envstr = getenv("DXT_ENABLE_IO_TRACE");
-    if(envstr && dxt_mpiio_runtime == NULL)
-    {
-        ret = sscanf(envstr, "%lf", &tmpfloat);
-        /* silently ignore if the env variable is set poorly */
-        if(ret == 1 && tmpfloat > 0)
-        {
-            dxt_total_mem = tmpfloat * 1024 * 1024; /* convert from MiB */
-        }
-    }
-    dxt_mem_remaining = dxt_total_mem;
     DXT_UNLOCK();
 
     return;
@@ -428,15 +411,24 @@ static void dxt_posix_runtime_initialize()
 
 void dxt_mpiio_runtime_initialize()
 {
-    /* DXT modules request 0 memory -- buffers will be managed internally by DXT
-     * and passed back to darshan-core at shutdown time to allow DXT more control
-     * over realloc'ing module memory as needed.
-     */
-    int dxt_mpiio_buf_size = 0;
+    int dxt_mpiio_buf_size;
     int ret;
     double tmpfloat;
     char *envstr;
 
+    /* set the memory quota for DXT */
+    envstr = getenv("DXT_ENABLE_IO_TRACE");
+    if(envstr)
+    {
+        ret = sscanf(envstr, "%lf", &tmpfloat);
+        /* silently ignore if the env variable is set poorly */
+        if(ret == 1 && tmpfloat > 0)
+        {
+            dxt_total_mem = tmpfloat * 1024 * 1024; /* convert from MiB */
+        }
+    }
+    dxt_mpiio_buf_size = dxt_total_mem;
+
     /* register the DXT module with darshan core */
     darshan_core_register_module(
         DXT_MPIIO_MOD,
@@ -445,8 +437,8 @@ void dxt_mpiio_runtime_initialize()
         &dxt_my_rank,
         NULL);
 
-    /* return if darshan-core allocates an unexpected amount of memory */
-    if(dxt_mpiio_buf_size != 0)
+    /* return if darshan-core does not provide enough module memory */
+    if(dxt_mpiio_buf_size < sizeof(struct dxt_file_record))
     {
         darshan_core_unregister_module(DXT_MPIIO_MOD);
         return;
@@ -461,19 +453,6 @@ void dxt_mpiio_runtime_initialize()
         return;
     }
     memset(dxt_mpiio_runtime, 0, sizeof(*dxt_mpiio_runtime));
-
-    /* set the memory quota for DXT, if it has not been initialized */
-    envstr = getenv("DXT_ENABLE_IO_TRACE");
-    if(envstr && dxt_posix_runtime == NULL)
-    {
-        ret = sscanf(envstr, "%lf", &tmpfloat);
-        /* silently ignore if the env variable is set poorly */
-        if(ret == 1 && tmpfloat > 0)
-        {
-            dxt_total_mem = tmpfloat * 1024 * 1024; /* convert from MiB */
-        }
-    }
-    dxt_mem_remaining = dxt_total_mem;
     DXT_UNLOCK();
 
     return;
@@ -486,11 +465,11 @@ static struct dxt_file_record_ref *dxt_posix_track_new_file_record(
     struct dxt_file_record *file_rec = NULL;
     int ret;
 
-    /* check if we have enough room for a new DXT record */
+    /* register room for a new DXT record with darshan-core */
     DXT_LOCK();
-    if(dxt_mem_remaining < sizeof(struct dxt_file_record))
+    if(!darshan_core_register_record(rec_id, NULL, DXT_POSIX_MOD,
+        sizeof(struct dxt_file_record), NULL))
     {
-        SET_DXT_MOD_PARTIAL_FLAG(DXT_POSIX_MOD);
         DXT_UNLOCK();
         return(NULL);
     }
@@ -523,7 +502,6 @@ static struct dxt_file_record_ref *dxt_posix_track_new_file_record(
         return(NULL);
     }
 
-    dxt_mem_remaining -= sizeof(struct dxt_file_record);
     DXT_UNLOCK();
 
     /* initialize record and record reference fields */
@@ -544,11 +522,11 @@ static struct dxt_file_record_ref *dxt_mpiio_track_new_file_record(
     struct dxt_file_record_ref *rec_ref = NULL;
     int ret;
 
-    /* check if we have enough room for a new DXT record */
+    /* register room for a new DXT record with darshan-core */
     DXT_LOCK();
-    if(dxt_mem_remaining < sizeof(struct dxt_file_record))
+    if(!darshan_core_register_record(rec_id, NULL, DXT_MPIIO_MOD,
+        sizeof(struct dxt_file_record), NULL))
     {
-        SET_DXT_MOD_PARTIAL_FLAG(DXT_MPIIO_MOD);
         DXT_UNLOCK();
         return(NULL);
     }
@@ -581,7 +559,6 @@ static struct dxt_file_record_ref *dxt_mpiio_track_new_file_record(
         return(NULL);
     }
 
-    dxt_mem_remaining -= sizeof(struct dxt_file_record);
     DXT_UNLOCK();
 
     /* initialize record and record reference fields */
@@ -723,12 +700,10 @@ static void dxt_posix_shutdown(
 {
     assert(dxt_posix_runtime);
 
-    *dxt_posix_buf_sz = 0;
-
-    dxt_posix_runtime->record_buf = malloc(dxt_total_mem);
-    if(!(dxt_posix_runtime->record_buf))
-        return;
-    memset(dxt_posix_runtime->record_buf, 0, dxt_total_mem);
+    /* serialize records into the module buffer darshan-core has set aside
+     * for them as they were traced
+     */
+    dxt_posix_runtime->record_buf = *dxt_posix_buf;
     dxt_posix_runtime->record_buf_size = 0;
 
     /* iterate all dxt posix records and serialize them to the output buffer */
@@ -833,12 +808,10 @@ static void dxt_mpiio_shutdown(
 {
     assert(dxt_mpiio_runtime);
 
-    *dxt_mpiio_buf_sz = 0;
-
-    dxt_mpiio_runtime->record_buf = malloc(dxt_total_mem);
-    if(!(dxt_mpiio_runtime->record_buf))
-        return;
-    memset(dxt_mpiio_runtime->record_buf, 0, dxt_total_mem);
+    /* serialize records into the module buffer darshan-core has set aside
+     * for them as they were traced
+     */
+    dxt_mpiio_runtime->record_buf = *dxt_mpiio_buf;
     dxt_mpiio_runtime->record_buf_size = 0;
 
     /* iterate all dxt posix records and serialize them to the output buffer */
@@ -74,21 +74,24 @@ static struct hdf5_runtime *hdf5_runtime = NULL;
 static pthread_mutex_t hdf5_runtime_mutex = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
 static int my_rank = -1;
 
-#define HDF5_LOCK() pthread_mutex_lock(&hdf5_runtime_mutex)
+#define HDF5_LOCK() DARSHAN_SELF_LOCK(&hdf5_runtime_mutex, DARSHAN_HDF5_MOD)
 #define HDF5_UNLOCK() pthread_mutex_unlock(&hdf5_runtime_mutex)
 
 #define HDF5_PRE_RECORD() do { \
+    DARSHAN_SELF_ENTER(DARSHAN_HDF5_MOD); \
     HDF5_LOCK(); \
     if(!darshan_core_disabled_instrumentation()) { \
         if(!hdf5_runtime) hdf5_runtime_initialize(); \
         if(hdf5_runtime) break; \
     } \
     HDF5_UNLOCK(); \
+    DARSHAN_SELF_EXIT(DARSHAN_HDF5_MOD); \
     return(ret); \
 } while(0)
 
 #define HDF5_POST_RECORD() do { \
     HDF5_UNLOCK(); \
+    DARSHAN_SELF_EXIT(DARSHAN_HDF5_MOD); \
 } while(0)
 
 #define HDF5_RECORD_OPEN(__ret, __path, __tm1, __tm2) do { \
@@ -97,7 +100,7 @@ static int my_rank = -1;
     char *newpath; \
     newpath = darshan_clean_file_path(__path); \
     if(!newpath) newpath = (char *)__path; \
-    if(darshan_core_excluded_path(newpath)) { \
+    if(darshan_core_excluded_path(DARSHAN_HDF5_MOD, newpath)) { \
         if(newpath != __path) free(newpath); \
         break; \
     } \
@@ -163,6 +166,7 @@ hid_t DARSHAN_DECL(H5Fcreate)(const char *filename, unsigned flags,
         }
 
         HDF5_PRE_RECORD();
+        DARSHAN_SELF_TIME(DARSHAN_HDF5_MOD, SELF_F_REAL_TIME, tm2 - tm1);
         HDF5_RECORD_OPEN(ret, filename, tm1, tm2);
         HDF5_POST_RECORD();
     }
@@ -212,6 +216,7 @@ hid_t DARSHAN_DECL(H5Fopen)(const char *filename, unsigned flags,
         }
 
         HDF5_PRE_RECORD();
+        DARSHAN_SELF_TIME(DARSHAN_HDF5_MOD, SELF_F_REAL_TIME, tm2 - tm1);
         HDF5_RECORD_OPEN(ret, filename, tm1, tm2);
         HDF5_POST_RECORD();
     }
@@ -233,6 +238,7 @@ herr_t DARSHAN_DECL(H5Fclose)(hid_t file_id)
     tm2 = darshan_core_wtime();
 
     HDF5_PRE_RECORD();
+    DARSHAN_SELF_TIME(DARSHAN_HDF5_MOD, SELF_F_REAL_TIME, tm2 - tm1);
     rec_ref = darshan_lookup_record_ref(hdf5_runtime->hid_hash,
         &file_id, sizeof(hid_t));
     if(rec_ref)
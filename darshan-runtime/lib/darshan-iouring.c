@@ -0,0 +1,1333 @@
+/*
+ * Copyright (C) 2015 University of Chicago.
+ * See COPYRIGHT notice in top-level directory.
+ *
+ */
+
+/* catalog of io_uring functions instrumented by this module
+ *
+ * system call wrappers (as exported by liburing 2.2 and later)
+ * --------------
+ * int io_uring_setup(unsigned, struct io_uring_params *);          DONE
+ * int io_uring_enter(unsigned, unsigned, unsigned, unsigned,
+ *                    sigset_t *);                                   DONE
+ *
+ * liburing functions (only if liburing.h was found at configure time)
+ * --------------
+ * int io_uring_queue_init(unsigned, struct io_uring *, unsigned);  DONE
+ * int io_uring_queue_init_params(unsigned, struct io_uring *,
+ *                                struct io_uring_params *);         DONE
+ * void io_uring_queue_exit(struct io_uring *);                     DONE
+ * int io_uring_submit(struct io_uring *);                          DONE
+ * int io_uring_submit_and_wait(struct io_uring *, unsigned);       DONE
+ * int __io_uring_get_cqe(struct io_uring *, struct io_uring_cqe **,
+ *                        unsigned, unsigned, sigset_t *);          DONE
+ *
+ * Submissions and completions do not pass through any function Darshan can
+ * intercept one by one: applications fill in submission queue entries
+ * (SQEs) and read completion queue entries (CQEs) directly in memory
+ * shared with the kernel. This module therefore keeps a read-only view of
+ * each ring it learns about (mapping the ring itself for rings set up with
+ * io_uring_setup(), or using liburing's mappings), and whenever one of the
+ * functions above returns it decodes the SQEs the kernel has consumed since
+ * the last call and matches the CQEs the kernel has posted since then to
+ * them by their user_data (in submission order, for operations sharing
+ * one).
+ *
+ * Read, write, readv, writev (including fixed buffer variants), fsync,
+ * openat, openat2, and close operations are decoded. They are attributed
+ * to the file records of their file descriptors, which are the records the
+ * POSIX module uses for descriptors it tracks, or those of files opened
+ * through a ring. Operations on fixed (registered) files are not
+ * attributed.
+ *
+ * Omissions:
+ *   - completion times are the times CQEs are observed, i.e., the return of
+ *     the next instrumented call on the ring, so latencies are upper bounds
+ *     for applications that reap completions without calling into the
+ *     kernel or liburing's out-of-line functions
+ *   - CQEs overwritten before they are observed (when the application
+ *     reaps a full ring's worth of completions between instrumented calls)
+ *     are counted as unobserved
+ *   - SQEs overwritten before they are decoded (when the kernel consumes
+ *     more than a ring's worth of submissions between instrumented calls)
+ *     can not be attributed to a file, and are counted as unobserved in
+ *     the <IO_URING> record
+ *   - opens consumed by calls Darshan did not see (e.g., raw syscall(2)
+ *     calls) are counted in the <IO_URING> record, as their paths may no
+ *     longer be valid when the SQEs are decoded
+ *   - rings set up with IORING_SETUP_SQPOLL are not instrumented, as a
+ *     kernel thread consumes their SQEs at any time, so they may be reused
+ *     by the application before Darshan gets to decode them
+ *   - rings set up with raw syscall(2) calls are not instrumented
+ */
+
+#define _XOPEN_SOURCE 500
+#define _GNU_SOURCE
+
+#include "darshan-runtime-config.h"
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <string.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <limits.h>
+
+#include <linux/io_uring.h>
+#ifdef HAVE_LIBURING_H
+#include <liburing.h>
+#endif
+
+#include "uthash.h"
+
+#include "darshan.h"
+#include "darshan-dynamic.h"
+#ifdef HAVE_MPI
+#include "darshan-mpi.h"
+#endif
+
+DARSHAN_FORWARD_DECL(io_uring_setup, int, (unsigned entries, struct io_uring_params *p));
+DARSHAN_FORWARD_DECL(io_uring_enter, int, (unsigned fd, unsigned to_submit, unsigned min_complete, unsigned flags, sigset_t *sig));
+#ifdef HAVE_LIBURING_H
+DARSHAN_FORWARD_DECL(io_uring_queue_init, int, (unsigned entries, struct io_uring *ring, unsigned flags));
+DARSHAN_FORWARD_DECL(io_uring_queue_init_params, int, (unsigned entries, struct io_uring *ring, struct io_uring_params *p));
+DARSHAN_FORWARD_DECL(io_uring_queue_exit, void, (struct io_uring *ring));
+DARSHAN_FORWARD_DECL(io_uring_submit, int, (struct io_uring *ring));
+DARSHAN_FORWARD_DECL(io_uring_submit_and_wait, int, (struct io_uring *ring, unsigned wait_nr));
+DARSHAN_FORWARD_DECL(__io_uring_get_cqe, int, (struct io_uring *ring, struct io_uring_cqe **cqe_ptr, unsigned submit, unsigned wait_nr, sigset_t *sigmask));
+#endif
+
+/* structure to track io_uring stats for a file at runtime */
+struct iouring_file_record_ref
+{
+    struct darshan_iouring_file *file_rec;
+    /* operations on the file submitted but not yet seen to complete */
+    int64_t inflight;
+};
+
+/* an operation submitted to a ring whose completion has not been
+ * observed yet, hashed by the user_data it will complete with. Only the
+ * oldest operation with a given user_data is in the hash; the others are
+ * queued behind it in submission order, and completions are matched to
+ * them in that order.
+ */
+struct iouring_op
+{
+    uint64_t user_data;
+    struct iouring_file_record_ref *rec_ref;
+    int opcode;
+    int fd;
+    /* file offset of a read or write, or -1 for the file position */
+    int64_t offset;
+    /* whether an open created a regular file descriptor */
+    int open_fd;
+    double submit_time;
+    UT_hash_handle hlink;
+    /* next operation with the same user_data, and (in the hashed one) the
+     * last one
+     */
+    struct iouring_op *next_dup;
+    struct iouring_op *dup_tail;
+    struct iouring_op *next_free;
+};
+
+/* Darshan's read-only view of an io_uring instance's submission and
+ * completion queues, hashed by the ring's file descriptor. 'sq_seen' and
+ * 'cq_seen' are the SQ head and CQ tail positions up to which the queues
+ * have been scanned.
+ */
+struct iouring_ring
+{
+    int fd;
+    const unsigned *sq_khead;
+    const unsigned *sq_kring_mask;
+    const unsigned *sq_array;
+    unsigned sq_entries;
+    const char *sqes;
+    size_t sqe_size;
+    const unsigned *cq_ktail;
+    const unsigned *cq_kring_mask;
+    unsigned cq_entries;
+    const char *cqes;
+    size_t cqe_size;
+    unsigned sq_seen;
+    unsigned cq_seen;
+    struct iouring_op *ops;
+    /* mappings made by Darshan, unset for rings mapped by liburing */
+    void *sq_ring_ptr;
+    size_t sq_ring_sz;
+    void *cq_ring_ptr;
+    size_t cq_ring_sz;
+    void *sqes_ptr;
+    size_t sqes_sz;
+    UT_hash_handle hlink;
+};
+
+/* The iouring_runtime structure maintains necessary state for storing
+ * io_uring file records and for coordinating with darshan-core at
+ * shutdown time.
+ */
+struct iouring_runtime
+{
+    void *rec_id_hash;
+    /* file descriptors opened through a ring */
+    struct darshan_fd_table fd_table;
+    struct iouring_ring *ring_hash;
+    struct iouring_op *op_free_list;
+    int file_rec_count;
+};
+
+static struct iouring_runtime *iouring_runtime = NULL;
+static pthread_mutex_t iouring_runtime_mutex = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+static int my_rank = -1;
+
+static void iouring_runtime_initialize(void);
+static void iouring_shutdown(
+    void *mod_comm,
+    darshan_record_id *shared_recs,
+    int shared_rec_count,
+    void **iouring_buf,
+    int *iouring_buf_sz);
+static void iouring_snapshot(
+    void **iouring_buf,
+    int *iouring_buf_sz,
+    int *iouring_partial);
+#ifdef HAVE_MPI
+static void iouring_record_reduction_op(void* infile_v, void* inoutfile_v,
+    int *len, MPI_Datatype *datatype);
+#endif
+static struct iouring_ring *iouring_map_ring(int fd,
+    struct io_uring_params *p);
+static int iouring_sq_head(int fd, unsigned *head);
+static void iouring_scan_ring(struct iouring_ring *ring, unsigned call_head,
+    double tm1, double tm2);
+static void iouring_release_ring(struct iouring_ring *ring, double tm);
+static void iouring_submit_op(struct iouring_ring *ring,
+    const struct io_uring_sqe *sqe, int unseen, double tm,
+    struct iouring_file_record_ref **fd_ref_cache, int *fd_cache);
+static struct iouring_op *iouring_take_op(struct iouring_ring *ring,
+    uint64_t user_data);
+static void iouring_complete_op(struct iouring_ring *ring,
+    struct iouring_op *op, int32_t res, double tm);
+static void iouring_drop_ops(struct iouring_ring *ring);
+static struct iouring_file_record_ref *iouring_lookup_fd_ref(int fd);
+static struct iouring_file_record_ref *iouring_track_new_file_record(
+    darshan_record_id rec_id, const char *path);
+static struct iouring_file_record_ref *iouring_unattributed_ref(void);
+static void iouring_cleanup_runtime(void);
+
+/* extern function def for querying the record id of a POSIX fd */
+extern int darshan_posix_lookup_record_id(int fd, darshan_record_id *rec_id);
+
+#define IOURING_LOCK() DARSHAN_SELF_LOCK(&iouring_runtime_mutex, DARSHAN_IOURING_MOD)
+#define IOURING_UNLOCK() pthread_mutex_unlock(&iouring_runtime_mutex)
+
+#define IOURING_PRE_RECORD() do { \
+    DARSHAN_SELF_ENTER(DARSHAN_IOURING_MOD); \
+    IOURING_LOCK(); \
+    if(!darshan_core_disabled_instrumentation()) { \
+        if(!iouring_runtime) iouring_runtime_initialize(); \
+        if(iouring_runtime) break; \
+    } \
+    IOURING_UNLOCK(); \
+    DARSHAN_SELF_EXIT(DARSHAN_IOURING_MOD); \
+    return(ret); \
+} while(0)
+
+#define IOURING_POST_RECORD() do { \
+    IOURING_UNLOCK(); \
+    DARSHAN_SELF_EXIT(DARSHAN_IOURING_MOD); \
+} while(0)
+
+/* scan the ring with file descriptor '__fd' after an instrumented call
+ * that started at '__tm1' (when the SQ head was at '__head') and returned
+ * at '__tm2'
+ */
+#define IOURING_RECORD_CALL(__fd, __head, __tm1, __tm2) do { \
+    struct iouring_ring *__ring; \
+    int __ring_fd = (__fd); \
+    DARSHAN_SELF_TIME(DARSHAN_IOURING_MOD, SELF_F_REAL_TIME, __tm2 - __tm1); \
+    HASH_FIND(hlink, iouring_runtime->ring_hash, &__ring_fd, sizeof(int), __ring); \
+    if(__ring) iouring_scan_ring(__ring, __head, __tm1, __tm2); \
+} while(0)
+
+#define IOURING_UPDATE_MAX(__val, __new) do { \
+    if((__new) > (__val)) (__val) = (__new); \
+} while(0)
+
+int DARSHAN_DECL(io_uring_setup)(unsigned entries, struct io_uring_params *p)
+{
+    int ret;
+
+    MAP_OR_FAIL(io_uring_setup);
+
+    ret = __real_io_uring_setup(entries, p);
+    if(ret < 0)
+        return(ret);
+
+    IOURING_PRE_RECORD();
+    iouring_map_ring(ret, p);
+    IOURING_POST_RECORD();
+
+    return(ret);
+}
+
+int DARSHAN_DECL(io_uring_enter)(unsigned fd, unsigned to_submit,
+    unsigned min_complete, unsigned flags, sigset_t *sig)
+{
+    int ret;
+    unsigned head = 0;
+    double tm1, tm2;
+
+    MAP_OR_FAIL(io_uring_enter);
+
+    iouring_sq_head(fd, &head);
+    tm1 = darshan_core_wtime();
+    ret = __real_io_uring_enter(fd, to_submit, min_complete, flags, sig);
+    tm2 = darshan_core_wtime();
+
+    IOURING_PRE_RECORD();
+    IOURING_RECORD_CALL(fd, head, tm1, tm2);
+    IOURING_POST_RECORD();
+
+    return(ret);
+}
+
+#ifdef HAVE_LIBURING_H
+
+/* start tracking a ring set up by liburing, using liburing's mappings */
+static struct iouring_ring *iouring_attach_liburing(struct io_uring *ring)
+{
+    struct iouring_ring *view;
+
+    /* see the notes on SQPOLL rings at the top of this file */
+    if(ring->flags & IORING_SETUP_SQPOLL)
+        return(NULL);
+
+    HASH_FIND(hlink, iouring_runtime->ring_hash, &ring->ring_fd, sizeof(int), view);
+    if(view)
+        return(view);
+
+    view = calloc(1, sizeof(*view));
+    if(!view)
+        return(NULL);
+
+    view->fd = ring->ring_fd;
+    view->sq_khead = ring->sq.khead;
+    view->sq_kring_mask = ring->sq.kring_mask;
+    view->sq_array = ring->sq.array;
+    view->sq_entries = *ring->sq.kring_entries;
+    view->sqes = (const char *)ring->sq.sqes;
+    view->sqe_size = sizeof(struct io_uring_sqe);
+#ifdef IORING_SETUP_SQE128
+    if(ring->flags & IORING_SETUP_SQE128)
+        view->sqe_size += 64;
+#endif
+    view->cq_ktail = ring->cq.ktail;
+    view->cq_kring_mask = ring->cq.kring_mask;
+    view->cq_entries = *ring->cq.kring_entries;
+    view->cqes = (const char *)ring->cq.cqes;
+    view->cqe_size = sizeof(struct io_uring_cqe);
+#ifdef IORING_SETUP_CQE32
+    if(ring->flags & IORING_SETUP_CQE32)
+        view->cqe_size += sizeof(struct io_uring_cqe);
+#endif
+    view->sq_seen = __atomic_load_n(view->sq_khead, __ATOMIC_ACQUIRE);
+    view->cq_seen = __atomic_load_n(view->cq_ktail, __ATOMIC_ACQUIRE);
+
+    HASH_ADD(hlink, iouring_runtime->ring_hash, fd, sizeof(int), view);
+    return(view);
+}
+
+int DARSHAN_DECL(io_uring_queue_init)(unsigned entries, struct io_uring *ring,
+    unsigned flags)
+{
+    int ret;
+
+    MAP_OR_FAIL(io_uring_queue_init);
+
+    ret = __real_io_uring_queue_init(entries, ring, flags);
+    if(ret < 0)
+        return(ret);
+
+    IOURING_PRE_RECORD();
+    iouring_attach_liburing(ring);
+    IOURING_POST_RECORD();
+
+    return(ret);
+}
+
+int DARSHAN_DECL(io_uring_queue_init_params)(unsigned entries,
+    struct io_uring *ring, struct io_uring_params *p)
+{
+    int ret;
+
+    MAP_OR_FAIL(io_uring_queue_init_params);
+
+    ret = __real_io_uring_queue_init_params(entries, ring, p);
+    if(ret < 0)
+        return(ret);
+
+    IOURING_PRE_RECORD();
+    iouring_attach_liburing(ring);
+    IOURING_POST_RECORD();
+
+    return(ret);
+}
+
+void DARSHAN_DECL(io_uring_queue_exit)(struct io_uring *ring)
+{
+    struct iouring_ring *view;
+
+    MAP_OR_FAIL(io_uring_queue_exit);
+
+    /* liburing unmaps the ring, so this is the last chance to scan it */
+    DARSHAN_SELF_ENTER(DARSHAN_IOURING_MOD);
+    IOURING_LOCK();
+    if(iouring_runtime)
+    {
+        HASH_FIND(hlink, iouring_runtime->ring_hash, &ring->ring_fd, sizeof(int), view);
+        if(view)
+            iouring_release_ring(view, darshan_core_wtime());
+    }
+    IOURING_UNLOCK();
+    DARSHAN_SELF_EXIT(DARSHAN_IOURING_MOD);
+
+    __real_io_uring_queue_exit(ring);
+
+    return;
+}
+
+int DARSHAN_DECL(io_uring_submit)(struct io_uring *ring)
+{
+    int ret;
+    unsigned head;
+    double tm1, tm2;
+
+    MAP_OR_FAIL(io_uring_submit);
+
+    head = __atomic_load_n(ring->sq.khead, __ATOMIC_ACQUIRE);
+    tm1 = darshan_core_wtime();
+    ret = __real_io_uring_submit(ring);
+    tm2 = darshan_core_wtime();
+
+    IOURING_PRE_RECORD();
+    iouring_attach_liburing(ring);
+    IOURING_RECORD_CALL(ring->ring_fd, head, tm1, tm2);
+    IOURING_POST_RECORD();
+
+    return(ret);
+}
+
+int DARSHAN_DECL(io_uring_submit_and_wait)(struct io_uring *ring,
+    unsigned wait_nr)
+{
+    int ret;
+    unsigned head;
+    double tm1, tm2;
+
+    MAP_OR_FAIL(io_uring_submit_and_wait);
+
+    head = __atomic_load_n(ring->sq.khead, __ATOMIC_ACQUIRE);
+    tm1 = darshan_core_wtime();
+    ret = __real_io_uring_submit_and_wait(ring, wait_nr);
+    tm2 = darshan_core_wtime();
+
+    IOURING_PRE_RECORD();
+    iouring_attach_liburing(ring);
+    IOURING_RECORD_CALL(ring->ring_fd, head, tm1, tm2);
+    IOURING_POST_RECORD();
+
+    return(ret);
+}
+
+int DARSHAN_DECL(__io_uring_get_cqe)(struct io_uring *ring,
+    struct io_uring_cqe **cqe_ptr, unsigned submit, unsigned wait_nr,
+    sigset_t *sigmask)
+{
+    int ret;
+    unsigned head;
+    double tm1, tm2;
+
+    MAP_OR_FAIL(__io_uring_get_cqe);
+
+    head = __atomic_load_n(ring->sq.khead, __ATOMIC_ACQUIRE);
+    tm1 = darshan_core_wtime();
+    ret = __real___io_uring_get_cqe(ring, cqe_ptr, submit, wait_nr, sigmask);
+    tm2 = darshan_core_wtime();
+
+    IOURING_PRE_RECORD();
+    iouring_attach_liburing(ring);
+    IOURING_RECORD_CALL(ring->ring_fd, head, tm1, tm2);
+    IOURING_POST_RECORD();
+
+    return(ret);
+}
+
+#endif
+
+/* drop the module's state for file descriptor 'fd', which the application
+ * has closed; called by the POSIX module's close() wrapper
+ */
+void darshan_iouring_close_fd(int fd)
+{
+    struct iouring_ring *ring;
+
+    if(!iouring_runtime)
+        return;
+
+    DARSHAN_SELF_ENTER(DARSHAN_IOURING_MOD);
+    IOURING_LOCK();
+    if(iouring_runtime)
+    {
+        darshan_delete_fd_ref(&(iouring_runtime->fd_table), fd);
+
+        /* the ring stays alive for as long as Darshan has it mapped */
+        HASH_FIND(hlink, iouring_runtime->ring_hash, &fd, sizeof(int), ring);
+        if(ring && ring->sq_ring_ptr)
+            iouring_release_ring(ring, darshan_core_wtime());
+    }
+    IOURING_UNLOCK();
+    DARSHAN_SELF_EXIT(DARSHAN_IOURING_MOD);
+
+    return;
+}
+
+/************************************************************
+ * Internal functions for manipulating io_uring module state *
+ ************************************************************/
+
+/* initialize internal io_uring module data structures and register with darshan-core */
+static void iouring_runtime_initialize()
+{
+    int iouring_buf_size;
+
+    /* try to store default number of records for this module */
+    iouring_buf_size = DARSHAN_DEF_MOD_REC_COUNT * sizeof(struct darshan_iouring_file);
+
+    /* register the io_uring module with darshan core */
+    darshan_core_register_module(
+        DARSHAN_IOURING_MOD,
+        &iouring_shutdown,
+        &iouring_buf_size,
+        &my_rank,
+        NULL);
+
+    /* return if darshan-core does not provide enough module memory */
+    if(iouring_buf_size < sizeof(struct darshan_iouring_file))
+    {
+        darshan_core_unregister_module(DARSHAN_IOURING_MOD);
+        return;
+    }
+    darshan_core_register_module_snapshot(DARSHAN_IOURING_MOD, &iouring_snapshot);
+
+    iouring_runtime = calloc(1, sizeof(*iouring_runtime));
+    if(!iouring_runtime)
+    {
+        darshan_core_unregister_module(DARSHAN_IOURING_MOD);
+        return;
+    }
+
+    return;
+}
+
+/* map a read-only view of the queues of the ring set up by io_uring_setup()
+ * with parameters 'p', following the layout liburing uses
+ */
+static struct iouring_ring *iouring_map_ring(int fd, struct io_uring_params *p)
+{
+    struct iouring_ring *ring;
+    void *ptr;
+
+#ifdef IORING_SETUP_NO_MMAP
+    /* the application provided the ring memory itself */
+    if(p->flags & IORING_SETUP_NO_MMAP)
+        return(NULL);
+#endif
+    /* see the notes on SQPOLL rings at the top of this file */
+    if(p->flags & IORING_SETUP_SQPOLL)
+        return(NULL);
+
+    ring = calloc(1, sizeof(*ring));
+    if(!ring)
+        return(NULL);
+    ring->fd = fd;
+    ring->sq_entries = p->sq_entries;
+    ring->cq_entries = p->cq_entries;
+    ring->sqe_size = sizeof(struct io_uring_sqe);
+#ifdef IORING_SETUP_SQE128
+    if(p->flags & IORING_SETUP_SQE128)
+        ring->sqe_size += 64;
+#endif
+    ring->cqe_size = sizeof(struct io_uring_cqe);
+#ifdef IORING_SETUP_CQE32
+    if(p->flags & IORING_SETUP_CQE32)
+        ring->cqe_size += sizeof(struct io_uring_cqe);
+#endif
+
+    ring->sq_ring_sz = p->sq_off.array + p->sq_entries * sizeof(unsigned);
+    ring->cq_ring_sz = p->cq_off.cqes + p->cq_entries * ring->cqe_size;
+    if(p->features & IORING_FEAT_SINGLE_MMAP)
+    {
+        if(ring->cq_ring_sz > ring->sq_ring_sz)
+            ring->sq_ring_sz = ring->cq_ring_sz;
+        ring->cq_ring_sz = 0;
+    }
+
+    ptr = mmap(NULL, ring->sq_ring_sz, PROT_READ, MAP_SHARED, fd,
+        IORING_OFF_SQ_RING);
+    if(ptr == MAP_FAILED)
+        goto fail;
+    ring->sq_ring_ptr = ptr;
+    if(ring->cq_ring_sz)
+    {
+        ptr = mmap(NULL, ring->cq_ring_sz, PROT_READ, MAP_SHARED, fd,
+            IORING_OFF_CQ_RING);
+        if(ptr == MAP_FAILED)
+            goto fail;
+        ring->cq_ring_ptr = ptr;
+    }
+    else
+        ring->cq_ring_ptr = ring->sq_ring_ptr;
+    ring->sqes_sz = ring->sqe_size * p->sq_entries;
+    ptr = mmap(NULL, ring->sqes_sz, PROT_READ, MAP_SHARED, fd,
+        IORING_OFF_SQES);
+    if(ptr == MAP_FAILED)
+        goto fail;
+    ring->sqes_ptr = ptr;
+
+    ring->sq_khead = (const unsigned *)((char *)ring->sq_ring_ptr + p->sq_off.head);
+    ring->sq_kring_mask = (const unsigned *)((char *)ring->sq_ring_ptr + p->sq_off.ring_mask);
+    ring->sq_array = (const unsigned *)((char *)ring->sq_ring_ptr + p->sq_off.array);
+#ifdef IORING_SETUP_NO_SQARRAY
+    if(p->flags & IORING_SETUP_NO_SQARRAY)
+        ring->sq_array = NULL;
+#endif
+    ring->sqes = ring->sqes_ptr;
+    ring->cq_ktail = (const unsigned *)((char *)ring->cq_ring_ptr + p->cq_off.tail);
+    ring->cq_kring_mask = (const unsigned *)((char *)ring->cq_ring_ptr + p->cq_off.ring_mask);
+    ring->cqes = (const char *)ring->cq_ring_ptr + p->cq_off.cqes;
+    ring->sq_seen = __atomic_load_n(ring->sq_khead, __ATOMIC_ACQUIRE);
+    ring->cq_seen = __atomic_load_n(ring->cq_ktail, __ATOMIC_ACQUIRE);
+
+    HASH_ADD(hlink, iouring_runtime->ring_hash, fd, sizeof(int), ring);
+    return(ring);
+
+fail:
+    if(ring->sq_ring_ptr)
+        munmap(ring->sq_ring_ptr, ring->sq_ring_sz);
+    if(ring->cq_ring_sz && ring->cq_ring_ptr)
+        munmap(ring->cq_ring_ptr, ring->cq_ring_sz);
+    free(ring);
+    return(NULL);
+}
+
+/* get the SQ head of the ring with file descriptor 'fd' before calling into
+ * the kernel; returns 0 if the ring is not tracked
+ */
+static int iouring_sq_head(int fd, unsigned *head)
+{
+    struct iouring_ring *ring = NULL;
+
+    if(!iouring_runtime)
+        return(0);
+
+    IOURING_LOCK();
+    if(iouring_runtime)
+    {
+        HASH_FIND(hlink, iouring_runtime->ring_hash, &fd, sizeof(int), ring);
+        if(ring)
+            *head = __atomic_load_n(ring->sq_khead, __ATOMIC_ACQUIRE);
+    }
+    IOURING_UNLOCK();
+
+    return(ring != NULL);
+}
+
+/* record the operations the kernel has consumed from the ring's submission
+ * queue, then match the completions it has posted since the last scan;
+ * the call that triggered the scan started at 'tm1', when the SQ head was
+ * at 'call_head', and returned at 'tm2'
+ */
+static void iouring_scan_ring(struct iouring_ring *ring, unsigned call_head,
+    double tm1, double tm2)
+{
+    struct iouring_file_record_ref *fd_ref_cache = NULL;
+    int fd_cache = -1;
+    struct iouring_file_record_ref *rec_ref;
+    struct iouring_op *op;
+    const struct io_uring_sqe *sqe;
+    const struct io_uring_cqe *cqe;
+    unsigned head, tail, idx, i;
+
+    /* without SQPOLL, the kernel only consumes SQEs in io_uring_enter(),
+     * so the SQEs consumed by the call that triggered this scan (from
+     * 'call_head' on) are still intact, as are the buffers they point to,
+     * since the application can not reuse them before this returns. SQEs
+     * consumed by calls Darshan did not see may have been reused, though,
+     * so they are decoded without following any of their pointers; any
+     * beyond a ring's worth are lost, and are counted as unobserved
+     * operations of the <IO_URING> record
+     */
+    head = __atomic_load_n(ring->sq_khead, __ATOMIC_ACQUIRE);
+    if(call_head - ring->sq_seen > head - ring->sq_seen)
+        call_head = head;
+    if(head - ring->sq_seen > ring->sq_entries)
+    {
+        rec_ref = iouring_unattributed_ref();
+        if(rec_ref)
+            rec_ref->file_rec->counters[IOURING_UNOBSERVED] +=
+                head - ring->sq_seen - ring->sq_entries;
+        ring->sq_seen = head - ring->sq_entries;
+    }
+    for(i = ring->sq_seen; i != head; i++)
+    {
+        idx = i & *ring->sq_kring_mask;
+        if(ring->sq_array)
+            idx = ring->sq_array[idx];
+        if(idx >= ring->sq_entries)
+            continue;
+        sqe = (const struct io_uring_sqe *)(ring->sqes + idx * ring->sqe_size);
+        iouring_submit_op(ring, sqe, (i - call_head) >= (head - call_head),
+            tm1, &fd_ref_cache, &fd_cache);
+    }
+    ring->sq_seen = head;
+
+    /* CQEs stay in place after the application reaps them, until the
+     * kernel wraps around the ring
+     */
+    tail = __atomic_load_n(ring->cq_ktail, __ATOMIC_ACQUIRE);
+    if(tail - ring->cq_seen > ring->cq_entries)
+    {
+        iouring_drop_ops(ring);
+        ring->cq_seen = tail - ring->cq_entries;
+    }
+    for(i = ring->cq_seen; i != tail; i++)
+    {
+        cqe = (const struct io_uring_cqe *)(ring->cqes +
+            (i & *ring->cq_kring_mask) * ring->cqe_size);
+        op = iouring_take_op(ring, cqe->user_data);
+        if(op)
+            iouring_complete_op(ring, op, cqe->res, tm2);
+    }
+    ring->cq_seen = tail;
+
+    return;
+}
+
+/* scan a ring one last time and stop tracking it */
+static void iouring_release_ring(struct iouring_ring *ring, double tm)
+{
+    /* no call is in progress, so every SQE left is from an unseen one */
+    iouring_scan_ring(ring, __atomic_load_n(ring->sq_khead, __ATOMIC_ACQUIRE),
+        tm, tm);
+    iouring_drop_ops(ring);
+
+    HASH_DELETE(hlink, iouring_runtime->ring_hash, ring);
+    if(ring->sqes_ptr)
+        munmap(ring->sqes_ptr, ring->sqes_sz);
+    if(ring->cq_ring_sz && ring->cq_ring_ptr)
+        munmap(ring->cq_ring_ptr, ring->cq_ring_sz);
+    if(ring->sq_ring_ptr)
+        munmap(ring->sq_ring_ptr, ring->sq_ring_sz);
+    free(ring);
+
+    return;
+}
+
+/* count the operation described by 'sqe', submitted at 'tm', against the
+ * record of its file, and track it until it completes. 'unseen' is set if
+ * the SQE was consumed by a call Darshan did not see, in which case the
+ * memory it points to may no longer be valid. 'fd_ref_cache' and
+ * 'fd_cache' remember the last file descriptor resolved in a scan, as
+ * consecutive SQEs usually refer to the same file.
+ */
+static void iouring_submit_op(struct iouring_ring *ring,
+    const struct io_uring_sqe *sqe, int unseen, double tm,
+    struct iouring_file_record_ref **fd_ref_cache, int *fd_cache)
+{
+    struct iouring_file_record_ref *rec_ref = NULL;
+    struct darshan_iouring_file *file_rec;
+    struct iouring_op *op, *first;
+    darshan_record_id rec_id;
+    char pathbuf[PATH_MAX];
+    const char *path;
+    char *newpath;
+    int open_fd = 0;
+
+    switch(sqe->opcode)
+    {
+        case IORING_OP_OPENAT:
+        case IORING_OP_OPENAT2:
+            if(sqe->flags & IOSQE_FIXED_FILE)
+                return;
+            /* file_index (aliased by splice_fd_in) asks for a direct
+             * descriptor rather than a regular one
+             */
+            open_fd = (sqe->splice_fd_in == 0);
+            /* the path may have been freed by now, so the open (and the
+             * descriptor it returns) can not be attributed to a file
+             */
+            if(unseen)
+            {
+                rec_ref = iouring_unattributed_ref();
+                break;
+            }
+            path = (const char *)(uintptr_t)sqe->addr;
+            if(!path)
+                return;
+            /* only paths that do not depend on a directory fd are tracked */
+            if(path[0] != '/' && sqe->fd != AT_FDCWD)
+                return;
+            newpath = darshan_clean_file_path_id(path, pathbuf, &rec_id);
+            if(!newpath)
+                return;
+            if(darshan_core_excluded_path(DARSHAN_IOURING_MOD, newpath))
+                return;
+            rec_ref = darshan_lookup_record_ref(iouring_runtime->rec_id_hash,
+                &rec_id, sizeof(darshan_record_id));
+            if(!rec_ref)
+                rec_ref = iouring_track_new_file_record(rec_id, newpath);
+            break;
+        case IORING_OP_READ:
+        case IORING_OP_READV:
+        case IORING_OP_READ_FIXED:
+        case IORING_OP_WRITE:
+        case IORING_OP_WRITEV:
+        case IORING_OP_WRITE_FIXED:
+        case IORING_OP_FSYNC:
+        case IORING_OP_CLOSE:
+            if(sqe->flags & IOSQE_FIXED_FILE)
+                return;
+            if(sqe->fd != *fd_cache)
+            {
+                *fd_ref_cache = iouring_lookup_fd_ref(sqe->fd);
+                *fd_cache = sqe->fd;
+            }
+            rec_ref = *fd_ref_cache;
+            break;
+        default:
+            return;
+    }
+    if(!rec_ref)
+        return;
+
+    if(iouring_runtime->op_free_list)
+    {
+        op = iouring_runtime->op_free_list;
+        iouring_runtime->op_free_list = op->next_free;
+    }
+    else
+    {
+        op = malloc(sizeof(*op));
+        if(!op)
+            return;
+    }
+    op->user_data = sqe->user_data;
+    op->rec_ref = rec_ref;
+    op->opcode = sqe->opcode;
+    op->fd = sqe->fd;
+    op->offset = (sqe->off == (uint64_t)-1) ? -1 : (int64_t)sqe->off;
+    op->open_fd = open_fd;
+    op->submit_time = tm;
+    op->next_dup = NULL;
+    op->dup_tail = op;
+    HASH_FIND(hlink, ring->ops, &op->user_data, sizeof(uint64_t), first);
+    if(first)
+    {
+        first->dup_tail->next_dup = op;
+        first->dup_tail = op;
+    }
+    else
+        HASH_ADD(hlink, ring->ops, user_data, sizeof(uint64_t), op);
+
+    file_rec = rec_ref->file_rec;
+    switch(sqe->opcode)
+    {
+        case IORING_OP_OPENAT:
+        case IORING_OP_OPENAT2:
+            file_rec->counters[IOURING_OPENS] += 1;
+            break;
+        case IORING_OP_READV:
+            file_rec->counters[IOURING_READVS] += 1;
+            /* fall through */
+        case IORING_OP_READ:
+        case IORING_OP_READ_FIXED:
+            file_rec->counters[IOURING_READS] += 1;
+            break;
+        case IORING_OP_WRITEV:
+            file_rec->counters[IOURING_WRITEVS] += 1;
+            /* fall through */
+        case IORING_OP_WRITE:
+        case IORING_OP_WRITE_FIXED:
+            file_rec->counters[IOURING_WRITES] += 1;
+            break;
+        case IORING_OP_FSYNC:
+            file_rec->counters[IOURING_FSYNCS] += 1;
+            break;
+        case IORING_OP_CLOSE:
+            file_rec->counters[IOURING_CLOSES] += 1;
+            break;
+    }
+    rec_ref->inflight++;
+    file_rec->counters[IOURING_QUEUE_DEPTH_SUM] += rec_ref->inflight;
+    IOURING_UPDATE_MAX(file_rec->counters[IOURING_MAX_QUEUE_DEPTH],
+        rec_ref->inflight);
+    if(file_rec->fcounters[IOURING_F_SUBMIT_START_TIMESTAMP] == 0 ||
+     file_rec->fcounters[IOURING_F_SUBMIT_START_TIMESTAMP] > tm)
+        file_rec->fcounters[IOURING_F_SUBMIT_START_TIMESTAMP] = tm;
+
+    return;
+}
+
+/* stop tracking the oldest in-flight operation submitted with 'user_data',
+ * and return it (or NULL if there is none)
+ */
+static struct iouring_op *iouring_take_op(struct iouring_ring *ring,
+    uint64_t user_data)
+{
+    struct iouring_op *op, *next;
+
+    HASH_FIND(hlink, ring->ops, &user_data, sizeof(uint64_t), op);
+    if(!op)
+        return(NULL);
+
+    HASH_DELETE(hlink, ring->ops, op);
+    next = op->next_dup;
+    if(next)
+    {
+        next->dup_tail = op->dup_tail;
+        HASH_ADD(hlink, ring->ops, user_data, sizeof(uint64_t), next);
+    }
+
+    return(op);
+}
+
+/* account for the completion of 'op' with result 'res', observed at 'tm' */
+static void iouring_complete_op(struct iouring_ring *ring,
+    struct iouring_op *op, int32_t res, double tm)
+{
+    struct iouring_file_record_ref *rec_ref = op->rec_ref;
+    struct darshan_iouring_file *file_rec = rec_ref->file_rec;
+    double latency = tm - op->submit_time;
+
+    rec_ref->inflight--;
+
+    if(res < 0)
+        file_rec->counters[IOURING_ERRORS] += 1;
+
+    switch(op->opcode)
+    {
+        case IORING_OP_READ:
+        case IORING_OP_READV:
+        case IORING_OP_READ_FIXED:
+            if(res > 0)
+            {
+                file_rec->counters[IOURING_BYTES_READ] += res;
+                if(op->offset >= 0)
+                    IOURING_UPDATE_MAX(file_rec->counters[IOURING_MAX_BYTE_READ],
+                        op->offset + res - 1);
+            }
+            file_rec->fcounters[IOURING_F_READ_LATENCY] += latency;
+            IOURING_UPDATE_MAX(file_rec->fcounters[IOURING_F_MAX_READ_LATENCY],
+                latency);
+            break;
+        case IORING_OP_WRITE:
+        case IORING_OP_WRITEV:
+        case IORING_OP_WRITE_FIXED:
+            if(res > 0)
+            {
+                file_rec->counters[IOURING_BYTES_WRITTEN] += res;
+                if(op->offset >= 0)
+                    IOURING_UPDATE_MAX(file_rec->counters[IOURING_MAX_BYTE_WRITTEN],
+                        op->offset + res - 1);
+            }
+            file_rec->fcounters[IOURING_F_WRITE_LATENCY] += latency;
+            IOURING_UPDATE_MAX(file_rec->fcounters[IOURING_F_MAX_WRITE_LATENCY],
+                latency);
+            break;
+        case IORING_OP_OPENAT:
+        case IORING_OP_OPENAT2:
+            if(res >= 0 && op->open_fd)
+                darshan_add_fd_ref(&(iouring_runtime->fd_table), res, rec_ref);
+            file_rec->fcounters[IOURING_F_META_LATENCY] += latency;
+            break;
+        case IORING_OP_CLOSE:
+            if(res >= 0)
+                darshan_delete_fd_ref(&(iouring_runtime->fd_table), op->fd);
+            file_rec->fcounters[IOURING_F_META_LATENCY] += latency;
+            break;
+        default:
+            file_rec->fcounters[IOURING_F_META_LATENCY] += latency;
+            break;
+    }
+    IOURING_UPDATE_MAX(file_rec->fcounters[IOURING_F_COMPLETE_END_TIMESTAMP], tm);
+
+    op->next_free = iouring_runtime->op_free_list;
+    iouring_runtime->op_free_list = op;
+
+    return;
+}
+
+/* stop tracking all of a ring's in-flight operations, counting them as
+ * unobserved
+ */
+static void iouring_drop_ops(struct iouring_ring *ring)
+{
+    struct iouring_op *first, *tmp, *op;
+
+    HASH_ITER(hlink, ring->ops, first, tmp)
+    {
+        HASH_DELETE(hlink, ring->ops, first);
+        while(first)
+        {
+            op = first;
+            first = op->next_dup;
+            op->rec_ref->inflight--;
+            op->rec_ref->file_rec->counters[IOURING_UNOBSERVED] += 1;
+            op->next_free = iouring_runtime->op_free_list;
+            iouring_runtime->op_free_list = op;
+        }
+    }
+
+    return;
+}
+
+/* find the record for file descriptor 'fd': first among descriptors opened
+ * through a ring, then among those the POSIX module tracks, so that both
+ * modules' records for a file share its record id
+ */
+static struct iouring_file_record_ref *iouring_lookup_fd_ref(int fd)
+{
+    struct iouring_file_record_ref *rec_ref;
+    darshan_record_id rec_id;
+    char *rec_name;
+
+    rec_ref = darshan_lookup_fd_ref(&(iouring_runtime->fd_table), fd);
+    if(rec_ref)
+        return(rec_ref);
+
+    if(!darshan_posix_lookup_record_id(fd, &rec_id))
+        return(NULL);
+    rec_ref = darshan_lookup_record_ref(iouring_runtime->rec_id_hash,
+        &rec_id, sizeof(darshan_record_id));
+    if(rec_ref)
+        return(rec_ref);
+
+    rec_name = darshan_core_lookup_record_name(rec_id);
+    if(!rec_name)
+        return(NULL);
+    if(!darshan_core_excluded_path(DARSHAN_IOURING_MOD, rec_name))
+        rec_ref = iouring_track_new_file_record(rec_id, rec_name);
+    free(rec_name);
+
+    return(rec_ref);
+}
+
+static struct iouring_file_record_ref *iouring_track_new_file_record(
+    darshan_record_id rec_id, const char *path)
+{
+    struct darshan_iouring_file *file_rec = NULL;
+    struct iouring_file_record_ref *rec_ref = NULL;
+    int ret;
+
+    rec_ref = calloc(1, sizeof(*rec_ref));
+    if(!rec_ref)
+        return(NULL);
+
+    /* add a reference to this file record based on record id */
+    ret = darshan_add_record_ref(&(iouring_runtime->rec_id_hash), &rec_id,
+        sizeof(darshan_record_id), rec_ref);
+    if(ret == 0)
+    {
+        free(rec_ref);
+        return(NULL);
+    }
+
+    /* register the actual file record with darshan-core so it is persisted
+     * in the log file
+     */
+    file_rec = darshan_core_register_record(
+        rec_id,
+        path,
+        DARSHAN_IOURING_MOD,
+        sizeof(struct darshan_iouring_file),
+        NULL);
+
+    if(!file_rec)
+    {
+        darshan_delete_record_ref(&(iouring_runtime->rec_id_hash),
+            &rec_id, sizeof(darshan_record_id));
+        free(rec_ref);
+        return(NULL);
+    }
+
+    /* registering this file record was successful, so initialize some fields */
+    file_rec->base_rec.id = rec_id;
+    file_rec->base_rec.rank = my_rank;
+    rec_ref->file_rec = file_rec;
+    iouring_runtime->file_rec_count++;
+
+    return(rec_ref);
+}
+
+/* get the record that counts operations Darshan could not attribute to a
+ * file, registering it on first use
+ */
+static struct iouring_file_record_ref *iouring_unattributed_ref(void)
+{
+    struct iouring_file_record_ref *rec_ref;
+    darshan_record_id rec_id;
+
+    rec_id = darshan_core_gen_record_id("<IO_URING>");
+    rec_ref = darshan_lookup_record_ref(iouring_runtime->rec_id_hash,
+        &rec_id, sizeof(darshan_record_id));
+    if(!rec_ref)
+        rec_ref = iouring_track_new_file_record(rec_id, "<IO_URING>");
+
+    return(rec_ref);
+}
+
+#ifdef HAVE_MPI
+static void iouring_record_reduction_op(void* infile_v, void* inoutfile_v,
+    int *len, MPI_Datatype *datatype)
+{
+    struct darshan_iouring_file tmp_file;
+    struct darshan_iouring_file *infile = infile_v;
+    struct darshan_iouring_file *inoutfile = inoutfile_v;
+    int i, j;
+
+    assert(infile);
+    assert(inoutfile);
+
+    for(i=0; i<*len; i++)
+    {
+        memset(&tmp_file, 0, sizeof(struct darshan_iouring_file));
+        tmp_file.base_rec.id = infile->base_rec.id;
+        tmp_file.base_rec.rank = -1;
+
+        /* sum */
+        for(j=IOURING_OPENS; j<=IOURING_BYTES_WRITTEN; j++)
+        {
+            tmp_file.counters[j] = infile->counters[j] + inoutfile->counters[j];
+        }
+        tmp_file.counters[IOURING_QUEUE_DEPTH_SUM] =
+            infile->counters[IOURING_QUEUE_DEPTH_SUM] +
+            inoutfile->counters[IOURING_QUEUE_DEPTH_SUM];
+
+        /* max */
+        for(j=IOURING_MAX_BYTE_READ; j<=IOURING_MAX_BYTE_WRITTEN; j++)
+        {
+            tmp_file.counters[j] = (infile->counters[j] > inoutfile->counters[j]) ?
+                infile->counters[j] : inoutfile->counters[j];
+        }
+        tmp_file.counters[IOURING_MAX_QUEUE_DEPTH] =
+            (infile->counters[IOURING_MAX_QUEUE_DEPTH] >
+             inoutfile->counters[IOURING_MAX_QUEUE_DEPTH]) ?
+            infile->counters[IOURING_MAX_QUEUE_DEPTH] :
+            inoutfile->counters[IOURING_MAX_QUEUE_DEPTH];
+
+        /* min non-zero (if available) value */
+        j = IOURING_F_SUBMIT_START_TIMESTAMP;
+        if((infile->fcounters[j] < inoutfile->fcounters[j] &&
+           infile->fcounters[j] > 0) || inoutfile->fcounters[j] == 0)
+            tmp_file.fcounters[j] = infile->fcounters[j];
+        else
+            tmp_file.fcounters[j] = inoutfile->fcounters[j];
+
+        /* max */
+        j = IOURING_F_COMPLETE_END_TIMESTAMP;
+        tmp_file.fcounters[j] = (infile->fcounters[j] > inoutfile->fcounters[j]) ?
+            infile->fcounters[j] : inoutfile->fcounters[j];
+        for(j=IOURING_F_MAX_READ_LATENCY; j<=IOURING_F_MAX_WRITE_LATENCY; j++)
+        {
+            tmp_file.fcounters[j] = (infile->fcounters[j] > inoutfile->fcounters[j]) ?
+                infile->fcounters[j] : inoutfile->fcounters[j];
+        }
+
+        /* sum */
+        for(j=IOURING_F_READ_LATENCY; j<=IOURING_F_META_LATENCY; j++)
+        {
+            tmp_file.fcounters[j] = infile->fcounters[j] + inoutfile->fcounters[j];
+        }
+
+        /* update pointers */
+        *inoutfile = tmp_file;
+        inoutfile++;
+        infile++;
+    }
+
+    return;
+}
+#endif
+
+/***********************************************************************
+ * Functions exported by the io_uring module for coordinating with darshan-core *
+ ***********************************************************************/
+
+static void iouring_shutdown(
+    void *mod_comm,
+    darshan_record_id *shared_recs,
+    int shared_rec_count,
+    void **iouring_buf,
+    int *iouring_buf_sz)
+{
+    struct iouring_ring *ring, *tmp;
+    int iouring_rec_count;
+    double tm;
+#ifdef HAVE_MPI
+    struct darshan_iouring_file *iouring_rec_buf =
+        *(struct darshan_iouring_file **)iouring_buf;
+    struct iouring_file_record_ref *rec_ref;
+    struct darshan_iouring_file *red_send_buf = NULL;
+    struct darshan_iouring_file *red_recv_buf = NULL;
+    MPI_Op red_op;
+    int i;
+#endif
+
+    IOURING_LOCK();
+    assert(iouring_runtime);
+
+    /* pick up completions posted since the last instrumented call; any
+     * operation still in flight is counted as unobserved
+     */
+    tm = darshan_core_wtime();
+    HASH_ITER(hlink, iouring_runtime->ring_hash, ring, tmp)
+    {
+        iouring_release_ring(ring, tm);
+    }
+
+    iouring_rec_count = iouring_runtime->file_rec_count;
+
+#ifdef HAVE_MPI
+    /* if there are globally shared files, do a shared file reduction */
+    /* NOTE: the shared file reduction is also skipped if the
+     * DARSHAN_DISABLE_SHARED_REDUCTION environment variable is set.
+     */
+    if(shared_rec_count && !getenv("DARSHAN_DISABLE_SHARED_REDUCTION"))
+    {
+        /* necessary initialization of shared records */
+        for(i = 0; i < shared_rec_count; i++)
+        {
+            rec_ref = darshan_lookup_record_ref(iouring_runtime->rec_id_hash,
+                &shared_recs[i], sizeof(darshan_record_id));
+            assert(rec_ref);
+
+            rec_ref->file_rec->base_rec.rank = -1;
+        }
+
+        /* sort the array of files descending by rank so that we get all of the
+         * shared files (marked by rank -1) in a contiguous portion at end
+         * of the array
+         */
+        darshan_record_sort(iouring_rec_buf, iouring_rec_count,
+            sizeof(struct darshan_iouring_file));
+
+        /* make *send_buf point to the shared files at the end of sorted array */
+        red_send_buf = &(iouring_rec_buf[iouring_rec_count-shared_rec_count]);
+
+        /* allocate memory for the reduction output on rank 0 */
+        if(my_rank == 0)
+        {
+            red_recv_buf = malloc(shared_rec_count * sizeof(struct darshan_iouring_file));
+            if(!red_recv_buf)
+            {
+                IOURING_UNLOCK();
+                return;
+            }
+        }
+
+        /* register an io_uring file record reduction operator */
+        darshan_mpi_op_create(iouring_record_reduction_op, 1, &red_op);
+
+        /* reduce shared io_uring file records */
+        darshan_mpi_reduce_records(red_send_buf, red_recv_buf, shared_rec_count,
+            sizeof(struct darshan_iouring_file), red_op, 0,
+            *((MPI_Comm*)mod_comm));
+
+        /* clean up reduction state */
+        if(my_rank == 0)
+        {
+            int tmp_ndx = iouring_rec_count - shared_rec_count;
+            memcpy(&(iouring_rec_buf[tmp_ndx]), red_recv_buf,
+                shared_rec_count * sizeof(struct darshan_iouring_file));
+            free(red_recv_buf);
+        }
+        else
+        {
+            iouring_rec_count -= shared_rec_count;
+        }
+
+        darshan_mpi_op_free(&red_op);
+    }
+#endif
+
+    /* update output buffer size to account for shared file reduction */
+    *iouring_buf_sz = iouring_rec_count * sizeof(struct darshan_iouring_file);
+
+    /* shutdown internal structures used for instrumenting */
+    iouring_cleanup_runtime();
+
+    IOURING_UNLOCK();
+
+    return;
+}
+
+static void iouring_snapshot(
+    void **iouring_buf,
+    int *iouring_buf_sz,
+    int *iouring_partial)
+{
+    char *snap_buf = NULL;
+
+    IOURING_LOCK();
+    if(iouring_runtime && *iouring_buf_sz > 0)
+        snap_buf = malloc(*iouring_buf_sz);
+    if(!snap_buf)
+    {
+        IOURING_UNLOCK();
+        *iouring_buf = NULL;
+        *iouring_buf_sz = 0;
+        return;
+    }
+
+    memcpy(snap_buf, *iouring_buf, *iouring_buf_sz);
+    IOURING_UNLOCK();
+
+    *iouring_buf = snap_buf;
+    return;
+}
+
+static void iouring_cleanup_runtime()
+{
+    struct iouring_op *op;
+
+    while((op = iouring_runtime->op_free_list))
+    {
+        iouring_runtime->op_free_list = op->next_free;
+        free(op);
+    }
+    darshan_clear_fd_refs(&(iouring_runtime->fd_table));
+    darshan_clear_record_refs(&(iouring_runtime->rec_id_hash), 1);
+
+    free(iouring_runtime);
+    iouring_runtime = NULL;
+
+    return;
+}
+
+/*
+ * Local variables:
+ *  c-indent-level: 4
+ *  c-basic-offset: 4
+ * End:
+ *
+ * vim: ts=8 sts=4 sw=4 expandtab
+ */
@@ -43,7 +43,7 @@ struct lustre_runtime *lustre_runtime = NULL;
 static pthread_mutex_t lustre_runtime_mutex = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
 static int my_rank = -1;
 
-#define LUSTRE_LOCK() pthread_mutex_lock(&lustre_runtime_mutex)
+#define LUSTRE_LOCK() DARSHAN_SELF_LOCK(&lustre_runtime_mutex, DARSHAN_LUSTRE_MOD)
 #define LUSTRE_UNLOCK() pthread_mutex_unlock(&lustre_runtime_mutex)
 
 #ifndef LOV_MAX_STRIPE_COUNT /* for Lustre < 2.4 */
@@ -113,7 +113,7 @@ static pthread_mutex_t mdhim_runtime_mutex = PTHREAD_RECURSIVE_MUTEX_INITIALIZER
 static int my_rank = -1;
 
 /* macros for obtaining/releasing the "MDHIM" module lock */
-#define MDHIM_LOCK() pthread_mutex_lock(&mdhim_runtime_mutex)
+#define MDHIM_LOCK() DARSHAN_SELF_LOCK(&mdhim_runtime_mutex, DARSHAN_MDHIM_MOD)
 #define MDHIM_UNLOCK() pthread_mutex_unlock(&mdhim_runtime_mutex)
 
 /* the MDHIM_PRE_RECORD macro is executed before performing MDHIM
@@ -122,12 +122,14 @@ static int my_rank = -1;
  * initialized before instrumenting.
  */
 #define MDHIM_PRE_RECORD() do { \
+    DARSHAN_SELF_ENTER(DARSHAN_MDHIM_MOD); \
     MDHIM_LOCK(); \
     if(!darshan_core_disabled_instrumentation()) { \
         if(!mdhim_runtime) mdhim_runtime_initialize(); \
         if(mdhim_runtime) break; \
     } \
     MDHIM_UNLOCK(); \
+    DARSHAN_SELF_EXIT(DARSHAN_MDHIM_MOD); \
 } while(0)
 
 /* the MDHIM_POST_RECORD macro is executed after performing MDHIM
@@ -135,6 +137,7 @@ static int my_rank = -1;
  */
 #define MDHIM_POST_RECORD() do { \
     MDHIM_UNLOCK(); \
+    DARSHAN_SELF_EXIT(DARSHAN_MDHIM_MOD); \
 } while(0)
 
 /* macro for instrumenting the "MDHIM" module's put function */
@@ -263,6 +266,7 @@ mdhim_rm_t *DARSHAN_DECL(mdhimPut)(mdhim_t *md,
     int server_id = mdhimWhichDB(md, key, key_len);
 
     MDHIM_PRE_RECORD();
+    DARSHAN_SELF_TIME(DARSHAN_MDHIM_MOD, SELF_F_REAL_TIME, tm2 - tm1);
     /* Call macro for instrumenting data for mdhimPut function calls. */
     /* TODO: call the mdhim hash routines and instrument which servers
      * get this request */
@@ -292,6 +296,7 @@ mdhim_grm_t * DARSHAN_DECL(mdhimGet)(mdhim_t *md,
     int server_id = mdhimWhichDB(md, key, key_len);
 
     MDHIM_PRE_RECORD();
+    DARSHAN_SELF_TIME(DARSHAN_MDHIM_MOD, SELF_F_REAL_TIME, tm2 - tm1);
     /* Call macro for instrumenting data for get function calls. */
     MDHIM_RECORD_GET(ret, md, server_id, key_len, tm1, tm2);
     MDHIM_POST_RECORD();
@@ -138,12 +138,25 @@ DARSHAN_FORWARD_DECL(PMPI_File_write_shared, int, (MPI_File fh, void *buf, int c
 struct mpiio_file_record_ref
 {
     struct darshan_mpiio_file *file_rec;
-    enum darshan_io_type last_io_type;
     double last_meta_end;
+    double last_write_end;
+    /* common access sizes, merged from all shards at shutdown */
+    struct darshan_common_val_sketch access_sketch;
+};
+
+/* The mpiio_file_shard structure holds the read/write counters a single
+ * thread accumulates for an MPIIO file record. Shards are merged into the
+ * file record at shutdown time, so read and write wrappers can record I/O
+ * without acquiring the MPIIO lock.
+ */
+struct mpiio_file_shard
+{
+    struct mpiio_file_record_ref *rec_ref;
+    struct darshan_mpiio_file rec;
+    enum darshan_io_type last_io_type;
     double last_read_end;
     double last_write_end;
-    void *access_root;
-    int access_count;
+    struct darshan_common_val_sketch access_sketch;
 };
 
 /* The mpiio_runtime structure maintains necessary state for storing
@@ -161,7 +174,15 @@ static void mpiio_runtime_initialize(
     void);
 static struct mpiio_file_record_ref *mpiio_track_new_file_record(
     darshan_record_id rec_id, const char *path);
-static void mpiio_finalize_file_records(
+static uint64_t mpiio_fh_handle(
+    MPI_File fh);
+static struct mpiio_file_shard *mpiio_lookup_shard(
+    MPI_File fh);
+static void mpiio_merge_file_shard(
+    void *shard_p);
+static void mpiio_thread_exit(
+    struct darshan_thread_shards *shards);
+static void mpiio_record_common_vals(
     void *rec_ref_p);
 static void mpiio_record_reduction_op(
     void* infile_v, void* inoutfile_v, int *len, MPI_Datatype *datatype);
@@ -187,11 +208,16 @@ static struct mpiio_runtime *mpiio_runtime = NULL;
 static pthread_mutex_t mpiio_runtime_mutex = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
 static int my_rank = -1;
 static int enable_dxt_io_trace = 0;
+static struct darshan_shard_registry mpiio_shards =
+    DARSHAN_SHARD_REGISTRY_INITIALIZER(sizeof(struct mpiio_file_shard),
+        &mpiio_thread_exit);
+static __thread struct darshan_thread_shards *mpiio_thread_shards = NULL;
 
-#define MPIIO_LOCK() pthread_mutex_lock(&mpiio_runtime_mutex)
+#define MPIIO_LOCK() DARSHAN_SELF_LOCK(&mpiio_runtime_mutex, DARSHAN_MPIIO_MOD)
 #define MPIIO_UNLOCK() pthread_mutex_unlock(&mpiio_runtime_mutex)
 
 #define MPIIO_PRE_RECORD() do { \
+    DARSHAN_SELF_ENTER(DARSHAN_MPIIO_MOD); \
     MPIIO_LOCK(); \
     if(!darshan_core_disabled_instrumentation()) { \
         if(!mpiio_runtime) { \
@@ -200,11 +226,28 @@ static int enable_dxt_io_trace = 0;
         if(mpiio_runtime) break; \
     } \
     MPIIO_UNLOCK(); \
+    DARSHAN_SELF_EXIT(DARSHAN_MPIIO_MOD); \
     return(ret); \
 } while(0)
 
 #define MPIIO_POST_RECORD() do { \
     MPIIO_UNLOCK(); \
+    DARSHAN_SELF_EXIT(DARSHAN_MPIIO_MOD); \
+} while(0)
+
+/* read and write wrappers only update per-thread counter shards, so they
+ * use these variants which do not acquire the MPIIO lock
+ */
+#define MPIIO_PRE_RECORD_SHARDED() do { \
+    DARSHAN_SELF_ENTER(DARSHAN_MPIIO_MOD); \
+    if(darshan_shards_enter(&mpiio_shards, &mpiio_thread_shards)) break; \
+    DARSHAN_SELF_EXIT(DARSHAN_MPIIO_MOD); \
+    return(ret); \
+} while(0)
+
+#define MPIIO_POST_RECORD_SHARDED() do { \
+    darshan_shards_exit(mpiio_thread_shards); \
+    DARSHAN_SELF_EXIT(DARSHAN_MPIIO_MOD); \
 } while(0)
 
 #define MPIIO_RECORD_OPEN(__ret, __path, __fh, __comm, __mode, __info, __tm1, __tm2) do { \
@@ -215,7 +258,7 @@ static int enable_dxt_io_trace = 0;
     if(__ret != MPI_SUCCESS) break; \
     newpath = darshan_clean_file_path(__path); \
     if(!newpath) newpath = (char *)__path; \
-    if(darshan_core_excluded_path(newpath)) { \
+    if(darshan_core_excluded_path(DARSHAN_MPIIO_MOD, newpath)) { \
         if(newpath != __path) free(newpath); \
         break; \
     } \
@@ -241,73 +284,74 @@ static int enable_dxt_io_trace = 0;
     DARSHAN_TIMER_INC_NO_OVERLAP(rec_ref->file_rec->fcounters[MPIIO_F_META_TIME], \
         __tm1, __tm2, rec_ref->last_meta_end); \
     darshan_add_record_ref(&(mpiio_runtime->fh_hash), &__fh, sizeof(MPI_File), rec_ref); \
+    darshan_shards_invalidate(&mpiio_shards, mpiio_fh_handle(__fh)); \
     if(newpath != __path) free(newpath); \
 } while(0)
 
 #define MPIIO_RECORD_READ(__ret, __fh, __count, __datatype, __counter, __tm1, __tm2) do { \
-    struct mpiio_file_record_ref *rec_ref; \
+    struct mpiio_file_shard *shard; \
     int size = 0; \
     double __elapsed = __tm2-__tm1; \
     if(__ret != MPI_SUCCESS) break; \
-    rec_ref = darshan_lookup_record_ref(mpiio_runtime->fh_hash, &(__fh), sizeof(MPI_File)); \
-    if(!rec_ref) break; \
+    shard = mpiio_lookup_shard(__fh); \
+    if(!shard) break; \
     PMPI_Type_size(__datatype, &size);  \
     size = size * __count; \
     /* DXT to record detailed read tracing information */ \
     if(enable_dxt_io_trace) { \
-        dxt_mpiio_read(rec_ref->file_rec->base_rec.id, size, __tm1, __tm2); \
+        MPIIO_LOCK(); \
+        dxt_mpiio_read(shard->rec_ref->file_rec->base_rec.id, size, __tm1, __tm2); \
+        MPIIO_UNLOCK(); \
     } \
-    DARSHAN_BUCKET_INC(&(rec_ref->file_rec->counters[MPIIO_SIZE_READ_AGG_0_100]), size); \
-    darshan_common_val_counter(&rec_ref->access_root, &rec_ref->access_count, size, \
-        &(rec_ref->file_rec->counters[MPIIO_ACCESS1_ACCESS]), \
-        &(rec_ref->file_rec->counters[MPIIO_ACCESS1_COUNT])); \
-    rec_ref->file_rec->counters[MPIIO_BYTES_READ] += size; \
-    rec_ref->file_rec->counters[__counter] += 1; \
-    if(rec_ref->last_io_type == DARSHAN_IO_WRITE) \
-        rec_ref->file_rec->counters[MPIIO_RW_SWITCHES] += 1; \
-    rec_ref->last_io_type = DARSHAN_IO_READ; \
-    if(rec_ref->file_rec->fcounters[MPIIO_F_READ_START_TIMESTAMP] == 0 || \
-     rec_ref->file_rec->fcounters[MPIIO_F_READ_START_TIMESTAMP] > __tm1) \
-        rec_ref->file_rec->fcounters[MPIIO_F_READ_START_TIMESTAMP] = __tm1; \
-    rec_ref->file_rec->fcounters[MPIIO_F_READ_END_TIMESTAMP] = __tm2; \
-    if(rec_ref->file_rec->fcounters[MPIIO_F_MAX_READ_TIME] < __elapsed) { \
-        rec_ref->file_rec->fcounters[MPIIO_F_MAX_READ_TIME] = __elapsed; \
-        rec_ref->file_rec->counters[MPIIO_MAX_READ_TIME_SIZE] = size; } \
-    DARSHAN_TIMER_INC_NO_OVERLAP(rec_ref->file_rec->fcounters[MPIIO_F_READ_TIME], \
-        __tm1, __tm2, rec_ref->last_read_end); \
+    DARSHAN_BUCKET_INC(&(shard->rec.counters[MPIIO_SIZE_READ_AGG_0_100]), size); \
+    darshan_common_val_counter(&shard->access_sketch, size); \
+    shard->rec.counters[MPIIO_BYTES_READ] += size; \
+    shard->rec.counters[__counter] += 1; \
+    if(shard->last_io_type == DARSHAN_IO_WRITE) \
+        shard->rec.counters[MPIIO_RW_SWITCHES] += 1; \
+    shard->last_io_type = DARSHAN_IO_READ; \
+    if(shard->rec.fcounters[MPIIO_F_READ_START_TIMESTAMP] == 0 || \
+     shard->rec.fcounters[MPIIO_F_READ_START_TIMESTAMP] > __tm1) \
+        shard->rec.fcounters[MPIIO_F_READ_START_TIMESTAMP] = __tm1; \
+    shard->rec.fcounters[MPIIO_F_READ_END_TIMESTAMP] = __tm2; \
+    if(shard->rec.fcounters[MPIIO_F_MAX_READ_TIME] < __elapsed) { \
+        shard->rec.fcounters[MPIIO_F_MAX_READ_TIME] = __elapsed; \
+        shard->rec.counters[MPIIO_MAX_READ_TIME_SIZE] = size; } \
+    DARSHAN_TIMER_INC_NO_OVERLAP(shard->rec.fcounters[MPIIO_F_READ_TIME], \
+        __tm1, __tm2, shard->last_read_end); \
 } while(0)
 
 #define MPIIO_RECORD_WRITE(__ret, __fh, __count, __datatype, __counter, __tm1, __tm2) do { \
-    struct mpiio_file_record_ref *rec_ref; \
+    struct mpiio_file_shard *shard; \
     int size = 0; \
     double __elapsed = __tm2-__tm1; \
     if(__ret != MPI_SUCCESS) break; \
-    rec_ref = darshan_lookup_record_ref(mpiio_runtime->fh_hash, &(__fh), sizeof(MPI_File)); \
-    if(!rec_ref) break; \
+    shard = mpiio_lookup_shard(__fh); \
+    if(!shard) break; \
     PMPI_Type_size(__datatype, &size);  \
     size = size * __count; \
      /* DXT to record detailed write tracing information */ \
     if(enable_dxt_io_trace) { \
-        dxt_mpiio_write(rec_ref->file_rec->base_rec.id, size, __tm1, __tm2); \
+        MPIIO_LOCK(); \
+        dxt_mpiio_write(shard->rec_ref->file_rec->base_rec.id, size, __tm1, __tm2); \
+        MPIIO_UNLOCK(); \
     } \
-    DARSHAN_BUCKET_INC(&(rec_ref->file_rec->counters[MPIIO_SIZE_WRITE_AGG_0_100]), size); \
-    darshan_common_val_counter(&rec_ref->access_root, &rec_ref->access_count, size, \
-        &(rec_ref->file_rec->counters[MPIIO_ACCESS1_ACCESS]), \
-        &(rec_ref->file_rec->counters[MPIIO_ACCESS1_COUNT])); \
-    rec_ref->file_rec->counters[MPIIO_BYTES_WRITTEN] += size; \
-    rec_ref->file_rec->counters[__counter] += 1; \
-    if(rec_ref->last_io_type == DARSHAN_IO_READ) \
-        rec_ref->file_rec->counters[MPIIO_RW_SWITCHES] += 1; \
-    rec_ref->last_io_type = DARSHAN_IO_WRITE; \
-    if(rec_ref->file_rec->fcounters[MPIIO_F_WRITE_START_TIMESTAMP] == 0 || \
-     rec_ref->file_rec->fcounters[MPIIO_F_WRITE_START_TIMESTAMP] > __tm1) \
-        rec_ref->file_rec->fcounters[MPIIO_F_WRITE_START_TIMESTAMP] = __tm1; \
-    rec_ref->file_rec->fcounters[MPIIO_F_WRITE_END_TIMESTAMP] = __tm2; \
-    if(rec_ref->file_rec->fcounters[MPIIO_F_MAX_WRITE_TIME] < __elapsed) { \
-        rec_ref->file_rec->fcounters[MPIIO_F_MAX_WRITE_TIME] = __elapsed; \
-        rec_ref->file_rec->counters[MPIIO_MAX_WRITE_TIME_SIZE] = size; } \
-    DARSHAN_TIMER_INC_NO_OVERLAP(rec_ref->file_rec->fcounters[MPIIO_F_WRITE_TIME], \
-        __tm1, __tm2, rec_ref->last_write_end); \
+    DARSHAN_BUCKET_INC(&(shard->rec.counters[MPIIO_SIZE_WRITE_AGG_0_100]), size); \
+    darshan_common_val_counter(&shard->access_sketch, size); \
+    shard->rec.counters[MPIIO_BYTES_WRITTEN] += size; \
+    shard->rec.counters[__counter] += 1; \
+    if(shard->last_io_type == DARSHAN_IO_READ) \
+        shard->rec.counters[MPIIO_RW_SWITCHES] += 1; \
+    shard->last_io_type = DARSHAN_IO_WRITE; \
+    if(shard->rec.fcounters[MPIIO_F_WRITE_START_TIMESTAMP] == 0 || \
+     shard->rec.fcounters[MPIIO_F_WRITE_START_TIMESTAMP] > __tm1) \
+        shard->rec.fcounters[MPIIO_F_WRITE_START_TIMESTAMP] = __tm1; \
+    shard->rec.fcounters[MPIIO_F_WRITE_END_TIMESTAMP] = __tm2; \
+    if(shard->rec.fcounters[MPIIO_F_MAX_WRITE_TIME] < __elapsed) { \
+        shard->rec.fcounters[MPIIO_F_MAX_WRITE_TIME] = __elapsed; \
+        shard->rec.counters[MPIIO_MAX_WRITE_TIME_SIZE] = size; } \
+    DARSHAN_TIMER_INC_NO_OVERLAP(shard->rec.fcounters[MPIIO_F_WRITE_TIME], \
+        __tm1, __tm2, shard->last_write_end); \
 } while(0)
 
 /**********************************************************
@@ -342,6 +386,7 @@ int DARSHAN_DECL(MPI_File_open)(MPI_Comm comm, char *filename, int amode, MPI_In
     }
 
     MPIIO_PRE_RECORD();
+    DARSHAN_SELF_TIME(DARSHAN_MPIIO_MOD, SELF_F_REAL_TIME, tm2 - tm1);
     tmp_fh = *fh;
     MPIIO_RECORD_OPEN(ret, filename, tmp_fh, comm, amode, info, tm1, tm2);
     MPIIO_POST_RECORD();
@@ -366,9 +411,10 @@ int DARSHAN_DECL(MPI_File_read)(MPI_File fh, void *buf, int count,
     ret = __real_PMPI_File_read(fh, buf, count, datatype, status);
     tm2 = darshan_core_wtime();
 
-    MPIIO_PRE_RECORD();
+    MPIIO_PRE_RECORD_SHARDED();
+    DARSHAN_SELF_TIME(DARSHAN_MPIIO_MOD, SELF_F_REAL_TIME, tm2 - tm1);
     MPIIO_RECORD_READ(ret, fh, count, datatype, MPIIO_INDEP_READS, tm1, tm2);
-    MPIIO_POST_RECORD();
+    MPIIO_POST_RECORD_SHARDED();
 
     return(ret);
 }
@@ -392,9 +438,10 @@ int DARSHAN_DECL(MPI_File_write)(MPI_File fh, void *buf, int count,
     ret = __real_PMPI_File_write(fh, buf, count, datatype, status);
     tm2 = darshan_core_wtime();
 
-    MPIIO_PRE_RECORD();
+    MPIIO_PRE_RECORD_SHARDED();
+    DARSHAN_SELF_TIME(DARSHAN_MPIIO_MOD, SELF_F_REAL_TIME, tm2 - tm1);
     MPIIO_RECORD_WRITE(ret, fh, count, datatype, MPIIO_INDEP_WRITES, tm1, tm2);
-    MPIIO_POST_RECORD();
+    MPIIO_POST_RECORD_SHARDED();
 
     return(ret);
 }
@@ -419,9 +466,10 @@ int DARSHAN_DECL(MPI_File_read_at)(MPI_File fh, MPI_Offset offset, void *buf,
         count, datatype, status);
     tm2 = darshan_core_wtime();
 
-    MPIIO_PRE_RECORD();
+    MPIIO_PRE_RECORD_SHARDED();
+    DARSHAN_SELF_TIME(DARSHAN_MPIIO_MOD, SELF_F_REAL_TIME, tm2 - tm1);
     MPIIO_RECORD_READ(ret, fh, count, datatype, MPIIO_INDEP_READS, tm1, tm2);
-    MPIIO_POST_RECORD();
+    MPIIO_POST_RECORD_SHARDED();
 
     return(ret);
 }
@@ -446,9 +494,10 @@ int DARSHAN_DECL(MPI_File_write_at)(MPI_File fh, MPI_Offset offset, void *buf,
         count, datatype, status);
     tm2 = darshan_core_wtime();
 
-    MPIIO_PRE_RECORD();
+    MPIIO_PRE_RECORD_SHARDED();
+    DARSHAN_SELF_TIME(DARSHAN_MPIIO_MOD, SELF_F_REAL_TIME, tm2 - tm1);
     MPIIO_RECORD_WRITE(ret, fh, count, datatype, MPIIO_INDEP_WRITES, tm1, tm2);
-    MPIIO_POST_RECORD();
+    MPIIO_POST_RECORD_SHARDED();
 
     return(ret);
 }
@@ -472,9 +521,10 @@ int DARSHAN_DECL(MPI_File_read_all)(MPI_File fh, void * buf, int count, MPI_Data
         datatype, status);
     tm2 = darshan_core_wtime();
 
-    MPIIO_PRE_RECORD();
+    MPIIO_PRE_RECORD_SHARDED();
+    DARSHAN_SELF_TIME(DARSHAN_MPIIO_MOD, SELF_F_REAL_TIME, tm2 - tm1);
     MPIIO_RECORD_READ(ret, fh, count, datatype, MPIIO_COLL_READS, tm1, tm2);
-    MPIIO_POST_RECORD();
+    MPIIO_POST_RECORD_SHARDED();
 
     return(ret);
 }
@@ -497,9 +547,10 @@ int DARSHAN_DECL(MPI_File_write_all)(MPI_File fh, void * buf, int count, MPI_Dat
         datatype, status);
     tm2 = darshan_core_wtime();
 
-    MPIIO_PRE_RECORD();
+    MPIIO_PRE_RECORD_SHARDED();
+    DARSHAN_SELF_TIME(DARSHAN_MPIIO_MOD, SELF_F_REAL_TIME, tm2 - tm1);
     MPIIO_RECORD_WRITE(ret, fh, count, datatype, MPIIO_COLL_WRITES, tm1, tm2);
-    MPIIO_POST_RECORD();
+    MPIIO_POST_RECORD_SHARDED();
 
     return(ret);
 }
@@ -524,9 +575,10 @@ int DARSHAN_DECL(MPI_File_read_at_all)(MPI_File fh, MPI_Offset offset, void * bu
         count, datatype, status);
     tm2 = darshan_core_wtime();
 
-    MPIIO_PRE_RECORD();
+    MPIIO_PRE_RECORD_SHARDED();
+    DARSHAN_SELF_TIME(DARSHAN_MPIIO_MOD, SELF_F_REAL_TIME, tm2 - tm1);
     MPIIO_RECORD_READ(ret, fh, count, datatype, MPIIO_COLL_READS, tm1, tm2);
-    MPIIO_POST_RECORD();
+    MPIIO_POST_RECORD_SHARDED();
 
     return(ret);
 }
@@ -552,9 +604,10 @@ int DARSHAN_DECL(MPI_File_write_at_all)(MPI_File fh, MPI_Offset offset, void * b
         count, datatype, status);
     tm2 = darshan_core_wtime();
 
-    MPIIO_PRE_RECORD();
+    MPIIO_PRE_RECORD_SHARDED();
+    DARSHAN_SELF_TIME(DARSHAN_MPIIO_MOD, SELF_F_REAL_TIME, tm2 - tm1);
     MPIIO_RECORD_WRITE(ret, fh, count, datatype, MPIIO_COLL_WRITES, tm1, tm2);
-    MPIIO_POST_RECORD();
+    MPIIO_POST_RECORD_SHARDED();
 
     return(ret);
 }
@@ -580,9 +633,10 @@ int DARSHAN_DECL(MPI_File_read_shared)(MPI_File fh, void * buf, int count, MPI_D
         datatype, status);
     tm2 = darshan_core_wtime();
 
-    MPIIO_PRE_RECORD();
+    MPIIO_PRE_RECORD_SHARDED();
+    DARSHAN_SELF_TIME(DARSHAN_MPIIO_MOD, SELF_F_REAL_TIME, tm2 - tm1);
     MPIIO_RECORD_READ(ret, fh, count, datatype, MPIIO_INDEP_READS, tm1, tm2);
-    MPIIO_POST_RECORD();
+    MPIIO_POST_RECORD_SHARDED();
 
     return(ret);
 }
@@ -605,9 +659,10 @@ int DARSHAN_DECL(MPI_File_write_shared)(MPI_File fh, void * buf, int count, MPI_
         datatype, status);
     tm2 = darshan_core_wtime();
 
-    MPIIO_PRE_RECORD();
+    MPIIO_PRE_RECORD_SHARDED();
+    DARSHAN_SELF_TIME(DARSHAN_MPIIO_MOD, SELF_F_REAL_TIME, tm2 - tm1);
     MPIIO_RECORD_WRITE(ret, fh, count, datatype, MPIIO_INDEP_WRITES, tm1, tm2);
-    MPIIO_POST_RECORD();
+    MPIIO_POST_RECORD_SHARDED();
 
     return(ret);
 }
@@ -633,9 +688,10 @@ int DARSHAN_DECL(MPI_File_read_ordered)(MPI_File fh, void * buf, int count,
         datatype, status);
     tm2 = darshan_core_wtime();
 
-    MPIIO_PRE_RECORD();
+    MPIIO_PRE_RECORD_SHARDED();
+    DARSHAN_SELF_TIME(DARSHAN_MPIIO_MOD, SELF_F_REAL_TIME, tm2 - tm1);
     MPIIO_RECORD_READ(ret, fh, count, datatype, MPIIO_COLL_READS, tm1, tm2);
-    MPIIO_POST_RECORD();
+    MPIIO_POST_RECORD_SHARDED();
 
     return(ret);
 }
@@ -661,9 +717,10 @@ int DARSHAN_DECL(MPI_File_write_ordered)(MPI_File fh, void * buf, int count,
          datatype, status);
     tm2 = darshan_core_wtime();
 
-    MPIIO_PRE_RECORD();
+    MPIIO_PRE_RECORD_SHARDED();
+    DARSHAN_SELF_TIME(DARSHAN_MPIIO_MOD, SELF_F_REAL_TIME, tm2 - tm1);
     MPIIO_RECORD_WRITE(ret, fh, count, datatype, MPIIO_COLL_WRITES, tm1, tm2);
-    MPIIO_POST_RECORD();
+    MPIIO_POST_RECORD_SHARDED();
 
     return(ret);
 }
@@ -688,9 +745,10 @@ int DARSHAN_DECL(MPI_File_read_all_begin)(MPI_File fh, void * buf, int count, MP
     ret = __real_PMPI_File_read_all_begin(fh, buf, count, datatype);
     tm2 = darshan_core_wtime();
 
-    MPIIO_PRE_RECORD();
+    MPIIO_PRE_RECORD_SHARDED();
+    DARSHAN_SELF_TIME(DARSHAN_MPIIO_MOD, SELF_F_REAL_TIME, tm2 - tm1);
     MPIIO_RECORD_READ(ret, fh, count, datatype, MPIIO_SPLIT_READS, tm1, tm2);
-    MPIIO_POST_RECORD();
+    MPIIO_POST_RECORD_SHARDED();
 
     return(ret);
 }
@@ -712,9 +770,10 @@ int DARSHAN_DECL(MPI_File_write_all_begin)(MPI_File fh, void * buf, int count, M
     ret = __real_PMPI_File_write_all_begin(fh, buf, count, datatype);
     tm2 = darshan_core_wtime();
 
-    MPIIO_PRE_RECORD();
+    MPIIO_PRE_RECORD_SHARDED();
+    DARSHAN_SELF_TIME(DARSHAN_MPIIO_MOD, SELF_F_REAL_TIME, tm2 - tm1);
     MPIIO_RECORD_WRITE(ret, fh, count, datatype, MPIIO_SPLIT_WRITES, tm1, tm2);
-    MPIIO_POST_RECORD();
+    MPIIO_POST_RECORD_SHARDED();
 
     return(ret);
 }
@@ -739,9 +798,10 @@ int DARSHAN_DECL(MPI_File_read_at_all_begin)(MPI_File fh, MPI_Offset offset, voi
         count, datatype);
     tm2 = darshan_core_wtime();
     
-    MPIIO_PRE_RECORD();
+    MPIIO_PRE_RECORD_SHARDED();
+    DARSHAN_SELF_TIME(DARSHAN_MPIIO_MOD, SELF_F_REAL_TIME, tm2 - tm1);
     MPIIO_RECORD_READ(ret, fh, count, datatype, MPIIO_SPLIT_READS, tm1, tm2);
-    MPIIO_POST_RECORD();
+    MPIIO_POST_RECORD_SHARDED();
 
     return(ret);
 }
@@ -767,9 +827,10 @@ int DARSHAN_DECL(MPI_File_write_at_all_begin)(MPI_File fh, MPI_Offset offset, vo
         buf, count, datatype);
     tm2 = darshan_core_wtime();
 
-    MPIIO_PRE_RECORD();
+    MPIIO_PRE_RECORD_SHARDED();
+    DARSHAN_SELF_TIME(DARSHAN_MPIIO_MOD, SELF_F_REAL_TIME, tm2 - tm1);
     MPIIO_RECORD_WRITE(ret, fh, count, datatype, MPIIO_SPLIT_WRITES, tm1, tm2);
-    MPIIO_POST_RECORD();
+    MPIIO_POST_RECORD_SHARDED();
 
     return(ret);
 }
@@ -793,9 +854,10 @@ int DARSHAN_DECL(MPI_File_read_ordered_begin)(MPI_File fh, void * buf, int count
         datatype);
     tm2 = darshan_core_wtime();
 
-    MPIIO_PRE_RECORD();
+    MPIIO_PRE_RECORD_SHARDED();
+    DARSHAN_SELF_TIME(DARSHAN_MPIIO_MOD, SELF_F_REAL_TIME, tm2 - tm1);
     MPIIO_RECORD_READ(ret, fh, count, datatype, MPIIO_SPLIT_READS, tm1, tm2);
-    MPIIO_POST_RECORD();
+    MPIIO_POST_RECORD_SHARDED();
 
     return(ret);
 }
@@ -818,9 +880,10 @@ int DARSHAN_DECL(MPI_File_write_ordered_begin)(MPI_File fh, void * buf, int coun
         datatype);
     tm2 = darshan_core_wtime();
 
-    MPIIO_PRE_RECORD();
+    MPIIO_PRE_RECORD_SHARDED();
+    DARSHAN_SELF_TIME(DARSHAN_MPIIO_MOD, SELF_F_REAL_TIME, tm2 - tm1);
     MPIIO_RECORD_WRITE(ret, fh, count, datatype, MPIIO_SPLIT_WRITES, tm1, tm2);
-    MPIIO_POST_RECORD();
+    MPIIO_POST_RECORD_SHARDED();
 
     return(ret);
 }
@@ -843,9 +906,10 @@ int DARSHAN_DECL(MPI_File_iread)(MPI_File fh, void * buf, int count, MPI_Datatyp
     ret = __real_PMPI_File_iread(fh, buf, count, datatype, request);
     tm2 = darshan_core_wtime();
 
-    MPIIO_PRE_RECORD();
+    MPIIO_PRE_RECORD_SHARDED();
+    DARSHAN_SELF_TIME(DARSHAN_MPIIO_MOD, SELF_F_REAL_TIME, tm2 - tm1);
     MPIIO_RECORD_READ(ret, fh, count, datatype, MPIIO_NB_READS, tm1, tm2);
-    MPIIO_POST_RECORD();
+    MPIIO_POST_RECORD_SHARDED();
 
     return(ret);
 }
@@ -869,9 +933,10 @@ int DARSHAN_DECL(MPI_File_iwrite)(MPI_File fh, void * buf, int count,
     ret = __real_PMPI_File_iwrite(fh, buf, count, datatype, request);
     tm2 = darshan_core_wtime();
 
-    MPIIO_PRE_RECORD();
+    MPIIO_PRE_RECORD_SHARDED();
+    DARSHAN_SELF_TIME(DARSHAN_MPIIO_MOD, SELF_F_REAL_TIME, tm2 - tm1);
     MPIIO_RECORD_WRITE(ret, fh, count, datatype, MPIIO_NB_WRITES, tm1, tm2);
-    MPIIO_POST_RECORD();
+    MPIIO_POST_RECORD_SHARDED();
 
     return(ret);
 }
@@ -898,9 +963,10 @@ int DARSHAN_DECL(MPI_File_iread_at)(MPI_File fh, MPI_Offset offset, void * buf,
         datatype, request);
     tm2 = darshan_core_wtime();
 
-    MPIIO_PRE_RECORD();
+    MPIIO_PRE_RECORD_SHARDED();
+    DARSHAN_SELF_TIME(DARSHAN_MPIIO_MOD, SELF_F_REAL_TIME, tm2 - tm1);
     MPIIO_RECORD_READ(ret, fh, count, datatype, MPIIO_NB_READS, tm1, tm2);
-    MPIIO_POST_RECORD();
+    MPIIO_POST_RECORD_SHARDED();
 
     return(ret);
 }
@@ -926,9 +992,10 @@ int DARSHAN_DECL(MPI_File_iwrite_at)(MPI_File fh, MPI_Offset offset, void * buf,
         count, datatype, request);
     tm2 = darshan_core_wtime();
 
-    MPIIO_PRE_RECORD();
+    MPIIO_PRE_RECORD_SHARDED();
+    DARSHAN_SELF_TIME(DARSHAN_MPIIO_MOD, SELF_F_REAL_TIME, tm2 - tm1);
     MPIIO_RECORD_WRITE(ret, fh, count, datatype, MPIIO_NB_WRITES, tm1, tm2);
-    MPIIO_POST_RECORD();
+    MPIIO_POST_RECORD_SHARDED();
 
     return(ret);
 }
@@ -955,9 +1022,10 @@ int DARSHAN_DECL(MPI_File_iread_shared)(MPI_File fh, void * buf, int count,
         datatype, request);
     tm2 = darshan_core_wtime();
 
-    MPIIO_PRE_RECORD();
+    MPIIO_PRE_RECORD_SHARDED();
+    DARSHAN_SELF_TIME(DARSHAN_MPIIO_MOD, SELF_F_REAL_TIME, tm2 - tm1);
     MPIIO_RECORD_READ(ret, fh, count, datatype, MPIIO_NB_READS, tm1, tm2);
-    MPIIO_POST_RECORD();
+    MPIIO_POST_RECORD_SHARDED();
 
     return(ret);
 }
@@ -983,9 +1051,10 @@ int DARSHAN_DECL(MPI_File_iwrite_shared)(MPI_File fh, void * buf, int count,
         datatype, request);
     tm2 = darshan_core_wtime();
 
-    MPIIO_PRE_RECORD();
+    MPIIO_PRE_RECORD_SHARDED();
+    DARSHAN_SELF_TIME(DARSHAN_MPIIO_MOD, SELF_F_REAL_TIME, tm2 - tm1);
     MPIIO_RECORD_WRITE(ret, fh, count, datatype, MPIIO_NB_WRITES, tm1, tm2);
-    MPIIO_POST_RECORD();
+    MPIIO_POST_RECORD_SHARDED();
 
     return(ret);
 }
@@ -1014,6 +1083,7 @@ int DARSHAN_DECL(MPI_File_sync)(MPI_File fh)
     if(ret == MPI_SUCCESS)
     {
         MPIIO_PRE_RECORD();
+        DARSHAN_SELF_TIME(DARSHAN_MPIIO_MOD, SELF_F_REAL_TIME, tm2 - tm1);
         rec_ref = darshan_lookup_record_ref(mpiio_runtime->fh_hash,
             &fh, sizeof(MPI_File));
         if(rec_ref)
@@ -1052,6 +1122,7 @@ int DARSHAN_DECL(MPI_File_set_view)(MPI_File fh, MPI_Offset disp, MPI_Datatype e
     if(ret == MPI_SUCCESS)
     {
         MPIIO_PRE_RECORD();
+        DARSHAN_SELF_TIME(DARSHAN_MPIIO_MOD, SELF_F_REAL_TIME, tm2 - tm1);
         rec_ref = darshan_lookup_record_ref(mpiio_runtime->fh_hash,
             &fh, sizeof(MPI_File));
         if(rec_ref)
@@ -1092,6 +1163,7 @@ int DARSHAN_DECL(MPI_File_close)(MPI_File *fh)
     tm2 = darshan_core_wtime();
 
     MPIIO_PRE_RECORD();
+    DARSHAN_SELF_TIME(DARSHAN_MPIIO_MOD, SELF_F_REAL_TIME, tm2 - tm1);
     rec_ref = darshan_lookup_record_ref(mpiio_runtime->fh_hash,
         &tmp_fh, sizeof(MPI_File));
     if(rec_ref)
@@ -1105,6 +1177,7 @@ int DARSHAN_DECL(MPI_File_close)(MPI_File *fh)
             tm1, tm2, rec_ref->last_meta_end);
         darshan_delete_record_ref(&(mpiio_runtime->fh_hash),
             &tmp_fh, sizeof(MPI_File));
+        darshan_shards_invalidate(&mpiio_shards, mpiio_fh_handle(tmp_fh));
     }
     MPIIO_POST_RECORD();
 
@@ -1203,12 +1276,121 @@ static struct mpiio_file_record_ref *mpiio_track_new_file_record(
     return(rec_ref);
 }
 
-static void mpiio_finalize_file_records(void *rec_ref_p)
+/* convert an MPI file handle to a key for the per-thread handle cache */
+static uint64_t mpiio_fh_handle(MPI_File fh)
+{
+    uint64_t handle = 0;
+
+    memcpy(&handle, &fh, (sizeof(fh) < sizeof(handle)) ? sizeof(fh) : sizeof(handle));
+    return(handle);
+}
+
+/* find the calling thread's counter shard for the file record associated
+ * with the given file handle, only acquiring the MPIIO lock the first time
+ * this thread sees the handle
+ */
+static struct mpiio_file_shard *mpiio_lookup_shard(MPI_File fh)
+{
+    struct mpiio_file_record_ref *rec_ref = NULL;
+    struct mpiio_file_shard *shard;
+    uint64_t gen;
+
+    if(darshan_shards_lookup(&mpiio_shards, mpiio_thread_shards,
+        mpiio_fh_handle(fh), (void **)&shard))
+        return(shard);
+
+    MPIIO_LOCK();
+    gen = darshan_shards_gen(&mpiio_shards, mpiio_fh_handle(fh));
+    if(mpiio_runtime)
+        rec_ref = darshan_lookup_record_ref(mpiio_runtime->fh_hash,
+            &fh, sizeof(MPI_File));
+    shard = darshan_shards_fill(&mpiio_shards, mpiio_thread_shards,
+        mpiio_fh_handle(fh), gen, rec_ref);
+    MPIIO_UNLOCK();
+
+    return(shard);
+}
+
+/* store the most common access sizes of a file in its record */
+static void mpiio_record_common_vals(void *rec_ref_p)
 {
     struct mpiio_file_record_ref *rec_ref =
         (struct mpiio_file_record_ref *)rec_ref_p;
 
-    tdestroy(rec_ref->access_root, free);
+    darshan_common_val_sketch_top(&rec_ref->access_sketch,
+        &(rec_ref->file_rec->counters[MPIIO_ACCESS1_ACCESS]),
+        &(rec_ref->file_rec->counters[MPIIO_ACCESS1_COUNT]));
+
+    return;
+}
+
+/* fold a thread's counter shard back into the corresponding file record */
+static void mpiio_merge_file_shard(void *shard_p)
+{
+    struct mpiio_file_shard *shard = (struct mpiio_file_shard *)shard_p;
+    struct darshan_mpiio_file *file_rec = shard->rec_ref->file_rec;
+    struct darshan_mpiio_file *shard_rec = &shard->rec;
+    int i;
+
+    /* sum */
+    for(i=MPIIO_INDEP_READS; i<=MPIIO_NB_WRITES; i++)
+        file_rec->counters[i] += shard_rec->counters[i];
+    for(i=MPIIO_BYTES_READ; i<=MPIIO_RW_SWITCHES; i++)
+        file_rec->counters[i] += shard_rec->counters[i];
+    for(i=MPIIO_SIZE_READ_AGG_0_100; i<=MPIIO_SIZE_WRITE_AGG_1G_PLUS; i++)
+        file_rec->counters[i] += shard_rec->counters[i];
+
+    darshan_common_val_sketch_merge(&shard->access_sketch,
+        &shard->rec_ref->access_sketch);
+
+    /* min non-zero (if available) value */
+    for(i=MPIIO_F_READ_START_TIMESTAMP; i<=MPIIO_F_WRITE_START_TIMESTAMP; i++)
+    {
+        if(shard_rec->fcounters[i] > 0 && (file_rec->fcounters[i] == 0 ||
+           shard_rec->fcounters[i] < file_rec->fcounters[i]))
+            file_rec->fcounters[i] = shard_rec->fcounters[i];
+    }
+
+    /* max */
+    for(i=MPIIO_F_READ_END_TIMESTAMP; i<=MPIIO_F_WRITE_END_TIMESTAMP; i++)
+    {
+        if(shard_rec->fcounters[i] > file_rec->fcounters[i])
+            file_rec->fcounters[i] = shard_rec->fcounters[i];
+    }
+
+    /* sum */
+    for(i=MPIIO_F_READ_TIME; i<=MPIIO_F_WRITE_TIME; i++)
+        file_rec->fcounters[i] += shard_rec->fcounters[i];
+
+    /* max (special case) */
+    if(shard_rec->fcounters[MPIIO_F_MAX_READ_TIME] >
+        file_rec->fcounters[MPIIO_F_MAX_READ_TIME])
+    {
+        file_rec->fcounters[MPIIO_F_MAX_READ_TIME] =
+            shard_rec->fcounters[MPIIO_F_MAX_READ_TIME];
+        file_rec->counters[MPIIO_MAX_READ_TIME_SIZE] =
+            shard_rec->counters[MPIIO_MAX_READ_TIME_SIZE];
+    }
+    if(shard_rec->fcounters[MPIIO_F_MAX_WRITE_TIME] >
+        file_rec->fcounters[MPIIO_F_MAX_WRITE_TIME])
+    {
+        file_rec->fcounters[MPIIO_F_MAX_WRITE_TIME] =
+            shard_rec->fcounters[MPIIO_F_MAX_WRITE_TIME];
+        file_rec->counters[MPIIO_MAX_WRITE_TIME_SIZE] =
+            shard_rec->counters[MPIIO_MAX_WRITE_TIME_SIZE];
+    }
+
+    return;
+}
+
+/* fold the shards of an exiting thread back into their file records */
+static void mpiio_thread_exit(struct darshan_thread_shards *shards)
+{
+    MPIIO_LOCK();
+    darshan_shards_release(&mpiio_shards, shards, NULL,
+        mpiio_runtime ? &mpiio_merge_file_shard : NULL);
+    MPIIO_UNLOCK();
+
     return;
 }
 
@@ -1487,6 +1669,7 @@ static void mpiio_shared_record_variance(MPI_Comm mod_comm,
 
 static void mpiio_cleanup_runtime()
 {
+    darshan_shards_clear(&mpiio_shards);
     darshan_clear_record_refs(&(mpiio_runtime->fh_hash), 0);
     darshan_clear_record_refs(&(mpiio_runtime->rec_id_hash), 1);
 
@@ -1496,8 +1679,11 @@ static void mpiio_cleanup_runtime()
     return;
 }
 
+/* number of distinct access sizes used by the shutdown benchmark */
+#define MPIIO_BENCH_SIZE_COUNT 32
+
 /* mpiio module shutdown benchmark routine */
-void darshan_mpiio_shutdown_bench_setup(int test_case)
+void darshan_mpiio_shutdown_bench_setup(int test_case, int file_count)
 {
     char filepath[256];
     MPI_File *fh_array;
@@ -1511,15 +1697,23 @@ void darshan_mpiio_shutdown_bench_setup(int test_case)
     mpiio_runtime_initialize();
 
     srand(my_rank);
-    fh_array = malloc(1024 * sizeof(MPI_File));
-    size_array = malloc(DARSHAN_COMMON_VAL_MAX_RUNTIME_COUNT * sizeof(int64_t));
+    fh_array = malloc(file_count * sizeof(MPI_File));
+    size_array = malloc(MPIIO_BENCH_SIZE_COUNT * sizeof(int64_t));
     assert(fh_array && size_array);
 
-    for(j = 0; j < 1024; j++)
+    for(j = 0; j < file_count; j++)
         fh_array[j] = (MPI_File)j;
-    for(i = 0; i < DARSHAN_COMMON_VAL_MAX_RUNTIME_COUNT; i++)
+    for(i = 0; i < MPIIO_BENCH_SIZE_COUNT; i++)
         size_array[i] = rand();
 
+    /* writes are recorded in this thread's counter shards */
+    if(!darshan_shards_enter(&mpiio_shards, &mpiio_thread_shards))
+    {
+        free(fh_array);
+        free(size_array);
+        return;
+    }
+
     switch(test_case)
     {
         case 1: /* single file-per-process */
@@ -1540,36 +1734,37 @@ void darshan_mpiio_shutdown_bench_setup(int test_case)
                 MPIIO_COLL_WRITES, 1, 2);
 
             break;
-        case 3: /* 1024 unique files per proc */
-            for(i = 0; i < 1024; i++)
+        case 3: /* file_count unique files per proc */
+            for(i = 0; i < file_count; i++)
             {
                 snprintf(filepath, 256, "fpp-%d_rank-%d", i , my_rank);
 
                 MPIIO_RECORD_OPEN(MPI_SUCCESS, filepath, fh_array[i], MPI_COMM_SELF,
                     2, MPI_INFO_NULL, 0, 1);
                 MPIIO_RECORD_WRITE(MPI_SUCCESS, fh_array[i],
-                    size_array[i % DARSHAN_COMMON_VAL_MAX_RUNTIME_COUNT],
+                    size_array[i % MPIIO_BENCH_SIZE_COUNT],
                     MPI_BYTE, MPIIO_INDEP_WRITES, 1, 2);
             }
 
             break;
-        case 4: /* 1024 shared files per proc */
-            for(i = 0; i < 1024; i++)
+        case 4: /* file_count shared files per proc */
+            for(i = 0; i < file_count; i++)
             {
                 snprintf(filepath, 256, "shared-%d", i);
 
                 MPIIO_RECORD_OPEN(MPI_SUCCESS, filepath, fh_array[i], MPI_COMM_WORLD,
                     2, MPI_INFO_NULL, 0, 1);
                 MPIIO_RECORD_WRITE(MPI_SUCCESS, fh_array[i],
-                    size_array[i % DARSHAN_COMMON_VAL_MAX_RUNTIME_COUNT],
+                    size_array[i % MPIIO_BENCH_SIZE_COUNT],
                     MPI_BYTE, MPIIO_COLL_WRITES, 1, 2);
             }
             break;
         default:
             fprintf(stderr, "Error: invalid Darshan benchmark test case.\n");
-            return;
+            break;
     }
 
+    darshan_shards_exit(mpiio_thread_shards);
     free(fh_array);
     free(size_array);
 
@@ -1695,13 +1890,18 @@ static void mpiio_shutdown(
     void **mpiio_buf,
     int *mpiio_buf_sz)
 {
+    /* wait for in-flight reads/writes before taking the MPIIO lock */
+    darshan_shards_quiesce(&mpiio_shards);
+
     MPIIO_LOCK();
     assert(mpiio_runtime);
 
-    /* perform any final transformations on MPIIO file records before
-     * writing them out to log file
+    /* fold per-thread read/write counters back into MPIIO file records
+     * before writing them out to log file
      */
-    darshan_iter_record_refs(mpiio_runtime->rec_id_hash, &mpiio_finalize_file_records);
+    darshan_shards_iter(&mpiio_shards, &mpiio_merge_file_shard);
+    darshan_iter_record_refs(mpiio_runtime->rec_id_hash,
+        &mpiio_record_common_vals);
 
     /* if there are globally shared files, do a shared file reduction */
     mpiio_reduce_records(mod_comm, shared_recs, shared_rec_count, mpiio_buf, mpiio_buf_sz);
@@ -104,7 +104,7 @@ static pthread_mutex_t null_runtime_mutex = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_
 static int my_rank = -1;
 
 /* macros for obtaining/releasing the "NULL" module lock */
-#define NULL_LOCK() pthread_mutex_lock(&null_runtime_mutex)
+#define NULL_LOCK() DARSHAN_SELF_LOCK(&null_runtime_mutex, DARSHAN_NULL_MOD)
 #define NULL_UNLOCK() pthread_mutex_unlock(&null_runtime_mutex)
 
 /* the NULL_PRE_RECORD macro is executed before performing NULL
@@ -113,12 +113,14 @@ static int my_rank = -1;
  * initialized before instrumenting.
  */
 #define NULL_PRE_RECORD() do { \
+    DARSHAN_SELF_ENTER(DARSHAN_NULL_MOD); \
     NULL_LOCK(); \
     if(!darshan_core_disabled_instrumentation()) { \
         if(!null_runtime) null_runtime_initialize(); \
         if(null_runtime) break; \
     } \
     NULL_UNLOCK(); \
+    DARSHAN_SELF_EXIT(DARSHAN_NULL_MOD); \
     return(ret); \
 } while(0)
 
@@ -127,6 +129,7 @@ static int my_rank = -1;
  */
 #define NULL_POST_RECORD() do { \
     NULL_UNLOCK(); \
+    DARSHAN_SELF_EXIT(DARSHAN_NULL_MOD); \
 } while(0)
 
 /* macro for instrumenting the "NULL" module's foo function */
@@ -60,21 +60,24 @@ static struct pnetcdf_runtime *pnetcdf_runtime = NULL;
 static pthread_mutex_t pnetcdf_runtime_mutex = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
 static int my_rank = -1;
 
-#define PNETCDF_LOCK() pthread_mutex_lock(&pnetcdf_runtime_mutex)
+#define PNETCDF_LOCK() DARSHAN_SELF_LOCK(&pnetcdf_runtime_mutex, DARSHAN_PNETCDF_MOD)
 #define PNETCDF_UNLOCK() pthread_mutex_unlock(&pnetcdf_runtime_mutex)
 
 #define PNETCDF_PRE_RECORD() do { \
+    DARSHAN_SELF_ENTER(DARSHAN_PNETCDF_MOD); \
     PNETCDF_LOCK(); \
     if(!darshan_core_disabled_instrumentation()) { \
         if(!pnetcdf_runtime) pnetcdf_runtime_initialize(); \
         if(pnetcdf_runtime) break; \
     } \
     PNETCDF_UNLOCK(); \
+    DARSHAN_SELF_EXIT(DARSHAN_PNETCDF_MOD); \
     return(ret); \
 } while(0)
 
 #define PNETCDF_POST_RECORD() do { \
     PNETCDF_UNLOCK(); \
+    DARSHAN_SELF_EXIT(DARSHAN_PNETCDF_MOD); \
 } while(0)
 
 #define PNETCDF_RECORD_OPEN(__ncidp, __path, __comm, __tm1, __tm2) do { \
@@ -84,7 +87,7 @@ static int my_rank = -1;
     int comm_size; \
     newpath = darshan_clean_file_path(__path); \
     if(!newpath) newpath = (char *)__path; \
-    if(darshan_core_excluded_path(newpath)) { \
+    if(darshan_core_excluded_path(DARSHAN_PNETCDF_MOD, newpath)) { \
         if(newpath != __path) free(newpath); \
         break; \
     } \
@@ -135,6 +138,7 @@ int DARSHAN_DECL(ncmpi_create)(MPI_Comm comm, const char *path,
         }
 
         PNETCDF_PRE_RECORD();
+        DARSHAN_SELF_TIME(DARSHAN_PNETCDF_MOD, SELF_F_REAL_TIME, tm2 - tm1);
         PNETCDF_RECORD_OPEN(ncidp, path, comm, tm1, tm2);
         PNETCDF_POST_RECORD();
     }
@@ -167,6 +171,7 @@ int DARSHAN_DECL(ncmpi_open)(MPI_Comm comm, const char *path,
         }
 
         PNETCDF_PRE_RECORD();
+        DARSHAN_SELF_TIME(DARSHAN_PNETCDF_MOD, SELF_F_REAL_TIME, tm2 - tm1);
         PNETCDF_RECORD_OPEN(ncidp, path, comm, tm1, tm2);
         PNETCDF_POST_RECORD();
     }
@@ -187,6 +192,7 @@ int DARSHAN_DECL(ncmpi_close)(int ncid)
     tm2 = darshan_core_wtime();
 
     PNETCDF_PRE_RECORD();
+    DARSHAN_SELF_TIME(DARSHAN_PNETCDF_MOD, SELF_F_REAL_TIME, tm2 - tm1);
     rec_ref = darshan_lookup_record_ref(pnetcdf_runtime->ncid_hash,
         &ncid, sizeof(int));
     if(rec_ref)
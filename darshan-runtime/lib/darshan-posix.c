@@ -25,6 +25,7 @@
 #include <libgen.h>
 #include <aio.h>
 #include <pthread.h>
+#include <limits.h>
 
 #include "utlist.h"
 #include "darshan.h"
@@ -73,6 +74,9 @@ DARSHAN_FORWARD_DECL(__fxstat64, int, (int vers, int fd, struct stat64 *buf));
 #ifdef DARSHAN_WRAP_MMAP
 DARSHAN_FORWARD_DECL(mmap, void*, (void *addr, size_t length, int prot, int flags, int fd, off_t offset));
 DARSHAN_FORWARD_DECL(mmap64, void*, (void *addr, size_t length, int prot, int flags, int fd, off64_t offset));
+DARSHAN_FORWARD_DECL(munmap, int, (void *addr, size_t length));
+DARSHAN_FORWARD_DECL(msync, int, (void *addr, size_t length, int flags));
+DARSHAN_FORWARD_DECL(madvise, int, (void *addr, size_t length, int advice));
 #endif /* DARSHAN_WRAP_MMAP */
 DARSHAN_FORWARD_DECL(fsync, int, (int fd));
 DARSHAN_FORWARD_DECL(fdatasync, int, (int fd));
@@ -86,6 +90,8 @@ DARSHAN_FORWARD_DECL(aio_return64, ssize_t, (struct aiocb64 *aiocbp));
 DARSHAN_FORWARD_DECL(lio_listio, int, (int mode, struct aiocb *const aiocb_list[], int nitems, struct sigevent *sevp));
 DARSHAN_FORWARD_DECL(lio_listio64, int, (int mode, struct aiocb64 *const aiocb_list[], int nitems, struct sigevent *sevp));
 DARSHAN_FORWARD_DECL(rename, int, (const char *oldpath, const char *newpath));
+DARSHAN_FORWARD_DECL(chdir, int, (const char *path));
+DARSHAN_FORWARD_DECL(fchdir, int, (int fd));
 
 /* The posix_file_record_ref structure maintains necessary runtime metadata
  * for the POSIX file record (darshan_posix_file structure, defined in
@@ -113,18 +119,38 @@ struct posix_file_record_ref
 {
     struct darshan_posix_file *file_rec;
     int64_t offset;
+    int io_session;
+    double last_meta_end;
+    double last_write_end;
+    struct posix_aio_tracker* aio_list;
+    int fs_type; /* same as darshan_fs_info->fs_type */
+    /* common access sizes and strides, merged from all shards at shutdown */
+    struct darshan_common_val_sketch access_sketch;
+    struct darshan_common_val_sketch stride_sketch;
+};
+
+/* The posix_file_shard structure holds the read/write counters a single
+ * thread accumulates for a POSIX file record, along with the access pattern
+ * state used to derive them. Shards are only touched by their owning thread
+ * until they are merged into the file record at shutdown time, which allows
+ * read and write wrappers to record I/O without acquiring the POSIX lock.
+ *
+ * NOTE: 'io_session' mirrors the counter of the same name in the record
+ * reference, which is bumped whenever the file is (re)opened or closed, so
+ * that each thread knows to reset its last byte offsets.
+ */
+struct posix_file_shard
+{
+    struct posix_file_record_ref *rec_ref;
+    struct darshan_posix_file rec;
+    int io_session;
     int64_t last_byte_read;
     int64_t last_byte_written;
     enum darshan_io_type last_io_type;
-    double last_meta_end;
     double last_read_end;
     double last_write_end;
-    void *access_root;
-    int access_count;
-    void *stride_root;
-    int stride_count;
-    struct posix_aio_tracker* aio_list;
-    int fs_type; /* same as darshan_fs_info->fs_type */
+    struct darshan_common_val_sketch access_sketch;
+    struct darshan_common_val_sketch stride_sketch;
 };
 
 /* The posix_runtime structure maintains necessary state for storing
@@ -134,7 +160,7 @@ struct posix_file_record_ref
 struct posix_runtime
 {
     void *rec_id_hash;
-    void *fd_hash;
+    struct darshan_fd_table fd_table;
     int file_rec_count;
 };
 
@@ -146,6 +172,26 @@ struct posix_aio_tracker
     struct posix_aio_tracker *next;
 };
 
+/* struct to track a mapping of a file into memory until it is unmapped.
+ * The bytes accessed through the mapping are estimated from how many of
+ * its pages are resident (according to mincore) when it is sampled, which
+ * happens when the mapping is synced, unmapped, or has pages dropped with
+ * madvise, when the file is closed, and at shutdown. 'base' is the number
+ * of bytes resident when the mapping was created (or last changed), and
+ * 'read'/'written' are the bytes already added to the file's counters.
+ */
+struct posix_mmap_tracker
+{
+    char *addr;
+    size_t length;
+    int shared_write;
+    int64_t base;
+    int64_t read;
+    int64_t written;
+    struct posix_file_record_ref *rec_ref;
+    struct posix_mmap_tracker *next;
+};
+
 static void posix_runtime_initialize(
     void);
 static struct posix_file_record_ref *posix_track_new_file_record(
@@ -154,8 +200,35 @@ static void posix_aio_tracker_add(
     int fd, void *aiocbp);
 static struct posix_aio_tracker* posix_aio_tracker_del(
     int fd, void *aiocbp);
-static void posix_finalize_file_records(
+#ifdef DARSHAN_WRAP_MMAP
+static void posix_mmap_tracker_add(
+    struct posix_file_record_ref *rec_ref, void *addr, size_t length,
+    int prot, int flags);
+static void posix_mmap_tracker_unmap(
+    void *addr, size_t length);
+static void posix_mmap_tracker_sample(
+    struct posix_mmap_tracker *tracker);
+static void posix_mmap_tracker_rebase(
+    struct posix_mmap_tracker *tracker);
+static int64_t posix_mmap_resident_bytes(
+    char *addr, size_t length);
+static int posix_mmap_tracker_overlaps(
+    struct posix_mmap_tracker *tracker, void *addr, size_t length);
+#endif
+static struct posix_file_shard *posix_lookup_shard(
+    int fd);
+static void posix_merge_file_shard(
+    void *shard_p);
+static void posix_thread_exit(
+    struct darshan_thread_shards *shards);
+static void posix_fold_file_shard(
+    struct darshan_posix_file *file_rec, struct darshan_posix_file *shard_rec);
+static void posix_snapshot_file_shard(
+    void *shard_p);
+static void posix_record_common_vals(
     void *rec_ref_p);
+static void posix_apply_event(
+    struct darshan_shard_event *event);
 
 #ifdef HAVE_MPI
 static void posix_record_reduction_op(
@@ -170,6 +243,8 @@ static void posix_cleanup_runtime(
 static void posix_shutdown(
     void *mod_comm, darshan_record_id *shared_recs,
     int shared_rec_count, void **posix_buf, int *posix_buf_sz);
+static void posix_snapshot(
+    void **posix_buf, int *posix_buf_sz, int *posix_partial);
 
 /* extern DXT function defs */
 extern void dxt_posix_write(darshan_record_id rec_id, int64_t offset,
@@ -180,16 +255,49 @@ extern void dxt_posix_read(darshan_record_id rec_id, int64_t offset,
 /* extern function def for querying record name from a STDIO stream */
 extern char *darshan_stdio_lookup_record_name(FILE *stream);
 
+#ifdef DARSHAN_IOURING
+/* extern function def for dropping io_uring module state tied to a closed
+ * file descriptor; weak so that static links only pull in the io_uring
+ * module if the application uses io_uring
+ */
+extern void darshan_iouring_close_fd(int fd) __attribute__((weak));
+#endif
+
 static struct posix_runtime *posix_runtime = NULL;
 static pthread_mutex_t posix_runtime_mutex = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
 static int my_rank = -1;
 static int darshan_mem_alignment = 1;
 static int enable_dxt_io_trace = 0;
+/* file mappings (and the MMAP_BYTES_READ/WRITTEN counters they update) are
+ * protected by their own lock, since munmap may be called by darshan-core
+ * while it holds its lock. The POSIX lock may be held when acquiring the
+ * mmap lock, but not the other way around. The
+ * number of tracked mappings is read without the lock, so that munmap,
+ * msync and madvise calls on other memory can skip it.
+ */
+static struct posix_mmap_tracker *posix_mmap_list = NULL;
+static int posix_mmap_count = 0;
+static pthread_mutex_t posix_mmap_mutex = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+static struct darshan_shard_registry posix_shards =
+    DARSHAN_SHARD_REGISTRY_INITIALIZER(sizeof(struct posix_file_shard),
+        &posix_thread_exit);
+static __thread struct darshan_thread_shards *posix_thread_shards = NULL;
+
+/* source and destination record buffers of an in-progress snapshot,
+ * protected by the POSIX lock
+ */
+static char *posix_snapshot_src = NULL;
+static char *posix_snapshot_dst = NULL;
+static int posix_snapshot_len = 0;
 
-#define POSIX_LOCK() pthread_mutex_lock(&posix_runtime_mutex)
+#define POSIX_LOCK() DARSHAN_SELF_LOCK(&posix_runtime_mutex, DARSHAN_POSIX_MOD)
 #define POSIX_UNLOCK() pthread_mutex_unlock(&posix_runtime_mutex)
 
+#define POSIX_MMAP_LOCK() DARSHAN_SELF_LOCK(&posix_mmap_mutex, DARSHAN_POSIX_MOD)
+#define POSIX_MMAP_UNLOCK() pthread_mutex_unlock(&posix_mmap_mutex)
+
 #define POSIX_PRE_RECORD() do { \
+    DARSHAN_SELF_ENTER(DARSHAN_POSIX_MOD); \
     POSIX_LOCK(); \
     if(!darshan_core_disabled_instrumentation()) { \
         if(!posix_runtime) { \
@@ -198,34 +306,47 @@ static int enable_dxt_io_trace = 0;
         if(posix_runtime) break; \
     } \
     POSIX_UNLOCK(); \
+    DARSHAN_SELF_EXIT(DARSHAN_POSIX_MOD); \
     return(ret); \
 } while(0)
 
 #define POSIX_POST_RECORD() do { \
     POSIX_UNLOCK(); \
+    DARSHAN_SELF_EXIT(DARSHAN_POSIX_MOD); \
+} while(0)
+
+/* read and write wrappers only update per-thread counter shards, so they
+ * use these variants which do not acquire the POSIX lock
+ */
+#define POSIX_PRE_RECORD_SHARDED() do { \
+    DARSHAN_SELF_ENTER(DARSHAN_POSIX_MOD); \
+    if(darshan_shards_enter(&posix_shards, &posix_thread_shards)) break; \
+    DARSHAN_SELF_EXIT(DARSHAN_POSIX_MOD); \
+    return(ret); \
+} while(0)
+
+#define POSIX_POST_RECORD_SHARDED() do { \
+    darshan_shards_exit(posix_thread_shards); \
+    DARSHAN_SELF_EXIT(DARSHAN_POSIX_MOD); \
 } while(0)
 
 #define POSIX_RECORD_OPEN(__ret, __path, __mode, __tm1, __tm2) do { \
     darshan_record_id __rec_id; \
     struct posix_file_record_ref *__rec_ref; \
+    char __pathbuf[PATH_MAX]; \
     char *__newpath; \
     if(__ret < 0) break; \
-    __newpath = darshan_clean_file_path(__path); \
-    if(!__newpath) __newpath = (char *)__path; \
-    if(darshan_core_excluded_path(__newpath)) { \
-        if(__newpath != __path) free(__newpath); \
-        break; \
+    __newpath = darshan_clean_file_path_id(__path, __pathbuf, &__rec_id); \
+    if(!__newpath) { \
+        __newpath = (char *)__path; \
+        __rec_id = darshan_core_gen_record_id(__newpath); \
     } \
-    __rec_id = darshan_core_gen_record_id(__newpath); \
+    if(darshan_core_excluded_path(DARSHAN_POSIX_MOD, __newpath)) break; \
     __rec_ref = darshan_lookup_record_ref(posix_runtime->rec_id_hash, &__rec_id, sizeof(darshan_record_id)); \
     if(!__rec_ref) __rec_ref = posix_track_new_file_record(__rec_id, __newpath); \
-    if(!__rec_ref) { \
-        if(__newpath != __path) free(__newpath); \
-        break; \
-    } \
+    if(!__rec_ref) break; \
     _POSIX_RECORD_OPEN(__ret, __rec_ref, __mode, __tm1, __tm2, 1, -1); \
     darshan_instrument_fs_data(__rec_ref->fs_type, __newpath, __ret); \
-    if(__newpath != __path) free(__newpath); \
 } while(0)
 
 #define POSIX_RECORD_REFOPEN(__ret, __rec_ref, __tm1, __tm2, __ref_counter) do { \
@@ -236,9 +357,8 @@ static int enable_dxt_io_trace = 0;
 #define _POSIX_RECORD_OPEN(__ret, __rec_ref, __mode, __tm1, __tm2, __reset_flag, __ref_counter) do { \
     if(__mode) __rec_ref->file_rec->counters[POSIX_MODE] = __mode; \
     if(__reset_flag) { \
-        __rec_ref->offset = 0; \
-        __rec_ref->last_byte_written = 0; \
-        __rec_ref->last_byte_read = 0; \
+        __atomic_store_n(&__rec_ref->offset, 0, __ATOMIC_RELAXED); \
+        __atomic_add_fetch(&__rec_ref->io_session, 1, __ATOMIC_RELAXED); \
     } \
     __rec_ref->file_rec->counters[POSIX_OPENS] += 1; \
     if(__ref_counter >= 0) __rec_ref->file_rec->counters[__ref_counter] += 1; \
@@ -248,138 +368,60 @@ static int enable_dxt_io_trace = 0;
     __rec_ref->file_rec->fcounters[POSIX_F_OPEN_END_TIMESTAMP] = __tm2; \
     DARSHAN_TIMER_INC_NO_OVERLAP(__rec_ref->file_rec->fcounters[POSIX_F_META_TIME], \
         __tm1, __tm2, __rec_ref->last_meta_end); \
-    darshan_add_record_ref(&(posix_runtime->fd_hash), &__ret, sizeof(int), __rec_ref); \
+    darshan_add_fd_ref(&(posix_runtime->fd_table), __ret, __rec_ref); \
+    darshan_shards_invalidate(&posix_shards, (uint64_t)__ret); \
 } while(0)
 
-#define POSIX_RECORD_READ(__ret, __fd, __pread_flag, __pread_offset, __aligned, __tm1, __tm2) do { \
-    struct posix_file_record_ref* rec_ref; \
-    size_t stride; \
-    int64_t this_offset; \
-    int64_t file_alignment; \
-    double __elapsed = __tm2-__tm1; \
-    if(__ret < 0) break; \
-    rec_ref = darshan_lookup_record_ref(posix_runtime->fd_hash, &(__fd), sizeof(int)); \
-    if(!rec_ref) break; \
-    if(__pread_flag) \
-        this_offset = __pread_offset; \
-    else \
-        this_offset = rec_ref->offset; \
-    /* DXT to record detailed read tracing information */ \
-    if(enable_dxt_io_trace) { \
-        dxt_posix_read(rec_ref->file_rec->base_rec.id, this_offset, __ret, __tm1, __tm2); \
-    } \
-    if(this_offset > rec_ref->last_byte_read) \
-        rec_ref->file_rec->counters[POSIX_SEQ_READS] += 1;  \
-    if(this_offset == (rec_ref->last_byte_read + 1)) \
-        rec_ref->file_rec->counters[POSIX_CONSEC_READS] += 1;  \
-    if(this_offset > 0 && this_offset > rec_ref->last_byte_read \
-        && rec_ref->last_byte_read != 0) \
-        stride = this_offset - rec_ref->last_byte_read - 1; \
-    else \
-        stride = 0; \
-    rec_ref->last_byte_read = this_offset + __ret - 1; \
-    rec_ref->offset = this_offset + __ret; \
-    if(rec_ref->file_rec->counters[POSIX_MAX_BYTE_READ] < (this_offset + __ret - 1)) \
-        rec_ref->file_rec->counters[POSIX_MAX_BYTE_READ] = (this_offset + __ret - 1); \
-    rec_ref->file_rec->counters[POSIX_BYTES_READ] += __ret; \
-    rec_ref->file_rec->counters[POSIX_READS] += 1; \
-    DARSHAN_BUCKET_INC(&(rec_ref->file_rec->counters[POSIX_SIZE_READ_0_100]), __ret); \
-    darshan_common_val_counter(&rec_ref->access_root, &rec_ref->access_count, __ret, \
-        &(rec_ref->file_rec->counters[POSIX_ACCESS1_ACCESS]), \
-        &(rec_ref->file_rec->counters[POSIX_ACCESS1_COUNT])); \
-    darshan_common_val_counter(&rec_ref->stride_root, &rec_ref->stride_count, stride, \
-        &(rec_ref->file_rec->counters[POSIX_STRIDE1_STRIDE]), \
-        &(rec_ref->file_rec->counters[POSIX_STRIDE1_COUNT])); \
-    if(!__aligned) \
-        rec_ref->file_rec->counters[POSIX_MEM_NOT_ALIGNED] += 1; \
-    file_alignment = rec_ref->file_rec->counters[POSIX_FILE_ALIGNMENT]; \
-    if(file_alignment > 0 && (this_offset % file_alignment) != 0) \
-        rec_ref->file_rec->counters[POSIX_FILE_NOT_ALIGNED] += 1; \
-    if(rec_ref->last_io_type == DARSHAN_IO_WRITE) \
-        rec_ref->file_rec->counters[POSIX_RW_SWITCHES] += 1; \
-    rec_ref->last_io_type = DARSHAN_IO_READ; \
-    if(rec_ref->file_rec->fcounters[POSIX_F_READ_START_TIMESTAMP] == 0 || \
-     rec_ref->file_rec->fcounters[POSIX_F_READ_START_TIMESTAMP] > __tm1) \
-        rec_ref->file_rec->fcounters[POSIX_F_READ_START_TIMESTAMP] = __tm1; \
-    rec_ref->file_rec->fcounters[POSIX_F_READ_END_TIMESTAMP] = __tm2; \
-    if(rec_ref->file_rec->fcounters[POSIX_F_MAX_READ_TIME] < __elapsed) { \
-        rec_ref->file_rec->fcounters[POSIX_F_MAX_READ_TIME] = __elapsed; \
-        rec_ref->file_rec->counters[POSIX_MAX_READ_TIME_SIZE] = __ret; } \
-    DARSHAN_TIMER_INC_NO_OVERLAP(rec_ref->file_rec->fcounters[POSIX_F_READ_TIME], \
-        __tm1, __tm2, rec_ref->last_read_end); \
-} while(0)
+/* read and write wrappers only resolve the calling thread's shard and the
+ * file offset of the access when the call completes; the remaining counter
+ * updates are made by posix_apply_event(), either immediately or, if
+ * DARSHAN_EVENT_RING is set, in batches from the thread's event ring
+ */
+#define POSIX_RECORD_READ(__ret, __fd, __pread_flag, __pread_offset, __aligned, __tm1, __tm2) \
+    POSIX_RECORD_RW(DARSHAN_IO_READ, __ret, __fd, __pread_flag, __pread_offset, __aligned, __tm1, __tm2)
 
-#define POSIX_RECORD_WRITE(__ret, __fd, __pwrite_flag, __pwrite_offset, __aligned, __tm1, __tm2) do { \
-    struct posix_file_record_ref* rec_ref; \
-    size_t stride; \
-    int64_t this_offset; \
-    int64_t file_alignment; \
-    double __elapsed = __tm2-__tm1; \
+#define POSIX_RECORD_WRITE(__ret, __fd, __pwrite_flag, __pwrite_offset, __aligned, __tm1, __tm2) \
+    POSIX_RECORD_RW(DARSHAN_IO_WRITE, __ret, __fd, __pwrite_flag, __pwrite_offset, __aligned, __tm1, __tm2)
+
+#define POSIX_RECORD_RW(__op, __ret, __fd, __pos_flag, __pos_offset, __aligned, __tm1, __tm2) do { \
+    struct posix_file_shard* __shard; \
+    struct darshan_shard_event __event_buf; \
+    struct darshan_shard_event* __event; \
+    int64_t __this_offset; \
     if(__ret < 0) break; \
-    rec_ref = darshan_lookup_record_ref(posix_runtime->fd_hash, &__fd, sizeof(int)); \
-    if(!rec_ref) break; \
-    if(__pwrite_flag) \
-        this_offset = __pwrite_offset; \
-    else \
-        this_offset = rec_ref->offset; \
-    /* DXT to record detailed write tracing information */ \
-    if(enable_dxt_io_trace) { \
-        dxt_posix_write(rec_ref->file_rec->base_rec.id, this_offset, __ret, __tm1, __tm2); \
+    __shard = posix_lookup_shard(__fd); \
+    if(!__shard) break; \
+    if(__pos_flag) { \
+        __this_offset = __pos_offset; \
+        __atomic_store_n(&__shard->rec_ref->offset, __this_offset + __ret, __ATOMIC_RELAXED); \
     } \
-    if(this_offset > rec_ref->last_byte_written) \
-        rec_ref->file_rec->counters[POSIX_SEQ_WRITES] += 1; \
-    if(this_offset == (rec_ref->last_byte_written + 1)) \
-        rec_ref->file_rec->counters[POSIX_CONSEC_WRITES] += 1; \
-    if(this_offset > 0 && this_offset > rec_ref->last_byte_written \
-        && rec_ref->last_byte_written != 0) \
-        stride = this_offset - rec_ref->last_byte_written - 1; \
     else \
-        stride = 0; \
-    rec_ref->last_byte_written = this_offset + __ret - 1; \
-    rec_ref->offset = this_offset + __ret; \
-    if(rec_ref->file_rec->counters[POSIX_MAX_BYTE_WRITTEN] < (this_offset + __ret - 1)) \
-        rec_ref->file_rec->counters[POSIX_MAX_BYTE_WRITTEN] = (this_offset + __ret - 1); \
-    rec_ref->file_rec->counters[POSIX_BYTES_WRITTEN] += __ret; \
-    rec_ref->file_rec->counters[POSIX_WRITES] += 1; \
-    DARSHAN_BUCKET_INC(&(rec_ref->file_rec->counters[POSIX_SIZE_WRITE_0_100]), __ret); \
-    darshan_common_val_counter(&rec_ref->access_root, &rec_ref->access_count, __ret, \
-        &(rec_ref->file_rec->counters[POSIX_ACCESS1_ACCESS]), \
-        &(rec_ref->file_rec->counters[POSIX_ACCESS1_COUNT])); \
-    darshan_common_val_counter(&rec_ref->stride_root, &rec_ref->stride_count, stride, \
-        &(rec_ref->file_rec->counters[POSIX_STRIDE1_STRIDE]), \
-        &(rec_ref->file_rec->counters[POSIX_STRIDE1_COUNT])); \
-    if(!__aligned) \
-        rec_ref->file_rec->counters[POSIX_MEM_NOT_ALIGNED] += 1; \
-    file_alignment = rec_ref->file_rec->counters[POSIX_FILE_ALIGNMENT]; \
-    if(file_alignment > 0 && (this_offset % file_alignment) != 0) \
-        rec_ref->file_rec->counters[POSIX_FILE_NOT_ALIGNED] += 1; \
-    if(rec_ref->last_io_type == DARSHAN_IO_READ) \
-        rec_ref->file_rec->counters[POSIX_RW_SWITCHES] += 1; \
-    rec_ref->last_io_type = DARSHAN_IO_WRITE; \
-    if(rec_ref->file_rec->fcounters[POSIX_F_WRITE_START_TIMESTAMP] == 0 || \
-     rec_ref->file_rec->fcounters[POSIX_F_WRITE_START_TIMESTAMP] > __tm1) \
-        rec_ref->file_rec->fcounters[POSIX_F_WRITE_START_TIMESTAMP] = __tm1; \
-    rec_ref->file_rec->fcounters[POSIX_F_WRITE_END_TIMESTAMP] = __tm2; \
-    if(rec_ref->file_rec->fcounters[POSIX_F_MAX_WRITE_TIME] < __elapsed) { \
-        rec_ref->file_rec->fcounters[POSIX_F_MAX_WRITE_TIME] = __elapsed; \
-        rec_ref->file_rec->counters[POSIX_MAX_WRITE_TIME_SIZE] = __ret; } \
-    DARSHAN_TIMER_INC_NO_OVERLAP(rec_ref->file_rec->fcounters[POSIX_F_WRITE_TIME], \
-        __tm1, __tm2, rec_ref->last_write_end); \
+        __this_offset = __atomic_fetch_add(&__shard->rec_ref->offset, __ret, __ATOMIC_RELAXED); \
+    __event = darshan_shards_defer(posix_thread_shards, &posix_apply_event); \
+    if(!__event) __event = &__event_buf; \
+    __event->shard_p = __shard; \
+    __event->offset = __this_offset; \
+    __event->size = __ret; \
+    __event->tm1 = __tm1; \
+    __event->tm2 = __tm2; \
+    __event->op = __op; \
+    __event->flags = __aligned; \
+    __event->session = __atomic_load_n(&__shard->rec_ref->io_session, __ATOMIC_RELAXED); \
+    if(__event == &__event_buf) posix_apply_event(__event); \
 } while(0)
 
 #define POSIX_LOOKUP_RECORD_STAT(__path, __statbuf, __tm1, __tm2) do { \
     darshan_record_id rec_id; \
     struct posix_file_record_ref* rec_ref; \
-    char *newpath = darshan_clean_file_path(__path); \
-    if(!newpath) newpath = (char *)__path; \
-    if(darshan_core_excluded_path(newpath)) { \
-        if(newpath != __path) free(newpath); \
-        break; \
+    char pathbuf[PATH_MAX]; \
+    char *newpath = darshan_clean_file_path_id(__path, pathbuf, &rec_id); \
+    if(!newpath) { \
+        newpath = (char *)__path; \
+        rec_id = darshan_core_gen_record_id(newpath); \
     } \
-    rec_id = darshan_core_gen_record_id(newpath); \
+    if(darshan_core_excluded_path(DARSHAN_POSIX_MOD, newpath)) break; \
     rec_ref = darshan_lookup_record_ref(posix_runtime->rec_id_hash, &rec_id, sizeof(darshan_record_id)); \
     if(!rec_ref) rec_ref = posix_track_new_file_record(rec_id, newpath); \
-    if(newpath != __path) free(newpath); \
     if(rec_ref) { \
         POSIX_RECORD_STAT(rec_ref, __statbuf, __tm1, __tm2); \
     } \
@@ -423,6 +465,7 @@ int DARSHAN_DECL(open)(const char *path, int flags, ...)
     }
 
     POSIX_PRE_RECORD();
+    DARSHAN_SELF_TIME(DARSHAN_POSIX_MOD, SELF_F_REAL_TIME, tm2 - tm1);
     POSIX_RECORD_OPEN(ret, path, mode, tm1, tm2);
     POSIX_POST_RECORD();
 
@@ -441,6 +484,7 @@ int DARSHAN_DECL(__open_2)(const char *path, int oflag)
     tm2 = darshan_core_wtime();
 
     POSIX_PRE_RECORD();
+    DARSHAN_SELF_TIME(DARSHAN_POSIX_MOD, SELF_F_REAL_TIME, tm2 - tm1);
     POSIX_RECORD_OPEN(ret, path, 0, tm1, tm2);
     POSIX_POST_RECORD();
 
@@ -474,6 +518,7 @@ int DARSHAN_DECL(open64)(const char *path, int flags, ...)
     }
 
     POSIX_PRE_RECORD();
+    DARSHAN_SELF_TIME(DARSHAN_POSIX_MOD, SELF_F_REAL_TIME, tm2 - tm1);
     POSIX_RECORD_OPEN(ret, path, mode, tm1, tm2);
     POSIX_POST_RECORD();
 
@@ -492,6 +537,7 @@ int DARSHAN_DECL(creat)(const char* path, mode_t mode)
     tm2 = darshan_core_wtime();
 
     POSIX_PRE_RECORD();
+    DARSHAN_SELF_TIME(DARSHAN_POSIX_MOD, SELF_F_REAL_TIME, tm2 - tm1);
     POSIX_RECORD_OPEN(ret, path, mode, tm1, tm2);
     POSIX_POST_RECORD();
 
@@ -510,6 +556,7 @@ int DARSHAN_DECL(creat64)(const char* path, mode_t mode)
     tm2 = darshan_core_wtime();
 
     POSIX_PRE_RECORD();
+    DARSHAN_SELF_TIME(DARSHAN_POSIX_MOD, SELF_F_REAL_TIME, tm2 - tm1);
     POSIX_RECORD_OPEN(ret, path, mode, tm1, tm2);
     POSIX_POST_RECORD();
 
@@ -531,8 +578,8 @@ int DARSHAN_DECL(dup)(int oldfd)
     if(ret >= 0)
     {
         POSIX_PRE_RECORD();
-        rec_ref = darshan_lookup_record_ref(posix_runtime->fd_hash,
-            &oldfd, sizeof(oldfd));
+        DARSHAN_SELF_TIME(DARSHAN_POSIX_MOD, SELF_F_REAL_TIME, tm2 - tm1);
+        rec_ref = darshan_lookup_fd_ref(&(posix_runtime->fd_table), oldfd);
         POSIX_RECORD_REFOPEN(ret, rec_ref, tm1, tm2, POSIX_DUPS);
         POSIX_POST_RECORD();
     }
@@ -555,8 +602,8 @@ int DARSHAN_DECL(dup2)(int oldfd, int newfd)
     if(ret >=0)
     {
         POSIX_PRE_RECORD();
-        rec_ref = darshan_lookup_record_ref(posix_runtime->fd_hash,
-            &oldfd, sizeof(oldfd));
+        DARSHAN_SELF_TIME(DARSHAN_POSIX_MOD, SELF_F_REAL_TIME, tm2 - tm1);
+        rec_ref = darshan_lookup_fd_ref(&(posix_runtime->fd_table), oldfd);
         POSIX_RECORD_REFOPEN(ret, rec_ref, tm1, tm2, POSIX_DUPS);
         POSIX_POST_RECORD();
     }
@@ -579,8 +626,8 @@ int DARSHAN_DECL(dup3)(int oldfd, int newfd, int flags)
     if(ret >=0)
     {
         POSIX_PRE_RECORD();
-        rec_ref = darshan_lookup_record_ref(posix_runtime->fd_hash,
-            &oldfd, sizeof(oldfd));
+        DARSHAN_SELF_TIME(DARSHAN_POSIX_MOD, SELF_F_REAL_TIME, tm2 - tm1);
+        rec_ref = darshan_lookup_fd_ref(&(posix_runtime->fd_table), oldfd);
         POSIX_RECORD_REFOPEN(ret, rec_ref, tm1, tm2, POSIX_DUPS);
         POSIX_POST_RECORD();
     }
@@ -609,12 +656,14 @@ int DARSHAN_DECL(fileno)(FILE *stream)
             rec_id = darshan_core_gen_record_id(rec_name);
 
             POSIX_PRE_RECORD();
+            DARSHAN_SELF_TIME(DARSHAN_POSIX_MOD, SELF_F_REAL_TIME, tm2 - tm1);
             rec_ref = darshan_lookup_record_ref(posix_runtime->rec_id_hash,
                 &rec_id, sizeof(darshan_record_id));
             if(!rec_ref)
                 rec_ref = posix_track_new_file_record(rec_id, rec_name);
             POSIX_RECORD_REFOPEN(ret, rec_ref, tm1, tm2, POSIX_FILENOS);
             POSIX_POST_RECORD();
+            free(rec_name);
         }
     }
 
@@ -633,6 +682,7 @@ int DARSHAN_DECL(mkstemp)(char* template)
     tm2 = darshan_core_wtime();
 
     POSIX_PRE_RECORD();
+    DARSHAN_SELF_TIME(DARSHAN_POSIX_MOD, SELF_F_REAL_TIME, tm2 - tm1);
     POSIX_RECORD_OPEN(ret, template, 0, tm1, tm2);
     POSIX_POST_RECORD();
 
@@ -651,6 +701,7 @@ int DARSHAN_DECL(mkostemp)(char* template, int flags)
     tm2 = darshan_core_wtime();
 
     POSIX_PRE_RECORD();
+    DARSHAN_SELF_TIME(DARSHAN_POSIX_MOD, SELF_F_REAL_TIME, tm2 - tm1);
     POSIX_RECORD_OPEN(ret, template, 0, tm1, tm2);
     POSIX_POST_RECORD();
 
@@ -669,6 +720,7 @@ int DARSHAN_DECL(mkstemps)(char* template, int suffixlen)
     tm2 = darshan_core_wtime();
 
     POSIX_PRE_RECORD();
+    DARSHAN_SELF_TIME(DARSHAN_POSIX_MOD, SELF_F_REAL_TIME, tm2 - tm1);
     POSIX_RECORD_OPEN(ret, template, 0, tm1, tm2);
     POSIX_POST_RECORD();
 
@@ -687,6 +739,7 @@ int DARSHAN_DECL(mkostemps)(char* template, int suffixlen, int flags)
     tm2 = darshan_core_wtime();
 
     POSIX_PRE_RECORD();
+    DARSHAN_SELF_TIME(DARSHAN_POSIX_MOD, SELF_F_REAL_TIME, tm2 - tm1);
     POSIX_RECORD_OPEN(ret, template, 0, tm1, tm2);
     POSIX_POST_RECORD();
 
@@ -707,9 +760,10 @@ ssize_t DARSHAN_DECL(read)(int fd, void *buf, size_t count)
     ret = __real_read(fd, buf, count);
     tm2 = darshan_core_wtime();
 
-    POSIX_PRE_RECORD();
+    POSIX_PRE_RECORD_SHARDED();
+    DARSHAN_SELF_TIME(DARSHAN_POSIX_MOD, SELF_F_REAL_TIME, tm2 - tm1);
     POSIX_RECORD_READ(ret, fd, 0, 0, aligned_flag, tm1, tm2);
-    POSIX_POST_RECORD();
+    POSIX_POST_RECORD_SHARDED();
 
     return(ret);
 }
@@ -728,9 +782,10 @@ ssize_t DARSHAN_DECL(write)(int fd, const void *buf, size_t count)
     ret = __real_write(fd, buf, count);
     tm2 = darshan_core_wtime();
 
-    POSIX_PRE_RECORD();
+    POSIX_PRE_RECORD_SHARDED();
+    DARSHAN_SELF_TIME(DARSHAN_POSIX_MOD, SELF_F_REAL_TIME, tm2 - tm1);
     POSIX_RECORD_WRITE(ret, fd, 0, 0, aligned_flag, tm1, tm2);
-    POSIX_POST_RECORD();
+    POSIX_POST_RECORD_SHARDED();
 
     return(ret);
 }
@@ -749,9 +804,10 @@ ssize_t DARSHAN_DECL(pread)(int fd, void *buf, size_t count, off_t offset)
     ret = __real_pread(fd, buf, count, offset);
     tm2 = darshan_core_wtime();
 
-    POSIX_PRE_RECORD();
+    POSIX_PRE_RECORD_SHARDED();
+    DARSHAN_SELF_TIME(DARSHAN_POSIX_MOD, SELF_F_REAL_TIME, tm2 - tm1);
     POSIX_RECORD_READ(ret, fd, 1, offset, aligned_flag, tm1, tm2);
-    POSIX_POST_RECORD();
+    POSIX_POST_RECORD_SHARDED();
 
     return(ret);
 }
@@ -770,9 +826,10 @@ ssize_t DARSHAN_DECL(pwrite)(int fd, const void *buf, size_t count, off_t offset
     ret = __real_pwrite(fd, buf, count, offset);
     tm2 = darshan_core_wtime();
 
-    POSIX_PRE_RECORD();
+    POSIX_PRE_RECORD_SHARDED();
+    DARSHAN_SELF_TIME(DARSHAN_POSIX_MOD, SELF_F_REAL_TIME, tm2 - tm1);
     POSIX_RECORD_WRITE(ret, fd, 1, offset, aligned_flag, tm1, tm2);
-    POSIX_POST_RECORD();
+    POSIX_POST_RECORD_SHARDED();
 
     return(ret);
 }
@@ -791,9 +848,10 @@ ssize_t DARSHAN_DECL(pread64)(int fd, void *buf, size_t count, off64_t offset)
     ret = __real_pread64(fd, buf, count, offset);
     tm2 = darshan_core_wtime();
 
-    POSIX_PRE_RECORD();
+    POSIX_PRE_RECORD_SHARDED();
+    DARSHAN_SELF_TIME(DARSHAN_POSIX_MOD, SELF_F_REAL_TIME, tm2 - tm1);
     POSIX_RECORD_READ(ret, fd, 1, offset, aligned_flag, tm1, tm2);
-    POSIX_POST_RECORD();
+    POSIX_POST_RECORD_SHARDED();
 
     return(ret);
 }
@@ -812,9 +870,10 @@ ssize_t DARSHAN_DECL(pwrite64)(int fd, const void *buf, size_t count, off64_t of
     ret = __real_pwrite64(fd, buf, count, offset);
     tm2 = darshan_core_wtime();
 
-    POSIX_PRE_RECORD();
+    POSIX_PRE_RECORD_SHARDED();
+    DARSHAN_SELF_TIME(DARSHAN_POSIX_MOD, SELF_F_REAL_TIME, tm2 - tm1);
     POSIX_RECORD_WRITE(ret, fd, 1, offset, aligned_flag, tm1, tm2);
-    POSIX_POST_RECORD();
+    POSIX_POST_RECORD_SHARDED();
 
     return(ret);
 }
@@ -838,9 +897,10 @@ ssize_t DARSHAN_DECL(readv)(int fd, const struct iovec *iov, int iovcnt)
     ret = __real_readv(fd, iov, iovcnt);
     tm2 = darshan_core_wtime();
 
-    POSIX_PRE_RECORD();
+    POSIX_PRE_RECORD_SHARDED();
+    DARSHAN_SELF_TIME(DARSHAN_POSIX_MOD, SELF_F_REAL_TIME, tm2 - tm1);
     POSIX_RECORD_READ(ret, fd, 0, 0, aligned_flag, tm1, tm2);
-    POSIX_POST_RECORD();
+    POSIX_POST_RECORD_SHARDED();
 
     return(ret);
 }
@@ -864,9 +924,10 @@ ssize_t DARSHAN_DECL(writev)(int fd, const struct iovec *iov, int iovcnt)
     ret = __real_writev(fd, iov, iovcnt);
     tm2 = darshan_core_wtime();
 
-    POSIX_PRE_RECORD();
+    POSIX_PRE_RECORD_SHARDED();
+    DARSHAN_SELF_TIME(DARSHAN_POSIX_MOD, SELF_F_REAL_TIME, tm2 - tm1);
     POSIX_RECORD_WRITE(ret, fd, 0, 0, aligned_flag, tm1, tm2);
-    POSIX_POST_RECORD();
+    POSIX_POST_RECORD_SHARDED();
 
     return(ret);
 }
@@ -886,10 +947,11 @@ off_t DARSHAN_DECL(lseek)(int fd, off_t offset, int whence)
     if(ret >= 0)
     {
         POSIX_PRE_RECORD();
-        rec_ref = darshan_lookup_record_ref(posix_runtime->fd_hash, &fd, sizeof(int));
+        DARSHAN_SELF_TIME(DARSHAN_POSIX_MOD, SELF_F_REAL_TIME, tm2 - tm1);
+        rec_ref = darshan_lookup_fd_ref(&(posix_runtime->fd_table), fd);
         if(rec_ref)
         {
-            rec_ref->offset = ret;
+            __atomic_store_n(&rec_ref->offset, ret, __ATOMIC_RELAXED);
             DARSHAN_TIMER_INC_NO_OVERLAP(
                 rec_ref->file_rec->fcounters[POSIX_F_META_TIME],
                 tm1, tm2, rec_ref->last_meta_end);
@@ -916,10 +978,11 @@ off64_t DARSHAN_DECL(lseek64)(int fd, off64_t offset, int whence)
     if(ret >= 0)
     {
         POSIX_PRE_RECORD();
-        rec_ref = darshan_lookup_record_ref(posix_runtime->fd_hash, &fd, sizeof(int));
+        DARSHAN_SELF_TIME(DARSHAN_POSIX_MOD, SELF_F_REAL_TIME, tm2 - tm1);
+        rec_ref = darshan_lookup_fd_ref(&(posix_runtime->fd_table), fd);
         if(rec_ref)
         {
-            rec_ref->offset = ret;
+            __atomic_store_n(&rec_ref->offset, ret, __ATOMIC_RELAXED);
             DARSHAN_TIMER_INC_NO_OVERLAP(
                 rec_ref->file_rec->fcounters[POSIX_F_META_TIME],
                 tm1, tm2, rec_ref->last_meta_end);
@@ -946,6 +1009,7 @@ int DARSHAN_DECL(__xstat)(int vers, const char *path, struct stat *buf)
         return(ret);
 
     POSIX_PRE_RECORD();
+    DARSHAN_SELF_TIME(DARSHAN_POSIX_MOD, SELF_F_REAL_TIME, tm2 - tm1);
     POSIX_LOOKUP_RECORD_STAT(path, buf, tm1, tm2);
     POSIX_POST_RECORD();
 
@@ -967,6 +1031,7 @@ int DARSHAN_DECL(__xstat64)(int vers, const char *path, struct stat64 *buf)
         return(ret);
 
     POSIX_PRE_RECORD();
+    DARSHAN_SELF_TIME(DARSHAN_POSIX_MOD, SELF_F_REAL_TIME, tm2 - tm1);
     POSIX_LOOKUP_RECORD_STAT(path, buf, tm1, tm2);
     POSIX_POST_RECORD();
 
@@ -988,6 +1053,7 @@ int DARSHAN_DECL(__lxstat)(int vers, const char *path, struct stat *buf)
         return(ret);
 
     POSIX_PRE_RECORD();
+    DARSHAN_SELF_TIME(DARSHAN_POSIX_MOD, SELF_F_REAL_TIME, tm2 - tm1);
     POSIX_LOOKUP_RECORD_STAT(path, buf, tm1, tm2);
     POSIX_POST_RECORD();
 
@@ -1009,6 +1075,7 @@ int DARSHAN_DECL(__lxstat64)(int vers, const char *path, struct stat64 *buf)
         return(ret);
 
     POSIX_PRE_RECORD();
+    DARSHAN_SELF_TIME(DARSHAN_POSIX_MOD, SELF_F_REAL_TIME, tm2 - tm1);
     POSIX_LOOKUP_RECORD_STAT(path, buf, tm1, tm2);
     POSIX_POST_RECORD();
 
@@ -1031,7 +1098,8 @@ int DARSHAN_DECL(__fxstat)(int vers, int fd, struct stat *buf)
         return(ret);
 
     POSIX_PRE_RECORD();
-    rec_ref = darshan_lookup_record_ref(posix_runtime->fd_hash, &fd, sizeof(int));
+    DARSHAN_SELF_TIME(DARSHAN_POSIX_MOD, SELF_F_REAL_TIME, tm2 - tm1);
+    rec_ref = darshan_lookup_fd_ref(&(posix_runtime->fd_table), fd);
     if(rec_ref)
     {
         POSIX_RECORD_STAT(rec_ref, buf, tm1, tm2);
@@ -1057,7 +1125,8 @@ int DARSHAN_DECL(__fxstat64)(int vers, int fd, struct stat64 *buf)
         return(ret);
 
     POSIX_PRE_RECORD();
-    rec_ref = darshan_lookup_record_ref(posix_runtime->fd_hash, &fd, sizeof(int));
+    DARSHAN_SELF_TIME(DARSHAN_POSIX_MOD, SELF_F_REAL_TIME, tm2 - tm1);
+    rec_ref = darshan_lookup_fd_ref(&(posix_runtime->fd_table), fd);
     if(rec_ref)
     {
         POSIX_RECORD_STAT(rec_ref, buf, tm1, tm2);
@@ -1089,10 +1158,11 @@ void* DARSHAN_DECL(mmap)(void *addr, size_t length, int prot, int flags,
         return(ret);
 
     POSIX_PRE_RECORD();
-    rec_ref = darshan_lookup_record_ref(posix_runtime->fd_hash, &fd, sizeof(int));
+    rec_ref = darshan_lookup_fd_ref(&(posix_runtime->fd_table), fd);
     if(rec_ref)
     {
         rec_ref->file_rec->counters[POSIX_MMAPS] += 1;
+        posix_mmap_tracker_add(rec_ref, ret, length, prot, flags);
     }
     POSIX_POST_RECORD();
 
@@ -1122,10 +1192,11 @@ void* DARSHAN_DECL(mmap64)(void *addr, size_t length, int prot, int flags,
         return(ret);
 
     POSIX_PRE_RECORD();
-    rec_ref = darshan_lookup_record_ref(posix_runtime->fd_hash, &fd, sizeof(int));
+    rec_ref = darshan_lookup_fd_ref(&(posix_runtime->fd_table), fd);
     if(rec_ref)
     {
         rec_ref->file_rec->counters[POSIX_MMAPS] += 1;
+        posix_mmap_tracker_add(rec_ref, ret, length, prot, flags);
     }
     POSIX_POST_RECORD();
 
@@ -1133,6 +1204,114 @@ void* DARSHAN_DECL(mmap64)(void *addr, size_t length, int prot, int flags,
 }
 #endif /* DARSHAN_WRAP_MMAP */
 
+#ifdef DARSHAN_WRAP_MMAP
+/* NOTE: munmap and madvise calls that drop pages are recorded before the
+ * underlying call, so that the pages of the mapping can still be sampled.
+ */
+int DARSHAN_DECL(munmap)(void *addr, size_t length)
+{
+    MAP_OR_FAIL(munmap);
+
+    if(__atomic_load_n(&posix_mmap_count, __ATOMIC_RELAXED) > 0 &&
+        !darshan_core_disabled_instrumentation())
+    {
+        DARSHAN_SELF_ENTER(DARSHAN_POSIX_MOD);
+        POSIX_MMAP_LOCK();
+        posix_mmap_tracker_unmap(addr, length);
+        POSIX_MMAP_UNLOCK();
+        DARSHAN_SELF_EXIT(DARSHAN_POSIX_MOD);
+    }
+
+    return(__real_munmap(addr, length));
+}
+
+int DARSHAN_DECL(msync)(void *addr, size_t length, int flags)
+{
+    int ret;
+    struct posix_mmap_tracker *tracker;
+    struct posix_file_record_ref *rec_ref = NULL;
+    double tm1, tm2;
+
+    MAP_OR_FAIL(msync);
+
+    tm1 = darshan_core_wtime();
+    ret = __real_msync(addr, length, flags);
+    tm2 = darshan_core_wtime();
+
+    if(ret < 0 || __atomic_load_n(&posix_mmap_count, __ATOMIC_RELAXED) == 0)
+        return(ret);
+
+    POSIX_PRE_RECORD();
+    DARSHAN_SELF_TIME(DARSHAN_POSIX_MOD, SELF_F_REAL_TIME, tm2 - tm1);
+    POSIX_MMAP_LOCK();
+    LL_FOREACH(posix_mmap_list, tracker)
+    {
+        if(!posix_mmap_tracker_overlaps(tracker, addr, length))
+            continue;
+        posix_mmap_tracker_sample(tracker);
+        /* count the call once per file it syncs */
+        if(tracker->rec_ref == rec_ref)
+            continue;
+        rec_ref = tracker->rec_ref;
+        DARSHAN_TIMER_INC_NO_OVERLAP(
+            rec_ref->file_rec->fcounters[POSIX_F_WRITE_TIME],
+            tm1, tm2, rec_ref->last_write_end);
+        rec_ref->file_rec->counters[POSIX_MSYNCS] += 1;
+    }
+    POSIX_MMAP_UNLOCK();
+    POSIX_POST_RECORD();
+
+    return(ret);
+}
+
+int DARSHAN_DECL(madvise)(void *addr, size_t length, int advice)
+{
+    int ret;
+    int drop = 0;
+    struct posix_mmap_tracker *tracker;
+
+    MAP_OR_FAIL(madvise);
+
+    /* only advice that drops resident pages affects our accounting */
+    if(advice == MADV_DONTNEED)
+        drop = 1;
+#ifdef MADV_REMOVE
+    if(advice == MADV_REMOVE)
+        drop = 1;
+#endif
+#ifdef MADV_PAGEOUT
+    if(advice == MADV_PAGEOUT)
+        drop = 1;
+#endif
+    if(!drop || __atomic_load_n(&posix_mmap_count, __ATOMIC_RELAXED) == 0 ||
+        darshan_core_disabled_instrumentation())
+        return(__real_madvise(addr, length, advice));
+
+    DARSHAN_SELF_ENTER(DARSHAN_POSIX_MOD);
+    POSIX_MMAP_LOCK();
+    LL_FOREACH(posix_mmap_list, tracker)
+    {
+        if(posix_mmap_tracker_overlaps(tracker, addr, length))
+            posix_mmap_tracker_sample(tracker);
+    }
+
+    ret = __real_madvise(addr, length, advice);
+
+    if(ret == 0)
+    {
+        LL_FOREACH(posix_mmap_list, tracker)
+        {
+            if(posix_mmap_tracker_overlaps(tracker, addr, length))
+                posix_mmap_tracker_rebase(tracker);
+        }
+    }
+    POSIX_MMAP_UNLOCK();
+    DARSHAN_SELF_EXIT(DARSHAN_POSIX_MOD);
+
+    return(ret);
+}
+#endif /* DARSHAN_WRAP_MMAP */
+
 int DARSHAN_DECL(fsync)(int fd)
 {
     int ret;
@@ -1149,7 +1328,8 @@ int DARSHAN_DECL(fsync)(int fd)
         return(ret);
 
     POSIX_PRE_RECORD();
-    rec_ref = darshan_lookup_record_ref(posix_runtime->fd_hash, &fd, sizeof(int));
+    DARSHAN_SELF_TIME(DARSHAN_POSIX_MOD, SELF_F_REAL_TIME, tm2 - tm1);
+    rec_ref = darshan_lookup_fd_ref(&(posix_runtime->fd_table), fd);
     if(rec_ref)
     {
         DARSHAN_TIMER_INC_NO_OVERLAP(
@@ -1178,7 +1358,8 @@ int DARSHAN_DECL(fdatasync)(int fd)
         return(ret);
 
     POSIX_PRE_RECORD();
-    rec_ref = darshan_lookup_record_ref(posix_runtime->fd_hash, &fd, sizeof(int));
+    DARSHAN_SELF_TIME(DARSHAN_POSIX_MOD, SELF_F_REAL_TIME, tm2 - tm1);
+    rec_ref = darshan_lookup_fd_ref(&(posix_runtime->fd_table), fd);
     if(rec_ref)
     {
         DARSHAN_TIMER_INC_NO_OVERLAP(
@@ -1195,6 +1376,9 @@ int DARSHAN_DECL(close)(int fd)
 {
     int ret;
     struct posix_file_record_ref *rec_ref;
+#ifdef DARSHAN_WRAP_MMAP
+    struct posix_mmap_tracker *tracker;
+#endif
     double tm1, tm2;
 
     MAP_OR_FAIL(close);
@@ -1203,12 +1387,17 @@ int DARSHAN_DECL(close)(int fd)
     ret = __real_close(fd);
     tm2 = darshan_core_wtime();
 
+#ifdef DARSHAN_IOURING
+    if(darshan_iouring_close_fd)
+        darshan_iouring_close_fd(fd);
+#endif
+
     POSIX_PRE_RECORD();
-    rec_ref = darshan_lookup_record_ref(posix_runtime->fd_hash, &fd, sizeof(int));
+    DARSHAN_SELF_TIME(DARSHAN_POSIX_MOD, SELF_F_REAL_TIME, tm2 - tm1);
+    rec_ref = darshan_lookup_fd_ref(&(posix_runtime->fd_table), fd);
     if(rec_ref)
     {
-        rec_ref->last_byte_written = 0;
-        rec_ref->last_byte_read = 0;
+        __atomic_add_fetch(&rec_ref->io_session, 1, __ATOMIC_RELAXED);
         if(rec_ref->file_rec->fcounters[POSIX_F_CLOSE_START_TIMESTAMP] == 0 ||
          rec_ref->file_rec->fcounters[POSIX_F_CLOSE_START_TIMESTAMP] > tm1)
            rec_ref->file_rec->fcounters[POSIX_F_CLOSE_START_TIMESTAMP] = tm1;
@@ -1216,7 +1405,20 @@ int DARSHAN_DECL(close)(int fd)
         DARSHAN_TIMER_INC_NO_OVERLAP(
             rec_ref->file_rec->fcounters[POSIX_F_META_TIME],
             tm1, tm2, rec_ref->last_meta_end);
-        darshan_delete_record_ref(&(posix_runtime->fd_hash), &fd, sizeof(int));
+#ifdef DARSHAN_WRAP_MMAP
+        /* the file's mappings outlive the descriptor, so sample them now
+         * in case the application never unmaps them
+         */
+        POSIX_MMAP_LOCK();
+        LL_FOREACH(posix_mmap_list, tracker)
+        {
+            if(tracker->rec_ref == rec_ref)
+                posix_mmap_tracker_sample(tracker);
+        }
+        POSIX_MMAP_UNLOCK();
+#endif
+        darshan_delete_fd_ref(&(posix_runtime->fd_table), fd);
+        darshan_shards_invalidate(&posix_shards, (uint64_t)fd);
     }
     POSIX_POST_RECORD();
 
@@ -1303,8 +1505,10 @@ ssize_t DARSHAN_DECL(aio_return)(struct aiocb *aiocbp)
     ret = __real_aio_return(aiocbp);
     tm2 = darshan_core_wtime();
 
-    POSIX_PRE_RECORD();
-    tmp = posix_aio_tracker_del(aiocbp->aio_fildes, aiocbp);
+    POSIX_PRE_RECORD_SHARDED();
+    POSIX_LOCK();
+    tmp = posix_runtime ? posix_aio_tracker_del(aiocbp->aio_fildes, aiocbp) : NULL;
+    POSIX_UNLOCK();
     if(tmp)
     {
         if((unsigned long)aiocbp->aio_buf % darshan_mem_alignment == 0)
@@ -1323,7 +1527,7 @@ ssize_t DARSHAN_DECL(aio_return)(struct aiocb *aiocbp)
         }
         free(tmp);
     }
-    POSIX_POST_RECORD();
+    POSIX_POST_RECORD_SHARDED();
 
     return(ret);
 }
@@ -1340,8 +1544,10 @@ ssize_t DARSHAN_DECL(aio_return64)(struct aiocb64 *aiocbp)
     ret = __real_aio_return64(aiocbp);
     tm2 = darshan_core_wtime();
 
-    POSIX_PRE_RECORD();
-    tmp = posix_aio_tracker_del(aiocbp->aio_fildes, aiocbp);
+    POSIX_PRE_RECORD_SHARDED();
+    POSIX_LOCK();
+    tmp = posix_runtime ? posix_aio_tracker_del(aiocbp->aio_fildes, aiocbp) : NULL;
+    POSIX_UNLOCK();
     if(tmp)
     {
         if((unsigned long)aiocbp->aio_buf % darshan_mem_alignment == 0)
@@ -1360,7 +1566,7 @@ ssize_t DARSHAN_DECL(aio_return64)(struct aiocb64 *aiocbp)
         }
         free(tmp);
     }
-    POSIX_POST_RECORD();
+    POSIX_POST_RECORD_SHARDED();
 
     return(ret);
 }
@@ -1427,7 +1633,7 @@ int DARSHAN_DECL(rename)(const char *oldpath, const char *newpath)
     {
         oldpath_clean = darshan_clean_file_path(oldpath);
         if(!oldpath_clean) oldpath_clean = (char *)oldpath;
-        if(darshan_core_excluded_path(oldpath_clean))
+        if(darshan_core_excluded_path(DARSHAN_POSIX_MOD, oldpath_clean))
         {
             if(oldpath_clean != oldpath) free(oldpath_clean);
             return(ret);
@@ -1435,6 +1641,7 @@ int DARSHAN_DECL(rename)(const char *oldpath, const char *newpath)
         old_rec_id = darshan_core_gen_record_id(oldpath_clean);
 
         POSIX_PRE_RECORD();
+        DARSHAN_SELF_TIME(DARSHAN_POSIX_MOD, SELF_F_REAL_TIME, tm2 - tm1);
         old_rec_ref = darshan_lookup_record_ref(posix_runtime->rec_id_hash,
             &old_rec_id, sizeof(darshan_record_id));
         if(!old_rec_ref)
@@ -1449,7 +1656,7 @@ int DARSHAN_DECL(rename)(const char *oldpath, const char *newpath)
 
         newpath_clean = darshan_clean_file_path(newpath);
         if(!newpath_clean) newpath_clean = (char *)newpath;
-        if(darshan_core_excluded_path(newpath_clean))
+        if(darshan_core_excluded_path(DARSHAN_POSIX_MOD, newpath_clean))
         {
             POSIX_POST_RECORD();
             if(oldpath_clean != oldpath) free(oldpath_clean);
@@ -1477,6 +1684,36 @@ int DARSHAN_DECL(rename)(const char *oldpath, const char *newpath)
     return(ret);
 }
 
+/* NOTE: chdir() and fchdir() are not recorded; they are only wrapped so
+ * that memoized relative paths are invalidated when the working directory
+ * changes
+ */
+int DARSHAN_DECL(chdir)(const char *path)
+{
+    int ret;
+
+    MAP_OR_FAIL(chdir);
+
+    ret = __real_chdir(path);
+    if(ret == 0)
+        darshan_common_cwd_changed();
+
+    return(ret);
+}
+
+int DARSHAN_DECL(fchdir)(int fd)
+{
+    int ret;
+
+    MAP_OR_FAIL(fchdir);
+
+    ret = __real_fchdir(fd);
+    if(ret == 0)
+        darshan_common_cwd_changed();
+
+    return(ret);
+}
+
 /**********************************************************
  * Internal functions for manipulating POSIX module state *
  **********************************************************/
@@ -1486,6 +1723,13 @@ static void posix_runtime_initialize()
 {
     int psx_buf_size;
 
+    /* our chdir wrappers keep track of the working directory from here
+     * on, so relative paths can be memoized too; this is done before the
+     * early returns below, as the wrappers (and other modules using the
+     * path cache) remain in place even if POSIX fails to register
+     */
+    darshan_common_cwd_track();
+
     /* try and store a default number of records for this module */
     psx_buf_size = DARSHAN_DEF_MOD_REC_COUNT * sizeof(struct darshan_posix_file);
 
@@ -1503,6 +1747,7 @@ static void posix_runtime_initialize()
         darshan_core_unregister_module(DARSHAN_POSIX_MOD);
         return;
     }
+    darshan_core_register_module_snapshot(DARSHAN_POSIX_MOD, &posix_snapshot);
 
     posix_runtime = malloc(sizeof(*posix_runtime));
     if(!posix_runtime)
@@ -1568,6 +1813,10 @@ static struct posix_file_record_ref *posix_track_new_file_record(
 #ifndef DARSHAN_WRAP_MMAP
     /* set invalid value here if MMAP instrumentation is disabled */
     file_rec->counters[POSIX_MMAPS] = -1;
+    file_rec->counters[POSIX_MSYNCS] = -1;
+    file_rec->counters[POSIX_MMAP_BYTES] = -1;
+    file_rec->counters[POSIX_MMAP_BYTES_READ] = -1;
+    file_rec->counters[POSIX_MMAP_BYTES_WRITTEN] = -1;
 #endif /* undefined DARSHAN_WRAP_MMAP */
     rec_ref->fs_type = fs_info.fs_type;
     rec_ref->file_rec = file_rec;
@@ -1586,7 +1835,7 @@ static struct posix_aio_tracker* posix_aio_tracker_del(int fd, void *aiocbp)
     struct posix_aio_tracker *tracker = NULL, *iter, *tmp;
     struct posix_file_record_ref *rec_ref;
 
-    rec_ref = darshan_lookup_record_ref(posix_runtime->fd_hash, &fd, sizeof(int));
+    rec_ref = darshan_lookup_fd_ref(&(posix_runtime->fd_table), fd);
     if(rec_ref)
     {
         LL_FOREACH_SAFE(rec_ref->aio_list, iter, tmp)
@@ -1609,7 +1858,7 @@ static void posix_aio_tracker_add(int fd, void *aiocbp)
     struct posix_aio_tracker* tracker;
     struct posix_file_record_ref *rec_ref;
 
-    rec_ref = darshan_lookup_record_ref(posix_runtime->fd_hash, &fd, sizeof(int));
+    rec_ref = darshan_lookup_fd_ref(&(posix_runtime->fd_table), fd);
     if(rec_ref)
     {
         tracker = malloc(sizeof(*tracker));
@@ -1624,13 +1873,439 @@ static void posix_aio_tracker_add(int fd, void *aiocbp)
     return;
 }
 
-static void posix_finalize_file_records(void *rec_ref_p)
+#ifdef DARSHAN_WRAP_MMAP
+/* number of pages whose residency is queried with each mincore call */
+#define POSIX_MMAP_MINCORE_PAGES 4096
+
+/* returns the number of bytes of the given page aligned range that are
+ * resident in memory, or -1 if the range is not (entirely) mapped
+ */
+static int64_t posix_mmap_resident_bytes(char *addr, size_t length)
+{
+    unsigned char vec[POSIX_MMAP_MINCORE_PAGES];
+    size_t page_sz = sysconf(_SC_PAGESIZE);
+    size_t npages = (length + page_sz - 1) / page_sz;
+    size_t chunk, i;
+    int64_t resident = 0;
+
+    while(npages > 0)
+    {
+        chunk = (npages < POSIX_MMAP_MINCORE_PAGES) ?
+            npages : POSIX_MMAP_MINCORE_PAGES;
+        if(mincore(addr, chunk * page_sz, vec) < 0)
+            return(-1);
+        for(i = 0; i < chunk; i++)
+            resident += (vec[i] & 1);
+        addr += chunk * page_sz;
+        npages -= chunk;
+    }
+
+    return(resident * page_sz);
+}
+
+/* adds a tracker for a new mapping of the file associated with 'rec_ref' */
+static void posix_mmap_tracker_add(struct posix_file_record_ref *rec_ref,
+    void *addr, size_t length, int prot, int flags)
+{
+    struct posix_mmap_tracker *tracker;
+
+    rec_ref->file_rec->counters[POSIX_MMAP_BYTES] += length;
+
+    tracker = malloc(sizeof(*tracker));
+    if(!tracker)
+        return;
+    tracker->addr = addr;
+    tracker->length = length;
+    tracker->shared_write = ((prot & PROT_WRITE) && (flags & MAP_SHARED));
+    tracker->rec_ref = rec_ref;
+    posix_mmap_tracker_rebase(tracker);
+    /* pages that were already cached can still be dirtied */
+    tracker->written = 0;
+    POSIX_MMAP_LOCK();
+    LL_PREPEND(posix_mmap_list, tracker);
+    __atomic_add_fetch(&posix_mmap_count, 1, __ATOMIC_RELAXED);
+    POSIX_MMAP_UNLOCK();
+
+    return;
+}
+
+/* adds the bytes faulted in and dirtied through a mapping since it was last
+ * sampled to the counters of the corresponding file.
+ *
+ * NOTE: pages of the file that were already cached when the mapping was
+ * created are not counted as read. Every resident page of a writable
+ * shared mapping is counted as written, since mincore cannot tell clean
+ * pages from dirty ones, so POSIX_MMAP_BYTES_WRITTEN is an upper bound.
+ */
+static void posix_mmap_tracker_sample(struct posix_mmap_tracker *tracker)
+{
+    struct darshan_posix_file *file_rec = tracker->rec_ref->file_rec;
+    int64_t resident;
+
+    resident = posix_mmap_resident_bytes(tracker->addr, tracker->length);
+    if(resident < 0)
+        return;
+
+    if(resident - tracker->base > tracker->read)
+    {
+        file_rec->counters[POSIX_MMAP_BYTES_READ] +=
+            resident - tracker->base - tracker->read;
+        tracker->read = resident - tracker->base;
+    }
+    if(tracker->shared_write && resident > tracker->written)
+    {
+        file_rec->counters[POSIX_MMAP_BYTES_WRITTEN] +=
+            resident - tracker->written;
+        tracker->written = resident;
+    }
+
+    return;
+}
+
+/* returns true (1) if the given range overlaps a tracked mapping */
+static int posix_mmap_tracker_overlaps(struct posix_mmap_tracker *tracker,
+    void *addr, size_t length)
+{
+    char *start = addr;
+
+    return(start < tracker->addr + tracker->length &&
+        start + length > tracker->addr);
+}
+
+/* restarts the accounting of a mapping whose extent or resident pages were
+ * changed by the application, so that pages it faults in again are counted
+ * (pages that are still resident are not counted again)
+ */
+static void posix_mmap_tracker_rebase(struct posix_mmap_tracker *tracker)
+{
+    tracker->base = posix_mmap_resident_bytes(tracker->addr, tracker->length);
+    if(tracker->base < 0)
+        tracker->base = 0;
+    tracker->read = 0;
+    tracker->written = tracker->base;
+
+    return;
+}
+
+/* samples the mappings overlapping a range that is about to be unmapped
+ * one last time, then stops tracking them or trims them to the part that
+ * remains mapped.
+ *
+ * NOTE: if a range is unmapped from the middle of a mapping, only the part
+ * below it remains tracked.
+ */
+static void posix_mmap_tracker_unmap(void *addr, size_t length)
+{
+    struct posix_mmap_tracker *tracker, *tmp;
+    char *start = addr;
+    char *end = start + length;
+    char *tracker_end;
+
+    LL_FOREACH_SAFE(posix_mmap_list, tracker, tmp)
+    {
+        if(!posix_mmap_tracker_overlaps(tracker, addr, length))
+            continue;
+        tracker_end = tracker->addr + tracker->length;
+
+        posix_mmap_tracker_sample(tracker);
+        if(start <= tracker->addr && end >= tracker_end)
+        {
+            LL_DELETE(posix_mmap_list, tracker);
+            free(tracker);
+            __atomic_sub_fetch(&posix_mmap_count, 1, __ATOMIC_RELAXED);
+            continue;
+        }
+        if(start <= tracker->addr)
+            tracker->addr = end;
+        else
+            tracker_end = start;
+        tracker->length = tracker_end - tracker->addr;
+        posix_mmap_tracker_rebase(tracker);
+    }
+
+    return;
+}
+#endif /* DARSHAN_WRAP_MMAP */
+
+/* finds the calling thread's counter shard for the file record associated
+ * with the given fd, without acquiring the POSIX lock if the fd has been
+ * resolved by this thread before.
+ *
+ * returns NULL if the fd is not instrumented
+ */
+static struct posix_file_shard *posix_lookup_shard(int fd)
+{
+    struct posix_file_record_ref *rec_ref = NULL;
+    struct posix_file_shard *shard;
+    uint64_t gen;
+
+    if(darshan_shards_lookup(&posix_shards, posix_thread_shards,
+        (uint64_t)fd, (void **)&shard))
+        return(shard);
+
+    /* cache miss, resolve the fd using the POSIX runtime's fd table */
+    POSIX_LOCK();
+    gen = darshan_shards_gen(&posix_shards, (uint64_t)fd);
+    if(posix_runtime)
+        rec_ref = darshan_lookup_fd_ref(&(posix_runtime->fd_table), fd);
+    shard = darshan_shards_fill(&posix_shards, posix_thread_shards,
+        (uint64_t)fd, gen, rec_ref);
+    POSIX_UNLOCK();
+
+    return(shard);
+}
+
+/* apply the counter updates of a read or write to the shard it was
+ * recorded in, either directly from the wrapper or as part of a batch of
+ * events deferred by the thread owning the shard
+ */
+static void posix_apply_event(struct darshan_shard_event *event)
+{
+    struct posix_file_shard *shard = (struct posix_file_shard *)event->shard_p;
+    int64_t this_offset = event->offset;
+    int64_t size = event->size;
+    double elapsed = event->tm2 - event->tm1;
+    int64_t file_alignment;
+    size_t stride;
+
+    if(shard->io_session != event->session)
+    {
+        shard->io_session = event->session;
+        shard->last_byte_read = 0;
+        shard->last_byte_written = 0;
+    }
+
+    if(event->op == DARSHAN_IO_READ)
+    {
+        /* DXT to record detailed read tracing information */
+        if(enable_dxt_io_trace)
+        {
+            POSIX_LOCK();
+            dxt_posix_read(shard->rec_ref->file_rec->base_rec.id, this_offset,
+                size, event->tm1, event->tm2);
+            POSIX_UNLOCK();
+        }
+        if(this_offset > shard->last_byte_read)
+            shard->rec.counters[POSIX_SEQ_READS] += 1;
+        if(this_offset == (shard->last_byte_read + 1))
+            shard->rec.counters[POSIX_CONSEC_READS] += 1;
+        if(this_offset > 0 && this_offset > shard->last_byte_read
+            && shard->last_byte_read != 0)
+            stride = this_offset - shard->last_byte_read - 1;
+        else
+            stride = 0;
+        shard->last_byte_read = this_offset + size - 1;
+        if(shard->rec.counters[POSIX_MAX_BYTE_READ] < (this_offset + size - 1))
+            shard->rec.counters[POSIX_MAX_BYTE_READ] = (this_offset + size - 1);
+        shard->rec.counters[POSIX_BYTES_READ] += size;
+        shard->rec.counters[POSIX_READS] += 1;
+        DARSHAN_BUCKET_INC(&(shard->rec.counters[POSIX_SIZE_READ_0_100]), size);
+    }
+    else
+    {
+        /* DXT to record detailed write tracing information */
+        if(enable_dxt_io_trace)
+        {
+            POSIX_LOCK();
+            dxt_posix_write(shard->rec_ref->file_rec->base_rec.id, this_offset,
+                size, event->tm1, event->tm2);
+            POSIX_UNLOCK();
+        }
+        if(this_offset > shard->last_byte_written)
+            shard->rec.counters[POSIX_SEQ_WRITES] += 1;
+        if(this_offset == (shard->last_byte_written + 1))
+            shard->rec.counters[POSIX_CONSEC_WRITES] += 1;
+        if(this_offset > 0 && this_offset > shard->last_byte_written
+            && shard->last_byte_written != 0)
+            stride = this_offset - shard->last_byte_written - 1;
+        else
+            stride = 0;
+        shard->last_byte_written = this_offset + size - 1;
+        if(shard->rec.counters[POSIX_MAX_BYTE_WRITTEN] < (this_offset + size - 1))
+            shard->rec.counters[POSIX_MAX_BYTE_WRITTEN] = (this_offset + size - 1);
+        shard->rec.counters[POSIX_BYTES_WRITTEN] += size;
+        shard->rec.counters[POSIX_WRITES] += 1;
+        DARSHAN_BUCKET_INC(&(shard->rec.counters[POSIX_SIZE_WRITE_0_100]), size);
+    }
+
+    darshan_common_val_counter(&shard->access_sketch, size);
+    darshan_common_val_counter(&shard->stride_sketch, stride);
+    if(!event->flags)
+        shard->rec.counters[POSIX_MEM_NOT_ALIGNED] += 1;
+    file_alignment = shard->rec_ref->file_rec->counters[POSIX_FILE_ALIGNMENT];
+    if(file_alignment > 0 && (this_offset % file_alignment) != 0)
+        shard->rec.counters[POSIX_FILE_NOT_ALIGNED] += 1;
+
+    if(event->op == DARSHAN_IO_READ)
+    {
+        if(shard->last_io_type == DARSHAN_IO_WRITE)
+            shard->rec.counters[POSIX_RW_SWITCHES] += 1;
+        shard->last_io_type = DARSHAN_IO_READ;
+        if(shard->rec.fcounters[POSIX_F_READ_START_TIMESTAMP] == 0 ||
+         shard->rec.fcounters[POSIX_F_READ_START_TIMESTAMP] > event->tm1)
+            shard->rec.fcounters[POSIX_F_READ_START_TIMESTAMP] = event->tm1;
+        shard->rec.fcounters[POSIX_F_READ_END_TIMESTAMP] = event->tm2;
+        if(shard->rec.fcounters[POSIX_F_MAX_READ_TIME] < elapsed)
+        {
+            shard->rec.fcounters[POSIX_F_MAX_READ_TIME] = elapsed;
+            shard->rec.counters[POSIX_MAX_READ_TIME_SIZE] = size;
+        }
+        DARSHAN_TIMER_INC_NO_OVERLAP(shard->rec.fcounters[POSIX_F_READ_TIME],
+            event->tm1, event->tm2, shard->last_read_end);
+    }
+    else
+    {
+        if(shard->last_io_type == DARSHAN_IO_READ)
+            shard->rec.counters[POSIX_RW_SWITCHES] += 1;
+        shard->last_io_type = DARSHAN_IO_WRITE;
+        if(shard->rec.fcounters[POSIX_F_WRITE_START_TIMESTAMP] == 0 ||
+         shard->rec.fcounters[POSIX_F_WRITE_START_TIMESTAMP] > event->tm1)
+            shard->rec.fcounters[POSIX_F_WRITE_START_TIMESTAMP] = event->tm1;
+        shard->rec.fcounters[POSIX_F_WRITE_END_TIMESTAMP] = event->tm2;
+        if(shard->rec.fcounters[POSIX_F_MAX_WRITE_TIME] < elapsed)
+        {
+            shard->rec.fcounters[POSIX_F_MAX_WRITE_TIME] = elapsed;
+            shard->rec.counters[POSIX_MAX_WRITE_TIME_SIZE] = size;
+        }
+        DARSHAN_TIMER_INC_NO_OVERLAP(shard->rec.fcounters[POSIX_F_WRITE_TIME],
+            event->tm1, event->tm2, shard->last_write_end);
+    }
+
+    return;
+}
+
+/* fold a thread's counter shard back into the corresponding file record */
+static void posix_merge_file_shard(void *shard_p)
+{
+    struct posix_file_shard *shard = (struct posix_file_shard *)shard_p;
+
+    posix_fold_file_shard(shard->rec_ref->file_rec, &shard->rec);
+    darshan_common_val_sketch_merge(&shard->access_sketch,
+        &shard->rec_ref->access_sketch);
+    darshan_common_val_sketch_merge(&shard->stride_sketch,
+        &shard->rec_ref->stride_sketch);
+
+    return;
+}
+
+/* fold the shards of an exiting thread back into their file records */
+static void posix_thread_exit(struct darshan_thread_shards *shards)
+{
+    POSIX_LOCK();
+    if(posix_runtime)
+        darshan_shards_release(&posix_shards, shards, &posix_apply_event,
+            &posix_merge_file_shard);
+    else
+        darshan_shards_release(&posix_shards, shards, NULL, NULL);
+    POSIX_UNLOCK();
+
+    return;
+}
+
+/* store the most common access sizes and strides of a file in its record */
+static void posix_record_common_vals(void *rec_ref_p)
 {
     struct posix_file_record_ref *rec_ref =
         (struct posix_file_record_ref *)rec_ref_p;
 
-    tdestroy(rec_ref->access_root, free);
-    tdestroy(rec_ref->stride_root, free);
+    darshan_common_val_sketch_top(&rec_ref->access_sketch,
+        &(rec_ref->file_rec->counters[POSIX_ACCESS1_ACCESS]),
+        &(rec_ref->file_rec->counters[POSIX_ACCESS1_COUNT]));
+    darshan_common_val_sketch_top(&rec_ref->stride_sketch,
+        &(rec_ref->file_rec->counters[POSIX_STRIDE1_STRIDE]),
+        &(rec_ref->file_rec->counters[POSIX_STRIDE1_COUNT]));
+
+    return;
+}
+
+/* fold a thread's counter shard into the snapshot copy of its file record,
+ * leaving both the shard and the live record untouched
+ */
+static void posix_snapshot_file_shard(void *shard_p)
+{
+    struct posix_file_shard *shard = (struct posix_file_shard *)shard_p;
+    char *rec_p = (char *)shard->rec_ref->file_rec;
+    struct darshan_posix_file *snap_rec;
+
+    /* skip records registered after the snapshot buffer was sized */
+    if(rec_p < posix_snapshot_src ||
+       rec_p >= posix_snapshot_src + posix_snapshot_len)
+        return;
+
+    snap_rec = (struct darshan_posix_file *)
+        (posix_snapshot_dst + (rec_p - posix_snapshot_src));
+    posix_fold_file_shard(snap_rec, &shard->rec);
+    darshan_common_val_sketch_top(&shard->access_sketch,
+        &(snap_rec->counters[POSIX_ACCESS1_ACCESS]),
+        &(snap_rec->counters[POSIX_ACCESS1_COUNT]));
+    darshan_common_val_sketch_top(&shard->stride_sketch,
+        &(snap_rec->counters[POSIX_STRIDE1_STRIDE]),
+        &(snap_rec->counters[POSIX_STRIDE1_COUNT]));
+
+    return;
+}
+
+static void posix_fold_file_shard(struct darshan_posix_file *file_rec,
+    struct darshan_posix_file *shard_rec)
+{
+    int i;
+
+    /* sum */
+    for(i=POSIX_READS; i<=POSIX_WRITES; i++)
+        file_rec->counters[i] += shard_rec->counters[i];
+    for(i=POSIX_BYTES_READ; i<=POSIX_BYTES_WRITTEN; i++)
+        file_rec->counters[i] += shard_rec->counters[i];
+    for(i=POSIX_CONSEC_READS; i<=POSIX_MEM_NOT_ALIGNED; i++)
+        file_rec->counters[i] += shard_rec->counters[i];
+    file_rec->counters[POSIX_FILE_NOT_ALIGNED] +=
+        shard_rec->counters[POSIX_FILE_NOT_ALIGNED];
+    for(i=POSIX_SIZE_READ_0_100; i<=POSIX_SIZE_WRITE_1G_PLUS; i++)
+        file_rec->counters[i] += shard_rec->counters[i];
+
+    /* max */
+    for(i=POSIX_MAX_BYTE_READ; i<=POSIX_MAX_BYTE_WRITTEN; i++)
+    {
+        if(shard_rec->counters[i] > file_rec->counters[i])
+            file_rec->counters[i] = shard_rec->counters[i];
+    }
+
+    /* min non-zero (if available) value */
+    for(i=POSIX_F_READ_START_TIMESTAMP; i<=POSIX_F_WRITE_START_TIMESTAMP; i++)
+    {
+        if(shard_rec->fcounters[i] > 0 && (file_rec->fcounters[i] == 0 ||
+           shard_rec->fcounters[i] < file_rec->fcounters[i]))
+            file_rec->fcounters[i] = shard_rec->fcounters[i];
+    }
+
+    /* max */
+    for(i=POSIX_F_READ_END_TIMESTAMP; i<=POSIX_F_WRITE_END_TIMESTAMP; i++)
+    {
+        if(shard_rec->fcounters[i] > file_rec->fcounters[i])
+            file_rec->fcounters[i] = shard_rec->fcounters[i];
+    }
+
+    /* sum */
+    for(i=POSIX_F_READ_TIME; i<=POSIX_F_WRITE_TIME; i++)
+        file_rec->fcounters[i] += shard_rec->fcounters[i];
+
+    /* max (special case) */
+    if(shard_rec->fcounters[POSIX_F_MAX_READ_TIME] >
+        file_rec->fcounters[POSIX_F_MAX_READ_TIME])
+    {
+        file_rec->fcounters[POSIX_F_MAX_READ_TIME] =
+            shard_rec->fcounters[POSIX_F_MAX_READ_TIME];
+        file_rec->counters[POSIX_MAX_READ_TIME_SIZE] =
+            shard_rec->counters[POSIX_MAX_READ_TIME_SIZE];
+    }
+    if(shard_rec->fcounters[POSIX_F_MAX_WRITE_TIME] >
+        file_rec->fcounters[POSIX_F_MAX_WRITE_TIME])
+    {
+        file_rec->fcounters[POSIX_F_MAX_WRITE_TIME] =
+            shard_rec->fcounters[POSIX_F_MAX_WRITE_TIME];
+        file_rec->counters[POSIX_MAX_WRITE_TIME_SIZE] =
+            shard_rec->counters[POSIX_MAX_WRITE_TIME_SIZE];
+    }
+
     return;
 }
 
@@ -1964,7 +2639,19 @@ static void posix_shared_record_variance(MPI_Comm mod_comm,
 
 static void posix_cleanup_runtime()
 {
-    darshan_clear_record_refs(&(posix_runtime->fd_hash), 0);
+    struct posix_mmap_tracker *tracker, *tmp;
+
+    POSIX_MMAP_LOCK();
+    LL_FOREACH_SAFE(posix_mmap_list, tracker, tmp)
+    {
+        LL_DELETE(posix_mmap_list, tracker);
+        free(tracker);
+    }
+    __atomic_store_n(&posix_mmap_count, 0, __ATOMIC_RELAXED);
+    POSIX_MMAP_UNLOCK();
+
+    darshan_shards_clear(&posix_shards);
+    darshan_clear_fd_refs(&(posix_runtime->fd_table));
     darshan_clear_record_refs(&(posix_runtime->rec_id_hash), 1);
 
     free(posix_runtime);
@@ -1981,8 +2668,7 @@ char *darshan_posix_lookup_record_name(int fd)
     POSIX_LOCK();
     if(posix_runtime)
     {
-        rec_ref = darshan_lookup_record_ref(posix_runtime->fd_hash,
-            &fd, sizeof(fd));
+        rec_ref = darshan_lookup_fd_ref(&(posix_runtime->fd_table), fd);
         if(rec_ref)
             rec_name = darshan_core_lookup_record_name(rec_ref->file_rec->base_rec.id);
     }
@@ -1991,8 +2677,34 @@ char *darshan_posix_lookup_record_name(int fd)
     return(rec_name);
 }
 
+/* look up the id of the record the POSIX module associates with file
+ * descriptor 'fd'; returns 1 and sets 'rec_id' if 'fd' is tracked, 0 if not
+ */
+int darshan_posix_lookup_record_id(int fd, darshan_record_id *rec_id)
+{
+    struct posix_file_record_ref *rec_ref;
+    int found = 0;
+
+    POSIX_LOCK();
+    if(posix_runtime)
+    {
+        rec_ref = darshan_lookup_fd_ref(&(posix_runtime->fd_table), fd);
+        if(rec_ref)
+        {
+            *rec_id = rec_ref->file_rec->base_rec.id;
+            found = 1;
+        }
+    }
+    POSIX_UNLOCK();
+
+    return(found);
+}
+
+/* number of distinct access sizes used by the shutdown benchmark */
+#define POSIX_BENCH_SIZE_COUNT 32
+
 /* posix module shutdown benchmark routine */
-void darshan_posix_shutdown_bench_setup(int test_case)
+void darshan_posix_shutdown_bench_setup(int test_case, int file_count)
 {
     char filepath[256];
     int *fd_array;
@@ -2005,15 +2717,23 @@ void darshan_posix_shutdown_bench_setup(int test_case)
     posix_runtime_initialize();
 
     srand(my_rank);
-    fd_array = malloc(1024 * sizeof(int));
-    size_array = malloc(DARSHAN_COMMON_VAL_MAX_RUNTIME_COUNT * sizeof(int64_t));
+    fd_array = malloc(file_count * sizeof(int));
+    size_array = malloc(POSIX_BENCH_SIZE_COUNT * sizeof(int64_t));
     assert(fd_array && size_array);
 
-    for(i = 0; i < 1024; i++)
+    for(i = 0; i < file_count; i++)
         fd_array[i] = i;
-    for(i = 0; i < DARSHAN_COMMON_VAL_MAX_RUNTIME_COUNT; i++)
+    for(i = 0; i < POSIX_BENCH_SIZE_COUNT; i++)
         size_array[i] = rand();
 
+    /* writes are recorded in this thread's counter shards */
+    if(!darshan_shards_enter(&posix_shards, &posix_thread_shards))
+    {
+        free(fd_array);
+        free(size_array);
+        return;
+    }
+
     switch(test_case)
     {
         case 1: /* single file-per-process */
@@ -2030,33 +2750,34 @@ void darshan_posix_shutdown_bench_setup(int test_case)
             POSIX_RECORD_WRITE(size_array[0], fd_array[0], 0, 0, 1, 1, 2);
 
             break;
-        case 3: /* 1024 unique files per proc */
-            for(i = 0; i < 1024; i++)
+        case 3: /* file_count unique files per proc */
+            for(i = 0; i < file_count; i++)
             {
                 snprintf(filepath, 256, "fpp-%d_rank-%d", i , my_rank);
 
                 POSIX_RECORD_OPEN(fd_array[i], filepath, 777, 0, 1);
-                POSIX_RECORD_WRITE(size_array[i % DARSHAN_COMMON_VAL_MAX_RUNTIME_COUNT],
+                POSIX_RECORD_WRITE(size_array[i % POSIX_BENCH_SIZE_COUNT],
                     fd_array[i], 0, 0, 1, 1, 2);
             }
 
             break;
-        case 4: /* 1024 shared files per proc */
-            for(i = 0; i < 1024; i++)
+        case 4: /* file_count shared files per proc */
+            for(i = 0; i < file_count; i++)
             {
                 snprintf(filepath, 256, "shared-%d", i);
 
                 POSIX_RECORD_OPEN(fd_array[i], filepath, 777, 0, 1);
-                POSIX_RECORD_WRITE(size_array[i % DARSHAN_COMMON_VAL_MAX_RUNTIME_COUNT],
+                POSIX_RECORD_WRITE(size_array[i % POSIX_BENCH_SIZE_COUNT],
                     fd_array[i], 0, 0, 1, 1, 2);
             }
 
             break;
         default:
             fprintf(stderr, "Error: invalid Darshan benchmark test case.\n");
-            return;
+            break;
     }
 
+    darshan_shards_exit(posix_thread_shards);
     free(fd_array);
     free(size_array);
 
@@ -2184,13 +2905,34 @@ static void posix_shutdown(
     void **posix_buf,
     int *posix_buf_sz)
 {
+#ifdef DARSHAN_WRAP_MMAP
+    struct posix_mmap_tracker *tracker;
+#endif
+
+    /* wait for any in-flight reads/writes to finish updating their shards;
+     * this must be done without holding the POSIX lock, which they may need
+     */
+    darshan_shards_quiesce(&posix_shards);
+
     POSIX_LOCK();
     assert(posix_runtime);
 
-    /* perform any final transformations on POSIX file records before
-     * writing them out to log file
+    /* apply any reads/writes still waiting in threads' event rings, then
+     * fold per-thread read/write counters back into POSIX file records
+     * before writing them out to log file
      */
-    darshan_iter_record_refs(posix_runtime->rec_id_hash, &posix_finalize_file_records);
+    darshan_shards_drain(&posix_shards, &posix_apply_event);
+    darshan_shards_iter(&posix_shards, &posix_merge_file_shard);
+    darshan_iter_record_refs(posix_runtime->rec_id_hash,
+        &posix_record_common_vals);
+
+#ifdef DARSHAN_WRAP_MMAP
+    /* account for file mappings the application did not unmap */
+    POSIX_MMAP_LOCK();
+    LL_FOREACH(posix_mmap_list, tracker)
+        posix_mmap_tracker_sample(tracker);
+    POSIX_MMAP_UNLOCK();
+#endif
 
     /* if there are globally shared files, do a shared file reduction */
     posix_reduce_records(mod_comm, shared_recs, shared_rec_count, posix_buf, posix_buf_sz);
@@ -2202,6 +2944,46 @@ static void posix_shutdown(
     return;
 }
 
+static void posix_snapshot(
+    void **posix_buf,
+    int *posix_buf_sz,
+    int *posix_partial)
+{
+    char *snap_buf = NULL;
+
+    POSIX_LOCK();
+    if(posix_runtime && *posix_buf_sz > 0)
+        snap_buf = malloc(*posix_buf_sz);
+    if(!snap_buf)
+    {
+        POSIX_UNLOCK();
+        *posix_buf = NULL;
+        *posix_buf_sz = 0;
+        return;
+    }
+
+    /* copy the records, then add in the counters threads have accumulated
+     * in their shards since the records were last updated
+     */
+    memcpy(snap_buf, *posix_buf, *posix_buf_sz);
+    posix_snapshot_src = *posix_buf;
+    posix_snapshot_dst = snap_buf;
+    posix_snapshot_len = *posix_buf_sz;
+    darshan_shards_iter(&posix_shards, &posix_snapshot_file_shard);
+    posix_snapshot_src = posix_snapshot_dst = NULL;
+    posix_snapshot_len = 0;
+    POSIX_UNLOCK();
+
+    /* events still waiting in threads' event rings are only applied by
+     * the threads themselves (or at shutdown), so they are left out
+     */
+    if(darshan_shards_pending(&posix_shards) > 0)
+        *posix_partial = 1;
+
+    *posix_buf = snap_buf;
+    return;
+}
+
 /*
  * Local variables:
  *  c-indent-level: 4
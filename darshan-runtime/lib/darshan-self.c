@@ -0,0 +1,451 @@
+/*
+ * Copyright (C) 2015 University of Chicago.
+ * See COPYRIGHT notice in top-level directory.
+ *
+ */
+
+#define _XOPEN_SOURCE 500
+#define _GNU_SOURCE
+
+#include "darshan-runtime-config.h"
+#include <stdio.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <assert.h>
+
+#include "darshan.h"
+#ifdef HAVE_MPI
+#include "darshan-mpi.h"
+#endif
+
+/* The SELF module records the overhead Darshan itself adds to the calls it
+ * instruments, so that it can be weighed against the cost of the calls.
+ *
+ * This module does not intercept any functions. Instead, the other modules
+ * call the DARSHAN_SELF_* hooks (defined in darshan.h) around the
+ * bookkeeping they do for each call, when they take their locks, and so on,
+ * and darshan-core reports the record memory each module uses. The hooks
+ * only update per-module counters in this file; a record is registered for
+ * each module the first time it instruments a call, and the counters are
+ * copied into the records when the log is written. The counters of
+ * darshan-core itself are recorded under the SELF module's own id.
+ *
+ * Self profiling is enabled by setting DARSHAN_SELF_PROFILE.
+ */
+
+/* The self_runtime structure tracks the SELF records registered with
+ * darshan-core; 'rec_mods' gives the module whose counters are held by
+ * each record, in the order the records are stored in the module buffer.
+ */
+struct self_runtime
+{
+    int rec_mods[DARSHAN_MAX_MODS];
+    int rec_count;
+};
+
+static void self_runtime_initialize(
+    void);
+static void self_track_new_record(
+    int mod_id);
+static void self_fill_record(
+    struct darshan_self_record *rec, int mod_id);
+#ifdef HAVE_MPI
+static void self_record_reduction_op(
+    void* inrec_v, void* inoutrec_v, int *len, MPI_Datatype *datatype);
+#endif
+static void self_shutdown(
+    void *mod_comm, darshan_record_id *shared_recs,
+    int shared_rec_count, void **self_buf, int *self_buf_sz);
+static void self_snapshot(
+    void **self_buf, int *self_buf_sz, int *self_partial);
+
+int darshan_self_profile = 0;
+
+static struct self_runtime *self_runtime = NULL;
+static pthread_mutex_t self_runtime_mutex = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+static int my_rank = -1;
+static int self_shutdown_flag = 0;
+
+/* per-module counters and timers (the latter in nanoseconds), updated
+ * atomically so that the hooks never need to take a lock
+ */
+static int64_t self_counters[DARSHAN_MAX_MODS][SELF_NUM_INDICES];
+static int64_t self_timers[DARSHAN_MAX_MODS][SELF_F_NUM_INDICES];
+/* set once a record has been registered (or failed to register) for
+ * each module, so that the hooks can check it without the SELF lock
+ */
+static int self_rec_tracked[DARSHAN_MAX_MODS];
+
+/* the module whose call this thread is instrumenting, and when the
+ * module's bookkeeping for that call started
+ */
+static __thread int self_cur_mod = -1;
+static __thread double self_start = 0;
+
+/* NOTE: the SELF lock is not counted, as it is only taken to register
+ * records and to write them out
+ */
+#define SELF_LOCK() pthread_mutex_lock(&self_runtime_mutex)
+#define SELF_UNLOCK() pthread_mutex_unlock(&self_runtime_mutex)
+
+/**********************************************************
+ *      hooks called by darshan-core and other modules     *
+ **********************************************************/
+
+void darshan_self_enter(int mod_id)
+{
+    if(mod_id < 0 || mod_id >= DARSHAN_MAX_MODS)
+        return;
+
+    if(!self_rec_tracked[mod_id])
+    {
+        SELF_LOCK();
+        if(!self_rec_tracked[mod_id] && !self_shutdown_flag &&
+           !darshan_core_disabled_instrumentation())
+        {
+            if(!self_runtime)
+                self_runtime_initialize();
+            if(self_runtime)
+                self_track_new_record(mod_id);
+            self_rec_tracked[mod_id] = 1;
+        }
+        SELF_UNLOCK();
+    }
+
+    __atomic_add_fetch(&self_counters[mod_id][SELF_CALLS], 1, __ATOMIC_RELAXED);
+    self_cur_mod = mod_id;
+    self_start = darshan_core_wtime();
+
+    return;
+}
+
+void darshan_self_exit(int mod_id)
+{
+    /* a nested call may have already closed this one out */
+    if(self_cur_mod != mod_id)
+        return;
+
+    darshan_self_time(mod_id, SELF_F_BOOKKEEPING_TIME,
+        darshan_core_wtime() - self_start);
+    self_cur_mod = -1;
+
+    return;
+}
+
+void darshan_self_lock(pthread_mutex_t *mutex, int mod_id)
+{
+    double tm1;
+
+    if(pthread_mutex_trylock(mutex) != 0)
+    {
+        tm1 = darshan_core_wtime();
+        pthread_mutex_lock(mutex);
+        darshan_self_time(mod_id, SELF_F_LOCK_WAIT_TIME,
+            darshan_core_wtime() - tm1);
+        darshan_self_count(mod_id, SELF_LOCK_WAITS, 1);
+    }
+    darshan_self_count(mod_id, SELF_LOCKS, 1);
+
+    return;
+}
+
+void darshan_self_count(int mod_id, int counter, int64_t val)
+{
+    if(mod_id == DARSHAN_SELF_CURRENT)
+        mod_id = self_cur_mod;
+    if(mod_id < 0 || mod_id >= DARSHAN_MAX_MODS)
+        return;
+
+    __atomic_add_fetch(&self_counters[mod_id][counter], val, __ATOMIC_RELAXED);
+
+    return;
+}
+
+void darshan_self_max(int mod_id, int counter, int64_t val)
+{
+    int64_t cur;
+
+    if(mod_id == DARSHAN_SELF_CURRENT)
+        mod_id = self_cur_mod;
+    if(mod_id < 0 || mod_id >= DARSHAN_MAX_MODS)
+        return;
+
+    cur = __atomic_load_n(&self_counters[mod_id][counter], __ATOMIC_RELAXED);
+    while(val > cur && !__atomic_compare_exchange_n(
+        &self_counters[mod_id][counter], &cur, val, 1,
+        __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+    return;
+}
+
+void darshan_self_time(int mod_id, int fcounter, double elapsed)
+{
+    if(mod_id == DARSHAN_SELF_CURRENT)
+        mod_id = self_cur_mod;
+    if(mod_id < 0 || mod_id >= DARSHAN_MAX_MODS || elapsed <= 0)
+        return;
+
+    __atomic_add_fetch(&self_timers[mod_id][fcounter],
+        (int64_t)(elapsed * 1e9), __ATOMIC_RELAXED);
+
+    return;
+}
+
+/**********************************************************
+ * Internal functions for manipulating SELF module state  *
+ **********************************************************/
+
+static void self_runtime_initialize()
+{
+    int self_buf_size;
+
+    /* at most one record per module */
+    self_buf_size = DARSHAN_MAX_MODS * sizeof(struct darshan_self_record);
+
+    darshan_core_register_module(
+        DARSHAN_SELF_MOD,
+        &self_shutdown,
+        &self_buf_size,
+        &my_rank,
+        NULL);
+
+    /* return if darshan-core does not provide enough module memory */
+    if(self_buf_size < sizeof(struct darshan_self_record))
+    {
+        darshan_core_unregister_module(DARSHAN_SELF_MOD);
+        return;
+    }
+    darshan_core_register_module_snapshot(DARSHAN_SELF_MOD, &self_snapshot);
+
+    self_runtime = malloc(sizeof(*self_runtime));
+    if(!self_runtime)
+    {
+        darshan_core_unregister_module(DARSHAN_SELF_MOD);
+        return;
+    }
+    memset(self_runtime, 0, sizeof(*self_runtime));
+
+    /* darshan-core's own counters are kept under the SELF module's id */
+    self_track_new_record(DARSHAN_SELF_MOD);
+
+    return;
+}
+
+static void self_track_new_record(int mod_id)
+{
+    struct darshan_self_record *rec;
+    darshan_record_id rec_id;
+    char name[64];
+
+    /* only try once, even if the record can't be registered */
+    self_rec_tracked[mod_id] = 1;
+
+    if(mod_id == DARSHAN_SELF_MOD)
+        snprintf(name, sizeof(name), "darshan-core");
+    else
+        snprintf(name, sizeof(name), "darshan-self:%s",
+            darshan_module_names[mod_id]);
+
+    rec_id = darshan_core_gen_record_id(name);
+    rec = darshan_core_register_record(
+        rec_id,
+        name,
+        DARSHAN_SELF_MOD,
+        sizeof(struct darshan_self_record),
+        NULL);
+    if(!rec)
+        return;
+
+    rec->base_rec.id = rec_id;
+    rec->base_rec.rank = my_rank;
+    self_runtime->rec_mods[self_runtime->rec_count++] = mod_id;
+
+    return;
+}
+
+/* copy the current counters of module 'mod_id' into the record 'rec' */
+static void self_fill_record(struct darshan_self_record *rec, int mod_id)
+{
+    int i;
+
+    for(i = 0; i < SELF_NUM_INDICES; i++)
+        rec->counters[i] = __atomic_load_n(&self_counters[mod_id][i],
+            __ATOMIC_RELAXED);
+    for(i = 0; i < SELF_F_NUM_INDICES; i++)
+        rec->fcounters[i] = __atomic_load_n(&self_timers[mod_id][i],
+            __ATOMIC_RELAXED) * 1e-9;
+
+    return;
+}
+
+#ifdef HAVE_MPI
+static void self_record_reduction_op(void* inrec_v, void* inoutrec_v,
+    int *len, MPI_Datatype *datatype)
+{
+    struct darshan_self_record *inrec = inrec_v;
+    struct darshan_self_record *inoutrec = inoutrec_v;
+    int i, j;
+
+    for(i=0; i<*len; i++)
+    {
+        inoutrec->base_rec.rank = -1;
+
+        /* sum */
+        for(j=SELF_CALLS; j<=SELF_RECORDS_DROPPED; j++)
+            inoutrec->counters[j] += inrec->counters[j];
+
+        /* max */
+        for(j=SELF_MEM_MAX; j<=SELF_MEM_LIMIT; j++)
+        {
+            if(inrec->counters[j] > inoutrec->counters[j])
+                inoutrec->counters[j] = inrec->counters[j];
+        }
+
+        /* sum */
+        for(j=0; j<SELF_F_NUM_INDICES; j++)
+            inoutrec->fcounters[j] += inrec->fcounters[j];
+
+        inrec++;
+        inoutrec++;
+    }
+
+    return;
+}
+#endif
+
+/********************************************************************************
+ * shutdown function exported by this module for coordinating with darshan-core *
+ ********************************************************************************/
+
+static void self_shutdown(
+    void *mod_comm,
+    darshan_record_id *shared_recs,
+    int shared_rec_count,
+    void **self_buf,
+    int *self_buf_sz)
+{
+    struct darshan_self_record *self_rec_buf =
+        *(struct darshan_self_record **)self_buf;
+    int self_rec_count;
+    int i;
+#ifdef HAVE_MPI
+    int j;
+    struct darshan_self_record *red_send_buf = NULL;
+    struct darshan_self_record *red_recv_buf = NULL;
+    MPI_Op red_op;
+#endif
+
+    SELF_LOCK();
+    assert(self_runtime);
+
+    /* stop counting; darshan-core shuts SELF down after every other module */
+    darshan_self_profile = 0;
+    self_shutdown_flag = 1;
+
+    self_rec_count = self_runtime->rec_count;
+    for(i = 0; i < self_rec_count; i++)
+        self_fill_record(&self_rec_buf[i], self_runtime->rec_mods[i]);
+
+#ifdef HAVE_MPI
+    /* NOTE: the shared record reduction is also skipped if the
+     * DARSHAN_DISABLE_SHARED_REDUCTION environment variable is set.
+     */
+    if(shared_rec_count && !getenv("DARSHAN_DISABLE_SHARED_REDUCTION"))
+    {
+        for(i = 0; i < self_rec_count; i++)
+        {
+            for(j = 0; j < shared_rec_count; j++)
+            {
+                if(self_rec_buf[i].base_rec.id == shared_recs[j])
+                    self_rec_buf[i].base_rec.rank = -1;
+            }
+        }
+
+        /* sort the array of records so we get all of the shared records
+         * (marked by rank -1) in a contiguous portion at end of the array
+         */
+        darshan_record_sort(self_rec_buf, self_rec_count,
+            sizeof(struct darshan_self_record));
+
+        /* make send_buf point to the shared records at the end of the array */
+        red_send_buf = &(self_rec_buf[self_rec_count-shared_rec_count]);
+
+        /* allocate memory for the reduction output on rank 0 */
+        if(my_rank == 0)
+        {
+            red_recv_buf = malloc(shared_rec_count *
+                sizeof(struct darshan_self_record));
+            if(!red_recv_buf)
+            {
+                SELF_UNLOCK();
+                return;
+            }
+        }
+
+        darshan_mpi_op_create(self_record_reduction_op, 1, &red_op);
+        darshan_mpi_reduce_records(red_send_buf, red_recv_buf, shared_rec_count,
+            sizeof(struct darshan_self_record), red_op, 0,
+            *((MPI_Comm*)mod_comm));
+
+        if(my_rank == 0)
+        {
+            memcpy(red_send_buf, red_recv_buf,
+                shared_rec_count * sizeof(struct darshan_self_record));
+            free(red_recv_buf);
+        }
+        else
+        {
+            self_rec_count -= shared_rec_count;
+        }
+
+        darshan_mpi_op_free(&red_op);
+    }
+#endif
+
+    *self_buf_sz = self_rec_count * sizeof(struct darshan_self_record);
+
+    free(self_runtime);
+    self_runtime = NULL;
+
+    SELF_UNLOCK();
+    return;
+}
+
+static void self_snapshot(
+    void **self_buf,
+    int *self_buf_sz,
+    int *self_partial)
+{
+    struct darshan_self_record *snap_buf = NULL;
+    int i;
+
+    SELF_LOCK();
+    if(self_runtime && *self_buf_sz > 0)
+        snap_buf = malloc(*self_buf_sz);
+    if(!snap_buf)
+    {
+        SELF_UNLOCK();
+        *self_buf = NULL;
+        *self_buf_sz = 0;
+        return;
+    }
+
+    memcpy(snap_buf, *self_buf, *self_buf_sz);
+    for(i = 0; i < self_runtime->rec_count; i++)
+        self_fill_record(&snap_buf[i], self_runtime->rec_mods[i]);
+    SELF_UNLOCK();
+
+    *self_buf = snap_buf;
+    return;
+}
+
+/*
+ * Local variables:
+ *  c-indent-level: 4
+ *  c-basic-offset: 4
+ * End:
+ *
+ * vim: ts=8 sts=4 sw=4 expandtab
+ */
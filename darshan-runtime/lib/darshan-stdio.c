@@ -126,9 +126,19 @@ struct stdio_file_record_ref
     struct darshan_stdio_file* file_rec;
     int64_t offset;
     double last_meta_end;
+    int fs_type;
+};
+
+/* per-thread read/write counters for a stdio file record, merged into
+ * the record at shutdown time so that read and write wrappers do not need
+ * to acquire the STDIO lock
+ */
+struct stdio_file_shard
+{
+    struct stdio_file_record_ref *rec_ref;
+    struct darshan_stdio_file rec;
     double last_read_end;
     double last_write_end;
-    int fs_type;
 };
 
 /* The stdio_runtime structure maintains necessary state for storing
@@ -142,10 +152,23 @@ struct stdio_runtime
     int file_rec_count;
 };
 
+static void stdio_thread_exit(struct darshan_thread_shards *shards);
+
 static struct stdio_runtime *stdio_runtime = NULL;
 static pthread_mutex_t stdio_runtime_mutex = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
 static int darshan_mem_alignment = 1;
 static int my_rank = -1;
+static struct darshan_shard_registry stdio_shards =
+    DARSHAN_SHARD_REGISTRY_INITIALIZER(sizeof(struct stdio_file_shard),
+        &stdio_thread_exit);
+static __thread struct darshan_thread_shards *stdio_thread_shards = NULL;
+
+/* source and destination record buffers of an in-progress snapshot,
+ * protected by the STDIO lock
+ */
+static char *stdio_snapshot_src = NULL;
+static char *stdio_snapshot_dst = NULL;
+static int stdio_snapshot_len = 0;
 
 static void stdio_runtime_initialize(void);
 static void stdio_shutdown(
@@ -161,6 +184,16 @@ static void stdio_shared_record_variance(
     struct darshan_stdio_file *outrec_array, int shared_rec_count);
 static struct stdio_file_record_ref *stdio_track_new_file_record(
     darshan_record_id rec_id, const char *path);
+static struct stdio_file_shard *stdio_lookup_shard(FILE *stream);
+static void stdio_merge_file_shard(void *shard_p);
+static void stdio_fold_file_shard(struct darshan_stdio_file *file_rec,
+    struct darshan_stdio_file *shard_rec);
+static void stdio_snapshot_file_shard(void *shard_p);
+static void stdio_apply_event(struct darshan_shard_event *event);
+static int stdio_filter_std_records(struct darshan_stdio_file *stdio_rec_buf,
+    int stdio_rec_count);
+static void stdio_snapshot(void **stdio_buf, int *stdio_buf_sz,
+    int *stdio_partial);
 static void stdio_cleanup_runtime();
 
 /* extern function def for querying record name from a POSIX fd */
@@ -173,47 +206,58 @@ extern int (*__real_fileno)(FILE *stream);
 extern int __real_fileno(FILE *stream);
 #endif
 
-#define STDIO_LOCK() pthread_mutex_lock(&stdio_runtime_mutex)
+#define STDIO_LOCK() DARSHAN_SELF_LOCK(&stdio_runtime_mutex, DARSHAN_STDIO_MOD)
 #define STDIO_UNLOCK() pthread_mutex_unlock(&stdio_runtime_mutex)
 
 #define STDIO_PRE_RECORD() do { \
+    DARSHAN_SELF_ENTER(DARSHAN_STDIO_MOD); \
     STDIO_LOCK(); \
     if(!darshan_core_disabled_instrumentation()) { \
         if(!stdio_runtime) stdio_runtime_initialize(); \
         if(stdio_runtime) break; \
     } \
     STDIO_UNLOCK(); \
+    DARSHAN_SELF_EXIT(DARSHAN_STDIO_MOD); \
     return(ret); \
 } while(0)
 
 #define STDIO_POST_RECORD() do { \
     STDIO_UNLOCK(); \
+    DARSHAN_SELF_EXIT(DARSHAN_STDIO_MOD); \
+} while(0)
+
+#define STDIO_PRE_RECORD_SHARDED() do { \
+    DARSHAN_SELF_ENTER(DARSHAN_STDIO_MOD); \
+    if(darshan_shards_enter(&stdio_shards, &stdio_thread_shards)) break; \
+    DARSHAN_SELF_EXIT(DARSHAN_STDIO_MOD); \
+    return(ret); \
+} while(0)
+
+#define STDIO_POST_RECORD_SHARDED() do { \
+    darshan_shards_exit(stdio_thread_shards); \
+    DARSHAN_SELF_EXIT(DARSHAN_STDIO_MOD); \
 } while(0)
 
 #define STDIO_RECORD_OPEN(__ret, __path, __tm1, __tm2) do { \
     darshan_record_id __rec_id; \
     struct stdio_file_record_ref *__rec_ref; \
+    char __pathbuf[PATH_MAX]; \
     char *__newpath; \
     int __fd; \
     MAP_OR_FAIL(fileno); \
     if(!__ret || !__path) break; \
-    __newpath = darshan_clean_file_path(__path); \
-    if(!__newpath) __newpath = (char*)__path; \
-    if(darshan_core_excluded_path(__newpath)) { \
-        if(__newpath != (char*)__path) free(__newpath); \
-        break; \
+    __newpath = darshan_clean_file_path_id(__path, __pathbuf, &__rec_id); \
+    if(!__newpath) { \
+        __newpath = (char*)__path; \
+        __rec_id = darshan_core_gen_record_id(__newpath); \
     } \
-    __rec_id = darshan_core_gen_record_id(__newpath); \
+    if(darshan_core_excluded_path(DARSHAN_STDIO_MOD, __newpath)) break; \
     __rec_ref = darshan_lookup_record_ref(stdio_runtime->rec_id_hash, &__rec_id, sizeof(darshan_record_id)); \
     if(!__rec_ref) __rec_ref = stdio_track_new_file_record(__rec_id, __newpath); \
-    if(!__rec_ref) { \
-        if(__newpath != (char*)__path) free(__newpath); \
-        break; \
-    } \
+    if(!__rec_ref) break; \
     _STDIO_RECORD_OPEN(__ret, __rec_ref, __tm1, __tm2, 1, -1); \
     __fd = __real_fileno(__ret); \
     darshan_instrument_fs_data(__rec_ref->fs_type, __newpath, __fd); \
-    if(__newpath != (char*)__path) free(__newpath); \
 } while(0)
 
 #define STDIO_RECORD_REFOPEN(__ret, __rec_ref, __tm1, __tm2, __ref_counter) do { \
@@ -222,7 +266,7 @@ extern int __real_fileno(FILE *stream);
 } while(0)
 
 #define _STDIO_RECORD_OPEN(__ret, __rec_ref, __tm1, __tm2, __reset_flag, __ref_counter) do { \
-    if(__reset_flag) __rec_ref->offset = 0; \
+    if(__reset_flag) __atomic_store_n(&__rec_ref->offset, 0, __ATOMIC_RELAXED); \
     __rec_ref->file_rec->counters[STDIO_OPENS] += 1; \
     if(__ref_counter >= 0) __rec_ref->file_rec->counters[__ref_counter] += 1; \
     if(__rec_ref->file_rec->fcounters[STDIO_F_OPEN_START_TIMESTAMP] == 0 || \
@@ -231,46 +275,37 @@ extern int __real_fileno(FILE *stream);
     __rec_ref->file_rec->fcounters[STDIO_F_OPEN_END_TIMESTAMP] = __tm2; \
     DARSHAN_TIMER_INC_NO_OVERLAP(__rec_ref->file_rec->fcounters[STDIO_F_META_TIME], __tm1, __tm2, __rec_ref->last_meta_end); \
     darshan_add_record_ref(&(stdio_runtime->stream_hash), &(__ret), sizeof(__ret), __rec_ref); \
+    darshan_shards_invalidate(&stdio_shards, (uint64_t)(uintptr_t)(__ret)); \
 } while(0)
 
 
-#define STDIO_RECORD_READ(__fp, __bytes,  __tm1, __tm2) do{ \
-    struct stdio_file_record_ref* rec_ref; \
-    int64_t this_offset; \
-    rec_ref = darshan_lookup_record_ref(stdio_runtime->stream_hash, &(__fp), sizeof(__fp)); \
-    if(!rec_ref) break; \
-    this_offset = rec_ref->offset; \
-    rec_ref->offset = this_offset + __bytes; \
-    if(rec_ref->file_rec->counters[STDIO_MAX_BYTE_READ] < (this_offset + __bytes - 1)) \
-        rec_ref->file_rec->counters[STDIO_MAX_BYTE_READ] = (this_offset + __bytes - 1); \
-    rec_ref->file_rec->counters[STDIO_BYTES_READ] += __bytes; \
-    rec_ref->file_rec->counters[STDIO_READS] += 1; \
-    if(rec_ref->file_rec->fcounters[STDIO_F_READ_START_TIMESTAMP] == 0 || \
-     rec_ref->file_rec->fcounters[STDIO_F_READ_START_TIMESTAMP] > __tm1) \
-        rec_ref->file_rec->fcounters[STDIO_F_READ_START_TIMESTAMP] = __tm1; \
-    rec_ref->file_rec->fcounters[STDIO_F_READ_END_TIMESTAMP] = __tm2; \
-    DARSHAN_TIMER_INC_NO_OVERLAP(rec_ref->file_rec->fcounters[STDIO_F_READ_TIME], __tm1, __tm2, rec_ref->last_read_end); \
-} while(0)
-
-#define STDIO_RECORD_WRITE(__fp, __bytes,  __tm1, __tm2, __fflush_flag) do{ \
-    struct stdio_file_record_ref* rec_ref; \
-    int64_t this_offset; \
-    rec_ref = darshan_lookup_record_ref(stdio_runtime->stream_hash, &(__fp), sizeof(__fp)); \
-    if(!rec_ref) break; \
-    this_offset = rec_ref->offset; \
-    rec_ref->offset = this_offset + __bytes; \
-    if(rec_ref->file_rec->counters[STDIO_MAX_BYTE_WRITTEN] < (this_offset + __bytes - 1)) \
-        rec_ref->file_rec->counters[STDIO_MAX_BYTE_WRITTEN] = (this_offset + __bytes - 1); \
-    rec_ref->file_rec->counters[STDIO_BYTES_WRITTEN] += __bytes; \
-    if(__fflush_flag) \
-        rec_ref->file_rec->counters[STDIO_FLUSHES] += 1; \
-    else \
-        rec_ref->file_rec->counters[STDIO_WRITES] += 1; \
-    if(rec_ref->file_rec->fcounters[STDIO_F_WRITE_START_TIMESTAMP] == 0 || \
-     rec_ref->file_rec->fcounters[STDIO_F_WRITE_START_TIMESTAMP] > __tm1) \
-        rec_ref->file_rec->fcounters[STDIO_F_WRITE_START_TIMESTAMP] = __tm1; \
-    rec_ref->file_rec->fcounters[STDIO_F_WRITE_END_TIMESTAMP] = __tm2; \
-    DARSHAN_TIMER_INC_NO_OVERLAP(rec_ref->file_rec->fcounters[STDIO_F_WRITE_TIME], __tm1, __tm2, rec_ref->last_write_end); \
+/* read and write wrappers only resolve the calling thread's shard and the
+ * stream offset of the access when the call completes; the remaining
+ * counter updates are made by stdio_apply_event(), either immediately or,
+ * if DARSHAN_EVENT_RING is set, in batches from the thread's event ring
+ */
+#define STDIO_RECORD_READ(__fp, __bytes,  __tm1, __tm2) \
+    STDIO_RECORD_RW(DARSHAN_IO_READ, __fp, __bytes, __tm1, __tm2, 0)
+
+#define STDIO_RECORD_WRITE(__fp, __bytes,  __tm1, __tm2, __fflush_flag) \
+    STDIO_RECORD_RW(DARSHAN_IO_WRITE, __fp, __bytes, __tm1, __tm2, __fflush_flag)
+
+#define STDIO_RECORD_RW(__op, __fp, __bytes, __tm1, __tm2, __fflush_flag) do{ \
+    struct stdio_file_shard* __shard; \
+    struct darshan_shard_event __event_buf; \
+    struct darshan_shard_event* __event; \
+    __shard = stdio_lookup_shard(__fp); \
+    if(!__shard) break; \
+    __event = darshan_shards_defer(stdio_thread_shards, &stdio_apply_event); \
+    if(!__event) __event = &__event_buf; \
+    __event->shard_p = __shard; \
+    __event->offset = __atomic_fetch_add(&__shard->rec_ref->offset, __bytes, __ATOMIC_RELAXED); \
+    __event->size = __bytes; \
+    __event->tm1 = __tm1; \
+    __event->tm2 = __tm2; \
+    __event->op = __op; \
+    __event->flags = __fflush_flag; \
+    if(__event == &__event_buf) stdio_apply_event(__event); \
 } while(0)
 
 FILE* DARSHAN_DECL(fopen)(const char *path, const char *mode)
@@ -285,6 +320,7 @@ FILE* DARSHAN_DECL(fopen)(const char *path, const char *mode)
     tm2 = darshan_core_wtime();
 
     STDIO_PRE_RECORD();
+    DARSHAN_SELF_TIME(DARSHAN_STDIO_MOD, SELF_F_REAL_TIME, tm2 - tm1);
     STDIO_RECORD_OPEN(ret, path, tm1, tm2);
     STDIO_POST_RECORD();
 
@@ -303,6 +339,7 @@ FILE* DARSHAN_DECL(fopen64)(const char *path, const char *mode)
     tm2 = darshan_core_wtime();
 
     STDIO_PRE_RECORD();
+    DARSHAN_SELF_TIME(DARSHAN_STDIO_MOD, SELF_F_REAL_TIME, tm2 - tm1);
     STDIO_RECORD_OPEN(ret, path, tm1, tm2);
     STDIO_POST_RECORD();
 
@@ -330,12 +367,14 @@ FILE* DARSHAN_DECL(fdopen)(int fd, const char *mode)
             rec_id = darshan_core_gen_record_id(rec_name);
 
             STDIO_PRE_RECORD();
+            DARSHAN_SELF_TIME(DARSHAN_STDIO_MOD, SELF_F_REAL_TIME, tm2 - tm1);
             rec_ref = darshan_lookup_record_ref(stdio_runtime->rec_id_hash,
                 &rec_id, sizeof(darshan_record_id));
             if(!rec_ref)
                 rec_ref = stdio_track_new_file_record(rec_id, rec_name);
             STDIO_RECORD_REFOPEN(ret, rec_ref, tm1, tm2, STDIO_FDOPENS);
             STDIO_POST_RECORD();
+            free(rec_name);
         }
     }
 
@@ -355,6 +394,7 @@ FILE* DARSHAN_DECL(freopen)(const char *path, const char *mode, FILE *stream)
     tm2 = darshan_core_wtime();
 
     STDIO_PRE_RECORD();
+    DARSHAN_SELF_TIME(DARSHAN_STDIO_MOD, SELF_F_REAL_TIME, tm2 - tm1);
     STDIO_RECORD_OPEN(ret, path, tm1, tm2);
     STDIO_POST_RECORD();
 
@@ -373,6 +413,7 @@ FILE* DARSHAN_DECL(freopen64)(const char *path, const char *mode, FILE *stream)
     tm2 = darshan_core_wtime();
 
     STDIO_PRE_RECORD();
+    DARSHAN_SELF_TIME(DARSHAN_STDIO_MOD, SELF_F_REAL_TIME, tm2 - tm1);
     STDIO_RECORD_OPEN(ret, path, tm1, tm2);
     STDIO_POST_RECORD();
 
@@ -391,10 +432,11 @@ int DARSHAN_DECL(fflush)(FILE *fp)
     ret = __real_fflush(fp);
     tm2 = darshan_core_wtime();
 
-    STDIO_PRE_RECORD();
+    STDIO_PRE_RECORD_SHARDED();
+    DARSHAN_SELF_TIME(DARSHAN_STDIO_MOD, SELF_F_REAL_TIME, tm2 - tm1);
     if(ret >= 0)
         STDIO_RECORD_WRITE(fp, 0, tm1, tm2, 1);
-    STDIO_POST_RECORD();
+    STDIO_POST_RECORD_SHARDED();
 
     return(ret);
 }
@@ -412,6 +454,7 @@ int DARSHAN_DECL(fclose)(FILE *fp)
     tm2 = darshan_core_wtime();
 
     STDIO_PRE_RECORD();
+    DARSHAN_SELF_TIME(DARSHAN_STDIO_MOD, SELF_F_REAL_TIME, tm2 - tm1);
     rec_ref = darshan_lookup_record_ref(stdio_runtime->stream_hash, &fp, sizeof(fp));
     if(rec_ref)
     {
@@ -423,6 +466,7 @@ int DARSHAN_DECL(fclose)(FILE *fp)
             rec_ref->file_rec->fcounters[STDIO_F_META_TIME],
             tm1, tm2, rec_ref->last_meta_end);
         darshan_delete_record_ref(&(stdio_runtime->stream_hash), &fp, sizeof(fp));
+        darshan_shards_invalidate(&stdio_shards, (uint64_t)(uintptr_t)fp);
     }
     STDIO_POST_RECORD();
 
@@ -440,10 +484,11 @@ size_t DARSHAN_DECL(fwrite)(const void *ptr, size_t size, size_t nmemb, FILE *st
     ret = __real_fwrite(ptr, size, nmemb, stream);
     tm2 = darshan_core_wtime();
 
-    STDIO_PRE_RECORD();
+    STDIO_PRE_RECORD_SHARDED();
+    DARSHAN_SELF_TIME(DARSHAN_STDIO_MOD, SELF_F_REAL_TIME, tm2 - tm1);
     if(ret > 0)
         STDIO_RECORD_WRITE(stream, size*ret, tm1, tm2, 0);
-    STDIO_POST_RECORD();
+    STDIO_POST_RECORD_SHARDED();
 
     return(ret);
 }
@@ -460,10 +505,11 @@ int DARSHAN_DECL(fputc)(int c, FILE *stream)
     ret = __real_fputc(c, stream);
     tm2 = darshan_core_wtime();
 
-    STDIO_PRE_RECORD();
+    STDIO_PRE_RECORD_SHARDED();
+    DARSHAN_SELF_TIME(DARSHAN_STDIO_MOD, SELF_F_REAL_TIME, tm2 - tm1);
     if(ret != EOF)
         STDIO_RECORD_WRITE(stream, 1, tm1, tm2, 0);
-    STDIO_POST_RECORD();
+    STDIO_POST_RECORD_SHARDED();
 
     return(ret);
 }
@@ -479,10 +525,11 @@ int DARSHAN_DECL(putw)(int w, FILE *stream)
     ret = __real_putw(w, stream);
     tm2 = darshan_core_wtime();
 
-    STDIO_PRE_RECORD();
+    STDIO_PRE_RECORD_SHARDED();
+    DARSHAN_SELF_TIME(DARSHAN_STDIO_MOD, SELF_F_REAL_TIME, tm2 - tm1);
     if(ret != EOF)
         STDIO_RECORD_WRITE(stream, sizeof(int), tm1, tm2, 0);
-    STDIO_POST_RECORD();
+    STDIO_POST_RECORD_SHARDED();
 
     return(ret);
 }
@@ -500,10 +547,11 @@ int DARSHAN_DECL(fputs)(const char *s, FILE *stream)
     ret = __real_fputs(s, stream);
     tm2 = darshan_core_wtime();
 
-    STDIO_PRE_RECORD();
+    STDIO_PRE_RECORD_SHARDED();
+    DARSHAN_SELF_TIME(DARSHAN_STDIO_MOD, SELF_F_REAL_TIME, tm2 - tm1);
     if(ret != EOF && ret > 0)
         STDIO_RECORD_WRITE(stream, strlen(s), tm1, tm2, 0);
-    STDIO_POST_RECORD();
+    STDIO_POST_RECORD_SHARDED();
 
     return(ret);
 }
@@ -519,10 +567,11 @@ int DARSHAN_DECL(vprintf)(const char *format, va_list ap)
     ret = __real_vprintf(format, ap);
     tm2 = darshan_core_wtime();
 
-    STDIO_PRE_RECORD();
+    STDIO_PRE_RECORD_SHARDED();
+    DARSHAN_SELF_TIME(DARSHAN_STDIO_MOD, SELF_F_REAL_TIME, tm2 - tm1);
     if(ret > 0)
         STDIO_RECORD_WRITE(stdout, ret, tm1, tm2, 0);
-    STDIO_POST_RECORD();
+    STDIO_POST_RECORD_SHARDED();
 
     return(ret);
 }
@@ -538,10 +587,11 @@ int DARSHAN_DECL(vfprintf)(FILE *stream, const char *format, va_list ap)
     ret = __real_vfprintf(stream, format, ap);
     tm2 = darshan_core_wtime();
 
-    STDIO_PRE_RECORD();
+    STDIO_PRE_RECORD_SHARDED();
+    DARSHAN_SELF_TIME(DARSHAN_STDIO_MOD, SELF_F_REAL_TIME, tm2 - tm1);
     if(ret > 0)
         STDIO_RECORD_WRITE(stream, ret, tm1, tm2, 0);
-    STDIO_POST_RECORD();
+    STDIO_POST_RECORD_SHARDED();
 
     return(ret);
 }
@@ -564,10 +614,11 @@ int DARSHAN_DECL(printf)(const char *format, ...)
     va_end(ap);
     tm2 = darshan_core_wtime();
 
-    STDIO_PRE_RECORD();
+    STDIO_PRE_RECORD_SHARDED();
+    DARSHAN_SELF_TIME(DARSHAN_STDIO_MOD, SELF_F_REAL_TIME, tm2 - tm1);
     if(ret > 0)
         STDIO_RECORD_WRITE(stdout, ret, tm1, tm2, 0);
-    STDIO_POST_RECORD();
+    STDIO_POST_RECORD_SHARDED();
 
     return(ret);
 }
@@ -589,10 +640,11 @@ int DARSHAN_DECL(fprintf)(FILE *stream, const char *format, ...)
     va_end(ap);
     tm2 = darshan_core_wtime();
 
-    STDIO_PRE_RECORD();
+    STDIO_PRE_RECORD_SHARDED();
+    DARSHAN_SELF_TIME(DARSHAN_STDIO_MOD, SELF_F_REAL_TIME, tm2 - tm1);
     if(ret > 0)
         STDIO_RECORD_WRITE(stream, ret, tm1, tm2, 0);
-    STDIO_POST_RECORD();
+    STDIO_POST_RECORD_SHARDED();
 
     return(ret);
 }
@@ -608,10 +660,11 @@ size_t DARSHAN_DECL(fread)(void *ptr, size_t size, size_t nmemb, FILE *stream)
     ret = __real_fread(ptr, size, nmemb, stream);
     tm2 = darshan_core_wtime();
 
-    STDIO_PRE_RECORD();
+    STDIO_PRE_RECORD_SHARDED();
+    DARSHAN_SELF_TIME(DARSHAN_STDIO_MOD, SELF_F_REAL_TIME, tm2 - tm1);
     if(ret > 0)
         STDIO_RECORD_READ(stream, size*ret, tm1, tm2);
-    STDIO_POST_RECORD();
+    STDIO_POST_RECORD_SHARDED();
 
     return(ret);
 }
@@ -627,10 +680,11 @@ int DARSHAN_DECL(fgetc)(FILE *stream)
     ret = __real_fgetc(stream);
     tm2 = darshan_core_wtime();
 
-    STDIO_PRE_RECORD();
+    STDIO_PRE_RECORD_SHARDED();
+    DARSHAN_SELF_TIME(DARSHAN_STDIO_MOD, SELF_F_REAL_TIME, tm2 - tm1);
     if(ret != EOF)
         STDIO_RECORD_READ(stream, 1, tm1, tm2);
-    STDIO_POST_RECORD();
+    STDIO_POST_RECORD_SHARDED();
 
     return(ret);
 }
@@ -647,10 +701,11 @@ int DARSHAN_DECL(_IO_getc)(FILE *stream)
     ret = __real__IO_getc(stream);
     tm2 = darshan_core_wtime();
 
-    STDIO_PRE_RECORD();
+    STDIO_PRE_RECORD_SHARDED();
+    DARSHAN_SELF_TIME(DARSHAN_STDIO_MOD, SELF_F_REAL_TIME, tm2 - tm1);
     if(ret != EOF)
         STDIO_RECORD_READ(stream, 1, tm1, tm2);
-    STDIO_POST_RECORD();
+    STDIO_POST_RECORD_SHARDED();
 
     return(ret);
 }
@@ -667,10 +722,11 @@ int DARSHAN_DECL(_IO_putc)(int c, FILE *stream)
     ret = __real__IO_putc(c, stream);
     tm2 = darshan_core_wtime();
 
-    STDIO_PRE_RECORD();
+    STDIO_PRE_RECORD_SHARDED();
+    DARSHAN_SELF_TIME(DARSHAN_STDIO_MOD, SELF_F_REAL_TIME, tm2 - tm1);
     if(ret != EOF)
         STDIO_RECORD_WRITE(stream, 1, tm1, tm2, 0);
-    STDIO_POST_RECORD();
+    STDIO_POST_RECORD_SHARDED();
 
     return(ret);
 }
@@ -686,10 +742,11 @@ int DARSHAN_DECL(getw)(FILE *stream)
     ret = __real_getw(stream);
     tm2 = darshan_core_wtime();
 
-    STDIO_PRE_RECORD();
+    STDIO_PRE_RECORD_SHARDED();
+    DARSHAN_SELF_TIME(DARSHAN_STDIO_MOD, SELF_F_REAL_TIME, tm2 - tm1);
     if(ret != EOF || ferror(stream) == 0)
         STDIO_RECORD_READ(stream, sizeof(int), tm1, tm2);
-    STDIO_POST_RECORD();
+    STDIO_POST_RECORD_SHARDED();
 
     return(ret);
 }
@@ -717,10 +774,11 @@ int DARSHAN_DECL(__isoc99_fscanf)(FILE *stream, const char *format, ...)
     end_off = ftell(stream);
     tm2 = darshan_core_wtime();
 
-    STDIO_PRE_RECORD();
+    STDIO_PRE_RECORD_SHARDED();
+    DARSHAN_SELF_TIME(DARSHAN_STDIO_MOD, SELF_F_REAL_TIME, tm2 - tm1);
     if(ret != 0)
         STDIO_RECORD_READ(stream, (end_off-start_off), tm1, tm2);
-    STDIO_POST_RECORD();
+    STDIO_POST_RECORD_SHARDED();
 
     return(ret);
 }
@@ -746,10 +804,11 @@ int DARSHAN_DECL(fscanf)(FILE *stream, const char *format, ...)
     end_off = ftell(stream);
     tm2 = darshan_core_wtime();
 
-    STDIO_PRE_RECORD();
+    STDIO_PRE_RECORD_SHARDED();
+    DARSHAN_SELF_TIME(DARSHAN_STDIO_MOD, SELF_F_REAL_TIME, tm2 - tm1);
     if(ret != 0)
         STDIO_RECORD_READ(stream, (end_off-start_off), tm1, tm2);
-    STDIO_POST_RECORD();
+    STDIO_POST_RECORD_SHARDED();
 
     return(ret);
 }
@@ -768,10 +827,11 @@ int DARSHAN_DECL(vfscanf)(FILE *stream, const char *format, va_list ap)
     end_off = ftell(stream);
     tm2 = darshan_core_wtime();
 
-    STDIO_PRE_RECORD();
+    STDIO_PRE_RECORD_SHARDED();
+    DARSHAN_SELF_TIME(DARSHAN_STDIO_MOD, SELF_F_REAL_TIME, tm2 - tm1);
     if(ret != 0)
         STDIO_RECORD_READ(stream, end_off-start_off, tm1, tm2);
-    STDIO_POST_RECORD();
+    STDIO_POST_RECORD_SHARDED();
 
     return(ret);
 }
@@ -788,10 +848,11 @@ char* DARSHAN_DECL(fgets)(char *s, int size, FILE *stream)
     ret = __real_fgets(s, size, stream);
     tm2 = darshan_core_wtime();
 
-    STDIO_PRE_RECORD();
+    STDIO_PRE_RECORD_SHARDED();
+    DARSHAN_SELF_TIME(DARSHAN_STDIO_MOD, SELF_F_REAL_TIME, tm2 - tm1);
     if(ret != NULL)
         STDIO_RECORD_READ(stream, strlen(ret), tm1, tm2);
-    STDIO_POST_RECORD();
+    STDIO_POST_RECORD_SHARDED();
 
     return(ret);
 }
@@ -821,12 +882,13 @@ void DARSHAN_DECL(rewind)(FILE *stream)
         STDIO_UNLOCK();
         return;
     }
+    DARSHAN_SELF_TIME(DARSHAN_STDIO_MOD, SELF_F_REAL_TIME, tm2 - tm1);
 
     rec_ref = darshan_lookup_record_ref(stdio_runtime->stream_hash, &stream, sizeof(stream));
 
     if(rec_ref)
     {
-        rec_ref->offset = 0;
+        __atomic_store_n(&rec_ref->offset, 0, __ATOMIC_RELAXED);
         DARSHAN_TIMER_INC_NO_OVERLAP(
             rec_ref->file_rec->fcounters[STDIO_F_META_TIME],
             tm1, tm2, rec_ref->last_meta_end);
@@ -852,10 +914,11 @@ int DARSHAN_DECL(fseek)(FILE *stream, long offset, int whence)
     if(ret >= 0)
     {
         STDIO_PRE_RECORD();
+        DARSHAN_SELF_TIME(DARSHAN_STDIO_MOD, SELF_F_REAL_TIME, tm2 - tm1);
         rec_ref = darshan_lookup_record_ref(stdio_runtime->stream_hash, &stream, sizeof(stream));
         if(rec_ref)
         {
-            rec_ref->offset = ftell(stream);
+            __atomic_store_n(&rec_ref->offset, ftell(stream), __ATOMIC_RELAXED);
             DARSHAN_TIMER_INC_NO_OVERLAP(
                 rec_ref->file_rec->fcounters[STDIO_F_META_TIME],
                 tm1, tm2, rec_ref->last_meta_end);
@@ -882,10 +945,11 @@ int DARSHAN_DECL(fseeko)(FILE *stream, off_t offset, int whence)
     if(ret >= 0)
     {
         STDIO_PRE_RECORD();
+        DARSHAN_SELF_TIME(DARSHAN_STDIO_MOD, SELF_F_REAL_TIME, tm2 - tm1);
         rec_ref = darshan_lookup_record_ref(stdio_runtime->stream_hash, &stream, sizeof(stream));
         if(rec_ref)
         {
-            rec_ref->offset = ftell(stream);
+            __atomic_store_n(&rec_ref->offset, ftell(stream), __ATOMIC_RELAXED);
             DARSHAN_TIMER_INC_NO_OVERLAP(
                 rec_ref->file_rec->fcounters[STDIO_F_META_TIME],
                 tm1, tm2, rec_ref->last_meta_end);
@@ -912,10 +976,11 @@ int DARSHAN_DECL(fseeko64)(FILE *stream, off64_t offset, int whence)
     if(ret >= 0)
     {
         STDIO_PRE_RECORD();
+        DARSHAN_SELF_TIME(DARSHAN_STDIO_MOD, SELF_F_REAL_TIME, tm2 - tm1);
         rec_ref = darshan_lookup_record_ref(stdio_runtime->stream_hash, &stream, sizeof(stream));
         if(rec_ref)
         {
-            rec_ref->offset = ftell(stream);
+            __atomic_store_n(&rec_ref->offset, ftell(stream), __ATOMIC_RELAXED);
             DARSHAN_TIMER_INC_NO_OVERLAP(
                 rec_ref->file_rec->fcounters[STDIO_F_META_TIME],
                 tm1, tm2, rec_ref->last_meta_end);
@@ -942,10 +1007,11 @@ int DARSHAN_DECL(fsetpos)(FILE *stream, const fpos_t *pos)
     if(ret >= 0)
     {
         STDIO_PRE_RECORD();
+        DARSHAN_SELF_TIME(DARSHAN_STDIO_MOD, SELF_F_REAL_TIME, tm2 - tm1);
         rec_ref = darshan_lookup_record_ref(stdio_runtime->stream_hash, &stream, sizeof(stream));
         if(rec_ref)
         {
-            rec_ref->offset = ftell(stream);
+            __atomic_store_n(&rec_ref->offset, ftell(stream), __ATOMIC_RELAXED);
             DARSHAN_TIMER_INC_NO_OVERLAP(
                 rec_ref->file_rec->fcounters[STDIO_F_META_TIME],
                 tm1, tm2, rec_ref->last_meta_end);
@@ -972,10 +1038,11 @@ int DARSHAN_DECL(fsetpos64)(FILE *stream, const fpos64_t *pos)
     if(ret >= 0)
     {
         STDIO_PRE_RECORD();
+        DARSHAN_SELF_TIME(DARSHAN_STDIO_MOD, SELF_F_REAL_TIME, tm2 - tm1);
         rec_ref = darshan_lookup_record_ref(stdio_runtime->stream_hash, &stream, sizeof(stream));
         if(rec_ref)
         {
-            rec_ref->offset = ftell(stream);
+            __atomic_store_n(&rec_ref->offset, ftell(stream), __ATOMIC_RELAXED);
             DARSHAN_TIMER_INC_NO_OVERLAP(
                 rec_ref->file_rec->fcounters[STDIO_F_META_TIME],
                 tm1, tm2, rec_ref->last_meta_end);
@@ -1013,6 +1080,7 @@ static void stdio_runtime_initialize()
         darshan_core_unregister_module(DARSHAN_STDIO_MOD);
         return;
     }
+    darshan_core_register_module_snapshot(DARSHAN_STDIO_MOD, &stdio_snapshot);
 
     stdio_runtime = malloc(sizeof(*stdio_runtime));
     if(!stdio_runtime)
@@ -1028,6 +1096,161 @@ static void stdio_runtime_initialize()
     STDIO_RECORD_OPEN(stderr, "<STDERR>", 0, 0);
 }
 
+/* find the calling thread's counter shard for the file record associated
+ * with the given stream, only acquiring the STDIO lock the first time this
+ * thread sees the stream
+ */
+static struct stdio_file_shard *stdio_lookup_shard(FILE *stream)
+{
+    struct stdio_file_record_ref *rec_ref = NULL;
+    struct stdio_file_shard *shard;
+    uint64_t gen;
+
+    if(darshan_shards_lookup(&stdio_shards, stdio_thread_shards,
+        (uint64_t)(uintptr_t)stream, (void **)&shard))
+        return(shard);
+
+    STDIO_LOCK();
+    /* the runtime is initialized here, rather than in the wrappers, so
+     * that stdin/stdout/stderr records exist before they are first used
+     */
+    if(!stdio_runtime) stdio_runtime_initialize();
+    gen = darshan_shards_gen(&stdio_shards, (uint64_t)(uintptr_t)stream);
+    if(stdio_runtime)
+        rec_ref = darshan_lookup_record_ref(stdio_runtime->stream_hash,
+            &stream, sizeof(stream));
+    shard = darshan_shards_fill(&stdio_shards, stdio_thread_shards,
+        (uint64_t)(uintptr_t)stream, gen, rec_ref);
+    STDIO_UNLOCK();
+
+    return(shard);
+}
+
+/* apply the counter updates of a read or write to the shard it was
+ * recorded in, either directly from the wrapper or as part of a batch of
+ * events deferred by the thread owning the shard
+ */
+static void stdio_apply_event(struct darshan_shard_event *event)
+{
+    struct stdio_file_shard *shard = (struct stdio_file_shard *)event->shard_p;
+    int64_t this_offset = event->offset;
+    int64_t bytes = event->size;
+
+    if(event->op == DARSHAN_IO_READ)
+    {
+        if(shard->rec.counters[STDIO_MAX_BYTE_READ] < (this_offset + bytes - 1))
+            shard->rec.counters[STDIO_MAX_BYTE_READ] = (this_offset + bytes - 1);
+        shard->rec.counters[STDIO_BYTES_READ] += bytes;
+        shard->rec.counters[STDIO_READS] += 1;
+        if(shard->rec.fcounters[STDIO_F_READ_START_TIMESTAMP] == 0 ||
+         shard->rec.fcounters[STDIO_F_READ_START_TIMESTAMP] > event->tm1)
+            shard->rec.fcounters[STDIO_F_READ_START_TIMESTAMP] = event->tm1;
+        shard->rec.fcounters[STDIO_F_READ_END_TIMESTAMP] = event->tm2;
+        DARSHAN_TIMER_INC_NO_OVERLAP(shard->rec.fcounters[STDIO_F_READ_TIME],
+            event->tm1, event->tm2, shard->last_read_end);
+    }
+    else
+    {
+        if(shard->rec.counters[STDIO_MAX_BYTE_WRITTEN] < (this_offset + bytes - 1))
+            shard->rec.counters[STDIO_MAX_BYTE_WRITTEN] = (this_offset + bytes - 1);
+        shard->rec.counters[STDIO_BYTES_WRITTEN] += bytes;
+        /* flags is set for fflush calls */
+        if(event->flags)
+            shard->rec.counters[STDIO_FLUSHES] += 1;
+        else
+            shard->rec.counters[STDIO_WRITES] += 1;
+        if(shard->rec.fcounters[STDIO_F_WRITE_START_TIMESTAMP] == 0 ||
+         shard->rec.fcounters[STDIO_F_WRITE_START_TIMESTAMP] > event->tm1)
+            shard->rec.fcounters[STDIO_F_WRITE_START_TIMESTAMP] = event->tm1;
+        shard->rec.fcounters[STDIO_F_WRITE_END_TIMESTAMP] = event->tm2;
+        DARSHAN_TIMER_INC_NO_OVERLAP(shard->rec.fcounters[STDIO_F_WRITE_TIME],
+            event->tm1, event->tm2, shard->last_write_end);
+    }
+
+    return;
+}
+
+/* fold a thread's counter shard back into the corresponding file record */
+static void stdio_merge_file_shard(void *shard_p)
+{
+    struct stdio_file_shard *shard = (struct stdio_file_shard *)shard_p;
+
+    stdio_fold_file_shard(shard->rec_ref->file_rec, &shard->rec);
+    return;
+}
+
+/* fold the shards of an exiting thread back into their file records */
+static void stdio_thread_exit(struct darshan_thread_shards *shards)
+{
+    STDIO_LOCK();
+    if(stdio_runtime)
+        darshan_shards_release(&stdio_shards, shards, &stdio_apply_event,
+            &stdio_merge_file_shard);
+    else
+        darshan_shards_release(&stdio_shards, shards, NULL, NULL);
+    STDIO_UNLOCK();
+
+    return;
+}
+
+/* fold a thread's counter shard into the snapshot copy of its file record,
+ * leaving both the shard and the live record untouched
+ */
+static void stdio_snapshot_file_shard(void *shard_p)
+{
+    struct stdio_file_shard *shard = (struct stdio_file_shard *)shard_p;
+    char *rec_p = (char *)shard->rec_ref->file_rec;
+
+    /* skip records registered after the snapshot buffer was sized */
+    if(rec_p < stdio_snapshot_src ||
+       rec_p >= stdio_snapshot_src + stdio_snapshot_len)
+        return;
+
+    stdio_fold_file_shard((struct darshan_stdio_file *)
+        (stdio_snapshot_dst + (rec_p - stdio_snapshot_src)), &shard->rec);
+    return;
+}
+
+static void stdio_fold_file_shard(struct darshan_stdio_file *file_rec,
+    struct darshan_stdio_file *shard_rec)
+{
+    int i;
+
+    /* sum */
+    for(i=STDIO_READS; i<=STDIO_WRITES; i++)
+        file_rec->counters[i] += shard_rec->counters[i];
+    for(i=STDIO_FLUSHES; i<=STDIO_BYTES_READ; i++)
+        file_rec->counters[i] += shard_rec->counters[i];
+
+    /* max */
+    for(i=STDIO_MAX_BYTE_READ; i<=STDIO_MAX_BYTE_WRITTEN; i++)
+    {
+        if(shard_rec->counters[i] > file_rec->counters[i])
+            file_rec->counters[i] = shard_rec->counters[i];
+    }
+
+    /* sum */
+    for(i=STDIO_F_WRITE_TIME; i<=STDIO_F_READ_TIME; i++)
+        file_rec->fcounters[i] += shard_rec->fcounters[i];
+
+    /* min non-zero (if available) value */
+    for(i=STDIO_F_WRITE_START_TIMESTAMP; i<=STDIO_F_READ_START_TIMESTAMP; i++)
+    {
+        if(shard_rec->fcounters[i] > 0 && (file_rec->fcounters[i] == 0 ||
+           shard_rec->fcounters[i] < file_rec->fcounters[i]))
+            file_rec->fcounters[i] = shard_rec->fcounters[i];
+    }
+
+    /* max */
+    for(i=STDIO_F_WRITE_END_TIMESTAMP; i<=STDIO_F_READ_END_TIMESTAMP; i++)
+    {
+        if(shard_rec->fcounters[i] > file_rec->fcounters[i])
+            file_rec->fcounters[i] = shard_rec->fcounters[i];
+    }
+
+    return;
+}
+
 /************************************************************************
  * Functions exported by this module for coordinating with darshan-core *
  ************************************************************************/
@@ -1155,9 +1378,18 @@ static void stdio_shutdown(
     int stdio_rec_count;
     double stdio_time;
 
+    /* wait for in-flight reads/writes before taking the STDIO lock */
+    darshan_shards_quiesce(&stdio_shards);
+
     STDIO_LOCK();
     assert(stdio_runtime);
 
+    /* apply any reads/writes still waiting in threads' event rings, then
+     * fold per-thread read/write counters back into stdio file records
+     */
+    darshan_shards_drain(&stdio_shards, &stdio_apply_event);
+    darshan_shards_iter(&stdio_shards, &stdio_merge_file_shard);
+
     stdio_rec_count = stdio_runtime->file_rec_count;
 
     /* if there are globally shared files, do a shared file reduction */
@@ -1250,15 +1482,81 @@ static void stdio_shutdown(
     /* filter out any records that have no activity on them; this is
      * specifically meant to filter out unused stdin, stdout, or stderr
      * entries
-     *
-     * NOTE: we can no longer use the darshan_lookup_record_ref()
-     * function at this point to find specific records, because the
-     * logic above has likely broken the mapping to the static array.
-     * We walk it manually here instead.
      */
+    stdio_rec_count = stdio_filter_std_records(stdio_rec_buf, stdio_rec_count);
+
+    /* update output buffer size to account for shared file reduction */
+    *stdio_buf_sz = stdio_rec_count * sizeof(struct darshan_stdio_file);
+
+    /* shutdown internal structures used for instrumenting */
+    stdio_cleanup_runtime();
+
+    STDIO_UNLOCK();
+    
+    return;
+}
+
+static void stdio_snapshot(
+    void **stdio_buf,
+    int *stdio_buf_sz,
+    int *stdio_partial)
+{
+    char *snap_buf = NULL;
+    int stdio_rec_count;
+
+    STDIO_LOCK();
+    if(stdio_runtime && *stdio_buf_sz > 0)
+        snap_buf = malloc(*stdio_buf_sz);
+    if(!snap_buf)
+    {
+        STDIO_UNLOCK();
+        *stdio_buf = NULL;
+        *stdio_buf_sz = 0;
+        return;
+    }
+
+    /* copy the records, then add in the counters threads have accumulated
+     * in their shards since the records were last updated
+     */
+    memcpy(snap_buf, *stdio_buf, *stdio_buf_sz);
+    stdio_snapshot_src = *stdio_buf;
+    stdio_snapshot_dst = snap_buf;
+    stdio_snapshot_len = *stdio_buf_sz;
+    darshan_shards_iter(&stdio_shards, &stdio_snapshot_file_shard);
+    stdio_snapshot_src = stdio_snapshot_dst = NULL;
+    stdio_snapshot_len = 0;
+    STDIO_UNLOCK();
+
+    /* events still waiting in threads' event rings are only applied by
+     * the threads themselves (or at shutdown), so they are left out
+     */
+    if(darshan_shards_pending(&stdio_shards) > 0)
+        *stdio_partial = 1;
+
+    stdio_rec_count = stdio_filter_std_records(
+        (struct darshan_stdio_file *)snap_buf,
+        *stdio_buf_sz / sizeof(struct darshan_stdio_file));
+
+    *stdio_buf = snap_buf;
+    *stdio_buf_sz = stdio_rec_count * sizeof(struct darshan_stdio_file);
+    return;
+}
+
+/* remove stdin, stdout, and stderr records that saw no reads or writes from
+ * the given record buffer, returning the new record count
+ *
+ * NOTE: we can not use the darshan_lookup_record_ref() function here to
+ * find specific records, because shutdown time reductions have likely
+ * broken the mapping to the static array. We walk it manually instead.
+ */
+static int stdio_filter_std_records(struct darshan_stdio_file *stdio_rec_buf,
+    int stdio_rec_count)
+{
     darshan_record_id stdin_rec_id = darshan_core_gen_record_id("<STDIN>");
     darshan_record_id stdout_rec_id = darshan_core_gen_record_id("<STDOUT>");
     darshan_record_id stderr_rec_id = darshan_core_gen_record_id("<STDERR>");
+    int i;
+
     for(i=0; i<stdio_rec_count; i++)
     {
         if((stdio_rec_buf[i].base_rec.id == stdin_rec_id) ||
@@ -1279,15 +1577,7 @@ static void stdio_shutdown(
         }
     }
 
-    /* update output buffer size to account for shared file reduction */
-    *stdio_buf_sz = stdio_rec_count * sizeof(struct darshan_stdio_file);
-
-    /* shutdown internal structures used for instrumenting */
-    stdio_cleanup_runtime();
-
-    STDIO_UNLOCK();
-    
-    return;
+    return(stdio_rec_count);
 }
 
 static struct stdio_file_record_ref *stdio_track_new_file_record(
@@ -1343,6 +1633,7 @@ static struct stdio_file_record_ref *stdio_track_new_file_record(
 
 static void stdio_cleanup_runtime()
 {
+    darshan_shards_clear(&stdio_shards);
     darshan_clear_record_refs(&(stdio_runtime->stream_hash), 0);
     darshan_clear_record_refs(&(stdio_runtime->rec_id_hash), 1);
 
@@ -0,0 +1,134 @@
+/*
+--------------------------------------------------------------------
+wyhash.c, adapted from wyhash (final version 4) by Wang Yi
+<godspeed_china@yeah.net>, released into the public domain under
+The Unlicense.  See https://github.com/wangyi-fudan/wyhash
+--------------------------------------------------------------------
+*/
+
+#include <stdint.h>
+#include <string.h>
+
+/* default secret of the reference implementation */
+static const uint64_t wyp[4] = {
+    0x2d358dccaa6c78a5ULL, 0x8bb84b93962eacc9ULL,
+    0x4b33a62ed433d4a3ULL, 0x4d5a2da51de1aa47ULL
+};
+
+/* 64x64 -> 128 bit multiply; low half in *a, high half in *b */
+static inline void wymum(uint64_t *a, uint64_t *b)
+{
+#ifdef __SIZEOF_INT128__
+    __uint128_t r = *a;
+    r *= *b;
+    *a = (uint64_t)r;
+    *b = (uint64_t)(r >> 64);
+#else
+    uint64_t ha = *a >> 32, hb = *b >> 32;
+    uint64_t la = (uint32_t)*a, lb = (uint32_t)*b;
+    uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+    uint64_t t = rl + (rm0 << 32), c = t < rl;
+    uint64_t lo = t + (rm1 << 32);
+    c += lo < t;
+    *a = lo;
+    *b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif
+}
+
+static inline uint64_t wymix(uint64_t a, uint64_t b)
+{
+    wymum(&a, &b);
+    return(a ^ b);
+}
+
+/* little-endian reads, so that hashes match across architectures */
+static inline uint64_t wyr8(const uint8_t *p)
+{
+    uint64_t v;
+    memcpy(&v, p, 8);
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+    v = __builtin_bswap64(v);
+#endif
+    return(v);
+}
+
+static inline uint64_t wyr4(const uint8_t *p)
+{
+    uint32_t v;
+    memcpy(&v, p, 4);
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+    v = __builtin_bswap32(v);
+#endif
+    return(v);
+}
+
+static inline uint64_t wyr3(const uint8_t *p, uint64_t k)
+{
+    return((((uint64_t)p[0]) << 16) | (((uint64_t)p[k >> 1]) << 8) | p[k - 1]);
+}
+
+/*
+--------------------------------------------------------------------
+darshan_wyhash() -- hash a variable-length key into a 64-bit value
+  key  : the key (the unaligned variable-length array of bytes)
+  len  : the length of the key, counting by bytes
+  seed : can be any 8-byte value
+Keys longer than 48 bytes are consumed 48 bytes at a time by three
+independent multiply chains, which keeps the multipliers of a modern
+superscalar core busy on long paths.
+--------------------------------------------------------------------
+*/
+uint64_t darshan_wyhash(const void *key, uint64_t len, uint64_t seed)
+{
+    const uint8_t *p = (const uint8_t *)key;
+    uint64_t a, b;
+    uint64_t i, see1, see2;
+
+    seed ^= wymix(seed ^ wyp[0], wyp[1]);
+    if(len <= 16)
+    {
+        if(len >= 4)
+        {
+            a = (wyr4(p) << 32) | wyr4(p + ((len >> 3) << 2));
+            b = (wyr4(p + len - 4) << 32) | wyr4(p + len - 4 - ((len >> 3) << 2));
+        }
+        else if(len > 0)
+        {
+            a = wyr3(p, len);
+            b = 0;
+        }
+        else
+            a = b = 0;
+    }
+    else
+    {
+        i = len;
+        if(i > 48)
+        {
+            see1 = seed;
+            see2 = seed;
+            do
+            {
+                seed = wymix(wyr8(p) ^ wyp[1], wyr8(p + 8) ^ seed);
+                see1 = wymix(wyr8(p + 16) ^ wyp[2], wyr8(p + 24) ^ see1);
+                see2 = wymix(wyr8(p + 32) ^ wyp[3], wyr8(p + 40) ^ see2);
+                p += 48;
+                i -= 48;
+            } while(i > 48);
+            seed ^= see1 ^ see2;
+        }
+        while(i > 16)
+        {
+            seed = wymix(wyr8(p) ^ wyp[1], wyr8(p + 8) ^ seed);
+            i -= 16;
+            p += 16;
+        }
+        a = wyr8(p + i - 16);
+        b = wyr8(p + i - 8);
+    }
+
+    a ^= wyp[1];
+    b ^= seed;
+    wymum(&a, &b);
+    return(wymix(a ^ wyp[0] ^ len, b ^ wyp[1]));
+}
@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2015 University of Chicago.
+ * See COPYRIGHT notice in top-level directory.
+ *
+ */
+
+#ifndef __DARSHAN_SELF_LOG_FORMAT_H
+#define __DARSHAN_SELF_LOG_FORMAT_H
+
+/* current log format version, to support backwards compatibility */
+#define DARSHAN_SELF_VER 1
+
+#define SELF_COUNTERS \
+    /* number of intercepted calls instrumented by the module */\
+    X(SELF_CALLS) \
+    /* number of record hash table lookups made instrumenting calls */\
+    X(SELF_HASH_LOOKUPS) \
+    /* number of times the module lock was acquired */\
+    X(SELF_LOCKS) \
+    /* number of lock acquisitions that waited on another thread */\
+    X(SELF_LOCK_WAITS) \
+    /* number of records registered by the module */\
+    X(SELF_RECORDS) \
+    /* number of records dropped because the module was out of memory */\
+    X(SELF_RECORDS_DROPPED) \
+    /* high water mark of the module's record memory, in bytes */\
+    X(SELF_MEM_MAX) \
+    /* record memory limit of the module, in bytes */\
+    X(SELF_MEM_LIMIT) \
+    /* end of counters */\
+    X(SELF_NUM_INDICES)
+
+#define SELF_F_COUNTERS \
+    /* cumulative time spent in Darshan bookkeeping for intercepted calls */\
+    X(SELF_F_BOOKKEEPING_TIME) \
+    /* cumulative time spent in the underlying (real) calls */\
+    X(SELF_F_REAL_TIME) \
+    /* cumulative time spent waiting to acquire the module lock */\
+    X(SELF_F_LOCK_WAIT_TIME) \
+    /* end of counters */\
+    X(SELF_F_NUM_INDICES)
+
+#define X(a) a,
+/* integer counters for the "SELF" module */
+enum darshan_self_indices
+{
+    SELF_COUNTERS
+};
+
+/* floating point counters for the "SELF" module */
+enum darshan_self_f_indices
+{
+    SELF_F_COUNTERS
+};
+#undef X
+
+/* the darshan_self_record structure holds the overhead Darshan itself
+ * added while instrumenting the calls of one module (or, for the record
+ * named "darshan-core", the overhead of darshan-core itself). For the
+ * darshan-core record, SELF_MEM_MAX and SELF_MEM_LIMIT describe the
+ * record memory used by all modules and the DARSHAN_MODMEM limit on it.
+ */
+struct darshan_self_record
+{
+    struct darshan_base_record base_rec;
+    int64_t counters[SELF_NUM_INDICES];
+    double fcounters[SELF_F_NUM_INDICES];
+};
+
+#endif /* __DARSHAN_SELF_LOG_FORMAT_H */
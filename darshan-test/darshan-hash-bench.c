@@ -0,0 +1,241 @@
+/*
+ *  (C) 2015 by Argonne National Laboratory.
+ *      See COPYRIGHT in top-level directory.
+ */
+
+/* Microbenchmark for the hash functions Darshan can use to generate
+ * record ids.
+ *
+ * Compares the Jenkins hash from lookup8.c (darshan_hash) against wyhash
+ * (darshan_wyhash) on sets of file paths. By default, three synthetic sets
+ * modeled on common workloads are used: Python module import probes, a
+ * file-per-process HPC checkpoint tree, and a build tree. Alternatively, a
+ * file with one path per line (e.g., the output of find) can be given.
+ * The hash sources are compiled in directly, e.g.:
+ *
+ *   gcc -O2 darshan-hash-bench.c ../darshan-runtime/lib/lookup8.c \
+ *       ../darshan-runtime/lib/wyhash.c -o darshan-hash-bench
+ *   ./darshan-hash-bench [-f <path list>] [iterations]
+ *
+ * Each set is hashed 'iterations' times (default 20) by each function.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+uint64_t darshan_hash(const register unsigned char *k, register uint64_t length,
+    register uint64_t level);
+uint64_t darshan_wyhash(const void *key, uint64_t len, uint64_t seed);
+
+struct path_set
+{
+    const char *name;
+    char **paths;
+    int *lens;
+    int count;
+    int max;
+};
+
+static double bench_clock(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (double)(t.tv_sec) + (double)(t.tv_nsec) * 1.0e-9;
+}
+
+static void set_add(struct path_set *set, const char *path)
+{
+    if(set->count == set->max)
+    {
+        set->max = set->max ? set->max * 2 : 1024;
+        set->paths = realloc(set->paths, set->max * sizeof(*set->paths));
+        set->lens = realloc(set->lens, set->max * sizeof(*set->lens));
+        if(!set->paths || !set->lens)
+        {
+            fprintf(stderr, "Error: out of memory.\n");
+            exit(1);
+        }
+    }
+    set->paths[set->count] = strdup(path);
+    set->lens[set->count] = strlen(path);
+    set->count++;
+    return;
+}
+
+/* the interpreter probes each directory on sys.path for every import */
+static void gen_python_set(struct path_set *set)
+{
+    static const char *dirs[] = {
+        "/home/user/project",
+        "/usr/lib/python38.zip",
+        "/usr/lib/python3.8",
+        "/usr/lib/python3.8/lib-dynload",
+        "/home/user/.local/lib/python3.8/site-packages",
+        "/usr/local/lib/python3.8/dist-packages",
+        "/usr/lib/python3/dist-packages",
+    };
+    static const char *suffixes[] = {
+        "/__init__.cpython-38-x86_64-linux-gnu.so",
+        "/__init__.abi3.so",
+        "/__init__.so",
+        "/__init__.py",
+        "/__pycache__/__init__.cpython-38.pyc",
+        ".cpython-38-x86_64-linux-gnu.so",
+        ".py",
+    };
+    char path[512];
+    int d, m, x;
+
+    set->name = "python";
+    for(m = 0; m < 400; m++)
+        for(d = 0; d < 7; d++)
+            for(x = 0; x < 7; x++)
+            {
+                snprintf(path, sizeof(path), "%s/pkg%d/submodule_%d%s",
+                    dirs[d], m / 20, m, suffixes[x]);
+                set_add(set, path);
+            }
+    return;
+}
+
+static void gen_hpc_set(struct path_set *set)
+{
+    char path[512];
+    int step, rank;
+
+    set->name = "hpc";
+    for(step = 0; step < 20; step++)
+        for(rank = 0; rank < 1024; rank++)
+        {
+            snprintf(path, sizeof(path),
+                "/lustre/scratch/user/climate-ensemble/run_0042/output/"
+                "step_%06d/rank_%05d.h5", step * 100, rank);
+            set_add(set, path);
+        }
+    return;
+}
+
+static void gen_build_set(struct path_set *set)
+{
+    static const char *exts[] = { ".c", ".h", ".c.o", ".c.o.d" };
+    char path[512];
+    int dir, file, x;
+
+    set->name = "build";
+    for(dir = 0; dir < 100; dir++)
+        for(file = 0; file < 50; file++)
+            for(x = 0; x < 4; x++)
+            {
+                snprintf(path, sizeof(path),
+                    "/home/user/src/project/%s/src/component%d/file%d%s",
+                    (x < 2) ? "." : "build/CMakeFiles/project.dir",
+                    dir, file, exts[x]);
+                set_add(set, path);
+            }
+    return;
+}
+
+static int read_set(struct path_set *set, const char *file)
+{
+    FILE *fp;
+    char *line = NULL;
+    size_t line_sz = 0;
+    ssize_t len;
+
+    fp = fopen(file, "r");
+    if(!fp)
+        return(-1);
+    set->name = file;
+    while((len = getline(&line, &line_sz, fp)) > 0)
+    {
+        if(line[len-1] == '\n')
+            line[len-1] = '\0';
+        if(line[0])
+            set_add(set, line);
+    }
+    free(line);
+    fclose(fp);
+
+    return(set->count ? 0 : -1);
+}
+
+static uint64_t hash_jenkins(const char *path, int len)
+{
+    return(darshan_hash((const unsigned char *)path, len, 0));
+}
+
+static uint64_t hash_wyhash(const char *path, int len)
+{
+    return(darshan_wyhash(path, len, 0));
+}
+
+static void run_test(const char *name, uint64_t (*hash)(const char *, int),
+    struct path_set *set, int iters)
+{
+    double start, end;
+    volatile uint64_t sink = 0;
+    long bytes = 0;
+    int i, j;
+
+    for(i = 0; i < set->count; i++)
+        bytes += set->lens[i];
+
+    start = bench_clock();
+    for(j = 0; j < iters; j++)
+        for(i = 0; i < set->count; i++)
+            sink ^= hash(set->paths[i], set->lens[i]);
+    end = bench_clock();
+
+    printf("%s\t%s\t%d\t%.1f\t%.2f\t%.2f\n", set->name, name, set->count,
+        (double)bytes / set->count,
+        (end - start) * 1.0e9 / ((double)iters * set->count),
+        (double)bytes * iters / (end - start) / 1.0e9);
+    return;
+}
+
+int main(int argc, char **argv)
+{
+    struct path_set sets[3];
+    int nsets = 0;
+    int iters = 20;
+    int opt;
+    int i;
+
+    memset(sets, 0, sizeof(sets));
+    while((opt = getopt(argc, argv, "f:")) != -1)
+    {
+        if(opt != 'f' || read_set(&sets[nsets++], optarg) < 0)
+        {
+            fprintf(stderr, "Usage: %s [-f <path list>] [iterations]\n", argv[0]);
+            return(-1);
+        }
+    }
+    if(optind < argc)
+        iters = atoi(argv[optind]);
+    if(iters < 1)
+    {
+        fprintf(stderr, "Error: invalid iteration count.\n");
+        return(-1);
+    }
+    if(nsets == 0)
+    {
+        gen_python_set(&sets[nsets++]);
+        gen_hpc_set(&sets[nsets++]);
+        gen_build_set(&sets[nsets++]);
+    }
+
+    printf("#<set>\t<hash>\t<paths>\t<avg path len>\t<ns per hash>\t<GB/s>\n");
+    for(i = 0; i < nsets; i++)
+    {
+        run_test("jenkins", hash_jenkins, &sets[i], iters);
+        run_test("wyhash", hash_wyhash, &sets[i], iters);
+    }
+
+    return(0);
+}
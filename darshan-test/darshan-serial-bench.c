@@ -0,0 +1,542 @@
+/*
+ *  (C) 2015 by Argonne National Laboratory.
+ *      See COPYRIGHT in top-level directory.
+ */
+
+/* Microbenchmark suite for the overhead Darshan adds to processes that do
+ * not use MPI.
+ *
+ * Measures:
+ *   - the cost of each benchmarked POSIX and STDIO wrapper, compared against
+ *     calling the same function in the C library directly
+ *   - the cost of darshan_common_val_counter() for access patterns with
+ *     different numbers of distinct values
+ *   - record registration throughput and shutdown time versus record count,
+ *     using the darshan_shutdown_bench() test cases (1 unique or shared file,
+ *     and many unique or shared files)
+ *
+ * Must be linked against a non-MPI build of libdarshan that includes the
+ * STDIO and DXT modules (the POSIX module calls into them), and run with
+ * DARSHAN_ENABLE_NONMPI set. 'make bench' in the darshan-runtime build
+ * directory builds it, or e.g.:
+ *
+ *   gcc darshan-serial-bench.c -o darshan-serial-bench -L<prefix>/lib \
+ *       -ldarshan -lpthread -lrt -lz -ldl
+ *   DARSHAN_ENABLE_NONMPI=1 ./darshan-serial-bench [-d <dir>] [iterations]
+ *
+ * Each wrapper is called 'iterations' times (default 100000) on a file in
+ * <dir> (default: the working directory, which must not be excluded from
+ * instrumentation). Results are printed to stdout as one tab-separated
+ * line per measurement, so runs of different releases can be compared
+ * directly. The logs written by each shutdown go to DARSHAN_LOGFILE, which
+ * defaults to darshan-serial-bench.darshan in <dir>. Setting
+ * DARSHAN_EVENT_RING measures the wrappers with deferred recording.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dlfcn.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+
+/* NOTE: we deliberately provide our own function declarations here; there
+ * is no header installed with the instrumentation package that declares
+ * the benchmarking hooks for us.
+ */
+void darshan_core_shutdown(void);
+void darshan_shutdown_bench_serial(int test_case, int file_count,
+    double *setup_time, double *shutdown_time);
+void darshan_common_val_counter(void *sketch, int64_t val);
+
+/* large enough to hold a struct darshan_common_val_sketch */
+#define BENCH_SKETCH_SIZE 1024
+
+#define BENCH_IO_SIZE 64
+
+/* the functions benchmarked, either as intercepted by Darshan or as
+ * resolved directly in the C library
+ */
+struct bench_calls
+{
+    int (*open)(const char *, int, ...);
+    int (*close)(int);
+    ssize_t (*read)(int, void *, size_t);
+    ssize_t (*write)(int, const void *, size_t);
+    ssize_t (*pread)(int, void *, size_t, off_t);
+    ssize_t (*pwrite)(int, const void *, size_t, off_t);
+    ssize_t (*readv)(int, const struct iovec *, int);
+    ssize_t (*writev)(int, const struct iovec *, int);
+    off_t (*lseek)(int, off_t, int);
+    int (*fsync)(int);
+    int (*fdatasync)(int);
+    void *(*mmap)(void *, size_t, int, int, int, off_t);
+    FILE *(*fopen)(const char *, const char *);
+    int (*fclose)(FILE *);
+    size_t (*fread)(void *, size_t, size_t, FILE *);
+    size_t (*fwrite)(const void *, size_t, size_t, FILE *);
+    int (*fseek)(FILE *, long, int);
+    int (*fgetc)(FILE *);
+    int (*fputc)(int, FILE *);
+    char *(*fgets)(char *, int, FILE *);
+    int (*fputs)(const char *, FILE *);
+    int (*fprintf)(FILE *, const char *, ...);
+    int (*fflush)(FILE *);
+};
+
+struct bench_test
+{
+    const char *name;
+    void (*run)(struct bench_calls *calls, int fd, FILE *fp, long iters);
+};
+
+static const char *bench_file;
+
+static double bench_clock(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (double)(t.tv_sec) + (double)(t.tv_nsec) * 1.0e-9;
+}
+
+static void bench_print(const char *suite, const char *test, long param,
+    const char *metric, double value)
+{
+    printf("%s\t%s\t%ld\t%s\t%.2f\n", suite, test, param, metric, value);
+    return;
+}
+
+static void run_open_close(struct bench_calls *calls, int fd, FILE *fp, long iters)
+{
+    long i;
+    for(i = 0; i < iters; i++)
+        calls->close(calls->open(bench_file, O_RDWR));
+    return;
+}
+
+static void run_read(struct bench_calls *calls, int fd, FILE *fp, long iters)
+{
+    char buf[BENCH_IO_SIZE];
+    long i;
+    for(i = 0; i < iters; i++)
+        calls->read(fd, buf, BENCH_IO_SIZE);
+    return;
+}
+
+static void run_write(struct bench_calls *calls, int fd, FILE *fp, long iters)
+{
+    char buf[BENCH_IO_SIZE] = {0};
+    long i;
+    for(i = 0; i < iters; i++)
+        calls->write(fd, buf, BENCH_IO_SIZE);
+    return;
+}
+
+static void run_pread(struct bench_calls *calls, int fd, FILE *fp, long iters)
+{
+    char buf[BENCH_IO_SIZE];
+    long i;
+    for(i = 0; i < iters; i++)
+        calls->pread(fd, buf, BENCH_IO_SIZE, (i & 1023) * BENCH_IO_SIZE);
+    return;
+}
+
+static void run_pwrite(struct bench_calls *calls, int fd, FILE *fp, long iters)
+{
+    char buf[BENCH_IO_SIZE] = {0};
+    long i;
+    for(i = 0; i < iters; i++)
+        calls->pwrite(fd, buf, BENCH_IO_SIZE, (i & 1023) * BENCH_IO_SIZE);
+    return;
+}
+
+static void run_readv(struct bench_calls *calls, int fd, FILE *fp, long iters)
+{
+    char buf[BENCH_IO_SIZE];
+    struct iovec iov[2] = {{buf, BENCH_IO_SIZE / 2}, {buf, BENCH_IO_SIZE / 2}};
+    long i;
+    for(i = 0; i < iters; i++)
+        calls->readv(fd, iov, 2);
+    return;
+}
+
+static void run_writev(struct bench_calls *calls, int fd, FILE *fp, long iters)
+{
+    char buf[BENCH_IO_SIZE] = {0};
+    struct iovec iov[2] = {{buf, BENCH_IO_SIZE / 2}, {buf, BENCH_IO_SIZE / 2}};
+    long i;
+    for(i = 0; i < iters; i++)
+        calls->writev(fd, iov, 2);
+    return;
+}
+
+static void run_lseek(struct bench_calls *calls, int fd, FILE *fp, long iters)
+{
+    long i;
+    for(i = 0; i < iters; i++)
+        calls->lseek(fd, (i & 1023) * BENCH_IO_SIZE, SEEK_SET);
+    return;
+}
+
+static void run_fsync(struct bench_calls *calls, int fd, FILE *fp, long iters)
+{
+    long i;
+    for(i = 0; i < iters; i++)
+        calls->fsync(fd);
+    return;
+}
+
+static void run_fdatasync(struct bench_calls *calls, int fd, FILE *fp, long iters)
+{
+    long i;
+    for(i = 0; i < iters; i++)
+        calls->fdatasync(fd);
+    return;
+}
+
+static void run_mmap(struct bench_calls *calls, int fd, FILE *fp, long iters)
+{
+    void *p;
+    long i;
+    for(i = 0; i < iters; i++)
+    {
+        p = calls->mmap(NULL, 4096, PROT_READ, MAP_SHARED, fd, 0);
+        if(p != MAP_FAILED)
+            munmap(p, 4096);
+    }
+    return;
+}
+
+static void run_fopen_fclose(struct bench_calls *calls, int fd, FILE *fp, long iters)
+{
+    long i;
+    for(i = 0; i < iters; i++)
+        calls->fclose(calls->fopen(bench_file, "r+"));
+    return;
+}
+
+static void run_fread(struct bench_calls *calls, int fd, FILE *fp, long iters)
+{
+    char buf[BENCH_IO_SIZE];
+    long i;
+    for(i = 0; i < iters; i++)
+        calls->fread(buf, 1, BENCH_IO_SIZE, fp);
+    return;
+}
+
+static void run_fwrite(struct bench_calls *calls, int fd, FILE *fp, long iters)
+{
+    char buf[BENCH_IO_SIZE] = {0};
+    long i;
+    for(i = 0; i < iters; i++)
+        calls->fwrite(buf, 1, BENCH_IO_SIZE, fp);
+    return;
+}
+
+static void run_fseek(struct bench_calls *calls, int fd, FILE *fp, long iters)
+{
+    long i;
+    for(i = 0; i < iters; i++)
+        calls->fseek(fp, (i & 1023) * BENCH_IO_SIZE, SEEK_SET);
+    return;
+}
+
+static void run_fgetc(struct bench_calls *calls, int fd, FILE *fp, long iters)
+{
+    long i;
+    for(i = 0; i < iters; i++)
+        calls->fgetc(fp);
+    return;
+}
+
+static void run_fputc(struct bench_calls *calls, int fd, FILE *fp, long iters)
+{
+    long i;
+    for(i = 0; i < iters; i++)
+        calls->fputc('x', fp);
+    return;
+}
+
+static void run_fgets(struct bench_calls *calls, int fd, FILE *fp, long iters)
+{
+    char buf[BENCH_IO_SIZE];
+    long i;
+    for(i = 0; i < iters; i++)
+        calls->fgets(buf, BENCH_IO_SIZE, fp);
+    return;
+}
+
+static void run_fputs(struct bench_calls *calls, int fd, FILE *fp, long iters)
+{
+    long i;
+    for(i = 0; i < iters; i++)
+        calls->fputs("darshan-serial-bench\n", fp);
+    return;
+}
+
+static void run_fprintf(struct bench_calls *calls, int fd, FILE *fp, long iters)
+{
+    long i;
+    for(i = 0; i < iters; i++)
+        calls->fprintf(fp, "%ld\n", i);
+    return;
+}
+
+static void run_fflush(struct bench_calls *calls, int fd, FILE *fp, long iters)
+{
+    long i;
+    for(i = 0; i < iters; i++)
+    {
+        calls->fputc('x', fp);
+        calls->fflush(fp);
+    }
+    return;
+}
+
+static struct bench_test posix_tests[] = {
+    {"open+close", run_open_close},
+    {"write", run_write},
+    {"read", run_read},
+    {"pwrite", run_pwrite},
+    {"pread", run_pread},
+    {"writev", run_writev},
+    {"readv", run_readv},
+    {"lseek", run_lseek},
+    {"fsync", run_fsync},
+    {"fdatasync", run_fdatasync},
+    {"mmap", run_mmap},
+    {NULL, NULL}
+};
+
+static struct bench_test stdio_tests[] = {
+    {"fopen+fclose", run_fopen_fclose},
+    {"fwrite", run_fwrite},
+    {"fread", run_fread},
+    {"fseek", run_fseek},
+    {"fputc", run_fputc},
+    {"fgetc", run_fgetc},
+    {"fputs", run_fputs},
+    {"fgets", run_fgets},
+    {"fprintf", run_fprintf},
+    {"fputc+fflush", run_fflush},
+    {NULL, NULL}
+};
+
+/* looks up the C library's definitions of the benchmarked functions,
+ * bypassing Darshan's wrappers
+ */
+static int resolve_real_calls(struct bench_calls *real)
+{
+    void *libc;
+
+    libc = dlopen("libc.so.6", RTLD_LAZY | RTLD_NOLOAD);
+    if(!libc)
+        return(-1);
+
+#define RESOLVE(__func) \
+    *(void **)&real->__func = dlsym(libc, #__func); \
+    if(!real->__func) return(-1)
+
+    RESOLVE(open);
+    RESOLVE(close);
+    RESOLVE(read);
+    RESOLVE(write);
+    RESOLVE(pread);
+    RESOLVE(pwrite);
+    RESOLVE(readv);
+    RESOLVE(writev);
+    RESOLVE(lseek);
+    RESOLVE(fsync);
+    RESOLVE(fdatasync);
+    RESOLVE(mmap);
+    RESOLVE(fopen);
+    RESOLVE(fclose);
+    RESOLVE(fread);
+    RESOLVE(fwrite);
+    RESOLVE(fseek);
+    RESOLVE(fgetc);
+    RESOLVE(fputc);
+    RESOLVE(fgets);
+    RESOLVE(fputs);
+    RESOLVE(fprintf);
+    RESOLVE(fflush);
+#undef RESOLVE
+
+    return(0);
+}
+
+static void run_wrapper_tests(const char *suite, struct bench_test *tests,
+    struct bench_calls *wrapped, struct bench_calls *real, long iters)
+{
+    struct bench_calls *calls[2] = {wrapped, real};
+    double ns[2];
+    double start;
+    FILE *fp;
+    int fd;
+    int i, j;
+
+    for(i = 0; tests[i].name; i++)
+    {
+        for(j = 0; j < 2; j++)
+        {
+            /* the file is always opened through Darshan, so that the
+             * wrapped calls find its record
+             */
+            fd = open(bench_file, O_RDWR);
+            fp = fdopen(fd, "r+");
+            if(fd < 0 || !fp)
+            {
+                perror(bench_file);
+                exit(1);
+            }
+
+            /* warm up before timing */
+            tests[i].run(calls[j], fileno(fp), fp, iters / 10 + 1);
+
+            start = bench_clock();
+            tests[i].run(calls[j], fileno(fp), fp, iters);
+            ns[j] = (bench_clock() - start) * 1.0e9 / iters;
+
+            fclose(fp);
+        }
+
+        bench_print(suite, tests[i].name, iters, "ns/call", ns[0]);
+        bench_print(suite, tests[i].name, iters, "ns/call-real", ns[1]);
+        bench_print(suite, tests[i].name, iters, "ns/call-overhead", ns[0] - ns[1]);
+    }
+
+    return;
+}
+
+/* feeds darshan_common_val_counter() a repeating pattern of 'distinct'
+ * access sizes, as a module does for each access to a file
+ */
+static void run_val_counter_test(int distinct, long iters)
+{
+    int64_t sketch[BENCH_SKETCH_SIZE / sizeof(int64_t)] = {0};
+    int64_t *sizes;
+    double start;
+    long i;
+
+    sizes = malloc(distinct * sizeof(*sizes));
+    if(!sizes)
+    {
+        fprintf(stderr, "Error: out of memory.\n");
+        exit(1);
+    }
+    srand(distinct);
+    for(i = 0; i < distinct; i++)
+        sizes[i] = (rand() % 1048576) + 1;
+
+    start = bench_clock();
+    for(i = 0; i < iters; i++)
+        darshan_common_val_counter(sketch, sizes[rand() % distinct]);
+    bench_print("common", "val_counter", distinct, "ns/call",
+        (bench_clock() - start) * 1.0e9 / iters);
+
+    free(sizes);
+    return;
+}
+
+int main(int argc, char **argv)
+{
+    static const int val_counts[] = {1, 4, 32, 1024, 0};
+    static const int file_counts[] = {16, 64, 256, 1024, 0};
+    struct bench_calls wrapped = {
+        open, close, read, write, pread, pwrite, readv, writev, lseek,
+        fsync, fdatasync, mmap, fopen, fclose, fread, fwrite, fseek, fgetc,
+        fputc, fgets, fputs, fprintf, fflush
+    };
+    struct bench_calls real;
+    const char *dir = ".";
+    char path[4096];
+    char logfile[4096];
+    double setup, shutdown;
+    long iters = 100000;
+    int opt;
+    int fd;
+    int i, j;
+
+    while((opt = getopt(argc, argv, "d:")) != -1)
+    {
+        if(opt != 'd')
+        {
+            fprintf(stderr, "Usage: %s [-d <dir>] [iterations]\n", argv[0]);
+            return(-1);
+        }
+        dir = optarg;
+    }
+    if(optind < argc)
+        iters = atol(argv[optind]);
+    if(iters < 1)
+    {
+        fprintf(stderr, "Error: invalid iteration count.\n");
+        return(-1);
+    }
+    if(!getenv("DARSHAN_ENABLE_NONMPI"))
+    {
+        fprintf(stderr, "Error: DARSHAN_ENABLE_NONMPI must be set.\n");
+        return(-1);
+    }
+    if(resolve_real_calls(&real) < 0)
+    {
+        fprintf(stderr, "Error: unable to resolve C library functions.\n");
+        return(-1);
+    }
+
+    /* darshan reads these at initialization and shutdown, which the
+     * shutdown tests below repeat
+     */
+    snprintf(logfile, sizeof(logfile), "%s/darshan-serial-bench.darshan", dir);
+    setenv("DARSHAN_LOGFILE", logfile, 0);
+    setenv("DARSHAN_MODMEM", "64", 0);
+
+    snprintf(path, sizeof(path), "%s/darshan-serial-bench.dat", dir);
+    bench_file = path;
+    fd = open(bench_file, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if(fd < 0 || ftruncate(fd, 1024 * BENCH_IO_SIZE) < 0)
+    {
+        perror(bench_file);
+        return(-1);
+    }
+    close(fd);
+
+    printf("#<suite>\t<test>\t<iterations, distinct values, or files>\t<metric>\t<value>\n");
+
+    run_wrapper_tests("POSIX", posix_tests, &wrapped, &real, iters);
+    run_wrapper_tests("STDIO", stdio_tests, &wrapped, &real, iters);
+
+    for(i = 0; val_counts[i]; i++)
+        run_val_counter_test(val_counts[i], iters);
+
+    /* shut down the running instance of darshan before the shutdown tests
+     * replace it, so that each test writes a log of its own
+     */
+    fflush(stdout);
+    unlink(bench_file);
+    darshan_core_shutdown();
+    unlink(logfile);
+
+    /* test cases 1 and 2 use a single file, 3 and 4 use many */
+    for(i = 1; i <= 4; i++)
+    {
+        for(j = 0; (i < 3 && j == 0) || (i >= 3 && file_counts[j]); j++)
+        {
+            int files = (i < 3) ? 1 : file_counts[j];
+            const char *test = (i % 2) ? "unique" : "shared";
+
+            darshan_shutdown_bench_serial(i, files, &setup, &shutdown);
+            bench_print("shutdown", test, files, "records/s", files / setup);
+            bench_print("shutdown", test, files, "us", shutdown * 1.0e6);
+            unlink(logfile);
+        }
+    }
+
+    return(0);
+}
@@ -0,0 +1,112 @@
+/*
+ *  (C) 2015 by Argonne National Laboratory.
+ *      See COPYRIGHT in top-level directory.
+ */
+
+/* Microbenchmark for the cost of taking Darshan timestamps.
+ *
+ * Compares darshan_core_wtime() against a bare clock_gettime() call and
+ * against a clock_gettime() call wrapped in a mutex lock/unlock pair (which
+ * is what darshan_core_wtime() used to cost). Must be linked against a
+ * non-MPI build of libdarshan that includes the STDIO and DXT modules, and
+ * run with DARSHAN_ENABLE_NONMPI set. 'make bench' in the darshan-runtime
+ * build directory builds it, or e.g.:
+ *
+ *   gcc darshan-wtime-bench.c -o darshan-wtime-bench -L<prefix>/lib -ldarshan \
+ *       -lpthread -lrt -lz -ldl
+ *   DARSHAN_ENABLE_NONMPI=1 DARSHAN_TIMER=tsc ./darshan-wtime-bench
+ *
+ * Arguments: an optional integer specifying the number of timestamps to take
+ * in each test (default 10000000)
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+
+/* NOTE: we deliberately provide our own function declaration here; there is
+ * no header installed with the instrumentation package that declares the
+ * darshan-core timer for us.
+ */
+double darshan_core_wtime(void);
+
+static pthread_mutex_t bench_mutex = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+
+static double bench_clock(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (double)(t.tv_sec) + (double)(t.tv_nsec) * 1.0e-9;
+}
+
+static double bench_locked_clock(void)
+{
+    double ret;
+
+    pthread_mutex_lock(&bench_mutex);
+    pthread_mutex_unlock(&bench_mutex);
+    ret = bench_clock();
+
+    return(ret);
+}
+
+static void run_test(const char *name, double (*timer)(void), long iters)
+{
+    double start, end;
+    volatile double sink = 0;
+    long i;
+
+    start = bench_clock();
+    for(i = 0; i < iters; i++)
+        sink += timer();
+    end = bench_clock();
+
+    printf("%s\t%ld\t%.2f\n", name, iters, (end - start) * 1.0e9 / iters);
+    return;
+}
+
+int main(int argc, char **argv)
+{
+    long iters = 10000000;
+    char *timer_name;
+
+    if(argc > 2)
+    {
+        fprintf(stderr, "Usage: %s [iterations]\n", argv[0]);
+        return(-1);
+    }
+    if(argc == 2)
+        iters = atol(argv[1]);
+    if(iters < 1)
+    {
+        fprintf(stderr, "Error: invalid iteration count.\n");
+        return(-1);
+    }
+
+    if(darshan_core_wtime() == 0)
+    {
+        fprintf(stderr, "Error: Darshan is not enabled (set DARSHAN_ENABLE_NONMPI).\n");
+        return(-1);
+    }
+
+    /* Darshan uses clock_gettime until its timer's calibration window has
+     * elapsed, and switches over on the next timestamp after that
+     */
+    close(open(argv[0], O_RDONLY));
+    usleep(10000);
+    darshan_core_wtime();
+
+    timer_name = getenv("DARSHAN_TIMER");
+    printf("# DARSHAN_TIMER=%s\n", timer_name ? timer_name : "(default)");
+    printf("#<test>\t<iterations>\t<ns per call>\n");
+    run_test("clock_gettime", bench_clock, iters);
+    run_test("locked_clock_gettime", bench_locked_clock, iters);
+    run_test("darshan_core_wtime", darshan_core_wtime, iters);
+
+    return(0);
+}
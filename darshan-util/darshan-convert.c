@@ -27,6 +27,8 @@ int usage (char *exename)
     fprintf(stderr, "       Converts darshan log from infile to outfile.\n");
     fprintf(stderr, "       rewrites the log file into the newest format.\n");
     fprintf(stderr, "       --bzip2 Use bzip2 compression instead of zlib.\n");
+    fprintf(stderr, "       --zstd Use zstd compression instead of zlib.\n");
+    fprintf(stderr, "       --lz4 Use lz4 compression instead of zlib.\n");
     fprintf(stderr, "       --obfuscate Obfuscate items in the log.\n");
     fprintf(stderr, "       --key <key> Key to use when obfuscating.\n");
     fprintf(stderr, "       --annotate <string> Additional metadata to add.\n");
@@ -37,7 +39,7 @@ int usage (char *exename)
 }
 
 void parse_args (int argc, char **argv, char **infile, char **outfile,
-                 int *bzip2, int *obfuscate, int *reset_md, int *key,
+                 enum darshan_comp_type *comp_type, int *obfuscate, int *reset_md, int *key,
                  char **annotate, uint64_t* hash)
 {
     int index;
@@ -46,6 +48,8 @@ void parse_args (int argc, char **argv, char **infile, char **outfile,
     static struct option long_opts[] =
     {
         {"bzip2", 0, NULL, 'b'},
+        {"zstd", 0, NULL, 'z'},
+        {"lz4", 0, NULL, 'l'},
         {"annotate", 1, NULL, 'a'},
         {"obfuscate", 0, NULL, 'o'},
         {"reset-md", 0, NULL, 'r'},
@@ -55,7 +59,7 @@ void parse_args (int argc, char **argv, char **infile, char **outfile,
         { 0, 0, 0, 0 }
     };
 
-    *bzip2 = 0;
+    *comp_type = DARSHAN_ZLIB_COMP;
     *obfuscate = 0;
     *reset_md = 0;
     *key = 0;
@@ -70,7 +74,13 @@ void parse_args (int argc, char **argv, char **infile, char **outfile,
         switch(c)
         {
             case 'b':
-                *bzip2 = 1;
+                *comp_type = DARSHAN_BZIP2_COMP;
+                break;
+            case 'z':
+                *comp_type = DARSHAN_ZSTD_COMP;
+                break;
+            case 'l':
+                *comp_type = DARSHAN_LZ4_COMP;
                 break;
             case 'a':
                 *annotate = optarg;
@@ -260,27 +270,27 @@ int main(int argc, char **argv)
     struct darshan_name_record_ref *ref, *tmp;
     char *mod_buf, *tmp_mod_buf;
     enum darshan_comp_type comp_type;
-    int bzip2;
     int obfuscate;
     int key;
     char *annotation = NULL;
     darshan_record_id hash;
     int reset_md;
 
-    parse_args(argc, argv, &infile_name, &outfile_name, &bzip2, &obfuscate,
+    parse_args(argc, argv, &infile_name, &outfile_name, &comp_type, &obfuscate,
                &reset_md, &key, &annotation, &hash);
 
     infile = darshan_log_open(infile_name);
     if(!infile)
         return(-1);
  
-    comp_type = bzip2 ? DARSHAN_BZIP2_COMP : DARSHAN_ZLIB_COMP;
     outfile = darshan_log_create(outfile_name, comp_type, infile->partial_flag);
     if(!outfile)
     {
         darshan_log_close(infile);
         return(-1);
     }
+    /* record ids are copied as is, so keep track of how they were made */
+    outfile->hash_type = infile->hash_type;
 
     /* read job info */
     ret = darshan_log_get_job(infile, &job);
@@ -86,6 +86,16 @@ int main(int argc, char *argv[])
         return(-1);
     }
 
+    /* records can only be matched up by id if both logs hash the same way */
+    if(file1->hash_type != file2->hash_type)
+    {
+        darshan_log_close(file1);
+        darshan_log_close(file2);
+        fprintf(stderr, "Error: darshan log files %s and %s use different record id hashes.\n",
+            logfile1, logfile2);
+        return(-1);
+    }
+
     /* get job data for each log file */
     ret = darshan_log_get_job(file1, &job1);
     if(ret < 0)
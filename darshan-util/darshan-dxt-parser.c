@@ -99,6 +99,10 @@ int main(int argc, char **argv)
         comp_str = "BZIP2";
     else if (fd->comp_type == DARSHAN_NO_COMP)
         comp_str = "NONE";
+    else if (fd->comp_type == DARSHAN_ZSTD_COMP)
+        comp_str = "ZSTD";
+    else if (fd->comp_type == DARSHAN_LZ4_COMP)
+        comp_str = "LZ4";
     else
         comp_str = "UNKNOWN";
 
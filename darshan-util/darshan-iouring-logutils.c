@@ -0,0 +1,338 @@
+/*
+ * Copyright (C) 2015 University of Chicago.
+ * See COPYRIGHT notice in top-level directory.
+ *
+ */
+
+#define _GNU_SOURCE
+#include "darshan-util-config.h"
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <inttypes.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <errno.h>
+
+#include "darshan-logutils.h"
+
+/* integer counter name strings for the io_uring module */
+#define X(a) #a,
+char *iouring_counter_names[] = {
+    IOURING_COUNTERS
+};
+
+/* floating point counter name strings for the io_uring module */
+char *iouring_f_counter_names[] = {
+    IOURING_F_COUNTERS
+};
+#undef X
+
+/* prototypes for each of the io_uring module's logutil functions */
+static int darshan_log_get_iouring_record(darshan_fd fd, void** iouring_buf_p);
+static int darshan_log_put_iouring_record(darshan_fd fd, void* iouring_buf);
+static void darshan_log_print_iouring_record(void *file_rec,
+    char *file_name, char *mnt_pt, char *fs_type);
+static void darshan_log_print_iouring_description(int ver);
+static void darshan_log_print_iouring_record_diff(void *file_rec1, char *file_name1,
+    void *file_rec2, char *file_name2);
+static void darshan_log_agg_iouring_records(void *rec, void *agg_rec, int init_flag);
+
+/* structure storing each function needed for implementing the darshan
+ * logutil interface. these functions are used for reading, writing, and
+ * printing module data in a consistent manner.
+ */
+struct darshan_mod_logutil_funcs iouring_logutils =
+{
+    .log_get_record = &darshan_log_get_iouring_record,
+    .log_put_record = &darshan_log_put_iouring_record,
+    .log_print_record = &darshan_log_print_iouring_record,
+    .log_print_description = &darshan_log_print_iouring_description,
+    .log_print_diff = &darshan_log_print_iouring_record_diff,
+    .log_agg_records = &darshan_log_agg_iouring_records
+};
+
+/* retrieve a io_uring record from log file descriptor 'fd', storing the
+ * data in the buffer address pointed to by 'iouring_buf_p'. Return 1 on
+ * successful record read, 0 on no more data, and -1 on error.
+ */
+static int darshan_log_get_iouring_record(darshan_fd fd, void** iouring_buf_p)
+{
+    struct darshan_iouring_file *rec = *((struct darshan_iouring_file **)iouring_buf_p);
+    int i;
+    int ret;
+
+    if(fd->mod_map[DARSHAN_IOURING_MOD].len == 0)
+        return(0);
+
+    if(*iouring_buf_p == NULL)
+    {
+        rec = malloc(sizeof(*rec));
+        if(!rec)
+            return(-1);
+    }
+
+    /* read a io_uring module record from the darshan log file */
+    ret = darshan_log_get_mod(fd, DARSHAN_IOURING_MOD, rec,
+        sizeof(struct darshan_iouring_file));
+
+    if(*iouring_buf_p == NULL)
+    {
+        if(ret == sizeof(struct darshan_iouring_file))
+            *iouring_buf_p = rec;
+        else
+            free(rec);
+    }
+
+    if(ret < 0)
+        return(-1);
+    else if(ret < sizeof(struct darshan_iouring_file))
+        return(0);
+    else
+    {
+        /* if the read was successful, do any necessary byte-swapping */
+        if(fd->swap_flag)
+        {
+            DARSHAN_BSWAP64(&(rec->base_rec.id));
+            DARSHAN_BSWAP64(&(rec->base_rec.rank));
+            for(i=0; i<IOURING_NUM_INDICES; i++)
+                DARSHAN_BSWAP64(&rec->counters[i]);
+            for(i=0; i<IOURING_F_NUM_INDICES; i++)
+                DARSHAN_BSWAP64(&rec->fcounters[i]);
+        }
+
+        return(1);
+    }
+}
+
+/* write the io_uring record stored in 'iouring_buf' to log file descriptor 'fd'.
+ * Return 0 on success, -1 on failure
+ */
+static int darshan_log_put_iouring_record(darshan_fd fd, void* iouring_buf)
+{
+    struct darshan_iouring_file *rec = (struct darshan_iouring_file *)iouring_buf;
+    int ret;
+
+    /* append io_uring record to darshan log file */
+    ret = darshan_log_put_mod(fd, DARSHAN_IOURING_MOD, rec,
+        sizeof(struct darshan_iouring_file), DARSHAN_IOURING_VER);
+    if(ret < 0)
+        return(-1);
+
+    return(0);
+}
+
+/* print all I/O data record statistics for the given io_uring record */
+static void darshan_log_print_iouring_record(void *file_rec, char *file_name,
+    char *mnt_pt, char *fs_type)
+{
+    int i;
+    struct darshan_iouring_file *iouring_rec =
+        (struct darshan_iouring_file *)file_rec;
+
+    /* print each of the integer and floating point counters for the io_uring module */
+    for(i=0; i<IOURING_NUM_INDICES; i++)
+    {
+        /* macro defined in darshan-logutils.h */
+        DARSHAN_D_COUNTER_PRINT(darshan_module_names[DARSHAN_IOURING_MOD],
+            iouring_rec->base_rec.rank, iouring_rec->base_rec.id,
+            iouring_counter_names[i], iouring_rec->counters[i],
+            file_name, mnt_pt, fs_type);
+    }
+
+    for(i=0; i<IOURING_F_NUM_INDICES; i++)
+    {
+        /* macro defined in darshan-logutils.h */
+        DARSHAN_F_COUNTER_PRINT(darshan_module_names[DARSHAN_IOURING_MOD],
+            iouring_rec->base_rec.rank, iouring_rec->base_rec.id,
+            iouring_f_counter_names[i], iouring_rec->fcounters[i],
+            file_name, mnt_pt, fs_type);
+    }
+
+    return;
+}
+
+/* print out a description of the io_uring module record fields */
+static void darshan_log_print_iouring_description(int ver)
+{
+    printf("\n# description of IOURING counters:\n");
+    printf("#   IOURING records describe operations submitted to io_uring instances on a file.\n");
+    printf("#   IOURING_{OPENS|READS|WRITES|READVS|WRITEVS|FSYNCS|CLOSES} are types of operations submitted.\n");
+    printf("#   IOURING_ERRORS: number of operations that completed with an error.\n");
+    printf("#   IOURING_UNOBSERVED: number of operations whose completion Darshan did not see.\n");
+    printf("#       Submissions Darshan did not see at all are counted in the <IO_URING> record.\n");
+    printf("#   IOURING_BYTES_*: total bytes read and written.\n");
+    printf("#   IOURING_MAX_BYTE_*: highest offset byte read and written.\n");
+    printf("#   IOURING_QUEUE_DEPTH_SUM: sum of the number of the file's operations in flight\n");
+    printf("#       at each submission (divide by the number of operations for the mean).\n");
+    printf("#   IOURING_MAX_QUEUE_DEPTH: largest number of the file's operations in flight at once.\n");
+    printf("#   IOURING_F_SUBMIT_START_TIMESTAMP: timestamp of the first operation submission.\n");
+    printf("#   IOURING_F_COMPLETE_END_TIMESTAMP: timestamp of the last operation completion.\n");
+    printf("#   IOURING_F_*_LATENCY: cumulative submission to completion time of different types of operations.\n");
+    printf("#   IOURING_F_MAX_*_LATENCY: longest submission to completion time of a read or write.\n");
+    printf("\n# WARNING: IOURING completion times are the times Darshan observed the completions,\n");
+    printf("# \tso IOURING_F_*_LATENCY counters are upper bounds\n");
+
+    return;
+}
+
+/* print a diff of two io_uring records (with the same record id) */
+static void darshan_log_print_iouring_record_diff(void *file_rec1, char *file_name1,
+    void *file_rec2, char *file_name2)
+{
+    struct darshan_iouring_file *file1 = (struct darshan_iouring_file *)file_rec1;
+    struct darshan_iouring_file *file2 = (struct darshan_iouring_file *)file_rec2;
+    int i;
+
+    /* NOTE: we assume that both input records are the same module format version */
+
+    for(i=0; i<IOURING_NUM_INDICES; i++)
+    {
+        if(!file2)
+        {
+            printf("- ");
+            DARSHAN_D_COUNTER_PRINT(darshan_module_names[DARSHAN_IOURING_MOD],
+                file1->base_rec.rank, file1->base_rec.id, iouring_counter_names[i],
+                file1->counters[i], file_name1, "", "");
+
+        }
+        else if(!file1)
+        {
+            printf("+ ");
+            DARSHAN_D_COUNTER_PRINT(darshan_module_names[DARSHAN_IOURING_MOD],
+                file2->base_rec.rank, file2->base_rec.id, iouring_counter_names[i],
+                file2->counters[i], file_name2, "", "");
+        }
+        else if(file1->counters[i] != file2->counters[i])
+        {
+            printf("- ");
+            DARSHAN_D_COUNTER_PRINT(darshan_module_names[DARSHAN_IOURING_MOD],
+                file1->base_rec.rank, file1->base_rec.id, iouring_counter_names[i],
+                file1->counters[i], file_name1, "", "");
+            printf("+ ");
+            DARSHAN_D_COUNTER_PRINT(darshan_module_names[DARSHAN_IOURING_MOD],
+                file2->base_rec.rank, file2->base_rec.id, iouring_counter_names[i],
+                file2->counters[i], file_name2, "", "");
+        }
+    }
+
+    for(i=0; i<IOURING_F_NUM_INDICES; i++)
+    {
+        if(!file2)
+        {
+            printf("- ");
+            DARSHAN_F_COUNTER_PRINT(darshan_module_names[DARSHAN_IOURING_MOD],
+                file1->base_rec.rank, file1->base_rec.id, iouring_f_counter_names[i],
+                file1->fcounters[i], file_name1, "", "");
+
+        }
+        else if(!file1)
+        {
+            printf("+ ");
+            DARSHAN_F_COUNTER_PRINT(darshan_module_names[DARSHAN_IOURING_MOD],
+                file2->base_rec.rank, file2->base_rec.id, iouring_f_counter_names[i],
+                file2->fcounters[i], file_name2, "", "");
+        }
+        else if(file1->fcounters[i] != file2->fcounters[i])
+        {
+            printf("- ");
+            DARSHAN_F_COUNTER_PRINT(darshan_module_names[DARSHAN_IOURING_MOD],
+                file1->base_rec.rank, file1->base_rec.id, iouring_f_counter_names[i],
+                file1->fcounters[i], file_name1, "", "");
+            printf("+ ");
+            DARSHAN_F_COUNTER_PRINT(darshan_module_names[DARSHAN_IOURING_MOD],
+                file2->base_rec.rank, file2->base_rec.id, iouring_f_counter_names[i],
+                file2->fcounters[i], file_name2, "", "");
+        }
+    }
+
+    return;
+}
+
+/* aggregate the input io_uring record 'rec'  into the output record 'agg_rec' */
+static void darshan_log_agg_iouring_records(void *rec, void *agg_rec, int init_flag)
+{
+    struct darshan_iouring_file *iouring_rec = (struct darshan_iouring_file *)rec;
+    struct darshan_iouring_file *agg_iouring_rec = (struct darshan_iouring_file *)agg_rec;
+    int i;
+
+    for(i = 0; i < IOURING_NUM_INDICES; i++)
+    {
+        switch(i)
+        {
+            case IOURING_OPENS:
+            case IOURING_READS:
+            case IOURING_WRITES:
+            case IOURING_READVS:
+            case IOURING_WRITEVS:
+            case IOURING_FSYNCS:
+            case IOURING_CLOSES:
+            case IOURING_ERRORS:
+            case IOURING_UNOBSERVED:
+            case IOURING_BYTES_READ:
+            case IOURING_BYTES_WRITTEN:
+            case IOURING_QUEUE_DEPTH_SUM:
+                /* sum */
+                agg_iouring_rec->counters[i] += iouring_rec->counters[i];
+                break;
+            case IOURING_MAX_BYTE_READ:
+            case IOURING_MAX_BYTE_WRITTEN:
+            case IOURING_MAX_QUEUE_DEPTH:
+                /* max */
+                if(iouring_rec->counters[i] > agg_iouring_rec->counters[i])
+                    agg_iouring_rec->counters[i] = iouring_rec->counters[i];
+                break;
+            default:
+                /* if we don't know how to aggregate this counter, just set to -1 */
+                agg_iouring_rec->counters[i] = -1;
+                break;
+        }
+    }
+
+    for(i = 0; i < IOURING_F_NUM_INDICES; i++)
+    {
+        switch(i)
+        {
+            case IOURING_F_READ_LATENCY:
+            case IOURING_F_WRITE_LATENCY:
+            case IOURING_F_META_LATENCY:
+                /* sum */
+                agg_iouring_rec->fcounters[i] += iouring_rec->fcounters[i];
+                break;
+            case IOURING_F_SUBMIT_START_TIMESTAMP:
+                /* minimum non-zero */
+                if((iouring_rec->fcounters[i] > 0)  &&
+                    ((agg_iouring_rec->fcounters[i] == 0) ||
+                    (iouring_rec->fcounters[i] < agg_iouring_rec->fcounters[i])))
+                {
+                    agg_iouring_rec->fcounters[i] = iouring_rec->fcounters[i];
+                }
+                break;
+            case IOURING_F_COMPLETE_END_TIMESTAMP:
+            case IOURING_F_MAX_READ_LATENCY:
+            case IOURING_F_MAX_WRITE_LATENCY:
+                /* max */
+                if(iouring_rec->fcounters[i] > agg_iouring_rec->fcounters[i])
+                    agg_iouring_rec->fcounters[i] = iouring_rec->fcounters[i];
+                break;
+            default:
+                /* if we don't know how to aggregate this counter, just set to -1 */
+                agg_iouring_rec->fcounters[i] = -1;
+                break;
+        }
+    }
+
+    return;
+}
+
+/*
+ * Local variables:
+ *  c-indent-level: 4
+ *  c-basic-offset: 4
+ * End:
+ *
+ * vim: ts=8 sts=4 sw=4 expandtab
+ */
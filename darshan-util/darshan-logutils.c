@@ -46,6 +46,40 @@ struct darshan_dz_state
     int prev_reg_id;
 };
 
+#ifdef HAVE_LIBZSTD
+/* zstd stream state -- the decompression input buffer points into the
+ * dz staging buffer
+ */
+struct darshan_zstd_state
+{
+    ZSTD_CCtx *cctx;
+    ZSTD_DCtx *dctx;
+    ZSTD_inBuffer in;
+    /* decompressor may still hold output not yet returned to the caller */
+    int pending;
+};
+#endif
+
+#ifdef HAVE_LIBLZ4
+/* size of the input chunks handed to the lz4 frame compressor */
+#define DARSHAN_LZ4_CHUNK_SZ (64*1024) /* 64 KiB */
+
+/* lz4 frame state -- the decompression input is the dz staging buffer,
+ * consumed up to in_pos
+ */
+struct darshan_lz4_state
+{
+    LZ4F_cctx *cctx;
+    LZ4F_dctx *dctx;
+    LZ4F_preferences_t prefs;
+    /* whether the frame header for the current region has been written */
+    int frame_started;
+    unsigned int in_pos;
+    /* decompressor may still hold output not yet returned to the caller */
+    int pending;
+};
+#endif
+
 /* internal fd data structure */
 struct darshan_fd_int_state
 {
@@ -64,7 +98,7 @@ struct darshan_fd_int_state
     /* log format version-specific function calls for getting
      * data from the log file
      */
-    int (*get_namerecs)(void *, int, int, struct darshan_name_record_ref **);
+    int (*get_namerecs)(void *, int, int, char *, struct darshan_name_record_ref **);
 
     /* compression/decompression stream read/write state */
     struct darshan_dz_state dz;
@@ -81,7 +115,8 @@ struct darshan_mod_logutil_funcs *mod_logutils[DARSHAN_MAX_MODS] =
 /* internal helper functions */
 static int darshan_mnt_info_cmp(const void *a, const void *b);
 static int darshan_log_get_namerecs(void *name_rec_buf, int buf_len,
-    int swap_flag, struct darshan_name_record_ref **hash);
+    int swap_flag, char *prev_name, struct darshan_name_record_ref **hash);
+static int darshan_name_record_ref_cmp(const void *a, const void *b);
 static int darshan_log_get_header(darshan_fd fd);
 static int darshan_log_put_header(darshan_fd fd);
 static int darshan_log_seek(darshan_fd fd, off_t offset);
@@ -103,6 +138,20 @@ static int darshan_log_bzip2_write(darshan_fd fd, struct darshan_log_map *map_p,
     void *buf, int len, int flush_strm_flag);
 static int darshan_log_bzip2_flush(darshan_fd fd, int region_id);
 #endif
+#ifdef HAVE_LIBZSTD
+static int darshan_log_zstd_read(darshan_fd fd, struct darshan_log_map map,
+    void *buf, int len, int reset_strm_flag);
+static int darshan_log_zstd_write(darshan_fd fd, struct darshan_log_map *map_p,
+    void *buf, int len, int flush_strm_flag);
+static int darshan_log_zstd_flush(darshan_fd fd, int region_id);
+#endif
+#ifdef HAVE_LIBLZ4
+static int darshan_log_lz4_read(darshan_fd fd, struct darshan_log_map map,
+    void *buf, int len, int reset_strm_flag);
+static int darshan_log_lz4_write(darshan_fd fd, struct darshan_log_map *map_p,
+    void *buf, int len, int flush_strm_flag);
+static int darshan_log_lz4_flush(darshan_fd fd, int region_id);
+#endif
 static int darshan_log_dzload(darshan_fd fd, struct darshan_log_map map);
 static int darshan_log_dzunload(darshan_fd fd, struct darshan_log_map *map_p);
 static int darshan_log_noz_read(darshan_fd fd, struct darshan_log_map map,
@@ -110,7 +159,9 @@ static int darshan_log_noz_read(darshan_fd fd, struct darshan_log_map map,
 
 /* backwards compatibility functions */
 int darshan_log_get_namerecs_3_00(void *name_rec_buf, int buf_len,
-    int swap_flag, struct darshan_name_record_ref **hash);
+    int swap_flag, char *prev_name, struct darshan_name_record_ref **hash);
+int darshan_log_get_namerecs_3_10(void *name_rec_buf, int buf_len,
+    int swap_flag, char *prev_name, struct darshan_name_record_ref **hash);
 
 
 /********************************************************
@@ -523,6 +574,7 @@ int darshan_log_get_namehash(darshan_fd fd, struct darshan_name_record_ref **has
 {
     struct darshan_fd_int_state *state = fd->state;
     char *name_rec_buf;
+    char *prev_name;
     int name_rec_buf_sz;
     int read;
     int read_req_sz;
@@ -545,6 +597,15 @@ int darshan_log_get_namehash(darshan_fd fd, struct darshan_name_record_ref **has
         return(-1);
     memset(name_rec_buf, 0, name_rec_buf_sz);
 
+    /* names may be front coded relative to the previous name in the map */
+    prev_name = malloc(DARSHAN_NAME_RECORD_MAX_LEN + 1);
+    if(!prev_name)
+    {
+        free(name_rec_buf);
+        return(-1);
+    }
+    prev_name[0] = '\0';
+
     do
     {
         /* read chunks of the darshan record id -> name mapping from log file,
@@ -557,12 +618,21 @@ int darshan_log_get_namehash(darshan_fd fd, struct darshan_name_record_ref **has
         {
             fprintf(stderr, "Error: failed to read name hash from darshan log file.\n");
             free(name_rec_buf);
+            free(prev_name);
             return(-1);
         }
         buf_len += read;
 
         /* extract any name records in the buffer */
-        buf_processed = state->get_namerecs(name_rec_buf, buf_len, fd->swap_flag, hash);
+        buf_processed = state->get_namerecs(name_rec_buf, buf_len, fd->swap_flag,
+            prev_name, hash);
+        if(buf_processed < 0)
+        {
+            fprintf(stderr, "Error: failed to parse name hash from darshan log file.\n");
+            free(name_rec_buf);
+            free(prev_name);
+            return(-1);
+        }
 
         /* copy any leftover data to beginning of buffer to parse next */
         memcpy(name_rec_buf, name_rec_buf + buf_processed, buf_len - buf_processed);
@@ -575,6 +645,7 @@ int darshan_log_get_namehash(darshan_fd fd, struct darshan_name_record_ref **has
     assert(buf_len == 0);
 
     free(name_rec_buf);
+    free(prev_name);
     return(0);
 }
 
@@ -590,24 +661,57 @@ int darshan_log_get_namehash(darshan_fd fd, struct darshan_name_record_ref **has
 int darshan_log_put_namehash(darshan_fd fd, struct darshan_name_record_ref *hash)
 {
     struct darshan_fd_int_state *state = fd->state;
+    struct darshan_name_record_ref **ref_array;
     struct darshan_name_record_ref *ref, *tmp;
-    struct darshan_name_record *name_rec;
+    char *name_rec;
+    char *prev_name = "";
+    char *name;
+    uint16_t prefix_len;
     int name_rec_len;
+    int ref_cnt = 0;
     int wrote;
+    int i;
 
     assert(state);
 
     /* allocate memory for largest possible hash record */
-    name_rec = malloc(sizeof(darshan_record_id) + PATH_MAX + 1);
-    if(!name_rec)
+    name_rec = malloc(DARSHAN_NAME_RECORD_HDR_SIZE + DARSHAN_NAME_RECORD_MAX_LEN + 1);
+    ref_array = malloc((HASH_CNT(hlink, hash) + 1) * sizeof(*ref_array));
+    if(!name_rec || !ref_array)
+    {
+        free(name_rec);
+        free(ref_array);
         return(-1);
-    memset(name_rec, 0, sizeof(darshan_record_id) + PATH_MAX + 1);
+    }
 
-    /* individually serialize each hash record and write to log file */
+    /* sort the hash records by name so names sharing a prefix are adjacent */
     HASH_ITER(hlink, hash, ref, tmp)
     {
-        name_rec_len = sizeof(darshan_record_id) + strlen(ref->name_record->name) + 1;
-        memcpy(name_rec, ref->name_record, name_rec_len);
+        ref_array[ref_cnt++] = ref;
+    }
+    qsort(ref_array, ref_cnt, sizeof(*ref_array), darshan_name_record_ref_cmp);
+
+    /* individually serialize each hash record (front coded relative to the
+     * previous record's name) and write to log file
+     */
+    for(i = 0; i < ref_cnt; i++)
+    {
+        name = ref_array[i]->name_record->name;
+        if(strlen(name) > DARSHAN_NAME_RECORD_MAX_LEN)
+        {
+            state->err = -1;
+            fprintf(stderr, "Error: name record too long to write to darshan log file.\n");
+            free(name_rec);
+            free(ref_array);
+            return(-1);
+        }
+        prefix_len = 0;
+        while(prev_name[prefix_len] && prev_name[prefix_len] == name[prefix_len])
+            prefix_len++;
+        name_rec_len = DARSHAN_NAME_RECORD_HDR_SIZE + strlen(name + prefix_len) + 1;
+        memcpy(name_rec, &(ref_array[i]->name_record->id), sizeof(darshan_record_id));
+        memcpy(name_rec + sizeof(darshan_record_id), &prefix_len, sizeof(prefix_len));
+        strcpy(name_rec + DARSHAN_NAME_RECORD_HDR_SIZE, name + prefix_len);
 
         /* write this hash entry to log file */
         wrote = darshan_log_dzwrite(fd, DARSHAN_NAME_MAP_REGION_ID,
@@ -617,11 +721,14 @@ int darshan_log_put_namehash(darshan_fd fd, struct darshan_name_record_ref *hash
             state->err = -1;
             fprintf(stderr, "Error: failed to write name hash to darshan log file.\n");
             free(name_rec);
+            free(ref_array);
             return(-1);
         }
+        prev_name = name;
     }
 
     free(name_rec);
+    free(ref_array);
     return(0);
 }
 
@@ -744,6 +851,18 @@ void darshan_log_close(darshan_fd fd)
                 if(ret == 0)
                     break;
 #endif 
+#ifdef HAVE_LIBZSTD
+            case DARSHAN_ZSTD_COMP:
+                ret = darshan_log_zstd_flush(fd, state->dz.prev_reg_id);
+                if(ret == 0)
+                    break;
+#endif
+#ifdef HAVE_LIBLZ4
+            case DARSHAN_LZ4_COMP:
+                ret = darshan_log_lz4_flush(fd, state->dz.prev_reg_id);
+                if(ret == 0)
+                    break;
+#endif
             default:
                 /* if flush fails, remove the output log file */
                 state->err = -1;
@@ -802,11 +921,14 @@ static int darshan_mnt_info_cmp(const void *a, const void *b)
 }
 
 static int darshan_log_get_namerecs(void *name_rec_buf, int buf_len,
-    int swap_flag, struct darshan_name_record_ref **hash)
+    int swap_flag, char *prev_name, struct darshan_name_record_ref **hash)
 {
     struct darshan_name_record_ref *ref;
-    struct darshan_name_record *name_rec;
-    char *tmp_p;
+    darshan_record_id rec_id;
+    uint16_t prefix_len;
+    char *buf_ptr = name_rec_buf;
+    char *suffix;
+    int suffix_len;
     int buf_processed = 0;
     int rec_len;
 
@@ -814,49 +936,65 @@ static int darshan_log_get_namerecs(void *name_rec_buf, int buf_len,
      * and add to the output hash table
      * NOTE: these mapping pairs are variable in length, so we have to be able
      * to handle incomplete mappings temporarily here
+     * NOTE: darshan record hash serialization method:
+     *          ... darshan_record_id | (uint16_t) prefix_len | name suffix ...
+     *       where prefix_len characters of the name are shared with the name
+     *       of the previous record (prev_name)
      */
-    name_rec = (struct darshan_name_record *)name_rec_buf;
-    while(buf_len > sizeof(darshan_record_id) + 1)
+    while(buf_len > DARSHAN_NAME_RECORD_HDR_SIZE)
     {
-        if(strnlen(name_rec->name, buf_len - sizeof(darshan_record_id)) ==
-            (buf_len - sizeof(darshan_record_id)))
+        suffix = buf_ptr + DARSHAN_NAME_RECORD_HDR_SIZE;
+        suffix_len = strnlen(suffix, buf_len - DARSHAN_NAME_RECORD_HDR_SIZE);
+        if(suffix_len == (buf_len - DARSHAN_NAME_RECORD_HDR_SIZE))
         {
             /* if this record name's terminating null character is not
              * present, we need to read more of the buffer before continuing
              */
             break;
         }
-        rec_len = sizeof(darshan_record_id) + strlen(name_rec->name) + 1;
+        rec_len = DARSHAN_NAME_RECORD_HDR_SIZE + suffix_len + 1;
 
+        /* NOTE: records are not aligned in the buffer, so copy out the
+         * fixed size fields before using them
+         */
+        memcpy(&rec_id, buf_ptr, sizeof(rec_id));
+        memcpy(&prefix_len, buf_ptr + sizeof(rec_id), sizeof(prefix_len));
         if(swap_flag)
         {
             /* we need to sort out endianness issues before deserializing */
-            DARSHAN_BSWAP64(&(name_rec->id));
+            DARSHAN_BSWAP64(&rec_id);
+            DARSHAN_BSWAP16(&prefix_len);
         }
 
-        HASH_FIND(hlink, *hash, &(name_rec->id), sizeof(darshan_record_id), ref);
+        if(prefix_len > strlen(prev_name) ||
+            (prefix_len + suffix_len) > DARSHAN_NAME_RECORD_MAX_LEN)
+            return(-1);
+        strcpy(prev_name + prefix_len, suffix);
+
+        HASH_FIND(hlink, *hash, &rec_id, sizeof(darshan_record_id), ref);
         if(!ref)
         {
             ref = malloc(sizeof(*ref));
             if(!ref)
                 return(-1);
 
-            ref->name_record = malloc(rec_len);
+            ref->name_record = malloc(sizeof(darshan_record_id) +
+                prefix_len + suffix_len + 1);
             if(!ref->name_record)
             {
                 free(ref);
                 return(-1);
             }
 
-            /* copy the name record over from the hash buffer */
-            memcpy(ref->name_record, name_rec, rec_len);
+            /* reconstruct the full name record */
+            ref->name_record->id = rec_id;
+            strcpy(ref->name_record->name, prev_name);
 
             /* add this record to the hash */
             HASH_ADD(hlink, *hash, name_record->id, sizeof(darshan_record_id), ref);
         }
 
-        tmp_p = (char *)name_rec + rec_len;
-        name_rec = (struct darshan_name_record *)tmp_p;
+        buf_ptr += rec_len;
         buf_len -= rec_len;
         buf_processed += rec_len;
     }
@@ -864,6 +1002,14 @@ static int darshan_log_get_namerecs(void *name_rec_buf, int buf_len,
     return(buf_processed);
 }
 
+static int darshan_name_record_ref_cmp(const void *a, const void *b)
+{
+    struct darshan_name_record_ref *ref_a = *(struct darshan_name_record_ref **)a;
+    struct darshan_name_record_ref *ref_b = *(struct darshan_name_record_ref **)b;
+
+    return(strcmp(ref_a->name_record->name, ref_b->name_record->name));
+}
+
 /* read the header of the darshan log and set internal fd data structures
  * NOTE: this is the only portion of the darshan log that is uncompressed
  *
@@ -896,6 +1042,10 @@ static int darshan_log_get_header(darshan_fd fd)
         fd->state->get_namerecs = darshan_log_get_namerecs_3_00;
     }
     else if(strcmp(fd->version, "3.10") == 0)
+    {
+        fd->state->get_namerecs = darshan_log_get_namerecs_3_10;
+    }
+    else if(strcmp(fd->version, "3.20") == 0)
     {
         fd->state->get_namerecs = darshan_log_get_namerecs;
     }
@@ -956,6 +1106,7 @@ static int darshan_log_get_header(darshan_fd fd)
 
     /* set some fd fields based on what's stored in the header */
     fd->comp_type = header.comp_type;
+    fd->hash_type = header.hash_type;
     fd->partial_flag = header.partial_flag;
     memcpy(fd->mod_ver, header.mod_ver, DARSHAN_MAX_MODS * sizeof(uint32_t));
 
@@ -1015,6 +1166,7 @@ static int darshan_log_put_header(darshan_fd fd)
     strcpy(header.version_string, DARSHAN_LOG_VERSION);
     header.magic_nr = DARSHAN_MAGIC_NR;
     header.comp_type = fd->comp_type;
+    header.hash_type = fd->hash_type;
     header.partial_flag = fd->partial_flag;
     memcpy(&header.name_map, &fd->name_map, sizeof(struct darshan_log_map));
     memcpy(header.mod_map, fd->mod_map, DARSHAN_MAX_MODS * sizeof(struct darshan_log_map));
@@ -1183,6 +1335,72 @@ static int darshan_log_dzinit(darshan_fd fd)
             state->dz.comp_dat = tmp_bzstrm;
             break;
         }
+#endif
+#ifdef HAVE_LIBZSTD
+        case DARSHAN_ZSTD_COMP:
+        {
+            struct darshan_zstd_state *tmp_zs = malloc(sizeof(*tmp_zs));
+            if(!tmp_zs)
+            {
+                free(state->dz.buf);
+                return(-1);
+            }
+            memset(tmp_zs, 0, sizeof(*tmp_zs));
+
+            if(!(state->creat_flag))
+            {
+                /* read only file, init decompression context */
+                tmp_zs->dctx = ZSTD_createDCtx();
+                ret = (tmp_zs->dctx == NULL);
+            }
+            else
+            {
+                /* write only file, init compression context */
+                tmp_zs->cctx = ZSTD_createCCtx();
+                ret = (tmp_zs->cctx == NULL);
+            }
+            if(ret)
+            {
+                free(tmp_zs);
+                free(state->dz.buf);
+                return(-1);
+            }
+            state->dz.comp_dat = tmp_zs;
+            break;
+        }
+#endif
+#ifdef HAVE_LIBLZ4
+        case DARSHAN_LZ4_COMP:
+        {
+            struct darshan_lz4_state *tmp_lz = malloc(sizeof(*tmp_lz));
+            if(!tmp_lz)
+            {
+                free(state->dz.buf);
+                return(-1);
+            }
+            memset(tmp_lz, 0, sizeof(*tmp_lz));
+
+            if(!(state->creat_flag))
+            {
+                /* read only file, init decompression context */
+                ret = LZ4F_isError(
+                    LZ4F_createDecompressionContext(&tmp_lz->dctx, LZ4F_VERSION));
+            }
+            else
+            {
+                /* write only file, init compression context */
+                ret = LZ4F_isError(
+                    LZ4F_createCompressionContext(&tmp_lz->cctx, LZ4F_VERSION));
+            }
+            if(ret)
+            {
+                free(tmp_lz);
+                free(state->dz.buf);
+                return(-1);
+            }
+            state->dz.comp_dat = tmp_lz;
+            break;
+        }
 #endif
         case DARSHAN_NO_COMP:
         {
@@ -1219,6 +1437,28 @@ static void darshan_log_dzdestroy(darshan_fd fd)
             else
                 BZ2_bzCompressEnd((bz_stream *)state->dz.comp_dat);
             break;
+#endif
+#ifdef HAVE_LIBZSTD
+        case DARSHAN_ZSTD_COMP:
+        {
+            struct darshan_zstd_state *zs = state->dz.comp_dat;
+            if(!(state->creat_flag))
+                ZSTD_freeDCtx(zs->dctx);
+            else
+                ZSTD_freeCCtx(zs->cctx);
+            break;
+        }
+#endif
+#ifdef HAVE_LIBLZ4
+        case DARSHAN_LZ4_COMP:
+        {
+            struct darshan_lz4_state *lz = state->dz.comp_dat;
+            if(!(state->creat_flag))
+                LZ4F_freeDecompressionContext(lz->dctx);
+            else
+                LZ4F_freeCompressionContext(lz->cctx);
+            break;
+        }
 #endif
         case DARSHAN_NO_COMP:
             /* do nothing */
@@ -1263,6 +1503,16 @@ static int darshan_log_dzread(darshan_fd fd, int region_id, void *buf, int len)
         case DARSHAN_BZIP2_COMP:
             ret = darshan_log_bzip2_read(fd, map, buf, len, reset_strm_flag);
             break;
+#endif
+#ifdef HAVE_LIBZSTD
+        case DARSHAN_ZSTD_COMP:
+            ret = darshan_log_zstd_read(fd, map, buf, len, reset_strm_flag);
+            break;
+#endif
+#ifdef HAVE_LIBLZ4
+        case DARSHAN_LZ4_COMP:
+            ret = darshan_log_lz4_read(fd, map, buf, len, reset_strm_flag);
+            break;
 #endif
         case DARSHAN_NO_COMP:
             ret = darshan_log_noz_read(fd, map, buf, len, reset_strm_flag);
@@ -1312,6 +1562,16 @@ static int darshan_log_dzwrite(darshan_fd fd, int region_id, void *buf, int len)
         case DARSHAN_BZIP2_COMP:
             ret = darshan_log_bzip2_write(fd, map_p, buf, len, flush_strm_flag);
             break;
+#endif
+#ifdef HAVE_LIBZSTD
+        case DARSHAN_ZSTD_COMP:
+            ret = darshan_log_zstd_write(fd, map_p, buf, len, flush_strm_flag);
+            break;
+#endif
+#ifdef HAVE_LIBLZ4
+        case DARSHAN_LZ4_COMP:
+            ret = darshan_log_lz4_write(fd, map_p, buf, len, flush_strm_flag);
+            break;
 #endif
         case DARSHAN_NO_COMP:
             fprintf(stderr,
@@ -1654,6 +1914,361 @@ static int darshan_log_bzip2_flush(darshan_fd fd, int region_id)
 }
 #endif
 
+#ifdef HAVE_LIBZSTD
+static int darshan_log_zstd_read(darshan_fd fd, struct darshan_log_map map,
+    void *buf, int len, int reset_strm_flag)
+{
+    struct darshan_fd_int_state *state = fd->state;
+    size_t ret;
+    int total_bytes = 0;
+    size_t tmp_out_bytes;
+    struct darshan_zstd_state *zs = (struct darshan_zstd_state *)state->dz.comp_dat;
+    ZSTD_outBuffer out;
+
+    assert(zs);
+
+    if(reset_strm_flag)
+    {
+        zs->in.src = state->dz.buf;
+        zs->in.size = 0;
+        zs->in.pos = 0;
+        zs->pending = 0;
+        ZSTD_DCtx_reset(zs->dctx, ZSTD_reset_session_only);
+    }
+
+    out.dst = buf;
+    out.size = len;
+    out.pos = 0;
+
+    /* we just decompress until the output buffer is full, assuming there
+     * is enough compressed data in file to satisfy the request size.
+     */
+    while(out.pos < out.size)
+    {
+        /* check if we need more compressed data */
+        if(zs->in.pos == zs->in.size && !zs->pending)
+        {
+            /* if the eor flag is set, clear it and return -- future
+             * reads of this log region will restart at the beginning
+             */
+            if(state->dz.eor)
+            {
+                state->dz.eor = 0;
+                break;
+            }
+
+            /* read more data from input file */
+            if(darshan_log_dzload(fd, map) < 0)
+                return(-1);
+            assert(state->dz.size > 0);
+
+            zs->in.src = state->dz.buf;
+            zs->in.size = state->dz.size;
+            zs->in.pos = 0;
+        }
+
+        tmp_out_bytes = out.pos;
+        ret = ZSTD_decompressStream(zs->dctx, &out, &zs->in);
+        if(ZSTD_isError(ret))
+        {
+            fprintf(stderr, "Error: unable to decompress darshan log data.\n");
+            return(-1);
+        }
+        total_bytes += (out.pos - tmp_out_bytes);
+
+        /* a full output buffer may leave decompressed data buffered in the
+         * context, so drain it before loading more input
+         */
+        zs->pending = (out.pos == out.size);
+        if(zs->in.pos == zs->in.size && out.pos == tmp_out_bytes)
+            zs->pending = 0;
+    }
+
+    return(total_bytes);
+}
+
+static int darshan_log_zstd_write(darshan_fd fd, struct darshan_log_map *map_p,
+    void *buf, int len, int flush_strm_flag)
+{
+    struct darshan_fd_int_state *state = fd->state;
+    size_t ret;
+    struct darshan_zstd_state *zs = (struct darshan_zstd_state *)state->dz.comp_dat;
+    ZSTD_inBuffer in;
+    ZSTD_outBuffer out;
+
+    assert(zs);
+
+    /* flush compressed output buffer if we are moving to a new log region */
+    if(flush_strm_flag)
+    {
+        if(darshan_log_zstd_flush(fd, state->dz.prev_reg_id) < 0)
+            return(-1);
+    }
+
+    in.src = buf;
+    in.size = len;
+    in.pos = 0;
+    out.dst = state->dz.buf;
+    out.size = DARSHAN_DEF_COMP_BUF_SZ;
+    out.pos = state->dz.size;
+
+    /* compress input data until none left */
+    while(in.pos < in.size)
+    {
+        /* if we are out of output, flush to log file */
+        if(out.pos == out.size)
+        {
+            assert(state->dz.size == DARSHAN_DEF_COMP_BUF_SZ);
+
+            if(darshan_log_dzunload(fd, map_p) < 0)
+                return(-1);
+            out.pos = 0;
+        }
+
+        ret = ZSTD_compressStream2(zs->cctx, &out, &in, ZSTD_e_continue);
+        if(ZSTD_isError(ret))
+        {
+            fprintf(stderr, "Error: unable to compress darshan log data.\n");
+            return(-1);
+        }
+        state->dz.size = out.pos;
+    }
+
+    return(in.pos);
+}
+
+static int darshan_log_zstd_flush(darshan_fd fd, int region_id)
+{
+    struct darshan_fd_int_state *state = fd->state;
+    size_t ret;
+    struct darshan_log_map *map_p;
+    struct darshan_zstd_state *zs = (struct darshan_zstd_state *)state->dz.comp_dat;
+    ZSTD_inBuffer in = {NULL, 0, 0};
+    ZSTD_outBuffer out;
+
+    assert(zs);
+
+    if(region_id == DARSHAN_JOB_REGION_ID)
+        map_p = &(fd->job_map);
+    else if(region_id == DARSHAN_NAME_MAP_REGION_ID)
+        map_p = &(fd->name_map);
+    else
+        map_p = &(fd->mod_map[region_id]);
+
+    out.dst = state->dz.buf;
+    out.size = DARSHAN_DEF_COMP_BUF_SZ;
+    out.pos = state->dz.size;
+
+    /* make sure zstd ends the frame for this region */
+    do
+    {
+        ret = ZSTD_compressStream2(zs->cctx, &out, &in, ZSTD_e_end);
+        if(ZSTD_isError(ret))
+        {
+            fprintf(stderr, "Error: unable to compress darshan log data.\n");
+            return(-1);
+        }
+        state->dz.size = out.pos;
+
+        if(state->dz.size)
+        {
+            /* flush to file */
+            if(darshan_log_dzunload(fd, map_p) < 0)
+                return(-1);
+            out.pos = 0;
+        }
+    } while(ret != 0);
+
+    return(0);
+}
+#endif
+
+#ifdef HAVE_LIBLZ4
+static int darshan_log_lz4_read(darshan_fd fd, struct darshan_log_map map,
+    void *buf, int len, int reset_strm_flag)
+{
+    struct darshan_fd_int_state *state = fd->state;
+    size_t ret;
+    int total_bytes = 0;
+    size_t src_size;
+    size_t dst_size;
+    struct darshan_lz4_state *lz = (struct darshan_lz4_state *)state->dz.comp_dat;
+
+    assert(lz);
+
+    if(reset_strm_flag)
+    {
+        lz->in_pos = state->dz.size;
+        lz->pending = 0;
+        LZ4F_resetDecompressionContext(lz->dctx);
+    }
+
+    /* we just decompress until the output buffer is full, assuming there
+     * is enough compressed data in file to satisfy the request size.
+     */
+    while(total_bytes < len)
+    {
+        /* check if we need more compressed data */
+        if(lz->in_pos == state->dz.size && !lz->pending)
+        {
+            /* if the eor flag is set, clear it and return -- future
+             * reads of this log region will restart at the beginning
+             */
+            if(state->dz.eor)
+            {
+                state->dz.eor = 0;
+                break;
+            }
+
+            /* read more data from input file */
+            if(darshan_log_dzload(fd, map) < 0)
+                return(-1);
+            assert(state->dz.size > 0);
+            lz->in_pos = 0;
+        }
+
+        src_size = state->dz.size - lz->in_pos;
+        dst_size = len - total_bytes;
+        ret = LZ4F_decompress(lz->dctx, (char *)buf + total_bytes, &dst_size,
+            state->dz.buf + lz->in_pos, &src_size, NULL);
+        if(LZ4F_isError(ret))
+        {
+            fprintf(stderr, "Error: unable to decompress darshan log data.\n");
+            return(-1);
+        }
+        lz->in_pos += src_size;
+        total_bytes += dst_size;
+
+        /* a full output buffer may leave decompressed data buffered in the
+         * context, so drain it before loading more input
+         */
+        lz->pending = (total_bytes == len);
+        if(lz->in_pos == state->dz.size && dst_size == 0)
+            lz->pending = 0;
+    }
+
+    return(total_bytes);
+}
+
+/* make sure the staging buffer has room for the lz4 output of one input
+ * chunk, flushing it to the log file if not
+ */
+static int darshan_log_lz4_reserve(darshan_fd fd, struct darshan_log_map *map_p)
+{
+    struct darshan_fd_int_state *state = fd->state;
+    struct darshan_lz4_state *lz = (struct darshan_lz4_state *)state->dz.comp_dat;
+
+    if(DARSHAN_DEF_COMP_BUF_SZ - state->dz.size <
+        LZ4F_compressBound(DARSHAN_LZ4_CHUNK_SZ, &lz->prefs))
+    {
+        if(darshan_log_dzunload(fd, map_p) < 0)
+            return(-1);
+    }
+
+    return(0);
+}
+
+static int darshan_log_lz4_write(darshan_fd fd, struct darshan_log_map *map_p,
+    void *buf, int len, int flush_strm_flag)
+{
+    struct darshan_fd_int_state *state = fd->state;
+    size_t ret;
+    int total_bytes = 0;
+    int chunk;
+    struct darshan_lz4_state *lz = (struct darshan_lz4_state *)state->dz.comp_dat;
+
+    assert(lz);
+
+    /* flush compressed output buffer if we are moving to a new log region */
+    if(flush_strm_flag)
+    {
+        if(darshan_log_lz4_flush(fd, state->dz.prev_reg_id) < 0)
+            return(-1);
+    }
+
+    if(!lz->frame_started)
+    {
+        if(darshan_log_lz4_reserve(fd, map_p) < 0)
+            return(-1);
+        ret = LZ4F_compressBegin(lz->cctx, state->dz.buf + state->dz.size,
+            DARSHAN_DEF_COMP_BUF_SZ - state->dz.size, &lz->prefs);
+        if(LZ4F_isError(ret))
+        {
+            fprintf(stderr, "Error: unable to compress darshan log data.\n");
+            return(-1);
+        }
+        state->dz.size += ret;
+        lz->frame_started = 1;
+    }
+
+    /* compress input data a chunk at a time until none left */
+    while(total_bytes < len)
+    {
+        if(darshan_log_lz4_reserve(fd, map_p) < 0)
+            return(-1);
+
+        chunk = len - total_bytes;
+        if(chunk > DARSHAN_LZ4_CHUNK_SZ)
+            chunk = DARSHAN_LZ4_CHUNK_SZ;
+        ret = LZ4F_compressUpdate(lz->cctx, state->dz.buf + state->dz.size,
+            DARSHAN_DEF_COMP_BUF_SZ - state->dz.size,
+            (char *)buf + total_bytes, chunk, NULL);
+        if(LZ4F_isError(ret))
+        {
+            fprintf(stderr, "Error: unable to compress darshan log data.\n");
+            return(-1);
+        }
+        state->dz.size += ret;
+        total_bytes += chunk;
+    }
+
+    return(total_bytes);
+}
+
+static int darshan_log_lz4_flush(darshan_fd fd, int region_id)
+{
+    struct darshan_fd_int_state *state = fd->state;
+    size_t ret;
+    struct darshan_log_map *map_p;
+    struct darshan_lz4_state *lz = (struct darshan_lz4_state *)state->dz.comp_dat;
+
+    assert(lz);
+
+    if(region_id == DARSHAN_JOB_REGION_ID)
+        map_p = &(fd->job_map);
+    else if(region_id == DARSHAN_NAME_MAP_REGION_ID)
+        map_p = &(fd->name_map);
+    else
+        map_p = &(fd->mod_map[region_id]);
+
+    /* regions with no data still get a (empty) frame */
+    if(!lz->frame_started)
+    {
+        if(darshan_log_lz4_write(fd, map_p, NULL, 0, 0) < 0)
+            return(-1);
+    }
+
+    /* make sure lz4 ends the frame for this region */
+    if(darshan_log_lz4_reserve(fd, map_p) < 0)
+        return(-1);
+    ret = LZ4F_compressEnd(lz->cctx, state->dz.buf + state->dz.size,
+        DARSHAN_DEF_COMP_BUF_SZ - state->dz.size, NULL);
+    if(LZ4F_isError(ret))
+    {
+        fprintf(stderr, "Error: unable to compress darshan log data.\n");
+        return(-1);
+    }
+    state->dz.size += ret;
+    lz->frame_started = 0;
+
+    /* flush to file */
+    if(darshan_log_dzunload(fd, map_p) < 0)
+        return(-1);
+
+    return(0);
+}
+#endif
+
 static int darshan_log_noz_read(darshan_fd fd, struct darshan_log_map map,
     void *buf, int len, int reset_strm_flag)
 {
@@ -1765,7 +2380,7 @@ static int darshan_log_dzunload(darshan_fd fd, struct darshan_log_map *map_p)
  ********************************************************/
 
 int darshan_log_get_namerecs_3_00(void *name_rec_buf, int buf_len,
-    int swap_flag, struct darshan_name_record_ref **hash)
+    int swap_flag, char *prev_name, struct darshan_name_record_ref **hash)
 {
     struct darshan_name_record_ref *ref;
     char *buf_ptr;
@@ -1837,6 +2452,69 @@ int darshan_log_get_namerecs_3_00(void *name_rec_buf, int buf_len,
     return(buf_processed);
 }
 
+int darshan_log_get_namerecs_3_10(void *name_rec_buf, int buf_len,
+    int swap_flag, char *prev_name, struct darshan_name_record_ref **hash)
+{
+    struct darshan_name_record_ref *ref;
+    struct darshan_name_record *name_rec;
+    char *tmp_p;
+    int buf_processed = 0;
+    int rec_len;
+
+    /* work through the name record buffer -- deserialize the record data
+     * and add to the output hash table
+     * NOTE: these mapping pairs are variable in length, so we have to be able
+     * to handle incomplete mappings temporarily here
+     */
+    name_rec = (struct darshan_name_record *)name_rec_buf;
+    while(buf_len > sizeof(darshan_record_id) + 1)
+    {
+        if(strnlen(name_rec->name, buf_len - sizeof(darshan_record_id)) ==
+            (buf_len - sizeof(darshan_record_id)))
+        {
+            /* if this record name's terminating null character is not
+             * present, we need to read more of the buffer before continuing
+             */
+            break;
+        }
+        rec_len = sizeof(darshan_record_id) + strlen(name_rec->name) + 1;
+
+        if(swap_flag)
+        {
+            /* we need to sort out endianness issues before deserializing */
+            DARSHAN_BSWAP64(&(name_rec->id));
+        }
+
+        HASH_FIND(hlink, *hash, &(name_rec->id), sizeof(darshan_record_id), ref);
+        if(!ref)
+        {
+            ref = malloc(sizeof(*ref));
+            if(!ref)
+                return(-1);
+
+            ref->name_record = malloc(rec_len);
+            if(!ref->name_record)
+            {
+                free(ref);
+                return(-1);
+            }
+
+            /* copy the name record over from the hash buffer */
+            memcpy(ref->name_record, name_rec, rec_len);
+
+            /* add this record to the hash */
+            HASH_ADD(hlink, *hash, name_record->id, sizeof(darshan_record_id), ref);
+        }
+
+        tmp_p = (char *)name_rec + rec_len;
+        name_rec = (struct darshan_name_record *)tmp_p;
+        buf_len -= rec_len;
+        buf_processed += rec_len;
+    }
+
+    return(buf_processed);
+}
+
 /*
  * Local variables:
  *  c-indent-level: 4
@@ -12,6 +12,12 @@
 #ifdef HAVE_LIBBZ2
 #include <bzlib.h>
 #endif
+#ifdef HAVE_LIBZSTD
+#include <zstd.h>
+#endif
+#ifdef HAVE_LIBLZ4
+#include <lz4frame.h>
+#endif
 
 #include "uthash-1.9.2/src/uthash.h"
 
@@ -37,6 +43,8 @@ struct darshan_fd_s
     int partial_flag;
     /* compression type used on log file */
     enum darshan_comp_type comp_type;
+    /* hash function used to generate the log's record ids */
+    enum darshan_hash_type hash_type;
     /* log file offset/length maps for each log file region */
     struct darshan_log_map job_map;
     struct darshan_log_map name_map;
@@ -138,6 +146,8 @@ extern struct darshan_mod_logutil_funcs *mod_logutils[];
 /* DXT */
 #include "darshan-dxt-logutils.h"
 #include "darshan-mdhim-logutils.h"
+#include "darshan-self-logutils.h"
+#include "darshan-iouring-logutils.h"
 
 darshan_fd darshan_log_open(const char *name);
 darshan_fd darshan_log_create(const char *name, enum darshan_comp_type comp_type,
@@ -211,5 +221,12 @@ void darshan_log_print_version_warnings(const char *version_string);
     __dst_char[3] = __src_char[0]; \
     memcpy(__ptr, __dst_char, 4); \
 } while(0)
+#define DARSHAN_BSWAP16(__ptr) do {\
+    char __dst_char[2]; \
+    char* __src_char = (char*)__ptr; \
+    __dst_char[0] = __src_char[1]; \
+    __dst_char[1] = __src_char[0]; \
+    memcpy(__ptr, __dst_char, 2); \
+} while(0)
 
 #endif
@@ -2,8 +2,11 @@
 #include <stdlib.h>
 #include <fcntl.h>
 #include <string.h>
+#include <unistd.h>
 #include <getopt.h>
 #include <glob.h>
+#include <libgen.h>
+#include <pthread.h>
 
 #include "uthash-1.9.2/src/uthash.h"
 
@@ -17,28 +20,129 @@ struct darshan_shared_record_ref
     UT_hash_handle hlink;
 };
 
+/* job data and record names read from an input log in the first pass */
+struct darshan_merge_input
+{
+    char *path;
+    struct darshan_job job;
+    enum darshan_hash_type hash_type;
+    struct darshan_name_record_ref *name_hash;
+    char *exe; /* exe and mounts are only read from the first log */
+    struct darshan_mnt_info *mnt_array;
+    int mnt_count;
+    char *err;
+};
+
+/* state shared by the threads reading input logs in the first pass */
+struct darshan_merge_readers
+{
+    struct darshan_merge_input *inputs;
+    int n_inputs;
+    int next_input;
+    pthread_mutex_t mutex;
+};
+
 void usage(char *exename)
 {
     fprintf(stderr, "Usage: %s --output <output_path> [options] <input_log_glob>\n", exename);
+    fprintf(stderr, "       %s --manifest <manifest_path> [options]\n", exename);
     fprintf(stderr, "This utility merges multiple Darshan log files into a single output log file.\n");
     fprintf(stderr, "<input_log_glob> is a pattern that matches all input log files (e.g., /log-path/*.darshan).\n");
+    fprintf(stderr, "Quote the pattern to have it expanded by %s rather than the shell.\n", exename);
     fprintf(stderr, "Options:\n");
-    fprintf(stderr, "\t--output\t(REQUIRED) Full path of the output darshan log file.\n");
+    fprintf(stderr, "\t--output\t(REQUIRED unless --manifest is given) Full path of the output darshan log file.\n");
+    fprintf(stderr, "\t--manifest\tAssemble the pieces of a log described by the given manifest (implies --shared-redux).\n");
     fprintf(stderr, "\t--shared-redux\tReduce globally shared records into a single record.\n");
+    fprintf(stderr, "\t--threads\tNumber of threads used to read the input logs (default 1).\n");
     fprintf(stderr, "\t--job-end-time\tSet the output log's job end time (requires argument of seconds since Epoch).\n");
 
     exit(1);
 }
 
+/* read the manifest describing the pieces of a log: the output log path,
+ * and the number of processes, each of which wrote a piece named after its
+ * rank alongside the manifest. returns the list of pieces, or NULL if the
+ * manifest can't be read or any piece is missing or incomplete
+ */
+char **read_manifest(char *manifest_path, char **outlog_path, int *n_pieces)
+{
+    FILE *manifest;
+    char line[PATH_MAX + 16];
+    char *dir;
+    char *dir_copy;
+    char **pieces;
+    char *check;
+    int nprocs = -1;
+    int missing = 0;
+    int len;
+    int i;
+
+    manifest = fopen(manifest_path, "r");
+    if(!manifest)
+        return(NULL);
+    while(fgets(line, sizeof(line), manifest))
+    {
+        len = strlen(line);
+        if(len > 0 && line[len-1] == '\n')
+            line[len-1] = '\0';
+        if(strncmp(line, "log=", 4) == 0 && *outlog_path == NULL)
+            *outlog_path = strdup(line + 4);
+        else if(strncmp(line, "nprocs=", 7) == 0)
+        {
+            nprocs = strtol(line + 7, &check, 10);
+            if(check == line + 7 || *check != '\0')
+                nprocs = -1;
+        }
+    }
+    fclose(manifest);
+    if(*outlog_path == NULL || nprocs < 1)
+        return(NULL);
+
+    dir_copy = strdup(manifest_path);
+    pieces = calloc(nprocs, sizeof(*pieces));
+    if(!dir_copy || !pieces)
+        return(NULL);
+    dir = dirname(dir_copy);
+
+    /* NOTE: pieces are renamed from *.darshan_partial once complete */
+    for(i = 0; i < nprocs; i++)
+    {
+        pieces[i] = malloc(PATH_MAX);
+        if(!pieces[i] ||
+           snprintf(pieces[i], PATH_MAX, "%s/%06d.darshan", dir, i) >= PATH_MAX)
+            return(NULL);
+        if(access(pieces[i], F_OK) != 0)
+        {
+            if(missing++ < 8)
+                fprintf(stderr, "Error: log piece %s is missing or incomplete.\n",
+                    pieces[i]);
+        }
+    }
+    free(dir_copy);
+    if(missing)
+    {
+        fprintf(stderr, "Error: %d of %d log pieces are missing or incomplete.\n",
+            missing, nprocs);
+        return(NULL);
+    }
+
+    *n_pieces = nprocs;
+    return(pieces);
+}
+
 void parse_args(int argc, char **argv, char ***infile_list, int *n_files,
-    char **outlog_path, int *shared_redux, int64_t *job_end_time)
+    char **outlog_path, int *shared_redux, int64_t *job_end_time,
+    int *n_threads)
 {
     int index;
     char *check;
+    char *manifest_path = NULL;
     static struct option long_opts[] =
     {
         {"output", required_argument, NULL, 'o'},
+        {"manifest", required_argument, NULL, 'm'},
         {"shared-redux", no_argument, NULL, 's'},
+        {"threads", required_argument, NULL, 't'},
         {"job-end-time", required_argument, NULL, 'e'},
         {0, 0, 0, 0}
     };
@@ -46,6 +150,7 @@ void parse_args(int argc, char **argv, char ***infile_list, int *n_files,
     *shared_redux = 0;
     *outlog_path = NULL;
     *job_end_time = 0;
+    *n_threads = 1;
 
     while(1)
     {
@@ -61,6 +166,17 @@ void parse_args(int argc, char **argv, char ***infile_list, int *n_files,
             case 'o':
                 *outlog_path = optarg;
                 break;
+            case 'm':
+                manifest_path = optarg;
+                break;
+            case 't':
+                *n_threads = strtol(optarg, &check, 10);
+                if(optarg == check || *n_threads < 1)
+                {
+                    fprintf(stderr, "Error: invalid number of threads.\n");
+                    exit(1);
+                }
+                break;
             case 'e':
                 *job_end_time = strtol(optarg, &check, 10);
                 if(optarg == check)
@@ -76,17 +192,124 @@ void parse_args(int argc, char **argv, char ***infile_list, int *n_files,
         }
     }
 
-    if(*outlog_path == NULL)
+    if(manifest_path)
+    {
+        /* the pieces of a log are reduced when they are assembled */
+        if(optind != argc)
+            usage(argv[0]);
+        *infile_list = read_manifest(manifest_path, outlog_path, n_files);
+        if(!*infile_list)
+        {
+            fprintf(stderr, "Error: unable to assemble the log pieces described by manifest %s.\n",
+                manifest_path);
+            exit(1);
+        }
+        *shared_redux = 1;
+    }
+    else
+    {
+        if(*outlog_path == NULL)
+        {
+            usage(argv[0]);
+        }
+
+        *infile_list = &argv[optind];
+        *n_files = argc - optind;
+    }
+
+    /* expand a quoted input glob ourselves, so that more logs can be merged
+     * than fit on a command line
+     */
+    if(*n_files == 1 && access((*infile_list)[0], F_OK) != 0)
     {
-        usage(argv[0]);
+        static glob_t infile_glob;
+
+        if(glob((*infile_list)[0], 0, NULL, &infile_glob) == 0)
+        {
+            *infile_list = infile_glob.gl_pathv;
+            *n_files = infile_glob.gl_pathc;
+        }
+    }
+
+    return;
+}
+
+/* read the job data and the record names of a single input log */
+void read_input_log(struct darshan_merge_input *input)
+{
+    darshan_fd in_fd;
+    int ret;
+
+    memset(&input->job, 0, sizeof(struct darshan_job));
+
+    in_fd = darshan_log_open(input->path);
+    if(in_fd == NULL)
+    {
+        input->err = "Error: unable to open input Darshan log file %s.\n";
+        return;
+    }
+
+    /* read job-level metadata from the input file */
+    ret = darshan_log_get_job(in_fd, &input->job);
+    if(ret < 0)
+    {
+        input->err = "Error: unable to read job data from input Darshan log file %s.\n";
+        darshan_log_close(in_fd);
+        return;
+    }
+    input->hash_type = in_fd->hash_type;
+
+    if(input->exe)
+    {
+        ret = darshan_log_get_exe(in_fd, input->exe);
+        if(ret < 0)
+        {
+            input->err = "Error: unable to read exe string from input Darshan log file %s.\n";
+            darshan_log_close(in_fd);
+            return;
+        }
+
+        ret = darshan_log_get_mounts(in_fd, &input->mnt_array, &input->mnt_count);
+        if(ret < 0)
+        {
+            input->err = "Error: unable to read mount info from input Darshan log file %s.\n";
+            darshan_log_close(in_fd);
+            return;
+        }
     }
 
-    *infile_list = &argv[optind];
-    *n_files = argc - optind;
+    /* read the hash of ids->names for the input log */
+    ret = darshan_log_get_namehash(in_fd, &input->name_hash);
+    if(ret < 0)
+    {
+        input->err = "Error: unable to read job data from input Darshan log file %s.\n";
+        darshan_log_close(in_fd);
+        return;
+    }
 
+    darshan_log_close(in_fd);
     return;
 }
 
+/* read input logs until there are none left */
+void *read_input_logs(void *arg)
+{
+    struct darshan_merge_readers *readers = arg;
+    int i;
+
+    while(1)
+    {
+        pthread_mutex_lock(&readers->mutex);
+        i = readers->next_input++;
+        pthread_mutex_unlock(&readers->mutex);
+        if(i >= readers->n_inputs)
+            break;
+        read_input_log(&readers->inputs[i]);
+    }
+
+    return(NULL);
+}
+
 int build_mod_shared_rec_hash(char **infile_list, int n_infiles,
     darshan_module_id mod_id, int nprocs, char *mod_buf,
     struct darshan_shared_record_ref **shared_rec_hash)
@@ -187,53 +410,77 @@ int main(int argc, char *argv[])
     char **infile_list;
     int n_infiles;
     int shared_redux;
+    int n_threads;
     int64_t job_end_time = 0;
     char *outlog_path;
     darshan_fd in_fd, merge_fd;
-    struct darshan_job in_job, merge_job;
+    struct darshan_job merge_job;
+    struct darshan_merge_input *inputs;
+    struct darshan_merge_readers readers;
+    pthread_t *threads;
     char merge_exe[DARSHAN_EXE_LEN+1] = {0};
-    struct darshan_mnt_info *merge_mnt_array;
+    struct darshan_mnt_info *merge_mnt_array = NULL;
     int merge_mnt_count = 0;
-    struct darshan_name_record_ref *in_hash = NULL;
     struct darshan_name_record_ref *merge_hash = NULL;
     struct darshan_name_record_ref *ref, *tmp, *found;
     struct darshan_shared_record_ref *shared_rec_hash = NULL;
     struct darshan_shared_record_ref *sref, *stmp;
     struct darshan_base_record *base_rec;
     char *mod_buf;
+    enum darshan_hash_type merge_hash_type = DARSHAN_JENKINS_HASH;
     int i, j;
     int ret;
 
     /* grab command line arguments */
-    parse_args(argc, argv, &infile_list, &n_infiles, &outlog_path, &shared_redux, &job_end_time);
+    parse_args(argc, argv, &infile_list, &n_infiles, &outlog_path, &shared_redux,
+        &job_end_time, &n_threads);
+
+    if(n_infiles < 1)
+    {
+        fprintf(stderr, "Error: no input Darshan log files to merge.\n");
+        return(-1);
+    }
 
     memset(&merge_job, 0, sizeof(struct darshan_job));
 
     /* first pass at merging together logs:
      *      - compose output job-level metadata structure (including exe & mount data)
      *      - compose output record_id->file_name mapping 
+     *
+     * input logs are read by a pool of threads, then merged in order
      */
+    inputs = calloc(n_infiles + 1, sizeof(*inputs));
+    threads = calloc(n_threads, sizeof(*threads));
+    if(!inputs || !threads)
+    {
+        fprintf(stderr, "Error: unable to allocate memory for input logs.\n");
+        return(-1);
+    }
     for(i = 0; i < n_infiles; i++)
+        inputs[i].path = infile_list[i];
+    if(n_infiles > 0)
+        inputs[0].exe = merge_exe;
+    readers.inputs = inputs;
+    readers.n_inputs = n_infiles;
+    readers.next_input = 0;
+    pthread_mutex_init(&readers.mutex, NULL);
+    if(n_threads > n_infiles)
+        n_threads = n_infiles;
+    for(i = 1; i < n_threads; i++)
     {
-        memset(&in_job, 0, sizeof(struct darshan_job));
-
-        in_fd = darshan_log_open(infile_list[i]);
-        if(in_fd == NULL)
-        {
-            fprintf(stderr,
-                "Error: unable to open input Darshan log file %s.\n",
-                infile_list[i]);
-            return(-1);
-        }
+        if(pthread_create(&threads[i], NULL, read_input_logs, &readers) != 0)
+            break;
+    }
+    n_threads = (i < n_threads) ? i : n_threads;
+    read_input_logs(&readers);
+    for(i = 1; i < n_threads; i++)
+        pthread_join(threads[i], NULL);
 
-        /* read job-level metadata from the input file */
-        ret = darshan_log_get_job(in_fd, &in_job);
-        if(ret < 0)
+    for(i = 0; i < n_infiles; i++)
+    {
+        if(inputs[i].err)
         {
-            fprintf(stderr,
-                "Error: unable to read job data from input Darshan log file %s.\n",
-                infile_list[i]);
-            darshan_log_close(in_fd);
+            fprintf(stderr, inputs[i].err, inputs[i].path);
             return(-1);
         }
 
@@ -244,65 +491,48 @@ int main(int argc, char *argv[])
          * shutdown procedure was started, then it's possible the log has
          * incomplete or corrupt data, so we just throw out the data for now.
          */
-        if(strstr(in_job.metadata, "darshan_shutdown=yes"))
+        if(strstr(inputs[i].job.metadata, "darshan_shutdown=yes"))
         {
             fprintf(stderr,
                 "Error: potentially corrupt data found in input log file %s.\n",
                 infile_list[i]);
-            darshan_log_close(in_fd);
             return(-1);
         }
 #endif
 
+        /* record ids generated by different hash functions can't be
+         * matched up with each other
+         */
         if(i == 0)
+            merge_hash_type = inputs[i].hash_type;
+        else if(inputs[i].hash_type != merge_hash_type)
         {
-            /* get job data, exe, & mounts directly from the first input log */
-            memcpy(&merge_job, &in_job, sizeof(struct darshan_job));
-
-            ret = darshan_log_get_exe(in_fd, merge_exe);
-            if(ret < 0)
-            {
-                fprintf(stderr,
-                    "Error: unable to read exe string from input Darshan log file %s.\n",
-                    infile_list[i]);
-                darshan_log_close(in_fd);
-                return(-1);
-            }
+            fprintf(stderr,
+                "Error: input Darshan log file %s uses a different record id hash than %s.\n",
+                infile_list[i], infile_list[0]);
+            return(-1);
+        }
 
-            ret = darshan_log_get_mounts(in_fd, &merge_mnt_array, &merge_mnt_count);
-            if(ret < 0)
-            {
-                fprintf(stderr,
-                    "Error: unable to read mount info from input Darshan log file %s.\n",
-                    infile_list[i]);
-                darshan_log_close(in_fd);
-                return(-1);
-            }
+        if(i == 0)
+        {
+            /* get job data, exe, & mounts directly from the first input log */
+            memcpy(&merge_job, &inputs[i].job, sizeof(struct darshan_job));
+            merge_mnt_array = inputs[i].mnt_array;
+            merge_mnt_count = inputs[i].mnt_count;
         }
         else
         {
             /* potentially update job timestamps using remaining logs */
-            if(in_job.start_time < merge_job.start_time)
-                merge_job.start_time = in_job.start_time;
-            if(in_job.end_time > merge_job.end_time)
-                merge_job.end_time = in_job.end_time;
-        }
-
-        /* read the hash of ids->names for the input log */
-        ret = darshan_log_get_namehash(in_fd, &in_hash);
-        if(ret < 0)
-        {
-            fprintf(stderr,
-                "Error: unable to read job data from input Darshan log file %s.\n",
-                infile_list[i]);
-            darshan_log_close(in_fd);
-            return(-1);
+            if(inputs[i].job.start_time < merge_job.start_time)
+                merge_job.start_time = inputs[i].job.start_time;
+            if(inputs[i].job.end_time > merge_job.end_time)
+                merge_job.end_time = inputs[i].job.end_time;
         }
 
         /* iterate the input hash, copying over record id->name mappings
          * that have not already been copied to the output hash
          */
-        HASH_ITER(hlink, in_hash, ref, tmp)
+        HASH_ITER(hlink, inputs[i].name_hash, ref, tmp)
         {
             HASH_FIND(hlink, merge_hash, &(ref->name_record->id),
                 sizeof(darshan_record_id), found);
@@ -315,12 +545,9 @@ int main(int argc, char *argv[])
             {
                 fprintf(stderr,
                     "Error: invalid Darshan record table entry.\n");
-                darshan_log_close(in_fd);
                 return(-1);
             }
         }
-
-        darshan_log_close(in_fd);
     }
 
     /* if a job end time was passed in, apply it to the output job */
@@ -334,6 +561,7 @@ int main(int argc, char *argv[])
         fprintf(stderr, "Error: unable to create output darshan log.\n");
         return(-1);
     }
+    merge_fd->hash_type = merge_hash_type;
 
     /* write the darshan job info, exe string, and mount data to output file */
     ret = darshan_log_put_job(merge_fd, &merge_job);
@@ -277,12 +277,18 @@ int main(int argc, char **argv)
         comp_str = "BZIP2";
     else if (fd->comp_type == DARSHAN_NO_COMP)
         comp_str = "NONE";
+    else if (fd->comp_type == DARSHAN_ZSTD_COMP)
+        comp_str = "ZSTD";
+    else if (fd->comp_type == DARSHAN_LZ4_COMP)
+        comp_str = "LZ4";
     else
         comp_str = "UNKNOWN";
 
     /* print job summary */
     printf("# darshan log version: %s\n", fd->version);
     printf("# compression method: %s\n", comp_str);
+    printf("# record id hash: %s\n",
+        (fd->hash_type == DARSHAN_WYHASH_HASH) ? "WYHASH" : "JENKINS");
     printf("# exe: %s\n", tmp_string);
     printf("# uid: %" PRId64 "\n", job.uid);
     printf("# jobid: %" PRId64 "\n", job.jobid);
@@ -416,7 +422,9 @@ int main(int argc, char **argv)
         if(DARSHAN_MOD_FLAG_ISSET(fd->partial_flag, i))
             printf("\n# *WARNING*: The %s module contains incomplete data!\n"
                    "#            This happens when a module runs out of\n"
-                   "#            memory to store new record data.\n",
+                   "#            memory to store new record data, or in\n"
+                   "#            checkpoints taken while some of its I/O\n"
+                   "#            was not yet recorded.\n",
                    darshan_module_names[i]);
 
         if(mask & OPTION_BASE)
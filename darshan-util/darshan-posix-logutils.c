@@ -33,6 +33,7 @@ char *posix_f_counter_names[] = {
 #define DARSHAN_POSIX_FILE_SIZE_1 680
 #define DARSHAN_POSIX_FILE_SIZE_2 648
 #define DARSHAN_POSIX_FILE_SIZE_3 664
+#define DARSHAN_POSIX_FILE_SIZE_4 704
 
 static int darshan_log_get_posix_file(darshan_fd fd, void** posix_buf_p);
 static int darshan_log_put_posix_file(darshan_fd fd, void* posix_buf);
@@ -163,6 +164,26 @@ static int darshan_log_get_posix_file(darshan_fd fd, void** posix_buf_p)
             /* set RENAMED_FROM to 0 (-1 not possible since this is a uint) */
             *((int64_t *)(src_p + (2 * sizeof(int64_t)))) = 0;
         }
+        if(fd->mod_ver[DARSHAN_POSIX_MOD] <= 4)
+        {
+            if(fd->mod_ver[DARSHAN_POSIX_MOD] == 4)
+            {
+                rec_len = DARSHAN_POSIX_FILE_SIZE_4;
+                ret = darshan_log_get_mod(fd, DARSHAN_POSIX_MOD, scratch, rec_len);
+                if(ret != rec_len)
+                    goto exit;
+            }
+
+            /* upconvert version 4 to version 5 in-place */
+            dest_p = scratch + sizeof(struct darshan_base_record) +
+                (12 * sizeof(int64_t));
+            src_p = dest_p - (4 * sizeof(int64_t));
+            len = DARSHAN_POSIX_FILE_SIZE_4 - (src_p - scratch);
+            memmove(dest_p, src_p, len);
+            /* set MSYNCS and MMAP_BYTES* to -1 */
+            for(i = 0; i < 4; i++)
+                *((int64_t *)(src_p + (i * sizeof(int64_t)))) = -1;
+        }
         
         memcpy(file, scratch, sizeof(struct darshan_posix_file));
     }
@@ -259,7 +280,10 @@ static void darshan_log_print_posix_description(int ver)
 {
     printf("\n# description of POSIX counters:\n");
     printf("#   POSIX_*: posix operation counts.\n");
-    printf("#   READS,WRITES,OPENS,SEEKS,STATS,MMAPS,SYNCS,FILENOS,DUPS are types of operations.\n");
+    printf("#   READS,WRITES,OPENS,SEEKS,STATS,MMAPS,MSYNCS,SYNCS,FILENOS,DUPS are types of operations.\n");
+    printf("#   POSIX_MMAP_BYTES: total bytes of the file mapped into memory.\n");
+    printf("#   POSIX_MMAP_BYTES_READ: estimated bytes faulted into memory through mappings (not counting pages already cached when mapped).\n");
+    printf("#   POSIX_MMAP_BYTES_WRITTEN: upper bound on bytes dirtied through writable shared mappings.\n");
     printf("#   POSIX_RENAME_SOURCES/TARGETS: total count file was source or target of a rename operation\n");
     printf("#   POSIX_RENAMED_FROM: Darshan record ID of the first rename source, if file was a rename target\n");
     printf("#   POSIX_MODE: mode that file was opened in.\n");
@@ -310,6 +334,16 @@ static void darshan_log_print_posix_description(int ver)
         printf("# \t- POSIX_RENAMED_FROM\n");
     }
 
+    if(ver <= 4)
+    {
+        printf("\n# WARNING: POSIX module log format version <=4 has the following limitations:\n");
+        printf("# - No support for the following counters to instrument memory-mapped file I/O:\n");
+        printf("# \t- POSIX_MSYNCS\n");
+        printf("# \t- POSIX_MMAP_BYTES\n");
+        printf("# \t- POSIX_MMAP_BYTES_READ\n");
+        printf("# \t- POSIX_MMAP_BYTES_WRITTEN\n");
+    }
+
     if(ver >= 4)
     {
         printf("\n# WARNING: POSIX_OPENS counter includes both POSIX_FILENOS and POSIX_DUPS counts\n");
@@ -452,6 +486,10 @@ static void darshan_log_agg_posix_files(void *rec, void *agg_rec, int init_flag)
             case POSIX_SEEKS:
             case POSIX_STATS:
             case POSIX_MMAPS:
+            case POSIX_MSYNCS:
+            case POSIX_MMAP_BYTES:
+            case POSIX_MMAP_BYTES_READ:
+            case POSIX_MMAP_BYTES_WRITTEN:
             case POSIX_FSYNCS:
             case POSIX_FDSYNCS:
             case POSIX_RENAME_SOURCES:
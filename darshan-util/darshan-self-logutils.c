@@ -0,0 +1,313 @@
+/*
+ * Copyright (C) 2015 University of Chicago.
+ * See COPYRIGHT notice in top-level directory.
+ *
+ */
+
+#define _GNU_SOURCE
+#include "darshan-util-config.h"
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <inttypes.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <errno.h>
+
+#include "darshan-logutils.h"
+
+/* integer counter name strings for the SELF module */
+#define X(a) #a,
+char *self_counter_names[] = {
+    SELF_COUNTERS
+};
+
+/* floating point counter name strings for the SELF module */
+char *self_f_counter_names[] = {
+    SELF_F_COUNTERS
+};
+#undef X
+
+/* prototypes for each of the SELF module's logutil functions */
+static int darshan_log_get_self_record(darshan_fd fd, void** self_buf_p);
+static int darshan_log_put_self_record(darshan_fd fd, void* self_buf);
+static void darshan_log_print_self_record(void *file_rec,
+    char *file_name, char *mnt_pt, char *fs_type);
+static void darshan_log_print_self_description(int ver);
+static void darshan_log_print_self_record_diff(void *file_rec1, char *file_name1,
+    void *file_rec2, char *file_name2);
+static void darshan_log_agg_self_records(void *rec, void *agg_rec, int init_flag);
+
+/* structure storing each function needed for implementing the darshan
+ * logutil interface. these functions are used for reading, writing, and
+ * printing module data in a consistent manner.
+ */
+struct darshan_mod_logutil_funcs self_logutils =
+{
+    .log_get_record = &darshan_log_get_self_record,
+    .log_put_record = &darshan_log_put_self_record,
+    .log_print_record = &darshan_log_print_self_record,
+    .log_print_description = &darshan_log_print_self_description,
+    .log_print_diff = &darshan_log_print_self_record_diff,
+    .log_agg_records = &darshan_log_agg_self_records
+};
+
+/* retrieve a SELF record from log file descriptor 'fd', storing the
+ * data in the buffer address pointed to by 'self_buf_p'. Return 1 on
+ * successful record read, 0 on no more data, and -1 on error.
+ */
+static int darshan_log_get_self_record(darshan_fd fd, void** self_buf_p)
+{
+    struct darshan_self_record *rec = *((struct darshan_self_record **)self_buf_p);
+    int i;
+    int ret;
+
+    if(fd->mod_map[DARSHAN_SELF_MOD].len == 0)
+        return(0);
+
+    if(*self_buf_p == NULL)
+    {
+        rec = malloc(sizeof(*rec));
+        if(!rec)
+            return(-1);
+    }
+
+    /* read a SELF module record from the darshan log file */
+    ret = darshan_log_get_mod(fd, DARSHAN_SELF_MOD, rec,
+        sizeof(struct darshan_self_record));
+
+    if(*self_buf_p == NULL)
+    {
+        if(ret == sizeof(struct darshan_self_record))
+            *self_buf_p = rec;
+        else
+            free(rec);
+    }
+
+    if(ret < 0)
+        return(-1);
+    else if(ret < sizeof(struct darshan_self_record))
+        return(0);
+    else
+    {
+        /* if the read was successful, do any necessary byte-swapping */
+        if(fd->swap_flag)
+        {
+            DARSHAN_BSWAP64(&(rec->base_rec.id));
+            DARSHAN_BSWAP64(&(rec->base_rec.rank));
+            for(i=0; i<SELF_NUM_INDICES; i++)
+                DARSHAN_BSWAP64(&rec->counters[i]);
+            for(i=0; i<SELF_F_NUM_INDICES; i++)
+                DARSHAN_BSWAP64(&rec->fcounters[i]);
+        }
+
+        return(1);
+    }
+}
+
+/* write the SELF record stored in 'self_buf' to log file descriptor 'fd'.
+ * Return 0 on success, -1 on failure
+ */
+static int darshan_log_put_self_record(darshan_fd fd, void* self_buf)
+{
+    struct darshan_self_record *rec = (struct darshan_self_record *)self_buf;
+    int ret;
+
+    /* append SELF record to darshan log file */
+    ret = darshan_log_put_mod(fd, DARSHAN_SELF_MOD, rec,
+        sizeof(struct darshan_self_record), DARSHAN_SELF_VER);
+    if(ret < 0)
+        return(-1);
+
+    return(0);
+}
+
+/* print all I/O data record statistics for the given SELF record */
+static void darshan_log_print_self_record(void *file_rec, char *file_name,
+    char *mnt_pt, char *fs_type)
+{
+    int i;
+    struct darshan_self_record *self_rec =
+        (struct darshan_self_record *)file_rec;
+
+    /* print each of the integer and floating point counters for the SELF module */
+    for(i=0; i<SELF_NUM_INDICES; i++)
+    {
+        /* macro defined in darshan-logutils.h */
+        DARSHAN_D_COUNTER_PRINT(darshan_module_names[DARSHAN_SELF_MOD],
+            self_rec->base_rec.rank, self_rec->base_rec.id,
+            self_counter_names[i], self_rec->counters[i],
+            file_name, mnt_pt, fs_type);
+    }
+
+    for(i=0; i<SELF_F_NUM_INDICES; i++)
+    {
+        /* macro defined in darshan-logutils.h */
+        DARSHAN_F_COUNTER_PRINT(darshan_module_names[DARSHAN_SELF_MOD],
+            self_rec->base_rec.rank, self_rec->base_rec.id,
+            self_f_counter_names[i], self_rec->fcounters[i],
+            file_name, mnt_pt, fs_type);
+    }
+
+    return;
+}
+
+/* print out a description of the SELF module record fields */
+static void darshan_log_print_self_description(int ver)
+{
+    printf("\n# description of SELF counters:\n");
+    printf("#   SELF records describe the overhead Darshan itself added while instrumenting\n");
+    printf("#   the calls of the module in their name (darshan-self:<module>); the record\n");
+    printf("#   named darshan-core describes darshan-core itself.\n");
+    printf("#   SELF_CALLS: number of intercepted calls instrumented by the module.\n");
+    printf("#   SELF_HASH_LOOKUPS: number of record hash table lookups made instrumenting calls.\n");
+    printf("#   SELF_LOCKS: number of times the module lock was acquired.\n");
+    printf("#   SELF_LOCK_WAITS: number of lock acquisitions that waited on another thread.\n");
+    printf("#   SELF_RECORDS: number of records registered by the module.\n");
+    printf("#   SELF_RECORDS_DROPPED: number of records dropped because the module was out of memory.\n");
+    printf("#   SELF_MEM_MAX, SELF_MEM_LIMIT: high water mark and limit of the module's record\n");
+    printf("#       memory, in bytes (for darshan-core, of all modules' records and DARSHAN_MODMEM).\n");
+    printf("#   SELF_F_BOOKKEEPING_TIME: time spent in Darshan bookkeeping for intercepted calls.\n");
+    printf("#   SELF_F_REAL_TIME: time spent in the underlying (real) calls.\n");
+    printf("#   SELF_F_LOCK_WAIT_TIME: time spent waiting to acquire the module lock.\n");
+
+    return;
+}
+
+/* print a diff of two SELF records (with the same record id) */
+static void darshan_log_print_self_record_diff(void *file_rec1, char *file_name1,
+    void *file_rec2, char *file_name2)
+{
+    struct darshan_self_record *file1 = (struct darshan_self_record *)file_rec1;
+    struct darshan_self_record *file2 = (struct darshan_self_record *)file_rec2;
+    int i;
+
+    /* NOTE: we assume that both input records are the same module format version */
+
+    for(i=0; i<SELF_NUM_INDICES; i++)
+    {
+        if(!file2)
+        {
+            printf("- ");
+            DARSHAN_D_COUNTER_PRINT(darshan_module_names[DARSHAN_SELF_MOD],
+                file1->base_rec.rank, file1->base_rec.id, self_counter_names[i],
+                file1->counters[i], file_name1, "", "");
+
+        }
+        else if(!file1)
+        {
+            printf("+ ");
+            DARSHAN_D_COUNTER_PRINT(darshan_module_names[DARSHAN_SELF_MOD],
+                file2->base_rec.rank, file2->base_rec.id, self_counter_names[i],
+                file2->counters[i], file_name2, "", "");
+        }
+        else if(file1->counters[i] != file2->counters[i])
+        {
+            printf("- ");
+            DARSHAN_D_COUNTER_PRINT(darshan_module_names[DARSHAN_SELF_MOD],
+                file1->base_rec.rank, file1->base_rec.id, self_counter_names[i],
+                file1->counters[i], file_name1, "", "");
+            printf("+ ");
+            DARSHAN_D_COUNTER_PRINT(darshan_module_names[DARSHAN_SELF_MOD],
+                file2->base_rec.rank, file2->base_rec.id, self_counter_names[i],
+                file2->counters[i], file_name2, "", "");
+        }
+    }
+
+    for(i=0; i<SELF_F_NUM_INDICES; i++)
+    {
+        if(!file2)
+        {
+            printf("- ");
+            DARSHAN_F_COUNTER_PRINT(darshan_module_names[DARSHAN_SELF_MOD],
+                file1->base_rec.rank, file1->base_rec.id, self_f_counter_names[i],
+                file1->fcounters[i], file_name1, "", "");
+
+        }
+        else if(!file1)
+        {
+            printf("+ ");
+            DARSHAN_F_COUNTER_PRINT(darshan_module_names[DARSHAN_SELF_MOD],
+                file2->base_rec.rank, file2->base_rec.id, self_f_counter_names[i],
+                file2->fcounters[i], file_name2, "", "");
+        }
+        else if(file1->fcounters[i] != file2->fcounters[i])
+        {
+            printf("- ");
+            DARSHAN_F_COUNTER_PRINT(darshan_module_names[DARSHAN_SELF_MOD],
+                file1->base_rec.rank, file1->base_rec.id, self_f_counter_names[i],
+                file1->fcounters[i], file_name1, "", "");
+            printf("+ ");
+            DARSHAN_F_COUNTER_PRINT(darshan_module_names[DARSHAN_SELF_MOD],
+                file2->base_rec.rank, file2->base_rec.id, self_f_counter_names[i],
+                file2->fcounters[i], file_name2, "", "");
+        }
+    }
+
+    return;
+}
+
+/* aggregate the input SELF record 'rec'  into the output record 'agg_rec' */
+static void darshan_log_agg_self_records(void *rec, void *agg_rec, int init_flag)
+{
+    struct darshan_self_record *self_rec = (struct darshan_self_record *)rec;
+    struct darshan_self_record *agg_self_rec = (struct darshan_self_record *)agg_rec;
+    int i;
+
+    for(i = 0; i < SELF_NUM_INDICES; i++)
+    {
+        switch(i)
+        {
+            case SELF_CALLS:
+            case SELF_HASH_LOOKUPS:
+            case SELF_LOCKS:
+            case SELF_LOCK_WAITS:
+            case SELF_RECORDS:
+            case SELF_RECORDS_DROPPED:
+                /* sum */
+                agg_self_rec->counters[i] += self_rec->counters[i];
+                break;
+            case SELF_MEM_MAX:
+            case SELF_MEM_LIMIT:
+                /* max */
+                if(self_rec->counters[i] > agg_self_rec->counters[i])
+                    agg_self_rec->counters[i] = self_rec->counters[i];
+                break;
+            default:
+                /* if we don't know how to aggregate this counter, just set to -1 */
+                agg_self_rec->counters[i] = -1;
+                break;
+        }
+    }
+
+    for(i = 0; i < SELF_F_NUM_INDICES; i++)
+    {
+        switch(i)
+        {
+            case SELF_F_BOOKKEEPING_TIME:
+            case SELF_F_REAL_TIME:
+            case SELF_F_LOCK_WAIT_TIME:
+                /* sum */
+                agg_self_rec->fcounters[i] += self_rec->fcounters[i];
+                break;
+            default:
+                /* if we don't know how to aggregate this counter, just set to -1 */
+                agg_self_rec->fcounters[i] = -1;
+                break;
+        }
+    }
+
+    return;
+}
+
+/*
+ * Local variables:
+ *  c-indent-level: 4
+ *  c-basic-offset: 4
+ * End:
+ *
+ * vim: ts=8 sts=4 sw=4 expandtab
+ */
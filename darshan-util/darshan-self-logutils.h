@@ -0,0 +1,18 @@
+/*
+ * Copyright (C) 2015 University of Chicago.
+ * See COPYRIGHT notice in top-level directory.
+ *
+ */
+
+#ifndef __DARSHAN_SELF_LOG_UTILS_H
+#define __DARSHAN_SELF_LOG_UTILS_H
+
+/* declare SELF module counter name strings and logutil definition as
+ * extern variables so they can be used in other utilities
+ */
+extern char *self_counter_names[];
+extern char *self_f_counter_names[];
+
+extern struct darshan_mod_logutil_funcs self_logutils;
+
+#endif
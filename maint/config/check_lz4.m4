@@ -0,0 +1,89 @@
+dnl @synopsis CHECK_LZ4()
+dnl
+dnl This macro searches for an installed lz4 library. If nothing was
+dnl specified when calling configure, it searches first in /usr/local
+dnl and then in /usr. If the --with-lz4=DIR is specified, it will try
+dnl to find it in DIR/include/lz4frame.h and DIR/lib/liblz4.a. If
+dnl --without-lz4 is specified, the library is not searched at all.
+dnl
+dnl If either the header file (lz4frame.h) or the library (liblz4) is not
+dnl found, a warning is printed and lz4 support is disabled.
+dnl
+dnl The macro defines the symbol HAVE_LIBLZ4 if the library is found. You
+dnl should use autoheader to include a definition for this symbol in a
+dnl config.h file. Sample usage in a C/C++ source is as follows:
+dnl
+dnl   #ifdef HAVE_LIBLZ4
+dnl   #include <lz4frame.h>
+dnl   #endif /* HAVE_LIBLZ4 */
+dnl
+dnl Adapted from CHECK_BZLIB by Loic Dachary <loic@senga.org>
+dnl @category InstalledPackages
+dnl @license GPLWithACException
+
+AC_DEFUN([CHECK_LZ4],
+#
+# Handle user hints
+#
+[AC_MSG_CHECKING(if lz4 is wanted)
+AC_ARG_WITH(lz4,
+[  --with-lz4=DIR root directory path of lz4 installation [defaults to
+                    /usr/local or /usr if not found in /usr/local]
+  --without-lz4 to disable lz4 usage completely],
+[if test "$withval" != no ; then
+  if test -d "$withval"
+  then
+    LZ4_HOME="$withval"
+  else
+    LZ4_HOME=/usr/local
+    AC_MSG_WARN([Sorry, $withval does not exist, checking usual places])
+  fi
+else
+  DISABLE_LZ4=1
+  AC_MSG_RESULT(no)
+fi])
+
+#
+# Locate lz4, if wanted
+#
+if test -z "${DISABLE_LZ4}" 
+then
+        if test ! -f "${LZ4_HOME}/include/lz4frame.h"
+        then
+            LZ4_HOME=/usr
+        fi
+
+        AC_MSG_RESULT(yes)
+        LZ4_OLD_LDFLAGS=$LDFLAGS
+        LZ4_OLD_CPPFLAGS=$CPPFLAGS
+        LDFLAGS="$LDFLAGS -L${LZ4_HOME}/lib"
+        CPPFLAGS="$CPPFLAGS -I${LZ4_HOME}/include"
+        AC_LANG_SAVE
+        AC_LANG_C
+        AC_CHECK_LIB(lz4, LZ4F_compressBegin, [lz4_cv_liblz4=yes], [lz4_cv_liblz4=no])
+        AC_CHECK_HEADER(lz4frame.h, [lz4_cv_lz4frame_h=yes], [lz4_cv_lz4frame_h=no])
+        AC_LANG_RESTORE
+        if test "$lz4_cv_liblz4" = "yes" -a "$lz4_cv_lz4frame_h" = "yes"
+        then
+                #
+                # If both library and header were found, use them
+                #
+                AC_CHECK_LIB(lz4, LZ4F_compressBegin)
+                AC_MSG_CHECKING(lz4 in ${LZ4_HOME})
+                AC_MSG_RESULT(ok)
+                LIBLZ4=-llz4
+                AC_SUBST(LIBLZ4)
+        else
+                #
+                # If either header or library was not found, revert and bomb
+                #
+                AC_MSG_CHECKING(lz4 in ${LZ4_HOME})
+                LDFLAGS="$LZ4_OLD_LDFLAGS"
+                CPPFLAGS="$LZ4_OLD_CPPFLAGS"
+                AC_MSG_RESULT(failed)
+# Don't fail; this is optional in Darshan
+                AC_MSG_WARN(liblz4 not found; Darshan will not support lz4 log compression.)
+        fi
+fi
+
+])